@@ -0,0 +1,293 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * This program counts the heap allocations performed while running the
+ * scenarios of parallel-reception-example and complete-network-example, to
+ * track the memory churn of the reception path. Global operator new is
+ * replaced to count the allocations and the allocated bytes, which are only
+ * accounted for while the simulator runs, and are printed in total and per
+ * transmission.
+ *
+ * ./waf --run "allocation-benchmark --scenario=complete-network --nDevices=1000"
+ */
+
+#include "ns3/lora-helper.h"
+#include "ns3/end-device-lorawan-mac.h"
+#include "ns3/network-server-helper.h"
+#include "ns3/forwarder-helper.h"
+#include "ns3/one-shot-sender-helper.h"
+#include "ns3/periodic-sender-helper.h"
+#include "ns3/lora-device-address-generator.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/position-allocator.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/simulator.h"
+#include "ns3/command-line.h"
+#include "ns3/double.h"
+#include "ns3/abort.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+using namespace ns3;
+using namespace lorawan;
+
+// Allocation counters, only updated while counting is enabled
+bool counting = false;
+uint64_t nAllocations = 0;
+uint64_t allocatedBytes = 0;
+
+void *
+operator new (std::size_t size)
+{
+  if (counting)
+    {
+      nAllocations++;
+      allocatedBytes += size;
+    }
+  void *pointer = std::malloc (size == 0 ? 1 : size);
+  if (pointer == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return pointer;
+}
+
+void *
+operator new[] (std::size_t size)
+{
+  return operator new (size);
+}
+
+void
+operator delete (void *pointer) noexcept
+{
+  std::free (pointer);
+}
+
+void
+operator delete[] (void *pointer) noexcept
+{
+  std::free (pointer);
+}
+
+void
+operator delete (void *pointer, std::size_t size) noexcept
+{
+  std::free (pointer);
+}
+
+void
+operator delete[] (void *pointer, std::size_t size) noexcept
+{
+  std::free (pointer);
+}
+
+uint64_t nTransmissions = 0;
+
+void
+OnStartSending (Ptr<const Packet> packet, uint32_t nodeId)
+{
+  nTransmissions++;
+}
+
+// Count the transmissions of all the PHYs of some nodes
+void
+CountTransmissions (NodeContainer nodes)
+{
+  for (NodeContainer::Iterator it = nodes.Begin (); it != nodes.End (); ++it)
+    {
+      (*it)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetPhy ()->TraceConnectWithoutContext
+        ("StartSending", MakeCallback (&OnStartSending));
+    }
+}
+
+Ptr<LoraChannel>
+CreateChannel (void)
+{
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  return CreateObject<LoraChannel> (loss, delay);
+}
+
+// The scenario of parallel-reception-example: six end devices send one
+// packet each at the same time, with different data rates, to a gateway
+Time
+SetUpParallelReception (void)
+{
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (0, 0, 0));
+  mobility.SetPositionAllocator (allocator);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+  LoraHelper helper = LoraHelper ();
+
+  NodeContainer endDevices;
+  endDevices.Create (6);
+  mobility.Install (endDevices);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_A);
+  macHelper.SetRegion (LorawanMacHelper::SingleChannel);
+  helper.Install (phyHelper, macHelper, endDevices);
+
+  NodeContainer gateways;
+  gateways.Create (1);
+  mobility.Install (gateways);
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  OneShotSenderHelper oneShotSenderHelper;
+  oneShotSenderHelper.SetSendTime (Seconds (1));
+  oneShotSenderHelper.Install (endDevices);
+
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      endDevices.Get (i)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac ()->
+        GetObject<EndDeviceLorawanMac> ()->SetDataRate (5 - i);
+    }
+
+  CountTransmissions (endDevices);
+  CountTransmissions (gateways);
+
+  return Hours (2);
+}
+
+// The scenario of complete-network-example, without buildings: end devices
+// uniformly placed in a disc periodically send packets to a gateway at its
+// center, which forwards them to a network server
+Time
+SetUpCompleteNetwork (uint32_t nDevices, double radius, double simulationTime)
+{
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator", "rho", DoubleValue (radius),
+                                 "X", DoubleValue (0.0), "Y", DoubleValue (0.0));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+  LoraHelper helper = LoraHelper ();
+
+  NodeContainer endDevices;
+  endDevices.Create (nDevices);
+  mobility.Install (endDevices);
+
+  Ptr<LoraDeviceAddressGenerator> addrGen = CreateObject<LoraDeviceAddressGenerator> (54, 1864);
+  macHelper.SetAddressGenerator (addrGen);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_A);
+  helper.Install (phyHelper, macHelper, endDevices);
+
+  NodeContainer gateways;
+  gateways.Create (1);
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (0.0, 0.0, 15.0));
+  mobility.SetPositionAllocator (allocator);
+  mobility.Install (gateways);
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel);
+
+  PeriodicSenderHelper appHelper = PeriodicSenderHelper ();
+  appHelper.SetPeriod (Seconds (600));
+  appHelper.SetPacketSize (23);
+  ApplicationContainer appContainer = appHelper.Install (endDevices);
+  appContainer.Start (Seconds (0));
+  appContainer.Stop (Seconds (simulationTime));
+
+  NodeContainer networkServer;
+  networkServer.Create (1);
+  NetworkServerHelper nsHelper = NetworkServerHelper ();
+  nsHelper.SetEndDevices (endDevices);
+  nsHelper.SetGateways (gateways);
+  nsHelper.Install (networkServer);
+
+  ForwarderHelper forHelper = ForwarderHelper ();
+  forHelper.Install (gateways);
+
+  CountTransmissions (endDevices);
+  CountTransmissions (gateways);
+
+  return Seconds (simulationTime) + Hours (1);
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string scenario = "complete-network";
+  uint32_t nDevices = 200;
+  double radius = 6400;
+  double simulationTime = 600;
+
+  CommandLine cmd;
+  cmd.AddValue ("scenario", "The scenario to run: parallel-reception or complete-network",
+                scenario);
+  cmd.AddValue ("nDevices", "Number of end devices of the complete-network scenario", nDevices);
+  cmd.AddValue ("radius", "Radius of the complete-network scenario (m)", radius);
+  cmd.AddValue ("simulationTime", "Duration of the complete-network scenario (s)",
+                simulationTime);
+  cmd.Parse (argc, argv);
+
+  Time stopTime;
+  if (scenario == "parallel-reception")
+    {
+      stopTime = SetUpParallelReception ();
+    }
+  else if (scenario == "complete-network")
+    {
+      stopTime = SetUpCompleteNetwork (nDevices, radius, simulationTime);
+    }
+  else
+    {
+      NS_ABORT_MSG ("Unknown scenario " << scenario);
+    }
+
+  Simulator::Stop (stopTime);
+
+  counting = true;
+  Simulator::Run ();
+  counting = false;
+
+  Simulator::Destroy ();
+
+  std::cout << "Scenario: " << scenario << std::endl;
+  std::cout << "Transmissions: " << nTransmissions << std::endl;
+  std::cout << "Allocations: " << nAllocations << " (" << allocatedBytes << " bytes)"
+            << std::endl;
+  if (nTransmissions > 0)
+    {
+      std::cout << "Allocations per transmission: "
+                << double (nAllocations) / nTransmissions << " ("
+                << double (allocatedBytes) / nTransmissions << " bytes)" << std::endl;
+    }
+
+  return 0;
+}
@@ -0,0 +1,231 @@
+/*
+ * This script compares the two downlink modes of the BrokerServer. A set of
+ * Class C end devices subscribe to a topic, and another device periodically
+ * publishes to it. In unicast mode, each publish is sent to each subscriber
+ * with a separate downlink, while in multicast mode the topic is mapped to a
+ * multicast group, and each gateway sends a single downlink to the group.
+ * The metric of interest is the number of delivered messages per second of
+ * gateway airtime, which is what the gateways' duty cycle limits.
+ *
+ * Each invocation runs a single mode, so that both modes see the same
+ * devices, positions and subscription times when run with the same RngRun:
+ *   ./waf --run "broker-multicast-example --mode=unicast"
+ *   ./waf --run "broker-multicast-example --mode=multicast"
+ */
+
+#include "ns3/broker.h"
+#include "ns3/broker-helper.h"
+#include "ns3/class-c-end-device-lorawan-mac.h"
+#include "ns3/gateway-lorawan-mac.h"
+#include "ns3/lora-helper.h"
+#include "ns3/lora-phy.h"
+#include "ns3/lora-tag.h"
+#include "ns3/lora-device-address-generator.h"
+#include "ns3/one-shot-sender-helper.h"
+#include "ns3/forwarder-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/position-allocator.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
+#include "ns3/command-line.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/integer.h"
+#include "ns3/string.h"
+#include "ns3/log.h"
+#include <cmath>
+#include <iomanip>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("BrokerMulticastExample");
+
+// Network settings
+int nDevices = 50;
+int nGateways = 3;
+double radius = 3000;
+int nPublishes = 5;
+double subscribePeriod = 600;
+double publishInterval = 900;
+double pubDelay = 10;
+std::string topic = "alerts";
+std::string mode = "multicast";
+
+// Results of a run
+struct Results
+{
+  int downlinks;
+  double airtime;
+  int delivered;
+};
+
+Results results;
+
+void
+OnGatewaySentPacket (Ptr<Packet const> packet)
+{
+  LoraTag tag;
+  packet->PeekPacketTag (tag);
+
+  // Use the same parameters as GatewayLorawanMac::Send
+  LoraTxParameters params;
+  params.sf = 12 - tag.GetDataRate ();
+  params.headerDisabled = false;
+  params.codingRate = 1;
+  params.bandwidthHz = 125000;
+  params.nPreamble = 8;
+  params.crcEnabled = 1;
+  params.lowDataRateOptimizationEnabled = LoraPhy::GetTSym (params) > MilliSeconds (16);
+
+  results.downlinks++;
+  results.airtime += LoraPhy::GetOnAirTime (packet->Copy (), params).GetSeconds ();
+}
+
+void
+OnDeviceReceivedPacket (Ptr<Packet const> packet)
+{
+  results.delivered++;
+}
+
+Results
+RunScenario (enum BrokerServer::DownlinkMode mode)
+{
+  results.downlinks = 0;
+  results.airtime = 0;
+  results.delivered = 0;
+
+  // Channel
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
+
+  // Helpers
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+  LoraHelper helper = LoraHelper ();
+
+  // End devices, uniformly placed in a disc
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator", "rho", DoubleValue (radius),
+                                 "X", DoubleValue (0.0), "Y", DoubleValue (0.0));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  NodeContainer endDevices;
+  endDevices.Create (nDevices);
+  mobility.Install (endDevices);
+
+  Ptr<LoraDeviceAddressGenerator> addrGen = CreateObject<LoraDeviceAddressGenerator> (54, 1864);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_C);
+  macHelper.SetAddressGenerator (addrGen);
+  macHelper.SetRegion (LorawanMacHelper::EU);
+  helper.Install (phyHelper, macHelper, endDevices);
+
+  // Gateways, on a circle around the center
+  Ptr<ListPositionAllocator> gwPositions = CreateObject<ListPositionAllocator> ();
+  for (int i = 0; i < nGateways; i++)
+    {
+      double angle = 2 * M_PI * i / nGateways;
+      double distance = (nGateways == 1) ? 0 : radius / 2;
+      gwPositions->Add (Vector (distance * std::cos (angle), distance * std::sin (angle), 15.0));
+    }
+  mobility.SetPositionAllocator (gwPositions);
+
+  NodeContainer gateways;
+  gateways.Create (nGateways);
+  mobility.Install (gateways);
+
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel);
+
+  // Broker
+  NodeContainer brokers;
+  brokers.Create (1);
+  BrokerServerHelper brokerHelper;
+  brokerHelper.SetAttribute ("DownlinkMode", EnumValue (mode));
+  brokerHelper.SetAttribute ("pubDelay", DoubleValue (pubDelay));
+  brokerHelper.SetGateways (gateways);
+  brokerHelper.SetEndDevices (endDevices);
+  Ptr<BrokerServer> broker = DynamicCast<BrokerServer> (brokerHelper.Install (brokers).Get (0));
+  broker->SetMulticastGroup (topic, LoraDeviceAddress (0x7E, 1));
+
+  ForwarderHelper forwarderHelper;
+  forwarderHelper.Install (gateways);
+
+  // The first device publishes, all the others subscribe
+  Ptr<UniformRandomVariable> subscribeTime = CreateObject<UniformRandomVariable> ();
+  subscribeTime->SetAttribute ("Min", DoubleValue (1));
+  subscribeTime->SetAttribute ("Max", DoubleValue (subscribePeriod));
+
+  OneShotSenderHelper senderHelper;
+  senderHelper.SetAttribute ("Topic", StringValue (topic));
+  senderHelper.SetAttribute ("Option", IntegerValue (0));
+  for (int i = 1; i < nDevices; i++)
+    {
+      senderHelper.SetSendTime (Seconds (subscribeTime->GetValue ()));
+      senderHelper.Install (endDevices.Get (i));
+
+      endDevices.Get (i)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac ()->
+        TraceConnectWithoutContext ("ReceivedPacket", MakeCallback (&OnDeviceReceivedPacket));
+    }
+
+  senderHelper.SetAttribute ("Option", IntegerValue (1));
+  senderHelper.SetAttribute ("Payload", StringValue ("message"));
+  for (int k = 0; k < nPublishes; k++)
+    {
+      senderHelper.SetSendTime (Seconds (subscribePeriod + 60 + k * publishInterval));
+      senderHelper.Install (endDevices.Get (0));
+    }
+
+  for (NodeContainer::Iterator it = gateways.Begin (); it != gateways.End (); ++it)
+    {
+      (*it)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac ()->
+        TraceConnectWithoutContext ("SentNewPacket", MakeCallback (&OnGatewaySentPacket));
+    }
+
+  Simulator::Stop (Seconds (subscribePeriod + 60 + nPublishes * publishInterval));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  return results;
+}
+
+int
+main (int argc, char *argv[])
+{
+  CommandLine cmd;
+  cmd.AddValue ("nDevices", "Number of end devices to include in the simulation", nDevices);
+  cmd.AddValue ("nGateways", "Number of gateways to include in the simulation", nGateways);
+  cmd.AddValue ("radius", "The radius of the area to simulate", radius);
+  cmd.AddValue ("nPublishes", "Number of messages published to the topic", nPublishes);
+  cmd.AddValue ("publishInterval", "Time between publishes (s)", publishInterval);
+  cmd.AddValue ("pubDelay", "Delay between unicast downlinks through a gateway (s)", pubDelay);
+  cmd.AddValue ("mode", "The downlink mode of the broker: unicast or multicast", mode);
+  cmd.Parse (argc, argv);
+
+  if (mode != "unicast" && mode != "multicast")
+    {
+      NS_FATAL_ERROR ("Unknown mode " << mode << ": use unicast or multicast");
+    }
+
+  Results run =
+      RunScenario (mode == "unicast" ? BrokerServer::UNICAST : BrokerServer::MULTICAST);
+
+  int expected = (nDevices - 1) * nPublishes;
+
+  std::cout << "mode downlinks airtime(s) delivered/expected delivered-per-airtime-second"
+            << std::endl;
+  std::cout << std::fixed << std::setprecision (3);
+  std::cout << mode << " " << run.downlinks << " " << run.airtime << " "
+            << run.delivered << "/" << expected << " "
+            << (run.airtime > 0 ? run.delivered / run.airtime : 0) << std::endl;
+
+  return 0;
+}
@@ -43,6 +43,9 @@ double simulationTime = 600;
 // Channel model
 bool realisticChannelModel = false;
 
+// Whether to only deliver transmissions to receivers that can hear them
+bool cullReceivers = false;
+
 int appPeriodSeconds = 600;
 
 // Output control
@@ -60,6 +63,8 @@ main (int argc, char *argv[])
                 "The period in seconds to be used by periodically transmitting applications",
                 appPeriodSeconds);
   cmd.AddValue ("print", "Whether or not to print various informations", print);
+  cmd.AddValue ("cullReceivers",
+                "Whether the channel should skip receivers that are out of range", cullReceivers);
   cmd.Parse (argc, argv);
 
   // Set up logging
@@ -128,6 +133,18 @@ main (int argc, char *argv[])
 
   Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
 
+  if (cullReceivers)
+    {
+      // Compute the culling distance from the deterministic part of the loss,
+      // leaving some room for shadowing if it's enabled
+      Ptr<LogDistancePropagationLossModel> pathLoss =
+          CreateObject<LogDistancePropagationLossModel> ();
+      pathLoss->SetPathLossExponent (3.76);
+      pathLoss->SetReference (1, 7.7);
+      double marginDb = realisticChannelModel ? 20 : 0;
+      channel->SetCullingDistance (LoraChannel::ComputeCullingDistance (pathLoss, 14, marginDb));
+    }
+
   /************************
    *  Create the helpers  *
    ************************/
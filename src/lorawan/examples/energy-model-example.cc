@@ -16,6 +16,7 @@
 #include "ns3/position-allocator.h"
 #include "ns3/periodic-sender-helper.h"
 #include "ns3/command-line.h"
+#include "ns3/boolean.h"
 #include "ns3/basic-energy-source-helper.h"
 #include "ns3/lora-radio-energy-model-helper.h"
 #include "ns3/file-helper.h"
@@ -30,6 +31,13 @@ NS_LOG_COMPONENT_DEFINE ("LoraEnergyModelExample");
 
 int main (int argc, char *argv[])
 {
+  bool lazyEnergyUpdates = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("lazyEnergyUpdates",
+                "Whether the radio energy models only update the energy sources when needed",
+                lazyEnergyUpdates);
+  cmd.Parse (argc, argv);
 
   // Set up logging
   LogComponentEnable ("LoraEnergyModelExample", LOG_LEVEL_ALL);
@@ -159,6 +167,7 @@ int main (int argc, char *argv[])
   radioEnergyHelper.Set ("TxCurrentA", DoubleValue (0.028));
   radioEnergyHelper.Set ("SleepCurrentA", DoubleValue (0.0000015));
   radioEnergyHelper.Set ("RxCurrentA", DoubleValue (0.0112));
+  radioEnergyHelper.Set ("LazyEnergyUpdates", BooleanValue (lazyEnergyUpdates));
 
   radioEnergyHelper.SetTxCurrentModel ("ns3::ConstantLoraTxCurrentModel",
                                        "TxCurrent", DoubleValue (0.028));
@@ -0,0 +1,246 @@
+/*
+ * This script runs a campaign of simulations over a grid of network
+ * parameters with LoraCampaignHelper, using all the cores of the machine.
+ * Each point of the grid is a network of Class A devices that periodically
+ * send uplinks to a BrokerServer, some of which subscribe to a topic that
+ * one device publishes to. The results of each replication, and their mean
+ * and standard deviation over the replications of each point, are printed
+ * as tables.
+ *
+ * Lists of values are given as comma separated strings, e.g.:
+ * ./waf --run "lora-campaign --nDevices=100,200,400 --adrEnabled=0,1 --replications=10"
+ */
+
+#include "ns3/lora-campaign-helper.h"
+#include "ns3/lora-helper.h"
+#include "ns3/broker-helper.h"
+#include "ns3/forwarder-helper.h"
+#include "ns3/periodic-sender-helper.h"
+#include "ns3/one-shot-sender-helper.h"
+#include "ns3/hex-grid-position-allocator.h"
+#include "ns3/lora-device-address-generator.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/position-allocator.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
+#include "ns3/command-line.h"
+#include "ns3/double.h"
+#include "ns3/integer.h"
+#include "ns3/string.h"
+#include "ns3/log.h"
+#include <fstream>
+#include <sstream>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraCampaign");
+
+// Settings shared by all the points of the grid
+double simulationTime = 3600;
+double appPeriod = 600;
+double publishInterval = 900;
+std::string topic = "campaign";
+
+int gatewayDownlinks;
+
+void
+OnGatewaySentPacket (Ptr<Packet const> packet)
+{
+  gatewayDownlinks++;
+}
+
+// Simulate a point of the grid, and return its metrics
+std::vector<double>
+RunScenario (const LoraCampaignHelper::Point &point)
+{
+  gatewayDownlinks = 0;
+
+  // Channel
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
+
+  // Helpers
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+  LoraHelper helper = LoraHelper ();
+  helper.EnablePacketTracking ();
+
+  // Gateways, on a hexagonal grid around the center
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (CreateObject<HexGridPositionAllocator> (point.radius / 2));
+
+  NodeContainer gateways;
+  gateways.Create (point.nGateways);
+  mobility.Install (gateways);
+
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  // End devices, uniformly placed in a disc
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator", "rho",
+                                 DoubleValue (point.radius), "X", DoubleValue (0.0),
+                                 "Y", DoubleValue (0.0));
+
+  NodeContainer endDevices;
+  endDevices.Create (point.nDevices);
+  mobility.Install (endDevices);
+
+  Ptr<LoraDeviceAddressGenerator> addrGen = CreateObject<LoraDeviceAddressGenerator> (54, 1864);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_A);
+  macHelper.SetAddressGenerator (addrGen);
+  macHelper.SetRegion (LorawanMacHelper::EU);
+  helper.Install (phyHelper, macHelper, endDevices);
+
+  macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel);
+
+  // Broker
+  NodeContainer brokers;
+  brokers.Create (1);
+  BrokerServerHelper brokerHelper;
+  brokerHelper.SetAttribute ("pubDelay", DoubleValue (point.brokerDelay));
+  brokerHelper.SetGateways (gateways);
+  brokerHelper.SetEndDevices (endDevices);
+  brokerHelper.EnableAdr (point.adrEnabled);
+  brokerHelper.Install (brokers);
+
+  ForwarderHelper forwarderHelper;
+  forwarderHelper.Install (gateways);
+
+  // Periodic uplinks from all devices
+  PeriodicSenderHelper periodicHelper;
+  periodicHelper.SetPeriod (Seconds (appPeriod));
+  ApplicationContainer apps = periodicHelper.Install (endDevices);
+  apps.Start (Seconds (0));
+  apps.Stop (Seconds (simulationTime));
+
+  // Half of the devices subscribe to a topic, and the first one publishes
+  Ptr<UniformRandomVariable> subscribeTime = CreateObject<UniformRandomVariable> ();
+  subscribeTime->SetAttribute ("Min", DoubleValue (1));
+  subscribeTime->SetAttribute ("Max", DoubleValue (appPeriod));
+
+  OneShotSenderHelper senderHelper;
+  senderHelper.SetAttribute ("Topic", StringValue (topic));
+  senderHelper.SetAttribute ("Option", IntegerValue (0));
+  for (uint32_t i = 1; i < endDevices.GetN (); i += 2)
+    {
+      senderHelper.SetSendTime (Seconds (subscribeTime->GetValue ()));
+      senderHelper.Install (endDevices.Get (i));
+    }
+
+  senderHelper.SetAttribute ("Option", IntegerValue (1));
+  senderHelper.SetAttribute ("Payload", StringValue ("message"));
+  for (double t = appPeriod + 60; t < simulationTime; t += publishInterval)
+    {
+      senderHelper.SetSendTime (Seconds (t));
+      senderHelper.Install (endDevices.Get (0));
+    }
+
+  for (NodeContainer::Iterator it = gateways.Begin (); it != gateways.End (); ++it)
+    {
+      (*it)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac ()->
+        TraceConnectWithoutContext ("SentNewPacket", MakeCallback (&OnGatewaySentPacket));
+    }
+
+  Simulator::Stop (Seconds (simulationTime));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // The tracker prints the number of sent and received packets
+  double sent = 0;
+  double received = 0;
+  std::istringstream counts (helper.GetPacketTracker ().CountMacPacketsGlobally
+                               (Seconds (0), Seconds (simulationTime)));
+  counts >> sent >> received;
+
+  std::vector<double> metrics;
+  metrics.push_back (sent);
+  metrics.push_back (received);
+  metrics.push_back (sent > 0 ? received / sent : 0);
+  metrics.push_back (gatewayDownlinks);
+  return metrics;
+}
+
+// Parse a comma separated list of values
+template <typename T>
+std::vector<T>
+ParseList (std::string list)
+{
+  std::vector<T> values;
+  std::istringstream stream (list);
+  std::string item;
+  while (std::getline (stream, item, ','))
+    {
+      std::istringstream itemStream (item);
+      double value;
+      itemStream >> value;
+      values.push_back (T (value));
+    }
+  return values;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string nDevices = "100,200";
+  std::string radius = "3000";
+  std::string nGateways = "1";
+  std::string adrEnabled = "0,1";
+  std::string brokerDelay = "10";
+  uint32_t replications = 5;
+  uint32_t maxProcesses = 0;
+  uint64_t firstRun = 1;
+  std::string outputFile = "";
+
+  CommandLine cmd;
+  cmd.AddValue ("nDevices", "Numbers of end devices", nDevices);
+  cmd.AddValue ("radius", "Radii of the area to simulate (m)", radius);
+  cmd.AddValue ("nGateways", "Numbers of gateways", nGateways);
+  cmd.AddValue ("adrEnabled", "Whether ADR is enabled (0 or 1)", adrEnabled);
+  cmd.AddValue ("brokerDelay", "Delays between downlinks of the broker (s)", brokerDelay);
+  cmd.AddValue ("replications", "Number of replications of each point", replications);
+  cmd.AddValue ("maxProcesses", "Replications to run at the same time, 0 for all cores",
+                maxProcesses);
+  cmd.AddValue ("firstRun", "RngRun of the first replication", firstRun);
+  cmd.AddValue ("simulationTime", "Duration of each replication (s)", simulationTime);
+  cmd.AddValue ("outputFile", "File to write the results of each replication to", outputFile);
+  cmd.Parse (argc, argv);
+
+  LoraCampaignHelper campaign;
+  std::vector<std::string> metricNames;
+  metricNames.push_back ("sent");
+  metricNames.push_back ("received");
+  metricNames.push_back ("pdr");
+  metricNames.push_back ("downlinks");
+  campaign.SetScenario (MakeCallback (&RunScenario), metricNames);
+  campaign.AddGrid (ParseList<uint32_t> (nDevices), ParseList<double> (radius),
+                    ParseList<uint32_t> (nGateways), ParseList<bool> (adrEnabled),
+                    ParseList<double> (brokerDelay));
+  campaign.SetReplications (replications);
+  campaign.SetMaxProcesses (maxProcesses);
+  campaign.SetFirstRun (firstRun);
+
+  std::cerr << "Running " << campaign.GetPoints ().size () * replications
+            << " replications" << std::endl;
+  uint32_t failed = campaign.Run ();
+  if (failed > 0)
+    {
+      std::cerr << failed << " replications failed" << std::endl;
+    }
+
+  if (!outputFile.empty ())
+    {
+      std::ofstream output (outputFile.c_str ());
+      campaign.PrintResults (output);
+    }
+  campaign.PrintSummary (std::cout);
+
+  return failed > 0 ? 1 : 0;
+}
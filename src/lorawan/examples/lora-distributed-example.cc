@@ -0,0 +1,236 @@
+/*
+ * This script simulates a network of gateways and end devices split between
+ * the two ranks of a distributed simulation, and checks that the gateways of
+ * each rank receive packets from the end devices of the other one.
+ *
+ * It needs ns-3 to be configured with --enable-mpi, and must be run with two
+ * processes:
+ *
+ *   mpiexec -np 2 ./waf --run lora-distributed-example
+ *
+ * Every rank builds the whole network, with the same nodes in the same
+ * positions, but only simulates the nodes of its own partition. The end
+ * devices and the gateways are assigned to partitions by the gateway cell
+ * they are in. The program fails if a rank receives no packet from the
+ * other partition.
+ */
+
+#include "ns3/end-device-lora-phy.h"
+#include "ns3/gateway-lora-phy.h"
+#include "ns3/end-device-lorawan-mac.h"
+#include "ns3/gateway-lorawan-mac.h"
+#include "ns3/lorawan-mac-header.h"
+#include "ns3/lora-frame-header.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/lora-helper.h"
+#include "ns3/lora-partition-helper.h"
+#include "ns3/lora-device-address-generator.h"
+#include "ns3/hex-grid-position-allocator.h"
+#include "ns3/periodic-sender-helper.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/simulator.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/command-line.h"
+#include <map>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraDistributedExample");
+
+// Network settings
+int nGateways = 7;
+int nDevices = 200;
+double cellRadius = 1000;
+double simulationTime = 600;
+double appPeriodSeconds = 60;
+
+// The partition of each end device, by address
+std::map<LoraDeviceAddress, uint32_t> devicePartitions;
+
+// Packets received by the gateways of this rank
+uint32_t localReceptions = 0;
+uint32_t remoteReceptions = 0;
+
+void
+OnGatewayReceivedPacket (Ptr<const Packet> packet, uint32_t gwId)
+{
+  Ptr<Packet> copy = packet->Copy ();
+  LorawanMacHeader mHdr;
+  copy->RemoveHeader (mHdr);
+  LoraFrameHeader fHdr;
+  fHdr.SetAsUplink ();
+  copy->RemoveHeader (fHdr);
+
+  std::map<LoraDeviceAddress, uint32_t>::const_iterator it =
+    devicePartitions.find (fHdr.GetAddress ());
+  NS_ASSERT (it != devicePartitions.end ());
+
+  if (it->second == MpiInterface::GetSystemId ())
+    {
+      localReceptions++;
+    }
+  else
+    {
+      remoteReceptions++;
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  CommandLine cmd;
+  cmd.AddValue ("nDevices", "Number of end devices to include in the simulation", nDevices);
+  cmd.AddValue ("cellRadius", "The radius of the gateway cells", cellRadius);
+  cmd.AddValue ("simulationTime", "The time for which to simulate", simulationTime);
+  cmd.AddValue ("appPeriod", "The period in seconds to be used by periodically transmitting applications",
+                appPeriodSeconds);
+  cmd.Parse (argc, argv);
+
+  // Set up logging
+  LogComponentEnable ("LoraDistributedExample", LOG_LEVEL_ALL);
+  // LogComponentEnable ("LoraChannel", LOG_LEVEL_INFO);
+
+  GlobalValue::Bind ("SimulatorImplementationType",
+                     StringValue ("ns3::DistributedSimulatorImpl"));
+  MpiInterface::Enable (&argc, &argv);
+
+  uint32_t systemId = MpiInterface::GetSystemId ();
+  if (MpiInterface::GetSize () != 2)
+    {
+      std::cerr << "This example must be run with 2 processes" << std::endl;
+      MpiInterface::Disable ();
+      return 1;
+    }
+
+  /************************
+   *  Create the channel  *
+   ************************/
+
+  // Receptions at the PHYs of the other partition are delayed by the remote
+  // delay, which must be at least the delay of the link between partitions
+  Time remoteDelay = MicroSeconds (10);
+
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+
+  Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
+  channel->SetAttribute ("RemoteDelay", TimeValue (remoteDelay));
+
+  /************************
+   *  Create the helpers  *
+   ************************/
+
+  LoraPartitionHelper partitionHelper;
+  partitionHelper.SetCellRadius (cellRadius);
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+
+  LoraHelper helper = LoraHelper ();
+
+  /************************
+   *  Create End Devices  *
+   ************************/
+
+  // Every rank draws the same positions, so that all of them agree on the
+  // partition of each node
+  Ptr<UniformDiscPositionAllocator> edAllocator = CreateObject<UniformDiscPositionAllocator> ();
+  edAllocator->SetAttribute ("rho", DoubleValue (2 * cellRadius));
+  NodeContainer endDevices = partitionHelper.Create (edAllocator, nDevices);
+
+  uint8_t nwkId = 54;
+  uint32_t nwkAddr = 1864;
+  Ptr<LoraDeviceAddressGenerator> addrGen =
+      CreateObject<LoraDeviceAddressGenerator> (nwkId, nwkAddr);
+
+  macHelper.SetAddressGenerator (addrGen);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_A);
+  helper.Install (phyHelper, macHelper, endDevices);
+
+  NodeContainer localEndDevices;
+  for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j)
+    {
+      Ptr<EndDeviceLorawanMac> mac = (*j)->GetDevice (0)->GetObject<LoraNetDevice> ()
+        ->GetMac ()->GetObject<EndDeviceLorawanMac> ();
+      devicePartitions[mac->GetDeviceAddress ()] = (*j)->GetSystemId ();
+      if ((*j)->GetSystemId () == systemId)
+        {
+          localEndDevices.Add (*j);
+        }
+    }
+
+  /*********************
+   *  Create Gateways  *
+   *********************/
+
+  Ptr<HexGridPositionAllocator> gwAllocator = CreateObject<HexGridPositionAllocator> (cellRadius);
+  NodeContainer gateways = partitionHelper.Create (gwAllocator, nGateways);
+
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  for (NodeContainer::Iterator j = gateways.Begin (); j != gateways.End (); ++j)
+    {
+      if ((*j)->GetSystemId () == systemId)
+        {
+          (*j)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetPhy ()
+            ->TraceConnectWithoutContext ("ReceivedPacket",
+                                          MakeCallback (&OnGatewayReceivedPacket));
+        }
+    }
+
+  macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel);
+
+  /**************************************
+   *  Connect the partitions' backbone  *
+   **************************************/
+
+  // The distributed simulator takes its lookahead from the point-to-point
+  // links between partitions
+  Ptr<Node> backbone0 = CreateObject<Node> (0);
+  Ptr<Node> backbone1 = CreateObject<Node> (1);
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  p2p.SetChannelAttribute ("Delay", TimeValue (remoteDelay));
+  p2p.Install (backbone0, backbone1);
+
+  /*********************************************
+   *  Install applications on the end devices  *
+   *********************************************/
+
+  PeriodicSenderHelper appHelper = PeriodicSenderHelper ();
+  appHelper.SetPeriod (Seconds (appPeriodSeconds));
+  ApplicationContainer appContainer = appHelper.Install (localEndDevices);
+  appContainer.Start (Seconds (0));
+  appContainer.Stop (Seconds (simulationTime));
+
+  /****************
+   *  Simulation  *
+   ****************/
+
+  Simulator::Stop (Seconds (simulationTime));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::cout << "Rank " << systemId << ": " << localEndDevices.GetN () << " end devices, "
+            << localReceptions << " packets received from the local partition, "
+            << remoteReceptions << " from the other one" << std::endl;
+
+  MpiInterface::Disable ();
+
+  // Every rank has gateways close to the border with the other partition,
+  // which must hear some of its end devices
+  return remoteReceptions > 0 ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+/*
+ * This program converts a binary trace written by LoraTraceSink (see
+ * LoraHelper::EnableBinaryTracing) to CSV, one line per event.
+ *
+ * Usage: ./waf --run "lora-trace-to-csv --input=trace.bin --output=trace.csv"
+ * If no output file is given, the CSV is written to the standard output.
+ */
+
+#include "ns3/lora-trace-sink.h"
+#include "ns3/command-line.h"
+#include <fstream>
+#include <iostream>
+
+using namespace ns3;
+using namespace lorawan;
+
+int
+main (int argc, char *argv[])
+{
+  std::string input = "";
+  std::string output = "";
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "The binary trace to convert", input);
+  cmd.AddValue ("output", "The CSV file to write, standard output if empty", output);
+  cmd.Parse (argc, argv);
+
+  LoraTraceReader reader (input);
+  if (!reader.IsValid ())
+    {
+      std::cerr << "Can't read a LoRa trace from '" << input << "'" << std::endl;
+      return 1;
+    }
+
+  uint64_t nRecords;
+  if (output.empty ())
+    {
+      nRecords = reader.ConvertToCsv (std::cout);
+    }
+  else
+    {
+      std::ofstream outputFile (output.c_str ());
+      nRecords = reader.ConvertToCsv (outputFile);
+    }
+
+  std::cerr << "Converted " << nRecords << " records" << std::endl;
+
+  return 0;
+}
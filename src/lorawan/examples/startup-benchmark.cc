@@ -0,0 +1,131 @@
+/*
+ * This program measures how long it takes to build a large LoRaWAN network
+ * before the first event of the simulation runs. It times the creation of
+ * the nodes and their mobility, the installation of the LoRa devices on
+ * gateways and end devices, with or without packet tracking and binary
+ * tracing, and the assignment of spreading factors, and prints the time
+ * taken by each phase and per end device.
+ *
+ * ./waf --run "startup-benchmark --nDevices=100000 --nGateways=50 --tracking=1"
+ */
+
+#include "ns3/lora-helper.h"
+#include "ns3/hex-grid-position-allocator.h"
+#include "ns3/lora-device-address-generator.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/position-allocator.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/simulator.h"
+#include "ns3/command-line.h"
+#include "ns3/double.h"
+#include <chrono>
+#include <iostream>
+
+using namespace ns3;
+using namespace lorawan;
+
+// Seconds elapsed since start
+double
+Elapsed (std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nDevices = 10000;
+  uint32_t nGateways = 10;
+  double radius = 6000;
+  bool tracking = true;
+  std::string traceFile = "";
+
+  CommandLine cmd;
+  cmd.AddValue ("nDevices", "Number of end devices", nDevices);
+  cmd.AddValue ("nGateways", "Number of gateways", nGateways);
+  cmd.AddValue ("radius", "Radius of the area the devices are placed in (m)", radius);
+  cmd.AddValue ("tracking", "Whether to enable packet tracking", tracking);
+  cmd.AddValue ("traceFile", "File to write a binary trace to, if any", traceFile);
+  cmd.Parse (argc, argv);
+
+  auto total = std::chrono::steady_clock::now ();
+
+  // Channel and helpers
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+  LoraHelper helper = LoraHelper ();
+  if (tracking)
+    {
+      helper.EnablePacketTracking ();
+    }
+  if (!traceFile.empty ())
+    {
+      helper.EnableBinaryTracing (traceFile);
+    }
+
+  // Nodes
+  auto start = std::chrono::steady_clock::now ();
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (CreateObject<HexGridPositionAllocator> (radius / 4));
+  NodeContainer gateways;
+  gateways.Create (nGateways);
+  mobility.Install (gateways);
+
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator", "rho",
+                                 DoubleValue (radius), "X", DoubleValue (0.0),
+                                 "Y", DoubleValue (0.0));
+  NodeContainer endDevices;
+  endDevices.Create (nDevices);
+  mobility.Install (endDevices);
+
+  double nodesTime = Elapsed (start);
+
+  // LoRa devices
+  start = std::chrono::steady_clock::now ();
+
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  double gatewaysTime = Elapsed (start);
+  start = std::chrono::steady_clock::now ();
+
+  Ptr<LoraDeviceAddressGenerator> addrGen = CreateObject<LoraDeviceAddressGenerator> (54, 1864);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_A);
+  macHelper.SetAddressGenerator (addrGen);
+  macHelper.SetRegion (LorawanMacHelper::EU);
+  helper.Install (phyHelper, macHelper, endDevices);
+
+  double endDevicesTime = Elapsed (start);
+
+  // Spreading factors
+  start = std::chrono::steady_clock::now ();
+
+  macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel);
+
+  double sfTime = Elapsed (start);
+  double totalTime = Elapsed (total);
+
+  std::cout << "Nodes and mobility: " << nodesTime << " s" << std::endl;
+  std::cout << "Gateway devices: " << gatewaysTime << " s" << std::endl;
+  std::cout << "End devices: " << endDevicesTime << " s, "
+            << endDevicesTime / nDevices * 1e6 << " us/device" << std::endl;
+  std::cout << "Spreading factors: " << sfTime << " s" << std::endl;
+  std::cout << "Total: " << totalTime << " s, "
+            << totalTime / nDevices * 1e6 << " us/device" << std::endl;
+
+  Simulator::Destroy ();
+
+  return 0;
+}
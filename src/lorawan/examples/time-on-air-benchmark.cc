@@ -0,0 +1,113 @@
+/*
+ * This program compares the two ways LoraPhy can compute the time on air of
+ * a packet: GetOnAirTime, which looks up the symbol time and counts payload
+ * symbols with integers, and GetOnAirTimeAnalytic, which evaluates the
+ * floating point formula of the SX1272 designer's guide. Both are run over
+ * all valid combinations of spreading factor, bandwidth, coding rate, CRC,
+ * header mode, low data rate optimization and payload size. The program
+ * checks that they always agree, and prints the time per call of each.
+ */
+
+#include "ns3/lora-phy.h"
+#include "ns3/command-line.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+using namespace lorawan;
+
+// Run a time on air function over all combinations, and return the sum of
+// the durations so that the compiler can't skip the calls
+int64_t
+RunAll (Time (*getOnAirTime)(uint32_t, LoraTxParameters),
+        const std::vector<LoraTxParameters> &combinations, uint32_t maxSize)
+{
+  int64_t sum = 0;
+  for (auto it = combinations.begin (); it != combinations.end (); ++it)
+    {
+      for (uint32_t size = 0; size <= maxSize; size++)
+        {
+          sum += getOnAirTime (size, *it).GetTimeStep ();
+        }
+    }
+  return sum;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int repetitions = 20;
+  uint32_t maxSize = 255;
+
+  CommandLine cmd;
+  cmd.AddValue ("repetitions", "Number of times to go through all combinations",
+                repetitions);
+  cmd.AddValue ("maxSize", "Largest payload size to consider (bytes)", maxSize);
+  cmd.Parse (argc, argv);
+
+  // All valid parameter combinations, except the payload size
+  std::vector<LoraTxParameters> combinations;
+  const double bandwidths[] = {125000, 250000, 500000};
+  for (uint8_t sf = 7; sf <= 12; sf++)
+    {
+      for (int bw = 0; bw < 3; bw++)
+        {
+          for (uint8_t cr = 1; cr <= 4; cr++)
+            {
+              for (int flags = 0; flags < 8; flags++)
+                {
+                  LoraTxParameters params;
+                  params.sf = sf;
+                  params.bandwidthHz = bandwidths[bw];
+                  params.codingRate = cr;
+                  params.crcEnabled = flags & 1;
+                  params.headerDisabled = flags & 2;
+                  params.lowDataRateOptimizationEnabled = flags & 4;
+                  combinations.push_back (params);
+                }
+            }
+        }
+    }
+
+  // Check that the two paths agree
+  uint64_t mismatches = 0;
+  for (auto it = combinations.begin (); it != combinations.end (); ++it)
+    {
+      for (uint32_t size = 0; size <= maxSize; size++)
+        {
+          if (LoraPhy::GetOnAirTime (size, *it) != LoraPhy::GetOnAirTimeAnalytic (size, *it))
+            {
+              mismatches++;
+            }
+        }
+    }
+
+  uint64_t calls = uint64_t (repetitions) * combinations.size () * (maxSize + 1);
+
+  int64_t tableSum = 0;
+  auto start = std::chrono::steady_clock::now ();
+  for (int r = 0; r < repetitions; r++)
+    {
+      tableSum += RunAll (&LoraPhy::GetOnAirTime, combinations, maxSize);
+    }
+  double tableNs = std::chrono::duration<double, std::nano>
+      (std::chrono::steady_clock::now () - start).count () / calls;
+
+  int64_t analyticSum = 0;
+  start = std::chrono::steady_clock::now ();
+  for (int r = 0; r < repetitions; r++)
+    {
+      analyticSum += RunAll (&LoraPhy::GetOnAirTimeAnalytic, combinations, maxSize);
+    }
+  double analyticNs = std::chrono::duration<double, std::nano>
+      (std::chrono::steady_clock::now () - start).count () / calls;
+
+  std::cout << "Combinations: " << combinations.size () * (maxSize + 1)
+            << ", mismatches: " << mismatches << std::endl;
+  std::cout << "Precomputed: " << tableNs << " ns/call" << std::endl;
+  std::cout << "Analytic: " << analyticNs << " ns/call" << std::endl;
+  std::cout << "Speedup: " << analyticNs / tableNs << std::endl;
+
+  return (mismatches == 0 && tableSum == analyticSum) ? 0 : 1;
+}
@@ -0,0 +1,384 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/lora-campaign-helper.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("LoraCampaignHelper");
+
+LoraCampaignHelper::LoraCampaignHelper () :
+  m_replications (1),
+  m_firstRun (1),
+  m_maxProcesses (0)
+{
+}
+
+void
+LoraCampaignHelper::SetScenario (Scenario scenario, std::vector<std::string> metricNames)
+{
+  m_scenario = scenario;
+  m_metricNames = metricNames;
+}
+
+void
+LoraCampaignHelper::AddPoint (const Point &point)
+{
+  m_points.push_back (point);
+}
+
+void
+LoraCampaignHelper::AddGrid (std::vector<uint32_t> nDevices, std::vector<double> radius,
+                             std::vector<uint32_t> nGateways, std::vector<bool> adrEnabled,
+                             std::vector<double> brokerDelay)
+{
+  Point point;
+  for (uint32_t d = 0; d < nDevices.size (); d++)
+    {
+      point.nDevices = nDevices[d];
+      for (uint32_t r = 0; r < radius.size (); r++)
+        {
+          point.radius = radius[r];
+          for (uint32_t g = 0; g < nGateways.size (); g++)
+            {
+              point.nGateways = nGateways[g];
+              for (uint32_t a = 0; a < adrEnabled.size (); a++)
+                {
+                  point.adrEnabled = adrEnabled[a];
+                  for (uint32_t b = 0; b < brokerDelay.size (); b++)
+                    {
+                      point.brokerDelay = brokerDelay[b];
+                      m_points.push_back (point);
+                    }
+                }
+            }
+        }
+    }
+}
+
+const std::vector<LoraCampaignHelper::Point> &
+LoraCampaignHelper::GetPoints (void) const
+{
+  return m_points;
+}
+
+void
+LoraCampaignHelper::SetReplications (uint32_t replications)
+{
+  NS_ABORT_MSG_IF (replications == 0, "At least one replication is needed");
+  m_replications = replications;
+}
+
+void
+LoraCampaignHelper::SetFirstRun (uint64_t firstRun)
+{
+  m_firstRun = firstRun;
+}
+
+void
+LoraCampaignHelper::SetMaxProcesses (uint32_t maxProcesses)
+{
+  m_maxProcesses = maxProcesses;
+}
+
+uint64_t
+LoraCampaignHelper::GetRun (uint32_t point, uint32_t replication) const
+{
+  return m_firstRun + uint64_t (point) * m_replications + replication;
+}
+
+uint32_t
+LoraCampaignHelper::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_scenario.IsNull (), "No scenario was set");
+
+  uint32_t nJobs = m_points.size () * m_replications;
+  uint32_t maxProcesses = m_maxProcesses;
+  if (maxProcesses == 0)
+    {
+      maxProcesses = std::max (1u, std::thread::hardware_concurrency ());
+    }
+
+  m_results.clear ();
+  m_results.resize (nJobs);
+  for (uint32_t job = 0; job < nJobs; job++)
+    {
+      m_results[job].point = job / m_replications;
+      m_results[job].replication = job % m_replications;
+      m_results[job].run = GetRun (m_results[job].point, m_results[job].replication);
+      m_results[job].completed = false;
+    }
+
+  // Running child processes, with their job, the pipe they write their
+  // metrics to, and what was read from it so far
+  struct Child
+  {
+    pid_t pid;
+    uint32_t job;
+    int fd;
+    std::vector<char> data;
+  };
+  std::vector<Child> running;
+  uint32_t nextJob = 0;
+  uint32_t nFailed = 0;
+
+  while (nextJob < nJobs || !running.empty ())
+    {
+      // Start replications until all processes are in use
+      while (nextJob < nJobs && running.size () < maxProcesses)
+        {
+          int fds[2];
+          NS_ABORT_MSG_IF (pipe (fds) != 0, "Can't create a pipe: " << std::strerror (errno));
+
+          // Don't let children inherit buffered output
+          std::cout.flush ();
+          std::cerr.flush ();
+
+          pid_t pid = fork ();
+          NS_ABORT_MSG_IF (pid < 0, "Can't create a process: " << std::strerror (errno));
+          if (pid == 0)
+            {
+              close (fds[0]);
+              for (auto it = running.begin (); it != running.end (); ++it)
+                {
+                  close (it->fd);
+                }
+              RunReplication (nextJob, fds[1]);
+              close (fds[1]);
+              std::cout.flush ();
+              std::cerr.flush ();
+              _exit (0);
+            }
+
+          close (fds[1]);
+          NS_LOG_DEBUG ("Started job " << nextJob << " with run " << m_results[nextJob].run
+                                       << " in process " << pid);
+          Child child;
+          child.pid = pid;
+          child.job = nextJob;
+          child.fd = fds[0];
+          running.push_back (child);
+          nextJob++;
+        }
+
+      // Read the pipes as the children write to them, so that no child
+      // blocks on a full pipe, until one of them is closed
+      std::vector<struct pollfd> polled (running.size ());
+      for (uint32_t i = 0; i < running.size (); i++)
+        {
+          polled[i].fd = running[i].fd;
+          polled[i].events = POLLIN;
+          polled[i].revents = 0;
+        }
+      if (poll (polled.data (), polled.size (), -1) < 0)
+        {
+          NS_ABORT_MSG_IF (errno != EINTR, "Error while polling: " << std::strerror (errno));
+          continue;
+        }
+
+      // Go backwards, so that removing a child doesn't move the ones left
+      for (uint32_t i = running.size (); i-- > 0;)
+        {
+          if (polled[i].revents == 0)
+            {
+              continue;
+            }
+
+          Child &child = running[i];
+          char buffer[4096];
+          ssize_t nRead = read (child.fd, buffer, sizeof (buffer));
+          if (nRead < 0 && errno == EINTR)
+            {
+              continue;
+            }
+          if (nRead > 0)
+            {
+              child.data.insert (child.data.end (), buffer, buffer + nRead);
+              continue;
+            }
+
+          // The child is done writing: wait for it to exit
+          close (child.fd);
+          int status;
+          while (waitpid (child.pid, &status, 0) < 0)
+            {
+              NS_ABORT_MSG_IF (errno != EINTR, "Error while waiting: " << std::strerror (errno));
+            }
+
+          Result &result = m_results[child.job];
+          const std::vector<char> &data = child.data;
+          uint32_t nMetrics = 0;
+          if (nRead == 0 && WIFEXITED (status) && WEXITSTATUS (status) == 0
+              && data.size () >= sizeof (nMetrics))
+            {
+              std::memcpy (&nMetrics, data.data (), sizeof (nMetrics));
+              if (data.size () == sizeof (nMetrics) + nMetrics * sizeof (double))
+                {
+                  result.metrics.resize (nMetrics);
+                  std::memcpy (result.metrics.data (), data.data () + sizeof (nMetrics),
+                               nMetrics * sizeof (double));
+                  result.completed = true;
+                }
+            }
+
+          if (!result.completed)
+            {
+              NS_LOG_WARN ("Run " << result.run << " of point " << result.point << " failed");
+              nFailed++;
+            }
+          NS_LOG_DEBUG ("Job " << child.job << " completed");
+          running.erase (running.begin () + i);
+        }
+    }
+
+  return nFailed;
+}
+
+void
+LoraCampaignHelper::RunReplication (uint32_t job, int fd) const
+{
+  const Result &result = m_results[job];
+  RngSeedManager::SetRun (result.run);
+
+  std::vector<double> metrics = m_scenario (m_points[result.point]);
+
+  // The parent reads the pipe while this process writes to it, so the
+  // metrics don't need to fit in the pipe's buffer
+  uint32_t nMetrics = metrics.size ();
+  std::vector<char> data (sizeof (nMetrics) + nMetrics * sizeof (double));
+  std::memcpy (data.data (), &nMetrics, sizeof (nMetrics));
+  std::memcpy (data.data () + sizeof (nMetrics), metrics.data (), nMetrics * sizeof (double));
+
+  size_t written = 0;
+  while (written < data.size ())
+    {
+      ssize_t n = write (fd, data.data () + written, data.size () - written);
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          _exit (1);
+        }
+      written += n;
+    }
+}
+
+const std::vector<LoraCampaignHelper::Result> &
+LoraCampaignHelper::GetResults (void) const
+{
+  return m_results;
+}
+
+void
+LoraCampaignHelper::PrintPoint (std::ostream &os, const Point &point) const
+{
+  os << point.nDevices << " " << point.radius << " " << point.nGateways << " "
+     << point.adrEnabled << " " << point.brokerDelay;
+}
+
+void
+LoraCampaignHelper::PrintResults (std::ostream &os) const
+{
+  os << "nDevices radius nGateways adrEnabled brokerDelay replication run";
+  for (auto name = m_metricNames.begin (); name != m_metricNames.end (); ++name)
+    {
+      os << " " << *name;
+    }
+  os << std::endl;
+
+  for (auto result = m_results.begin (); result != m_results.end (); ++result)
+    {
+      if (!result->completed)
+        {
+          continue;
+        }
+      PrintPoint (os, m_points[result->point]);
+      os << " " << result->replication << " " << result->run;
+      for (auto value = result->metrics.begin (); value != result->metrics.end (); ++value)
+        {
+          os << " " << *value;
+        }
+      os << std::endl;
+    }
+}
+
+void
+LoraCampaignHelper::PrintSummary (std::ostream &os) const
+{
+  os << "nDevices radius nGateways adrEnabled brokerDelay replications";
+  for (auto name = m_metricNames.begin (); name != m_metricNames.end (); ++name)
+    {
+      os << " " << *name << "_mean " << *name << "_std";
+    }
+  os << std::endl;
+
+  if (m_results.size () != m_points.size () * m_replications)
+    {
+      return;
+    }
+
+  // Results are sorted by point, with m_replications results per point
+  for (uint32_t point = 0; point < m_points.size (); point++)
+    {
+      std::vector<double> sum (m_metricNames.size (), 0);
+      std::vector<double> sumSquares (m_metricNames.size (), 0);
+      uint32_t n = 0;
+      for (uint32_t r = 0; r < m_replications; r++)
+        {
+          const Result &result = m_results[point * m_replications + r];
+          if (!result.completed)
+            {
+              continue;
+            }
+          for (uint32_t m = 0; m < sum.size () && m < result.metrics.size (); m++)
+            {
+              sum[m] += result.metrics[m];
+              sumSquares[m] += result.metrics[m] * result.metrics[m];
+            }
+          n++;
+        }
+
+      PrintPoint (os, m_points[point]);
+      os << " " << n;
+      for (uint32_t m = 0; m < sum.size (); m++)
+        {
+          double mean = n > 0 ? sum[m] / n : 0;
+          double variance = n > 1 ? (sumSquares[m] - n * mean * mean) / (n - 1) : 0;
+          os << " " << mean << " " << std::sqrt (std::max (variance, 0.0));
+        }
+      os << std::endl;
+    }
+}
+
+}
+}
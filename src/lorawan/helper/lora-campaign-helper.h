@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LORA_CAMPAIGN_HELPER_H
+#define LORA_CAMPAIGN_HELPER_H
+
+#include "ns3/callback.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Runs a campaign of simulations over a grid of network parameters, with
+ * several independent replications of each point of the grid.
+ *
+ * The simulator is a singleton, so replications can't share a process:
+ * each one runs in a child process, and up to a set number of them run at
+ * the same time. Before calling the scenario, the child process sets the
+ * RngRun of its replication, which only depends on the position of the
+ * point in the grid and on the replication number, so that results are
+ * the same regardless of the number of processes and of the order in which
+ * replications complete. The scenario returns a set of metrics, which are
+ * sent back to the parent process and collected in one table.
+ */
+class LoraCampaignHelper
+{
+public:
+  /**
+   * A point of the parameter grid.
+   */
+  struct Point
+  {
+    uint32_t nDevices;    //!< Number of end devices
+    double radius;        //!< Radius of the area the devices are placed in (m)
+    uint32_t nGateways;   //!< Number of gateways
+    bool adrEnabled;      //!< Whether the server runs ADR
+    double brokerDelay;   //!< Delay between downlinks of the broker (s)
+  };
+
+  /**
+   * The results of a replication.
+   */
+  struct Result
+  {
+    uint32_t point;               //!< Index of the point in the grid
+    uint32_t replication;         //!< Replication number
+    uint64_t run;                 //!< RngRun the replication used
+    bool completed;               //!< Whether the replication returned its metrics
+    std::vector<double> metrics;  //!< Metrics returned by the scenario
+  };
+
+  /**
+   * A scenario runs one simulation of a point of the grid, and returns one
+   * value for each metric.
+   */
+  typedef Callback<std::vector<double>, const Point &> Scenario;
+
+  LoraCampaignHelper ();
+
+  /**
+   * Set the scenario to run, and the names of the metrics it returns.
+   */
+  void SetScenario (Scenario scenario, std::vector<std::string> metricNames);
+
+  /**
+   * Add a point to the grid.
+   */
+  void AddPoint (const Point &point);
+
+  /**
+   * Add all the combinations of the given values to the grid. The last
+   * parameter varies fastest.
+   */
+  void AddGrid (std::vector<uint32_t> nDevices, std::vector<double> radius,
+                std::vector<uint32_t> nGateways, std::vector<bool> adrEnabled,
+                std::vector<double> brokerDelay);
+
+  /**
+   * Get the points of the grid, in the order in which they were added.
+   */
+  const std::vector<Point> &GetPoints (void) const;
+
+  /**
+   * Set the number of replications of each point.
+   */
+  void SetReplications (uint32_t replications);
+
+  /**
+   * Set the RngRun of the first replication of the first point.
+   */
+  void SetFirstRun (uint64_t firstRun);
+
+  /**
+   * Set the number of replications that run at the same time. If 0, which is
+   * the default, the number of hardware threads is used.
+   */
+  void SetMaxProcesses (uint32_t maxProcesses);
+
+  /**
+   * Get the RngRun used by a replication of a point.
+   */
+  uint64_t GetRun (uint32_t point, uint32_t replication) const;
+
+  /**
+   * Run all the replications, and wait for them to complete.
+   *
+   * \return The number of replications that did not complete.
+   */
+  uint32_t Run (void);
+
+  /**
+   * Get the results of the replications, sorted by point and replication.
+   */
+  const std::vector<Result> &GetResults (void) const;
+
+  /**
+   * Print a line for each replication, with the parameters of its point and
+   * its metrics, preceded by a line with the names of the columns.
+   */
+  void PrintResults (std::ostream &os) const;
+
+  /**
+   * Print a line for each point, with the mean and standard deviation of
+   * each metric over the completed replications.
+   */
+  void PrintSummary (std::ostream &os) const;
+
+private:
+  /**
+   * Run a replication in the current process, and write its metrics to fd.
+   */
+  void RunReplication (uint32_t job, int fd) const;
+  void PrintPoint (std::ostream &os, const Point &point) const;
+
+  Scenario m_scenario;
+  std::vector<std::string> m_metricNames;
+  std::vector<Point> m_points;
+  uint32_t m_replications;
+  uint64_t m_firstRun;
+  uint32_t m_maxProcesses;
+  std::vector<Result> m_results;
+};
+
+}
+}
+#endif
@@ -20,6 +20,7 @@
 
 #include "ns3/lora-helper.h"
 #include "ns3/log.h"
+#include "ns3/trace-source-accessor.h"
 
 #include <fstream>
 
@@ -28,6 +29,221 @@ namespace lorawan {
 
 NS_LOG_COMPONENT_DEFINE ("LoraHelper");
 
+LoraTraceForwarder::LoraTraceForwarder (LoraPacketTracker *packetTracker,
+                                        LoraTraceSink *traceSink) :
+  m_packetTracker (packetTracker),
+  m_traceSink (traceSink)
+{
+}
+
+LoraTraceDispatcher::LoraTraceDispatcher ()
+{
+}
+
+void
+LoraTraceDispatcher::SetListeners (LoraPacketTracker *packetTracker,
+                                   LoraTraceSink *traceSink)
+{
+  // The trace sources looked up so far were paired with the old callbacks
+  m_phyConnections.clear ();
+  m_macConnections.clear ();
+  m_types.clear ();
+
+  // Sources both the tracker and the sink listen to go through a forwarder,
+  // which the callbacks keep alive, the others are connected to their
+  // listener directly
+  if (packetTracker && traceSink)
+    {
+      Ptr<LoraTraceForwarder> forwarder = Create<LoraTraceForwarder> (packetTracker, traceSink);
+      m_phyConnections.push_back (Connection
+        ("StartSending", MakeCallback (&LoraTraceForwarder::PhyTransmission, forwarder)));
+      m_phyConnections.push_back (Connection
+        ("ReceivedPacket", MakeCallback (&LoraTraceForwarder::PhyReception, forwarder)));
+      m_phyConnections.push_back (Connection
+        ("LostPacketBecauseInterference",
+        MakeCallback (&LoraTraceForwarder::PhyInterference, forwarder)));
+      m_phyConnections.push_back (Connection
+        ("LostPacketBecauseNoMoreReceivers",
+        MakeCallback (&LoraTraceForwarder::PhyNoMoreReceivers, forwarder)));
+      m_phyConnections.push_back (Connection
+        ("LostPacketBecauseUnderSensitivity",
+        MakeCallback (&LoraTraceForwarder::PhyUnderSensitivity, forwarder)));
+      m_phyConnections.push_back (Connection
+        ("NoReceptionBecauseTransmitting",
+        MakeCallback (&LoraTraceForwarder::PhyLostBecauseTx, forwarder)));
+      m_macConnections.push_back (Connection
+        ("SentNewPacket", MakeCallback (&LoraTraceForwarder::MacTransmission, forwarder)));
+      m_macConnections.push_back (Connection
+        ("ReceivedPacket", MakeCallback (&LoraTraceForwarder::MacReception, forwarder)));
+    }
+  else if (packetTracker)
+    {
+      m_phyConnections.push_back (Connection
+        ("StartSending",
+        MakeCallback (&LoraPacketTracker::TransmissionCallback, packetTracker)));
+      m_phyConnections.push_back (Connection
+        ("ReceivedPacket",
+        MakeCallback (&LoraPacketTracker::PacketReceptionCallback, packetTracker)));
+      m_phyConnections.push_back (Connection
+        ("LostPacketBecauseInterference",
+        MakeCallback (&LoraPacketTracker::InterferenceCallback, packetTracker)));
+      m_phyConnections.push_back (Connection
+        ("LostPacketBecauseNoMoreReceivers",
+        MakeCallback (&LoraPacketTracker::NoMoreReceiversCallback, packetTracker)));
+      m_phyConnections.push_back (Connection
+        ("LostPacketBecauseUnderSensitivity",
+        MakeCallback (&LoraPacketTracker::UnderSensitivityCallback, packetTracker)));
+      m_phyConnections.push_back (Connection
+        ("NoReceptionBecauseTransmitting",
+        MakeCallback (&LoraPacketTracker::LostBecauseTxCallback, packetTracker)));
+      m_macConnections.push_back (Connection
+        ("SentNewPacket",
+        MakeCallback (&LoraPacketTracker::MacTransmissionCallback, packetTracker)));
+      m_macConnections.push_back (Connection
+        ("ReceivedPacket",
+        MakeCallback (&LoraPacketTracker::MacGwReceptionCallback, packetTracker)));
+    }
+  else if (traceSink)
+    {
+      m_phyConnections.push_back (Connection
+        ("StartSending",
+        MakeCallback (&LoraTraceSink::TransmissionCallback, traceSink)));
+      m_phyConnections.push_back (Connection
+        ("ReceivedPacket",
+        MakeCallback (&LoraTraceSink::PacketReceptionCallback, traceSink)));
+      m_phyConnections.push_back (Connection
+        ("LostPacketBecauseInterference",
+        MakeCallback (&LoraTraceSink::InterferenceCallback, traceSink)));
+      m_phyConnections.push_back (Connection
+        ("LostPacketBecauseNoMoreReceivers",
+        MakeCallback (&LoraTraceSink::NoMoreReceiversCallback, traceSink)));
+      m_phyConnections.push_back (Connection
+        ("LostPacketBecauseUnderSensitivity",
+        MakeCallback (&LoraTraceSink::UnderSensitivityCallback, traceSink)));
+      m_phyConnections.push_back (Connection
+        ("NoReceptionBecauseTransmitting",
+        MakeCallback (&LoraTraceSink::LostBecauseTxCallback, traceSink)));
+      m_macConnections.push_back (Connection
+        ("SentNewPacket",
+        MakeCallback (&LoraTraceSink::MacTransmissionCallback, traceSink)));
+      m_macConnections.push_back (Connection
+        ("ReceivedPacket",
+        MakeCallback (&LoraTraceSink::MacReceptionCallback, traceSink)));
+    }
+
+  // Only the tracker counts the transmissions needed by each packet
+  if (packetTracker)
+    {
+      m_macConnections.push_back (Connection
+        ("RequiredTransmissions",
+        MakeCallback (&LoraPacketTracker::RequiredTransmissionsCallback, packetTracker)));
+    }
+}
+
+void
+LoraTraceDispatcher::ConnectPhy (Ptr<LoraPhy> phy)
+{
+  Connect (phy, m_phyConnections);
+}
+
+void
+LoraTraceDispatcher::ConnectMac (Ptr<LorawanMac> mac)
+{
+  Connect (mac, m_macConnections);
+}
+
+void
+LoraTraceDispatcher::Connect (Ptr<Object> object,
+                              const std::vector<Connection> &connections)
+{
+  TypeId tid = object->GetInstanceTypeId ();
+
+  // Look for the trace sources of this type, looking them up by name the
+  // first time a device of this type is connected
+  std::vector<TypeConnections>::iterator type = m_types.begin ();
+  while (type != m_types.end () && type->tid != tid)
+    {
+      ++type;
+    }
+  if (type == m_types.end ())
+    {
+      TypeConnections newType;
+      newType.tid = tid;
+      for (auto it = connections.begin (); it != connections.end (); ++it)
+        {
+          // Types that don't have a source are simply not connected to it
+          Ptr<const TraceSourceAccessor> accessor = tid.LookupTraceSourceByName (it->first);
+          if (accessor)
+            {
+              newType.sources.push_back (std::make_pair (accessor, it->second));
+            }
+        }
+      m_types.push_back (newType);
+      type = m_types.end () - 1;
+    }
+
+  for (auto it = type->sources.begin (); it != type->sources.end (); ++it)
+    {
+      it->first->ConnectWithoutContext (PeekPointer (object), it->second);
+    }
+}
+
+void
+LoraTraceForwarder::PhyTransmission (Ptr<Packet const> packet, uint32_t systemId)
+{
+  m_packetTracker->TransmissionCallback (packet, systemId);
+  m_traceSink->TransmissionCallback (packet, systemId);
+}
+
+void
+LoraTraceForwarder::PhyReception (Ptr<Packet const> packet, uint32_t systemId)
+{
+  m_packetTracker->PacketReceptionCallback (packet, systemId);
+  m_traceSink->PacketReceptionCallback (packet, systemId);
+}
+
+void
+LoraTraceForwarder::PhyInterference (Ptr<Packet const> packet, uint32_t systemId)
+{
+  m_packetTracker->InterferenceCallback (packet, systemId);
+  m_traceSink->InterferenceCallback (packet, systemId);
+}
+
+void
+LoraTraceForwarder::PhyNoMoreReceivers (Ptr<Packet const> packet, uint32_t systemId)
+{
+  m_packetTracker->NoMoreReceiversCallback (packet, systemId);
+  m_traceSink->NoMoreReceiversCallback (packet, systemId);
+}
+
+void
+LoraTraceForwarder::PhyUnderSensitivity (Ptr<Packet const> packet, uint32_t systemId)
+{
+  m_packetTracker->UnderSensitivityCallback (packet, systemId);
+  m_traceSink->UnderSensitivityCallback (packet, systemId);
+}
+
+void
+LoraTraceForwarder::PhyLostBecauseTx (Ptr<Packet const> packet, uint32_t systemId)
+{
+  m_packetTracker->LostBecauseTxCallback (packet, systemId);
+  m_traceSink->LostBecauseTxCallback (packet, systemId);
+}
+
+void
+LoraTraceForwarder::MacTransmission (Ptr<Packet const> packet)
+{
+  m_packetTracker->MacTransmissionCallback (packet);
+  m_traceSink->MacTransmissionCallback (packet);
+}
+
+void
+LoraTraceForwarder::MacReception (Ptr<Packet const> packet)
+{
+  m_packetTracker->MacGwReceptionCallback (packet);
+  m_traceSink->MacReceptionCallback (packet);
+}
+
   LoraHelper::LoraHelper () :
     m_lastPhyPerformanceUpdate (Seconds (0)),
     m_lastGlobalPerformanceUpdate (Seconds (0))
@@ -47,6 +263,13 @@ NS_LOG_COMPONENT_DEFINE ("LoraHelper");
 
     NetDeviceContainer devices;
 
+    // Make room in the channel for all the new PHYs at once
+    Ptr<LoraChannel> channel = phyHelper.GetChannel ();
+    if (channel)
+      {
+        channel->Reserve (channel->GetNDevices () + c.GetN ());
+      }
+
     // Go over the various nodes in which to install the NetDevice
     for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
       {
@@ -61,120 +284,26 @@ NS_LOG_COMPONENT_DEFINE ("LoraHelper");
         device->SetPhy (phy);
         NS_LOG_DEBUG ("Done creating the PHY");
 
+        // Create the MAC
+        Ptr<LorawanMac> mac = macHelper.Create (node, device);
+        NS_ASSERT (mac != 0);
+        mac->SetPhy (phy);
+        NS_LOG_DEBUG ("Done creating the MAC");
+        device->SetMac (mac);
+
         // Connect Trace Sources if necessary
-        if (m_packetTracker)
+        if (m_traceDispatcher)
           {
-            if (phyHelper.GetDeviceType () ==
-                TypeId::LookupByName ("ns3::SimpleEndDeviceLoraPhy"))
-              {
-                phy->TraceConnectWithoutContext ("StartSending",
-                                                 MakeCallback
-                                                 (&LoraPacketTracker::TransmissionCallback,
-                                                  m_packetTracker));
-                phy->TraceConnectWithoutContext ("ReceivedPacket",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::PacketReceptionCallback,
-                                                 m_packetTracker));
-                phy->TraceConnectWithoutContext ("LostPacketBecauseInterference",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::InterferenceCallback,
-                                                 m_packetTracker));
-				phy->TraceConnectWithoutContext ("LostPacketBecauseNoMoreReceivers",
-											   MakeCallback
-												 (&LoraPacketTracker::NoMoreReceiversCallback,
-												 m_packetTracker));
-				phy->TraceConnectWithoutContext ("LostPacketBecauseUnderSensitivity",
-											   MakeCallback
-												 (&LoraPacketTracker::UnderSensitivityCallback,
-												 m_packetTracker));
-				phy->TraceConnectWithoutContext ("NoReceptionBecauseTransmitting",
-											   MakeCallback
-												 (&LoraPacketTracker::LostBecauseTxCallback,
-												 m_packetTracker));
-              }
-            else if (phyHelper.GetDeviceType () ==
-                     TypeId::LookupByName ("ns3::SimpleGatewayLoraPhy"))
-            {
-              phy->TraceConnectWithoutContext ("StartSending",
-                                               MakeCallback
-                                               (&LoraPacketTracker::TransmissionCallback,
-                                                m_packetTracker));
-              phy->TraceConnectWithoutContext ("ReceivedPacket",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::PacketReceptionCallback,
-                                                 m_packetTracker));
-				phy->TraceConnectWithoutContext ("LostPacketBecauseInterference",
-									   MakeCallback
-										 (&LoraPacketTracker::InterferenceCallback,
-										 m_packetTracker));
-				phy->TraceConnectWithoutContext ("LostPacketBecauseNoMoreReceivers",
-									   MakeCallback
-										 (&LoraPacketTracker::NoMoreReceiversCallback,
-										 m_packetTracker));
-				phy->TraceConnectWithoutContext ("LostPacketBecauseUnderSensitivity",
-									   MakeCallback
-										 (&LoraPacketTracker::UnderSensitivityCallback,
-										 m_packetTracker));
-				phy->TraceConnectWithoutContext ("NoReceptionBecauseTransmitting",
-									   MakeCallback
-												 (&LoraPacketTracker::LostBecauseTxCallback,
-												 m_packetTracker));
-
-             
-            }
-        }
-
-      // Create the MAC
-      Ptr<LorawanMac> mac = macHelper.Create (node, device);
-      NS_ASSERT (mac != 0);
-      mac->SetPhy (phy);
-      NS_LOG_DEBUG ("Done creating the MAC");
-      device->SetMac (mac);
-
-      if (m_packetTracker)
-        {
-          if (phyHelper.GetDeviceType () ==
-              TypeId::LookupByName ("ns3::SimpleEndDeviceLoraPhy"))
-            {
-              mac->TraceConnectWithoutContext ("SentNewPacket",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::MacTransmissionCallback,
-                                                 m_packetTracker));
-
-              mac->TraceConnectWithoutContext ("RequiredTransmissions",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::RequiredTransmissionsCallback,
-                                                 m_packetTracker));
-			 mac->TraceConnectWithoutContext ("ReceivedPacket",
-                                               MakeCallback
-                                               (&LoraPacketTracker::MacGwReceptionCallback,
-                                                m_packetTracker));
-            }
-          else if (phyHelper.GetDeviceType () ==
-                   TypeId::LookupByName ("ns3::SimpleGatewayLoraPhy"))
-            {
-              mac->TraceConnectWithoutContext ("SentNewPacket",
-                                               MakeCallback
-                                               (&LoraPacketTracker::MacTransmissionCallback,
-                                                m_packetTracker));
-
-              mac->TraceConnectWithoutContext ("ReceivedPacket",
-                                               MakeCallback
-                                               (&LoraPacketTracker::MacGwReceptionCallback,
-                                                m_packetTracker));
-			 mac->TraceConnectWithoutContext ("RequiredTransmissions",
-                                               MakeCallback
-                                                 (&LoraPacketTracker::RequiredTransmissionsCallback,
-                                                 m_packetTracker));
-            }
-        }
-
-      node->AddDevice (device);
-      devices.Add (device);
-      NS_LOG_DEBUG ("node=" << node << ", mob=" << node->GetObject<MobilityModel> ()->GetPosition ());
-    }
-  return devices;
-}
+            m_traceDispatcher->ConnectPhy (phy);
+            m_traceDispatcher->ConnectMac (mac);
+          }
+
+        node->AddDevice (device);
+        devices.Add (device);
+        NS_LOG_DEBUG ("node=" << node << ", mob=" << node->GetObject<MobilityModel> ()->GetPosition ());
+      }
+    return devices;
+  }
 
 NetDeviceContainer
 LoraHelper::Install ( const LoraPhyHelper &phy,
@@ -191,6 +320,35 @@ LoraHelper::EnablePacketTracking ()
 
   // Create the packet tracker
   m_packetTracker = new LoraPacketTracker ();
+
+  // Devices installed from now on are connected to the new tracker
+  SetTraceListeners ();
+}
+
+void
+LoraHelper::EnableBinaryTracing (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+
+  m_traceSink = new LoraTraceSink (filename);
+  SetTraceListeners ();
+
+  // Make sure buffered records reach the file
+  Simulator::ScheduleDestroy (&LoraTraceSink::Flush, m_traceSink);
+}
+
+void
+LoraHelper::SetTraceListeners (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Reuse the dispatcher, so that there is a single one connected to each
+  // source no matter how many times tracing is enabled
+  if (m_traceDispatcher == 0)
+    {
+      m_traceDispatcher = Create<LoraTraceDispatcher> ();
+    }
+  m_traceDispatcher->SetListeners (m_packetTracker, m_traceSink);
 }
 
 LoraPacketTracker&
@@ -280,6 +438,14 @@ LoraHelper::EnablePeriodicPhyPerformancePrinting (NodeContainer gateways,
 {
   NS_LOG_FUNCTION (this);
 
+  // Count outcomes per printing interval, so that printing doesn't need to
+  // go through the whole packet history. The counts don't change, since
+  // the counters include both bounds of the window like a scan does.
+  if (m_packetTracker && m_packetTracker->GetCountingInterval ().IsZero ())
+    {
+      m_packetTracker->SetCountingInterval (interval);
+    }
+
   DoPrintPhyPerformance (gateways, filename);
 
   Simulator::Schedule (interval,
@@ -328,6 +494,11 @@ LoraHelper::EnablePeriodicGlobalPerformancePrinting (std::string filename,
 {
   NS_LOG_FUNCTION (this << filename << interval);
 
+  if (m_packetTracker && m_packetTracker->GetCountingInterval ().IsZero ())
+    {
+      m_packetTracker->SetCountingInterval (interval);
+    }
+
   DoPrintGlobalPerformance (filename);
 
   Simulator::Schedule (interval,
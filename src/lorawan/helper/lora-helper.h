@@ -28,12 +28,103 @@
 #include "ns3/net-device.h"
 #include "ns3/lora-net-device.h"
 #include "ns3/lora-packet-tracker.h"
+#include "ns3/lora-trace-sink.h"
+#include "ns3/simple-ref-count.h"
 
 #include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace ns3 {
+
+class TraceSourceAccessor;
+
 namespace lorawan {
 
+/**
+ * Forwards the events of the trace sources that both the packet tracker and
+ * the binary trace sink of a LoraHelper listen to.
+ *
+ * The callbacks connected to the devices hold a reference to the forwarder,
+ * which therefore lives as long as the devices it is connected to.
+ */
+class LoraTraceForwarder : public SimpleRefCount<LoraTraceForwarder>
+{
+public:
+  LoraTraceForwarder (LoraPacketTracker *packetTracker, LoraTraceSink *traceSink);
+
+  // Callbacks forwarding to both the tracker and the sink
+  void PhyTransmission (Ptr<Packet const> packet, uint32_t systemId);
+  void PhyReception (Ptr<Packet const> packet, uint32_t systemId);
+  void PhyInterference (Ptr<Packet const> packet, uint32_t systemId);
+  void PhyNoMoreReceivers (Ptr<Packet const> packet, uint32_t systemId);
+  void PhyUnderSensitivity (Ptr<Packet const> packet, uint32_t systemId);
+  void PhyLostBecauseTx (Ptr<Packet const> packet, uint32_t systemId);
+  void MacTransmission (Ptr<Packet const> packet);
+  void MacReception (Ptr<Packet const> packet);
+
+private:
+  LoraPacketTracker *m_packetTracker;
+  LoraTraceSink *m_traceSink;
+};
+
+/**
+ * Connects the trace sources of the devices created by a LoraHelper to its
+ * packet tracker and binary trace sink.
+ *
+ * The callbacks are built once, and the trace sources of each PHY and MAC
+ * type are looked up once, the first time a device of that type is
+ * connected, so that connecting a device doesn't need any lookup by name.
+ * Sources that both the tracker and the sink listen to are connected once,
+ * to a LoraTraceForwarder that forwards to both.
+ *
+ * The connected callbacks don't point to the dispatcher, so the helper that
+ * owns it can be destroyed before the simulation runs.
+ */
+class LoraTraceDispatcher : public SimpleRefCount<LoraTraceDispatcher>
+{
+public:
+  LoraTraceDispatcher ();
+
+  /**
+   * Set the tracker and the sink the devices connected from now on report
+   * to. Either may be 0.
+   */
+  void SetListeners (LoraPacketTracker *packetTracker, LoraTraceSink *traceSink);
+
+  /**
+   * Connect the trace sources of a PHY.
+   */
+  void ConnectPhy (Ptr<LoraPhy> phy);
+
+  /**
+   * Connect the trace sources of a MAC.
+   */
+  void ConnectMac (Ptr<LorawanMac> mac);
+
+private:
+  /**
+   * A trace source name and the callback to connect to it.
+   */
+  typedef std::pair<std::string, CallbackBase> Connection;
+
+  /**
+   * The trace sources of a type, with the callbacks to connect to them.
+   */
+  struct TypeConnections
+  {
+    TypeId tid;
+    std::vector<std::pair<Ptr<const TraceSourceAccessor>, CallbackBase> > sources;
+  };
+
+  void Connect (Ptr<Object> object, const std::vector<Connection> &connections);
+
+  std::vector<Connection> m_phyConnections;
+  std::vector<Connection> m_macConnections;
+  std::vector<TypeConnections> m_types;   //!< Trace sources of each type seen so far
+};
+
 /**
  * Helps to create LoraNetDevice objects
  *
@@ -50,6 +141,9 @@ public:
   /**
    * Install LoraNetDevices on a list of nodes
    *
+   * Trace sources are connected through a LoraTraceDispatcher, and the
+   * channel is made room for all the new PHYs at once.
+   *
    * \param phy the PHY helper to create PHY objects
    * \param mac the MAC helper to create MAC objects
    * \param c the set of nodes on which a lora device must be created
@@ -96,6 +190,10 @@ public:
 
   /**
    * Periodically prints PHY-level performance at every gateway in the container.
+   *
+   * Unless the packet tracker already has a counting interval, it is set to
+   * interval, so that each print sums counters instead of scanning the
+   * packet history. The printed counts are the same either way.
    */
   void EnablePeriodicPhyPerformancePrinting (NodeContainer gateways,
                                              std::string filename,
@@ -105,6 +203,9 @@ public:
 
   /**
    * Periodically prints global performance.
+   *
+   * Like EnablePeriodicPhyPerformancePrinting, this sets the counting
+   * interval of the packet tracker if it has none.
    */
   void EnablePeriodicGlobalPerformancePrinting (std::string filename,
                                                 Time interval);
@@ -115,6 +216,17 @@ public:
 
   LoraPacketTracker* m_packetTracker = 0;
 
+  /**
+   * Record PHY and MAC events of the devices installed from now on in a
+   * binary trace. See LoraTraceSink for the format, and the lora-trace-to-csv
+   * example to convert it to CSV.
+   */
+  void EnableBinaryTracing (std::string filename);
+
+  LoraTraceSink* m_traceSink = 0;
+
+  Ptr<LoraTraceDispatcher> m_traceDispatcher;
+
   time_t m_oldtime;
 
   /**
@@ -130,6 +242,12 @@ private:
    */
   void DoPrintSimulationTime (Time interval);
 
+  /**
+   * Make the trace dispatcher connect the devices installed from now on to
+   * the current packet tracker and trace sink.
+   */
+  void SetTraceListeners (void);
+
   Time m_lastPhyPerformanceUpdate;
   Time m_lastGlobalPerformanceUpdate;
 };
@@ -20,6 +20,7 @@
 
 #include "lora-packet-tracker.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
 #include "ns3/simulator.h"
 #include "ns3/lorawan-mac-header.h"
 #include <iostream>
@@ -29,7 +30,16 @@ namespace ns3 {
 namespace lorawan {
 NS_LOG_COMPONENT_DEFINE ("LoraPacketTracker");
 
+LoraPacketTracker::IntervalCounters::IntervalCounters ()
+  : pruned (0)
+{
+}
+
 LoraPacketTracker::LoraPacketTracker ()
+  : m_countingInterval (Seconds (0)),
+    m_prunedIndex (0),
+    m_streaming (false),
+    m_retention (Seconds (0))
 {
   NS_LOG_FUNCTION (this);
 }
@@ -37,6 +47,8 @@ LoraPacketTracker::LoraPacketTracker ()
 LoraPacketTracker::~LoraPacketTracker ()
 {
   NS_LOG_FUNCTION (this);
+
+  FlushRecords ();
 }
 
 /////////////////
@@ -46,18 +58,25 @@ LoraPacketTracker::~LoraPacketTracker ()
 void
 LoraPacketTracker::MacTransmissionCallback (Ptr<Packet const> packet)
 {
+  NS_LOG_INFO ("A new packet was sent by the MAC layer");
 
-      NS_LOG_INFO ("A new packet was sent by the MAC layer");
+  if (m_streaming)
+    {
+      FlushRecordsBefore (Simulator::Now () - m_retention);
+    }
 
-      MacPacketStatus status;
-      status.packet = packet;
-      status.sendTime = Simulator::Now ();
-      status.senderId = Simulator::GetContext ();
-      status.receivedTime = Time::Max ();
+  MacPacketStatus status;
+  status.packet = packet;
+  status.sendTime = Simulator::Now ();
+  status.senderId = Simulator::GetContext ();
+  status.receivedTime = Time::Max ();
 
-      m_macPacketTracker.insert (std::pair<Ptr<Packet const>, MacPacketStatus>
-                                   (packet, status));
-    
+  if (m_macPacketTracker.insert (std::pair<Ptr<Packet const>, MacPacketStatus>
+                                   (packet, status)).second)
+    {
+      m_macOrder.push_back (packet);
+      CountMacRecord (status);
+    }
 }
 
 void
@@ -76,52 +95,50 @@ LoraPacketTracker::RequiredTransmissionsCallback (uint8_t reqTx, bool success,
   entry.reTxAttempts = reqTx;
   entry.successful = success;
 
-  m_reTransmissionTracker.insert (std::pair<Ptr<Packet>, RetransmissionStatus>
-                                    (packet, entry));
+  if (m_streaming)
+    {
+      // The record is complete, so there is no need to keep it around
+      m_streamFile << "RETX " << entry.firstAttempt.GetSeconds () << " " <<
+        entry.finishTime.GetSeconds () << " " << unsigned(entry.reTxAttempts) <<
+        " " << entry.successful << std::endl;
+      CountRetransmissionRecord (entry);
+      return;
+    }
+
+  if (m_reTransmissionTracker.insert (std::pair<Ptr<Packet>, RetransmissionStatus>
+                                        (packet, entry)).second)
+    {
+      CountRetransmissionRecord (entry);
+    }
 }
 
 void
 LoraPacketTracker::MacGwReceptionCallback (Ptr<Packet const> packet)
 {
-  if (IsUplink (packet))
+  NS_LOG_INFO ("A packet was successfully received at the MAC layer of " <<
+               (IsUplink (packet) ? "gateway " : "endDevice ") <<
+               Simulator::GetContext ());
+
+  // Find the received packet in the m_macPacketTracker
+  auto it = m_macPacketTracker.find (packet);
+  if (it == m_macPacketTracker.end ())
     {
-      NS_LOG_INFO ("A packet was successfully received" <<
-                   " at the MAC layer of gateway " <<
-                   Simulator::GetContext ());
+      // With streaming, the record may have been freed already
+      NS_ABORT_MSG_UNLESS (m_streaming, "Packet not found in tracker");
+      NS_LOG_WARN ("Packet not found in tracker, the retention may be too short");
+      return;
+    }
 
-      // Find the received packet in the m_macPacketTracker
-      auto it = m_macPacketTracker.find (packet);
-      if (it != m_macPacketTracker.end ())
-        {
-          (*it).second.receptionTimes.insert (std::pair<int, Time>
-                                                (Simulator::GetContext (),
-                                                Simulator::Now ()));
-        }
-      else
-        {
-          NS_ABORT_MSG ("Packet not found in tracker");
-        }
-    } else {
-	
-	NS_LOG_INFO ("A packet was successfully received" <<
-                   " at the MAC layer of endDevice " <<
-                   Simulator::GetContext ());
-
-      // Find the received packet in the m_macPacketTracker
-      auto it = m_macPacketTracker.find (packet);
-      if (it != m_macPacketTracker.end ())
-        {
-          (*it).second.receptionTimes.insert (std::pair<int, Time>
-                                                (Simulator::GetContext (),
-                                                Simulator::Now ()));
-        }
-      else
-        {
-          NS_ABORT_MSG ("Packet not found in tracker");
-        }
-	
-	
-	}
+  bool firstReception = (*it).second.receptionTimes.empty ();
+  (*it).second.receptionTimes.insert (std::pair<int, Time>
+                                        (Simulator::GetContext (),
+                                        Simulator::Now ()));
+
+  // A MAC packet counts as received once, at its first reception
+  if (firstReception && !m_countingInterval.IsZero ())
+    {
+      Increment (m_macReceived, (*it).second.sendTime);
+    }
 }
 
 /////////////////
@@ -131,152 +148,108 @@ LoraPacketTracker::MacGwReceptionCallback (Ptr<Packet const> packet)
 void
 LoraPacketTracker::TransmissionCallback (Ptr<Packet const> packet, uint32_t edId)
 {
-  if (IsUplink (packet))
-    {
-      NS_LOG_INFO ("PHY packet " << packet
-                                 << " was transmitted by device "
-                                 << edId);
-      // Create a packetStatus
-      PacketStatus status;
-      status.packet = packet;
-      status.sendTime = Simulator::Now ();
-      status.senderId = edId;
-
-      m_packetTracker.insert (std::pair<Ptr<Packet const>, PacketStatus> (packet, status));
-    } else{
-		 NS_LOG_INFO ("PHY packet " << packet
-                                 << " was transmitted by Gateway "
-                                 << edId);
-      // Create a packetStatus
-      PacketStatus status;
-      status.packet = packet;
-      status.sendTime = Simulator::Now ();
-      status.senderId = edId;
-
-      m_packetTracker.insert (std::pair<Ptr<Packet const>, PacketStatus> (packet, status));
-		
-		}
+  NS_LOG_INFO ("PHY packet " << packet
+                             << " was transmitted by "
+                             << (IsUplink (packet) ? "device " : "Gateway ")
+                             << edId);
+
+  if (m_streaming)
+    {
+      FlushRecordsBefore (Simulator::Now () - m_retention);
+    }
+
+  // Create a packetStatus
+  PacketStatus status;
+  status.packet = packet;
+  status.sendTime = Simulator::Now ();
+  status.senderId = edId;
+
+  if (m_packetTracker.insert (std::pair<Ptr<Packet const>, PacketStatus>
+                                (packet, status)).second)
+    {
+      m_phyOrder.push_back (packet);
+      CountPhyRecord (status);
+    }
 }
 
 void
 LoraPacketTracker::PacketReceptionCallback (Ptr<Packet const> packet, uint32_t gwId)
 {
-  if (IsUplink (packet))
-    {
-      // Remove the successfully received packet from the list of sent ones
-      NS_LOG_INFO ("PHY packet " << packet
-                                 << " was successfully received at gateway "
-                                 << gwId);
-
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           RECEIVED));
-    } else{
-		
-   // Remove the successfully received packet from the list of sent ones
-      NS_LOG_INFO ("PHY packet " << packet
-                                 << " was successfully received at endDevice "
-                                 << gwId);
+  // Remove the successfully received packet from the list of sent ones
+  NS_LOG_INFO ("PHY packet " << packet
+                             << " was successfully received at "
+                             << (IsUplink (packet) ? "gateway " : "endDevice ")
+                             << gwId);
 
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           RECEIVED));
-		}
+  RecordPhyOutcome (packet, gwId, RECEIVED);
 }
 
 void
 LoraPacketTracker::InterferenceCallback (Ptr<Packet const> packet, uint32_t gwId)
 {
-  if (IsUplink (packet))
-    {
-      NS_LOG_INFO ("PHY packet " << packet
-                                 << " was interfered at gateway "
-                                 << gwId);
-
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           INTERFERED));
-    }else{
-		NS_LOG_INFO ("PHY packet " << packet
-                                 << " was interfered at endDevice "
-                                 << gwId);
+  NS_LOG_INFO ("PHY packet " << packet
+                             << " was interfered at "
+                             << (IsUplink (packet) ? "gateway " : "endDevice ")
+                             << gwId);
 
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           INTERFERED));
-		
-	}
+  RecordPhyOutcome (packet, gwId, INTERFERED);
 }
 
 void
 LoraPacketTracker::NoMoreReceiversCallback (Ptr<Packet const> packet, uint32_t gwId)
 {
-  if (IsUplink (packet))
-    {
-      NS_LOG_INFO ("PHY packet " << packet
-                                 << " was lost because no more receivers at gateway "
-                                 << gwId);
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           NO_MORE_RECEIVERS));
-    }else{
-		
-		 NS_LOG_INFO ("PHY packet " << packet
-                                 << " was lost because no more receivers at endDevices "
-                                 << gwId);
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           NO_MORE_RECEIVERS));
-		
-		}
+  NS_LOG_INFO ("PHY packet " << packet
+                             << " was lost because no more receivers at "
+                             << (IsUplink (packet) ? "gateway " : "endDevice ")
+                             << gwId);
+
+  RecordPhyOutcome (packet, gwId, NO_MORE_RECEIVERS);
 }
 
 void
 LoraPacketTracker::UnderSensitivityCallback (Ptr<Packet const> packet, uint32_t gwId)
 {
-  if (IsUplink (packet))
-    {
-      NS_LOG_INFO ("PHY packet " << packet
-                                 << " was lost because under sensitivity at gateway "
-                                 << gwId);
+  NS_LOG_INFO ("PHY packet " << packet
+                             << " was lost because under sensitivity at "
+                             << (IsUplink (packet) ? "gateway " : "endDevice ")
+                             << gwId);
 
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           UNDER_SENSITIVITY));
-    }else {
-		NS_LOG_INFO ("PHY packet " << packet
-                                 << " was lost because under sensitivity at endDevice "
-                                 << gwId);
-
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           UNDER_SENSITIVITY));
-		
-		
-	}
+  RecordPhyOutcome (packet, gwId, UNDER_SENSITIVITY);
 }
 
 void
 LoraPacketTracker::LostBecauseTxCallback (Ptr<Packet const> packet, uint32_t gwId)
 {
-  if (IsUplink (packet))
+  NS_LOG_INFO ("PHY packet " << packet
+                             << " was lost because of transmission at "
+                             << (IsUplink (packet) ? "gateway " : "endDevice ")
+                             << gwId);
+
+  RecordPhyOutcome (packet, gwId, LOST_BECAUSE_TX);
+}
+
+void
+LoraPacketTracker::RecordPhyOutcome (Ptr<Packet const> packet, uint32_t systemId,
+                                     enum PhyPacketOutcome outcome)
+{
+  NS_LOG_FUNCTION (this << packet << systemId << outcome);
+
+  std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
+  if (it == m_packetTracker.end ())
     {
-      NS_LOG_INFO ("PHY packet " << packet
-                                 << " was lost because of GW transmission at gateway "
-                                 << gwId);
+      NS_LOG_WARN ("PHY packet " << packet << " not found in tracker");
+      return;
+    }
 
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           LOST_BECAUSE_TX));
-    } else{
-		NS_LOG_INFO ("PHY packet " << packet
-                                 << " was lost because of transmission at endDevice "
-                                 << gwId);
+  bool inserted = (*it).second.outcomes.insert
+      (std::pair<int, enum PhyPacketOutcome> (systemId, outcome)).second;
 
-      std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find (packet);
-      (*it).second.outcomes.insert (std::pair<int, enum PhyPacketOutcome> (gwId,
-                                                                           LOST_BECAUSE_TX));
-	}
+  if (inserted && !m_countingInterval.IsZero ())
+    {
+      std::vector<IntervalCounters> &counters = m_phyOutcomes[systemId];
+      counters.resize (N_PHY_OUTCOMES);
+      Increment (counters[outcome], (*it).second.sendTime);
+    }
 }
 
 bool
@@ -290,6 +263,312 @@ LoraPacketTracker::IsUplink (Ptr<Packet const> packet)
   return mHdr.IsUplink ();
 }
 
+//////////////////////////////
+// Counters and streaming   //
+//////////////////////////////
+
+void
+LoraPacketTracker::SetCountingInterval (Time interval)
+{
+  NS_LOG_FUNCTION (this << interval);
+
+  NS_ASSERT (!interval.IsNegative ());
+
+  m_countingInterval = interval;
+
+  m_prunedIndex = 0;
+  m_phySent = IntervalCounters ();
+  m_phyOutcomes.clear ();
+  m_macSent = IntervalCounters ();
+  m_macReceived = IntervalCounters ();
+  m_cpsrSent = IntervalCounters ();
+  m_cpsrReceived = IntervalCounters ();
+
+  if (m_countingInterval.IsZero ())
+    {
+      return;
+    }
+
+  // Rebuild the counters from the records we still have
+  for (auto it = m_packetTracker.begin (); it != m_packetTracker.end (); ++it)
+    {
+      CountPhyRecord ((*it).second);
+      const std::map<int, enum PhyPacketOutcome> &outcomes = (*it).second.outcomes;
+      for (auto out = outcomes.begin (); out != outcomes.end (); ++out)
+        {
+          if ((*out).second == UNSET)
+            {
+              continue;
+            }
+          std::vector<IntervalCounters> &counters = m_phyOutcomes[(*out).first];
+          counters.resize (N_PHY_OUTCOMES);
+          Increment (counters[(*out).second], (*it).second.sendTime);
+        }
+    }
+  for (auto it = m_macPacketTracker.begin (); it != m_macPacketTracker.end (); ++it)
+    {
+      CountMacRecord ((*it).second);
+      if (!(*it).second.receptionTimes.empty ())
+        {
+          Increment (m_macReceived, (*it).second.sendTime);
+        }
+    }
+  for (auto it = m_reTransmissionTracker.begin ();
+       it != m_reTransmissionTracker.end (); ++it)
+    {
+      CountRetransmissionRecord ((*it).second);
+    }
+}
+
+Time
+LoraPacketTracker::GetCountingInterval (void) const
+{
+  return m_countingInterval;
+}
+
+void
+LoraPacketTracker::EnableStreaming (std::string filename, Time retention)
+{
+  NS_LOG_FUNCTION (this << filename << retention);
+
+  if (m_streamFile.is_open ())
+    {
+      m_streamFile.close ();
+    }
+  m_streamFile.open (filename.c_str (), std::ofstream::out | std::ofstream::trunc);
+  NS_ABORT_MSG_UNLESS (m_streamFile.is_open (), "Can't open " << filename);
+
+  m_streaming = true;
+  m_retention = retention;
+
+  // Records of completed retransmissions are not stored while streaming
+  for (auto it = m_reTransmissionTracker.begin ();
+       it != m_reTransmissionTracker.end (); ++it)
+    {
+      m_streamFile << "RETX " << (*it).second.firstAttempt.GetSeconds () << " " <<
+        (*it).second.finishTime.GetSeconds () << " " <<
+        unsigned((*it).second.reTxAttempts) << " " << (*it).second.successful <<
+        std::endl;
+    }
+  m_reTransmissionTracker.clear ();
+}
+
+void
+LoraPacketTracker::FlushRecords (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_streaming)
+    {
+      FlushRecordsBefore (Time::Max ());
+      m_streamFile.flush ();
+    }
+}
+
+uint32_t
+LoraPacketTracker::GetNStoredRecords (void) const
+{
+  return m_packetTracker.size () + m_macPacketTracker.size ();
+}
+
+uint32_t
+LoraPacketTracker::GetNStoredCounters (void) const
+{
+  uint32_t nCounters = m_phySent.counts.size () + m_macSent.counts.size () +
+    m_macReceived.counts.size () + m_cpsrSent.counts.size () +
+    m_cpsrReceived.counts.size ();
+  for (auto it = m_phyOutcomes.begin (); it != m_phyOutcomes.end (); ++it)
+    {
+      for (auto out = (*it).second.begin (); out != (*it).second.end (); ++out)
+        {
+          nCounters += (*out).counts.size ();
+        }
+    }
+  return nCounters;
+}
+
+void
+LoraPacketTracker::FlushRecordsBefore (Time time)
+{
+  NS_LOG_FUNCTION (this << time);
+
+  // Packets are pushed in order of send time, so the oldest are at the front
+  while (!m_phyOrder.empty ())
+    {
+      auto it = m_packetTracker.find (m_phyOrder.front ());
+      if ((*it).second.sendTime >= time)
+        {
+          break;
+        }
+
+      const PacketStatus &status = (*it).second;
+      m_streamFile << "PHY " << status.sendTime.GetSeconds () << " " <<
+        status.senderId;
+      for (auto out = status.outcomes.begin (); out != status.outcomes.end (); ++out)
+        {
+          m_streamFile << " " << (*out).first << ":" << (*out).second;
+        }
+      m_streamFile << "\n";
+
+      m_packetTracker.erase (it);
+      m_phyOrder.pop_front ();
+    }
+
+  while (!m_macOrder.empty ())
+    {
+      auto it = m_macPacketTracker.find (m_macOrder.front ());
+      if ((*it).second.sendTime >= time)
+        {
+          break;
+        }
+
+      const MacPacketStatus &status = (*it).second;
+      m_streamFile << "MAC " << status.sendTime.GetSeconds () << " " <<
+        status.senderId;
+      for (auto rec = status.receptionTimes.begin ();
+           rec != status.receptionTimes.end (); ++rec)
+        {
+          m_streamFile << " " << (*rec).first << ":" << (*rec).second.GetSeconds ();
+        }
+      m_streamFile << "\n";
+
+      m_macPacketTracker.erase (it);
+      m_macOrder.pop_front ();
+    }
+
+  // The intervals that ended before time won't get any new packet, since
+  // their records are gone: merge their counters
+  if (m_countingInterval.IsZero () || time == Time::Max () || time.IsNegative ())
+    {
+      return;
+    }
+  uint32_t index = GetCounterIndex (time) & ~1u;
+  if (index <= m_prunedIndex)
+    {
+      return;
+    }
+  m_prunedIndex = index;
+  PruneCounters (m_phySent, index);
+  for (auto it = m_phyOutcomes.begin (); it != m_phyOutcomes.end (); ++it)
+    {
+      for (auto out = (*it).second.begin (); out != (*it).second.end (); ++out)
+        {
+          PruneCounters (*out, index);
+        }
+    }
+  PruneCounters (m_macSent, index);
+  PruneCounters (m_macReceived, index);
+  PruneCounters (m_cpsrSent, index);
+  PruneCounters (m_cpsrReceived, index);
+}
+
+void
+LoraPacketTracker::PruneCounters (IntervalCounters &counters, uint32_t index)
+{
+  std::map<uint32_t, uint32_t>::iterator end = counters.counts.lower_bound (index);
+  for (auto it = counters.counts.begin (); it != end; ++it)
+    {
+      counters.pruned += (*it).second;
+    }
+  counters.counts.erase (counters.counts.begin (), end);
+}
+
+uint32_t
+LoraPacketTracker::GetCounterIndex (Time time) const
+{
+  int64_t step = m_countingInterval.GetTimeStep ();
+  return 2 * (time.GetTimeStep () / step) + (time.GetTimeStep () % step != 0);
+}
+
+void
+LoraPacketTracker::Increment (IntervalCounters &counters, Time time)
+{
+  // Packets can complete after their interval was merged, for instance when
+  // retransmissions last longer than the retention
+  uint32_t index = GetCounterIndex (time);
+  if (index < m_prunedIndex)
+    {
+      counters.pruned++;
+    }
+  else
+    {
+      counters.counts[index]++;
+    }
+}
+
+void
+LoraPacketTracker::CountPhyRecord (const PacketStatus &status)
+{
+  if (!m_countingInterval.IsZero ())
+    {
+      Increment (m_phySent, status.sendTime);
+    }
+}
+
+void
+LoraPacketTracker::CountMacRecord (const MacPacketStatus &status)
+{
+  if (!m_countingInterval.IsZero ())
+    {
+      Increment (m_macSent, status.sendTime);
+    }
+}
+
+void
+LoraPacketTracker::CountRetransmissionRecord (const RetransmissionStatus &status)
+{
+  if (!m_countingInterval.IsZero ())
+    {
+      Increment (m_cpsrSent, status.firstAttempt);
+      if (status.successful)
+        {
+          Increment (m_cpsrReceived, status.firstAttempt);
+        }
+    }
+}
+
+bool
+LoraPacketTracker::CanUseCounters (Time startTime, Time stopTime) const
+{
+  if (m_countingInterval.IsZero () || startTime > stopTime)
+    {
+      return false;
+    }
+
+  int64_t step = m_countingInterval.GetTimeStep ();
+  if (startTime.GetTimeStep () % step != 0 || stopTime.GetTimeStep () % step != 0)
+    {
+      return false;
+    }
+
+  // Merged counters can only be used as a whole
+  return startTime.IsZero () || GetCounterIndex (startTime) >= m_prunedIndex;
+}
+
+uint32_t
+LoraPacketTracker::SumCounters (const IntervalCounters &counters,
+                                Time startTime, Time stopTime) const
+{
+  // Both bounds are at the start of an interval: take the whole intervals
+  // from the first to the one before the last, and the packets sent at the
+  // start of the last one
+  uint32_t first = GetCounterIndex (startTime);
+  uint32_t last = GetCounterIndex (stopTime);
+
+  uint32_t sum = 0;
+  if (first < m_prunedIndex)
+    {
+      // The window starts at time zero, and includes all merged indexes
+      sum += counters.pruned;
+    }
+  std::map<uint32_t, uint32_t>::const_iterator end = counters.counts.upper_bound (last);
+  for (auto it = counters.counts.lower_bound (first); it != end; ++it)
+    {
+      sum += (*it).second;
+    }
+  return sum;
+}
+
 ////////////////////////
 // Counting Functions //
 ////////////////////////
@@ -304,6 +583,22 @@ LoraPacketTracker::CountPhyPacketsPerGw (Time startTime, Time stopTime,
 
   std::vector<int> packetCounts (6, 0);
 
+  if (CanUseCounters (startTime, stopTime))
+    {
+      packetCounts.at (0) = SumCounters (m_phySent, startTime, stopTime);
+
+      auto it = m_phyOutcomes.find (gwId);
+      if (it != m_phyOutcomes.end ())
+        {
+          for (uint32_t outcome = 0; outcome < N_PHY_OUTCOMES; outcome++)
+            {
+              packetCounts.at (outcome + 1) = SumCounters ((*it).second[outcome],
+                                                           startTime, stopTime);
+            }
+        }
+      return packetCounts;
+    }
+
   for (auto itPhy = m_packetTracker.begin ();
        itPhy != m_packetTracker.end ();
        ++itPhy)
@@ -356,6 +651,7 @@ LoraPacketTracker::CountPhyPacketsPerGw (Time startTime, Time stopTime,
 
   return packetCounts;
 }
+
 std::string
 LoraPacketTracker::PrintPhyPacketsPerGw (Time startTime, Time stopTime,
                                          int gwId)
@@ -364,57 +660,7 @@ LoraPacketTracker::PrintPhyPacketsPerGw (Time startTime, Time stopTime,
   // the function, the following fields: totPacketsSent receivedPackets
   // interferedPackets noMoreGwPackets underSensitivityPackets lostBecauseTxPackets
 
-  std::vector<int> packetCounts (6, 0);
-
-  for (auto itPhy = m_packetTracker.begin ();
-       itPhy != m_packetTracker.end ();
-       ++itPhy)
-    {
-      if ((*itPhy).second.sendTime >= startTime && (*itPhy).second.sendTime <= stopTime)
-        {
-          packetCounts.at (0)++;
-
-          NS_LOG_DEBUG ("Dealing with packet " << (*itPhy).second.packet);
-          NS_LOG_DEBUG ("This packet was received by " <<
-                        (*itPhy).second.outcomes.size () << " gateways");
-
-          if ((*itPhy).second.outcomes.count (gwId) > 0)
-            {
-              switch ((*itPhy).second.outcomes.at (gwId))
-                {
-                case RECEIVED:
-                  {
-                    packetCounts.at (1)++;
-                    break;
-                  }
-                case INTERFERED:
-                  {
-                    packetCounts.at (2)++;
-                    break;
-                  }
-                case NO_MORE_RECEIVERS:
-                  {
-                    packetCounts.at (3)++;
-                    break;
-                  }
-                case UNDER_SENSITIVITY:
-                  {
-                    packetCounts.at (4)++;
-                    break;
-                  }
-                case LOST_BECAUSE_TX:
-                  {
-                    packetCounts.at (5)++;
-                    break;
-                  }
-                case UNSET:
-                  {
-                    break;
-                  }
-                }
-            }
-        }
-    }
+  std::vector<int> packetCounts = CountPhyPacketsPerGw (startTime, stopTime, gwId);
 
   std::string output ("");
   for (int i = 0; i < 6; ++i)
@@ -432,6 +678,15 @@ LoraPacketTracker::PrintPhyPacketsPerGw (Time startTime, Time stopTime,
 
     double sent = 0;
     double received = 0;
+
+    if (CanUseCounters (startTime, stopTime))
+      {
+        sent = SumCounters (m_macSent, startTime, stopTime);
+        received = SumCounters (m_macReceived, startTime, stopTime);
+        return std::to_string (sent) + " " +
+          std::to_string (received);
+      }
+
     for (auto it = m_macPacketTracker.begin ();
          it != m_macPacketTracker.end ();
          ++it)
@@ -457,6 +712,15 @@ LoraPacketTracker::PrintPhyPacketsPerGw (Time startTime, Time stopTime,
 
     double sent = 0;
     double received = 0;
+
+    if (CanUseCounters (startTime, stopTime))
+      {
+        sent = SumCounters (m_cpsrSent, startTime, stopTime);
+        received = SumCounters (m_cpsrReceived, startTime, stopTime);
+        return std::to_string (sent) + " " +
+          std::to_string (received);
+      }
+
     for (auto it = m_reTransmissionTracker.begin ();
          it != m_reTransmissionTracker.end ();
          ++it)
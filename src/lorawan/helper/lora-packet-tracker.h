@@ -24,8 +24,11 @@
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
 
+#include <deque>
+#include <fstream>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -159,10 +162,150 @@ public:
    * of packets that generated a successful acknowledgment.
    */
   std::string CountMacPacketsGloballyCpsr (Time startTime, Time stopTime);
+
+  /////////////////////////////
+  // Counters and streaming  //
+  /////////////////////////////
+
+  /**
+   * Set the width of the intervals over which packet outcomes are counted.
+   *
+   * Every callback updates the counters of the interval in which its packet
+   * was sent, so the counting functions can answer windows whose bounds are
+   * multiples of the interval by summing counters instead of scanning the
+   * stored packets. Packets sent exactly at the start of an interval are
+   * counted separately, so that such windows are taken as [startTime,
+   * stopTime] like the others, and give the same counts as a scan. Other
+   * windows are still counted by scanning the stored packets.
+   *
+   * Counters are only kept for the intervals in which packets were sent.
+   * With streaming, the counters of the intervals whose records were freed
+   * are merged into a single total, so that memory doesn't grow with the
+   * length of the simulation: windows that start at time zero or within the
+   * retention are still counted exactly, while other windows that start
+   * before the retention are counted by scanning the stored records.
+   *
+   * Counters are rebuilt from the packets that are currently stored. An
+   * interval of zero, the default, disables the counters.
+   */
+  void SetCountingInterval (Time interval);
+
+  /**
+   * Get the width of the intervals over which packet outcomes are counted.
+   */
+  Time GetCountingInterval (void) const;
+
+  /**
+   * Stream the records of packets to a file and remove them from memory.
+   *
+   * Records of packets that were sent more than retention ago are appended
+   * to filename, one per line, and freed. The retention should be longer
+   * than the time it takes for the outcomes of a packet to be known, that
+   * is, longer than the longest time on air. When counters are disabled,
+   * the counting functions only consider the records that are still stored.
+   */
+  void EnableStreaming (std::string filename, Time retention);
+
+  /**
+   * Write all the records that are still stored to the streaming file and
+   * free them. This has no effect if streaming was not enabled.
+   */
+  void FlushRecords (void);
+
+  /**
+   * Get the number of PHY and MAC packet records currently stored.
+   */
+  uint32_t GetNStoredRecords (void) const;
+
+  /**
+   * Get the number of interval counters currently stored.
+   */
+  uint32_t GetNStoredCounters (void) const;
+
 private:
+  /**
+   * Packets counted per counter index. Only indexes with packets have an
+   * entry, and the indexes before m_prunedIndex are merged in pruned.
+   */
+  struct IntervalCounters
+  {
+    IntervalCounters ();
+
+    std::map<uint32_t, uint32_t> counts; //!< Packets, per counter index
+    uint32_t pruned;                      //!< Packets of the merged indexes
+  };
+
+  /**
+   * Store the outcome of a PHY packet at a device and update the counters.
+   */
+  void RecordPhyOutcome (Ptr<Packet const> packet, uint32_t systemId,
+                         enum PhyPacketOutcome outcome);
+
+  /**
+   * Whether the window can be counted with the interval counters.
+   */
+  bool CanUseCounters (Time startTime, Time stopTime) const;
+
+  /**
+   * Get the index of the counters of packets sent at time. Counting interval
+   * i has two indexes: 2i for packets sent exactly at its start, and 2i + 1
+   * for the others.
+   */
+  uint32_t GetCounterIndex (Time time) const;
+
+  /**
+   * Count a packet sent at time.
+   */
+  void Increment (IntervalCounters &counters, Time time);
+
+  /**
+   * Update the counters with a stored record.
+   */
+  void CountPhyRecord (const PacketStatus &status);
+  void CountMacRecord (const MacPacketStatus &status);
+  void CountRetransmissionRecord (const RetransmissionStatus &status);
+
+  /**
+   * Stream and free the records of packets sent before time, and merge the
+   * counters of the intervals that ended before it.
+   */
+  void FlushRecordsBefore (Time time);
+
+  /**
+   * Merge the counters of the indexes before index.
+   */
+  void PruneCounters (IntervalCounters &counters, uint32_t index);
+
+  /**
+   * Sum the counters of the packets sent in [startTime, stopTime].
+   */
+  uint32_t SumCounters (const IntervalCounters &counters, Time startTime,
+                        Time stopTime) const;
+
   PhyPacketData m_packetTracker;
   MacPacketData m_macPacketTracker;
   RetransmissionData m_reTransmissionTracker;
+
+  Time m_countingInterval;              //!< Width of the counting intervals
+  uint32_t m_prunedIndex;               //!< Counter indexes before this are merged
+  IntervalCounters m_phySent;           //!< PHY packets sent
+  /**
+   * PHY packet outcomes, per device, with N_PHY_OUTCOMES counters each, one
+   * per outcome.
+   */
+  std::map<int, std::vector<IntervalCounters> > m_phyOutcomes;
+  IntervalCounters m_macSent;           //!< MAC packets sent
+  IntervalCounters m_macReceived;       //!< MAC packets received
+  IntervalCounters m_cpsrSent;          //!< Packets done retransmitting
+  IntervalCounters m_cpsrReceived;      //!< Successful packets
+
+  bool m_streaming;                     //!< Whether records are streamed to file
+  Time m_retention;                     //!< How long records are kept in memory
+  std::ofstream m_streamFile;           //!< The file records are streamed to
+  std::deque<Ptr<Packet const> > m_phyOrder; //!< Stored PHY packets, by send time
+  std::deque<Ptr<Packet const> > m_macOrder; //!< Stored MAC packets, by send time
+
+  static const uint32_t N_PHY_OUTCOMES = UNSET; //!< Outcomes that are counted
 };
 }
 }
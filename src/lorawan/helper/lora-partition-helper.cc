@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/lora-partition-helper.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/node.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <cmath>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("LoraPartitionHelper");
+
+LoraPartitionHelper::LoraPartitionHelper () :
+  m_radius (6000),
+  m_nPartitions (MpiInterface::IsEnabled () ? MpiInterface::GetSize () : 1),
+  m_stripeWidth (1)
+{
+}
+
+void
+LoraPartitionHelper::SetCellRadius (double radius)
+{
+  NS_ABORT_MSG_IF (radius <= 0, "The radius of the cells must be positive");
+  m_radius = radius;
+}
+
+void
+LoraPartitionHelper::SetNPartitions (uint32_t nPartitions)
+{
+  NS_ABORT_MSG_IF (nPartitions == 0, "At least one partition is needed");
+  m_nPartitions = nPartitions;
+}
+
+void
+LoraPartitionHelper::SetStripeWidth (uint32_t stripeWidth)
+{
+  NS_ABORT_MSG_IF (stripeWidth == 0, "Stripes must be at least one cell wide");
+  m_stripeWidth = stripeWidth;
+}
+
+uint32_t
+LoraPartitionHelper::GetPartition (Vector position) const
+{
+  // HexGridPositionAllocator places the centers of the cells in
+  // a * (0, 2R) + b * (sqrt(3) R, R), for integer a and b. Find the
+  // coordinates of the position in this basis, and round them to the
+  // closest center.
+  double b = position.x / (std::sqrt (3.0) * m_radius);
+  double a = (position.y - m_radius * b) / (2 * m_radius);
+  double c = -a - b;
+
+  double roundedA = std::round (a);
+  double roundedB = std::round (b);
+  double roundedC = std::round (c);
+  double errorA = std::abs (roundedA - a);
+  double errorB = std::abs (roundedB - b);
+  double errorC = std::abs (roundedC - c);
+  if (errorB > errorA && errorB > errorC)
+    {
+      roundedB = -roundedA - roundedC;
+    }
+
+  // Cells with the same b are in the same column
+  int64_t stripe = int64_t (std::floor (roundedB / m_stripeWidth));
+  int64_t partition = stripe % int64_t (m_nPartitions);
+  if (partition < 0)
+    {
+      partition += m_nPartitions;
+    }
+
+  NS_LOG_DEBUG ("Position " << position << " is in column " << roundedB <<
+                ", partition " << partition);
+  return uint32_t (partition);
+}
+
+NodeContainer
+LoraPartitionHelper::Create (Ptr<PositionAllocator> allocator, uint32_t nNodes) const
+{
+  NS_LOG_FUNCTION (this << allocator << nNodes);
+
+  NodeContainer nodes;
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      Vector position = allocator->GetNext ();
+      Ptr<Node> node = CreateObject<Node> (GetPartition (position));
+      Ptr<ConstantPositionMobilityModel> mobility =
+        CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (position);
+      node->AggregateObject (mobility);
+      nodes.Add (node);
+    }
+  return nodes;
+}
+
+}
+}
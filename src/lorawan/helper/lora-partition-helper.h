@@ -0,0 +1,83 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LORA_PARTITION_HELPER_H
+#define LORA_PARTITION_HELPER_H
+
+#include "ns3/node-container.h"
+#include "ns3/position-allocator.h"
+#include "ns3/vector.h"
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Assigns the nodes of a LoRa network to the partitions of a distributed
+ * simulation, based on the gateway region they are in.
+ *
+ * Regions are the hexagonal cells of the grid HexGridPositionAllocator
+ * places gateways on, and partitions are vertical stripes of cells: this
+ * keeps each gateway in the same partition as the devices around it, so
+ * that only transmissions close to the border of a stripe need to be sent
+ * to another partition. Partitions are assigned to stripes cyclically.
+ *
+ * The partition only depends on the position, so all the ranks of the
+ * distributed simulation agree on it as long as they place nodes in the
+ * same positions.
+ */
+class LoraPartitionHelper
+{
+public:
+  LoraPartitionHelper ();
+
+  /**
+   * Set the radius of the cells, which must be the one of the
+   * HexGridPositionAllocator that places the gateways.
+   */
+  void SetCellRadius (double radius);
+
+  /**
+   * Set the number of partitions. By default, it's the number of ranks of
+   * the distributed simulation, or 1 if it is not enabled.
+   */
+  void SetNPartitions (uint32_t nPartitions);
+
+  /**
+   * Set the width of the stripes, in cells.
+   */
+  void SetStripeWidth (uint32_t stripeWidth);
+
+  /**
+   * Get the partition of a node in the given position.
+   */
+  uint32_t GetPartition (Vector position) const;
+
+  /**
+   * Create nodes in the positions returned by the allocator, each one in the
+   * partition of its position, and give them a constant position mobility
+   * model.
+   */
+  NodeContainer Create (Ptr<PositionAllocator> allocator, uint32_t nNodes) const;
+
+private:
+  double m_radius;
+  uint32_t m_nPartitions;
+  uint32_t m_stripeWidth;
+};
+
+}
+}
+#endif
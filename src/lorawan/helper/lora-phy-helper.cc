@@ -38,6 +38,12 @@ LoraPhyHelper::SetChannel (Ptr<LoraChannel> channel)
   m_channel = channel;
 }
 
+Ptr<LoraChannel>
+LoraPhyHelper::GetChannel (void) const
+{
+  return m_channel;
+}
+
 void
 LoraPhyHelper::SetDeviceType (enum DeviceType dt)
 {
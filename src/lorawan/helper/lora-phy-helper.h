@@ -62,6 +62,11 @@ public:
    */
   void SetChannel (Ptr<LoraChannel> channel);
 
+  /**
+   * Get the LoraChannel the PHYs are connected to.
+   */
+  Ptr<LoraChannel> GetChannel (void) const;
+
   /**
    * Set the kind of PHY this helper will create.
    *
@@ -0,0 +1,473 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "lora-trace-sink.h"
+#include "ns3/lora-tag.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include <cmath>
+#include <cstring>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("LoraTraceSink");
+
+namespace {
+
+const char MAGIC[8] = "LORATRC";
+
+struct FieldDescriptor
+{
+  const char *name;
+  uint8_t size;
+  bool isSigned;
+  uint16_t offset;
+};
+
+// The layout of LoraTraceSink::Record on disk
+const FieldDescriptor FIELDS[] = {
+  {"timeNs", 8, true, 0},
+  {"packetUid", 8, false, 8},
+  {"nodeId", 4, false, 16},
+  {"frequencyHz", 4, false, 20},
+  {"size", 2, false, 24},
+  {"event", 1, false, 26},
+  {"sf", 1, false, 27}
+};
+
+const uint16_t N_FIELDS = sizeof (FIELDS) / sizeof (FIELDS[0]);
+
+const char *EVENT_NAMES[LoraTraceSink::N_EVENT_TYPES] = {
+  "PhyTx",
+  "PhyRx",
+  "PhyInterfered",
+  "PhyNoMoreRx",
+  "PhyUnderSens",
+  "PhyLostBecauseTx",
+  "MacTx",
+  "MacRx"
+};
+
+void
+PutLittleEndian (std::vector<uint8_t> &buffer, uint64_t value, uint8_t size)
+{
+  for (uint8_t i = 0; i < size; i++)
+    {
+      buffer.push_back ((value >> (8 * i)) & 0xff);
+    }
+}
+
+void
+PutName (std::vector<uint8_t> &buffer, const std::string &name)
+{
+  for (uint16_t i = 0; i < LoraTraceSink::FIELD_NAME_SIZE; i++)
+    {
+      buffer.push_back (i < name.size () ? name[i] : 0);
+    }
+}
+
+uint64_t
+GetLittleEndian (const uint8_t *data, uint8_t size)
+{
+  uint64_t value = 0;
+  for (uint8_t i = 0; i < size; i++)
+    {
+      value |= uint64_t (data[i]) << (8 * i);
+    }
+  return value;
+}
+
+}
+
+////////////////////
+// LoraTraceSink //
+////////////////////
+
+LoraTraceSink::LoraTraceSink (std::string filename, uint32_t bufferedRecords)
+  : m_bufferedRecords (bufferedRecords),
+    m_nRecords (0)
+{
+  NS_LOG_FUNCTION (this << filename << bufferedRecords);
+
+  NS_ASSERT (m_bufferedRecords > 0);
+
+  m_file.open (filename.c_str (), std::ofstream::out | std::ofstream::trunc |
+               std::ofstream::binary);
+  NS_ABORT_MSG_UNLESS (m_file.is_open (), "Can't open " << filename);
+
+  m_buffer.reserve (m_bufferedRecords * RECORD_SIZE);
+  WriteHeader ();
+}
+
+LoraTraceSink::~LoraTraceSink ()
+{
+  NS_LOG_FUNCTION (this);
+
+  Flush ();
+}
+
+void
+LoraTraceSink::WriteHeader (void)
+{
+  std::vector<uint8_t> header (MAGIC, MAGIC + sizeof (MAGIC));
+  PutLittleEndian (header, VERSION, 2);
+  PutLittleEndian (header, RECORD_SIZE, 2);
+  PutLittleEndian (header, N_FIELDS, 2);
+  for (uint16_t i = 0; i < N_FIELDS; i++)
+    {
+      PutName (header, FIELDS[i].name);
+      PutLittleEndian (header, FIELDS[i].size, 1);
+      PutLittleEndian (header, FIELDS[i].isSigned, 1);
+      PutLittleEndian (header, FIELDS[i].offset, 2);
+    }
+  PutLittleEndian (header, N_EVENT_TYPES, 2);
+  for (uint16_t i = 0; i < N_EVENT_TYPES; i++)
+    {
+      PutName (header, EVENT_NAMES[i]);
+    }
+
+  m_file.write (reinterpret_cast<const char *> (&header[0]), header.size ());
+}
+
+void
+LoraTraceSink::Write (const Record &record)
+{
+  PutLittleEndian (m_buffer, record.timeNs, 8);
+  PutLittleEndian (m_buffer, record.packetUid, 8);
+  PutLittleEndian (m_buffer, record.nodeId, 4);
+  PutLittleEndian (m_buffer, record.frequencyHz, 4);
+  PutLittleEndian (m_buffer, record.size, 2);
+  PutLittleEndian (m_buffer, record.event, 1);
+  PutLittleEndian (m_buffer, record.sf, 1);
+  m_nRecords++;
+
+  if (m_buffer.size () >= m_bufferedRecords * RECORD_SIZE)
+    {
+      Flush ();
+    }
+}
+
+void
+LoraTraceSink::Flush (void)
+{
+  NS_LOG_FUNCTION (this << m_buffer.size ());
+
+  if (!m_buffer.empty ())
+    {
+      m_file.write (reinterpret_cast<const char *> (&m_buffer[0]), m_buffer.size ());
+      m_buffer.clear ();
+    }
+  m_file.flush ();
+}
+
+uint64_t
+LoraTraceSink::GetNRecords (void) const
+{
+  return m_nRecords;
+}
+
+std::string
+LoraTraceSink::GetEventName (uint8_t event)
+{
+  if (event < N_EVENT_TYPES)
+    {
+      return EVENT_NAMES[event];
+    }
+  return "Unknown";
+}
+
+void
+LoraTraceSink::RecordPacket (Ptr<Packet const> packet, uint32_t nodeId,
+                             enum EventType event)
+{
+  Record record;
+  record.timeNs = Simulator::Now ().GetNanoSeconds ();
+  record.packetUid = packet->GetUid ();
+  record.nodeId = nodeId;
+  record.size = packet->GetSize ();
+  record.event = event;
+
+  LoraTag tag;
+  if (packet->PeekPacketTag (tag))
+    {
+      record.frequencyHz = static_cast<uint32_t> (std::round (tag.GetFrequency () * 1e6));
+      record.sf = tag.GetSpreadingFactor ();
+    }
+  else
+    {
+      record.frequencyHz = 0;
+      record.sf = 0;
+    }
+
+  Write (record);
+}
+
+void
+LoraTraceSink::TransmissionCallback (Ptr<Packet const> packet, uint32_t systemId)
+{
+  RecordPacket (packet, systemId, PHY_TX);
+}
+
+void
+LoraTraceSink::PacketReceptionCallback (Ptr<Packet const> packet, uint32_t systemId)
+{
+  RecordPacket (packet, systemId, PHY_RX);
+}
+
+void
+LoraTraceSink::InterferenceCallback (Ptr<Packet const> packet, uint32_t systemId)
+{
+  RecordPacket (packet, systemId, PHY_INTERFERED);
+}
+
+void
+LoraTraceSink::NoMoreReceiversCallback (Ptr<Packet const> packet, uint32_t systemId)
+{
+  RecordPacket (packet, systemId, PHY_NO_MORE_RECEIVERS);
+}
+
+void
+LoraTraceSink::UnderSensitivityCallback (Ptr<Packet const> packet, uint32_t systemId)
+{
+  RecordPacket (packet, systemId, PHY_UNDER_SENSITIVITY);
+}
+
+void
+LoraTraceSink::LostBecauseTxCallback (Ptr<Packet const> packet, uint32_t systemId)
+{
+  RecordPacket (packet, systemId, PHY_LOST_BECAUSE_TX);
+}
+
+void
+LoraTraceSink::MacTransmissionCallback (Ptr<Packet const> packet)
+{
+  RecordPacket (packet, Simulator::GetContext (), MAC_TX);
+}
+
+void
+LoraTraceSink::MacReceptionCallback (Ptr<Packet const> packet)
+{
+  RecordPacket (packet, Simulator::GetContext (), MAC_RX);
+}
+
+/////////////////////
+// LoraTraceReader //
+/////////////////////
+
+LoraTraceReader::LoraTraceReader (std::string filename)
+  : m_valid (false),
+    m_recordSize (0)
+{
+  NS_LOG_FUNCTION (this << filename);
+
+  m_file.open (filename.c_str (), std::ifstream::in | std::ifstream::binary);
+  if (!m_file.is_open ())
+    {
+      NS_LOG_WARN ("Can't open " << filename);
+      return;
+    }
+
+  uint8_t buffer[LoraTraceSink::FIELD_NAME_SIZE];
+
+  // Magic, version, record size and number of fields
+  if (!m_file.read (reinterpret_cast<char *> (buffer), 14)
+      || std::memcmp (buffer, MAGIC, sizeof (MAGIC)) != 0)
+    {
+      NS_LOG_WARN (filename << " is not a LoRa trace");
+      return;
+    }
+  uint16_t version = GetLittleEndian (buffer + 8, 2);
+  m_recordSize = GetLittleEndian (buffer + 10, 2);
+  uint16_t nFields = GetLittleEndian (buffer + 12, 2);
+  if (version == 0 || version > LoraTraceSink::VERSION)
+    {
+      NS_LOG_WARN ("Unsupported trace version " << version);
+      return;
+    }
+  NS_LOG_DEBUG ("Record size " << m_recordSize << ", " << nFields << " fields");
+
+  for (uint16_t i = 0; i < nFields; i++)
+    {
+      Field field;
+      if (!m_file.read (reinterpret_cast<char *> (buffer), LoraTraceSink::FIELD_NAME_SIZE))
+        {
+          return;
+        }
+      field.name = std::string (reinterpret_cast<char *> (buffer),
+                                strnlen (reinterpret_cast<char *> (buffer),
+                                         LoraTraceSink::FIELD_NAME_SIZE));
+      if (!m_file.read (reinterpret_cast<char *> (buffer), 4))
+        {
+          return;
+        }
+      field.size = buffer[0];
+      field.isSigned = buffer[1];
+      field.offset = GetLittleEndian (buffer + 2, 2);
+      if (field.size > 8 || field.offset + field.size > m_recordSize)
+        {
+          NS_LOG_WARN ("Invalid field " << field.name);
+          return;
+        }
+      m_fields.push_back (field);
+      m_fieldNames.push_back (field.name);
+    }
+
+  if (!m_file.read (reinterpret_cast<char *> (buffer), 2))
+    {
+      return;
+    }
+  uint16_t nEvents = GetLittleEndian (buffer, 2);
+  for (uint16_t i = 0; i < nEvents; i++)
+    {
+      if (!m_file.read (reinterpret_cast<char *> (buffer), LoraTraceSink::FIELD_NAME_SIZE))
+        {
+          return;
+        }
+      m_eventNames.push_back (std::string (reinterpret_cast<char *> (buffer),
+                                           strnlen (reinterpret_cast<char *> (buffer),
+                                                    LoraTraceSink::FIELD_NAME_SIZE)));
+    }
+
+  m_raw.resize (m_recordSize);
+  m_valid = true;
+}
+
+bool
+LoraTraceReader::IsValid (void) const
+{
+  return m_valid;
+}
+
+bool
+LoraTraceReader::ReadRaw (void)
+{
+  return m_valid && m_recordSize > 0
+         && m_file.read (reinterpret_cast<char *> (&m_raw[0]), m_recordSize);
+}
+
+uint64_t
+LoraTraceReader::GetFieldValue (const Field &field) const
+{
+  uint64_t value = GetLittleEndian (&m_raw[field.offset], field.size);
+
+  // Sign extend narrower signed fields
+  if (field.isSigned && field.size < 8 && (value >> (8 * field.size - 1)) & 1)
+    {
+      value |= ~uint64_t (0) << (8 * field.size);
+    }
+  return value;
+}
+
+bool
+LoraTraceReader::Read (LoraTraceSink::Record &record)
+{
+  if (!ReadRaw ())
+    {
+      return false;
+    }
+
+  std::memset (&record, 0, sizeof (record));
+  for (auto it = m_fields.begin (); it != m_fields.end (); ++it)
+    {
+      uint64_t value = GetFieldValue (*it);
+      if (it->name == "timeNs")
+        {
+          record.timeNs = value;
+        }
+      else if (it->name == "packetUid")
+        {
+          record.packetUid = value;
+        }
+      else if (it->name == "nodeId")
+        {
+          record.nodeId = value;
+        }
+      else if (it->name == "frequencyHz")
+        {
+          record.frequencyHz = value;
+        }
+      else if (it->name == "size")
+        {
+          record.size = value;
+        }
+      else if (it->name == "event")
+        {
+          record.event = value;
+        }
+      else if (it->name == "sf")
+        {
+          record.sf = value;
+        }
+    }
+  return true;
+}
+
+uint64_t
+LoraTraceReader::ConvertToCsv (std::ostream &os)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (uint16_t i = 0; i < m_fields.size (); i++)
+    {
+      os << (i ? "," : "") << m_fields[i].name;
+    }
+  os << "\n";
+
+  uint64_t nRecords = 0;
+  while (ReadRaw ())
+    {
+      for (uint16_t i = 0; i < m_fields.size (); i++)
+        {
+          const Field &field = m_fields[i];
+          uint64_t value = GetFieldValue (field);
+
+          os << (i ? "," : "");
+          if (field.name == "event" && value < m_eventNames.size ())
+            {
+              os << m_eventNames[value];
+            }
+          else if (field.isSigned)
+            {
+              os << int64_t (value);
+            }
+          else
+            {
+              os << value;
+            }
+        }
+      os << "\n";
+      nRecords++;
+    }
+
+  return nRecords;
+}
+
+const std::vector<std::string> &
+LoraTraceReader::GetFieldNames (void) const
+{
+  return m_fieldNames;
+}
+
+const std::vector<std::string> &
+LoraTraceReader::GetEventNames (void) const
+{
+  return m_eventNames;
+}
+
+}
+}
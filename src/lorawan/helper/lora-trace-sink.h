@@ -0,0 +1,194 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LORA_TRACE_SINK_H
+#define LORA_TRACE_SINK_H
+
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Append-only binary trace of PHY and MAC events.
+ *
+ * The file starts with a header that describes the layout of the records:
+ *
+ * - 8 bytes: the magic string "LORATRC", null terminated
+ * - uint16: format version
+ * - uint16: size of a record, in bytes
+ * - uint16: number of fields N
+ * - N times: field name (16 bytes, null padded), uint8 size in bytes,
+ *   uint8 signedness, uint16 offset in the record
+ * - uint16: number of event types M
+ * - M times: event name (16 bytes, null padded)
+ *
+ * The header is followed by fixed-size records, one per event. All integers
+ * are little endian. Records are buffered in memory and written in blocks.
+ */
+class LoraTraceSink
+{
+public:
+  /**
+   * The events that are recorded. The value of the event field of a record
+   * indexes the event names in the header.
+   */
+  enum EventType
+  {
+    PHY_TX,
+    PHY_RX,
+    PHY_INTERFERED,
+    PHY_NO_MORE_RECEIVERS,
+    PHY_UNDER_SENSITIVITY,
+    PHY_LOST_BECAUSE_TX,
+    MAC_TX,
+    MAC_RX,
+    N_EVENT_TYPES
+  };
+
+  /**
+   * A record of the trace.
+   */
+  struct Record
+  {
+    int64_t timeNs;        //!< Simulation time of the event, in nanoseconds
+    uint64_t packetUid;    //!< Uid of the packet
+    uint32_t nodeId;       //!< Node at which the event happened
+    uint32_t frequencyHz;  //!< Frequency in the packet's LoraTag, if any
+    uint16_t size;         //!< Size of the packet, in bytes
+    uint8_t event;         //!< The EventType
+    uint8_t sf;            //!< Spreading factor in the packet's LoraTag
+  };
+
+  static const uint16_t VERSION = 1;
+  static const uint16_t RECORD_SIZE = 28;
+  static const uint16_t FIELD_NAME_SIZE = 16;
+
+  /**
+   * Create a sink that writes to filename, truncating it, and that writes to
+   * disk every bufferedRecords records.
+   */
+  LoraTraceSink (std::string filename, uint32_t bufferedRecords = 4096);
+  ~LoraTraceSink ();
+
+  /////////////////////////
+  // PHY layer callbacks //
+  /////////////////////////
+  void TransmissionCallback (Ptr<Packet const> packet, uint32_t systemId);
+  void PacketReceptionCallback (Ptr<Packet const> packet, uint32_t systemId);
+  void InterferenceCallback (Ptr<Packet const> packet, uint32_t systemId);
+  void NoMoreReceiversCallback (Ptr<Packet const> packet, uint32_t systemId);
+  void UnderSensitivityCallback (Ptr<Packet const> packet, uint32_t systemId);
+  void LostBecauseTxCallback (Ptr<Packet const> packet, uint32_t systemId);
+
+  /////////////////////////
+  // MAC layer callbacks //
+  /////////////////////////
+  // These use the simulation context as the node id
+  void MacTransmissionCallback (Ptr<Packet const> packet);
+  void MacReceptionCallback (Ptr<Packet const> packet);
+
+  /**
+   * Append a record to the trace.
+   */
+  void Write (const Record &record);
+
+  /**
+   * Write the buffered records to disk.
+   */
+  void Flush (void);
+
+  /**
+   * Get the number of records written so far, including buffered ones.
+   */
+  uint64_t GetNRecords (void) const;
+
+  /**
+   * Get the name of an event, as it appears in the header.
+   */
+  static std::string GetEventName (uint8_t event);
+
+private:
+  void RecordPacket (Ptr<Packet const> packet, uint32_t nodeId,
+                     enum EventType event);
+  void WriteHeader (void);
+
+  std::ofstream m_file;
+  std::vector<uint8_t> m_buffer;     //!< Records waiting to be written
+  uint32_t m_bufferedRecords;        //!< Records to buffer before writing
+  uint64_t m_nRecords;               //!< Records written so far
+};
+
+/**
+ * Reads the traces written by LoraTraceSink.
+ *
+ * Records are decoded with the layout described in the header of the file,
+ * so fields the reader does not know about are still converted to CSV.
+ */
+class LoraTraceReader
+{
+public:
+  LoraTraceReader (std::string filename);
+
+  /**
+   * Whether the file could be opened and has a valid header.
+   */
+  bool IsValid (void) const;
+
+  /**
+   * Read the next record. Returns false at the end of the file.
+   */
+  bool Read (LoraTraceSink::Record &record);
+
+  /**
+   * Convert all the remaining records to CSV, with a line of field names
+   * first. Events are written by name. Returns the number of records.
+   */
+  uint64_t ConvertToCsv (std::ostream &os);
+
+  const std::vector<std::string> &GetFieldNames (void) const;
+  const std::vector<std::string> &GetEventNames (void) const;
+
+private:
+  struct Field
+  {
+    std::string name;
+    uint8_t size;
+    bool isSigned;
+    uint16_t offset;
+  };
+
+  bool ReadRaw (void);
+  uint64_t GetFieldValue (const Field &field) const;
+
+  std::ifstream m_file;
+  bool m_valid;
+  uint16_t m_recordSize;
+  std::vector<Field> m_fields;
+  std::vector<std::string> m_fieldNames;
+  std::vector<std::string> m_eventNames;
+  std::vector<uint8_t> m_raw;        //!< The last record that was read
+};
+
+}
+}
+#endif
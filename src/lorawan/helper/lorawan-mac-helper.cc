@@ -26,6 +26,11 @@
 #include "ns3/lora-net-device.h"
 #include "ns3/log.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/pointer.h"
+
+#include <algorithm>
+#include <thread>
 
 namespace ns3 {
 namespace lorawan {
@@ -95,21 +100,15 @@ LorawanMacHelper::Create (Ptr<Node> node, Ptr<NetDevice> device) const
   Ptr<LorawanMac> mac = m_mac.Create<LorawanMac> ();
   mac->SetDevice (device);
 
-  // If we are operating on an end device, add an address to it
-  if (m_deviceType == ED_A && m_addrGen != 0)
-    {
-      mac->GetObject<ClassAEndDeviceLorawanMac> ()->SetDeviceAddress (m_addrGen->NextAddress ());
-    }
-  else if (m_deviceType == ED_C && m_addrGen != 0)
-    {
-      mac->GetObject<ClassCEndDeviceLorawanMac> ()->SetDeviceAddress (m_addrGen->NextAddress ());
-    }
-
-  // Add a basic list of channels based on the region where the device is
-  // operating
+  // If we are operating on an end device, add an address to it, and add a
+  // basic list of channels based on the region where the device is operating
   if (m_deviceType == ED_A)
     {
       Ptr<ClassAEndDeviceLorawanMac> edMac = mac->GetObject<ClassAEndDeviceLorawanMac> ();
+      if (m_addrGen != 0)
+        {
+          edMac->SetDeviceAddress (m_addrGen->NextAddress ());
+        }
       switch (m_region)
         {
           case LorawanMacHelper::EU: {
@@ -133,6 +132,10 @@ LorawanMacHelper::Create (Ptr<Node> node, Ptr<NetDevice> device) const
   else if (m_deviceType == ED_C)
     {
       Ptr<ClassCEndDeviceLorawanMac> edMac = mac->GetObject<ClassCEndDeviceLorawanMac> ();
+      if (m_addrGen != 0)
+        {
+          edMac->SetDeviceAddress (m_addrGen->NextAddress ());
+        }
       switch (m_region)
         {
         case LorawanMacHelper::EU:
@@ -578,43 +581,91 @@ LorawanMacHelper::SetSpreadingFactorsUp (NodeContainer endDevices, NodeContainer
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  std::vector<int> sfQuantity (7, 0);
+  // Assume devices transmit at 14 dBm
+  double txPowerDbm = 14;
+
+  // Gather the mobility models once, so that the loops below don't need to
+  // go through the objects aggregated to each node
+  std::vector<Ptr<MobilityModel> > gwMobility;
+  gwMobility.reserve (gateways.GetN ());
+  for (NodeContainer::Iterator currentGw = gateways.Begin (); currentGw != gateways.End ();
+       ++currentGw)
+    {
+      gwMobility.push_back ((*currentGw)->GetObject<MobilityModel> ());
+    }
+
+  std::vector<Ptr<MobilityModel> > edMobility;
+  edMobility.reserve (endDevices.GetN ());
   for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j)
     {
-      Ptr<Node> object = *j;
-      Ptr<MobilityModel> position = object->GetObject<MobilityModel> ();
-      NS_ASSERT (position != 0);
-      Ptr<NetDevice> netDevice = object->GetDevice (0);
-      Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice> ();
-      NS_ASSERT (loraNetDevice != 0);
-      Ptr<EndDeviceLorawanMac> mac = loraNetDevice->GetMac ()->GetObject<EndDeviceLorawanMac> ();
-      NS_ASSERT (mac != 0);
+      edMobility.push_back ((*j)->GetObject<MobilityModel> ());
+      NS_ASSERT (edMobility.back () != 0);
+    }
 
-      // Try computing the distance from each gateway and find the best one
-      Ptr<Node> bestGateway = gateways.Get (0);
-      Ptr<MobilityModel> bestGatewayPosition = bestGateway->GetObject<MobilityModel> ();
+  // Use several threads when there is enough work, and the loss model allows
+  // it. Only positions are shared with the threads.
+  PointerValue lossValue;
+  channel->GetAttribute ("PropagationLossModel", lossValue);
+  Ptr<PropagationLossModel> loss = lossValue.Get<PropagationLossModel> ();
 
-      // Assume devices transmit at 14 dBm
-      double highestRxPower = channel->GetRxPower (14, position, bestGatewayPosition);
+  uint64_t nEvaluations = uint64_t (endDevices.GetN ()) * gateways.GetN ();
+  uint32_t nThreads = std::min<uint64_t> (std::thread::hardware_concurrency (),
+                                          nEvaluations / 4096);
 
-      for (NodeContainer::Iterator currentGw = gateways.Begin () + 1; currentGw != gateways.End ();
-           ++currentGw)
+  std::vector<double> highestRxPowers;
+  if (nThreads > 1 && IsLossModelThreadSafe (loss))
+    {
+      std::vector<Vector> edPositions;
+      edPositions.reserve (edMobility.size ());
+      for (auto it = edMobility.begin (); it != edMobility.end (); ++it)
+        {
+          edPositions.push_back ((*it)->GetPosition ());
+        }
+      std::vector<Vector> gwPositions;
+      gwPositions.reserve (gwMobility.size ());
+      for (auto it = gwMobility.begin (); it != gwMobility.end (); ++it)
         {
-          // Compute the power received from the current gateway
-          Ptr<Node> curr = *currentGw;
-          Ptr<MobilityModel> currPosition = curr->GetObject<MobilityModel> ();
-          double currentRxPower = channel->GetRxPower (14, position, currPosition); // dBm
+          gwPositions.push_back ((*it)->GetPosition ());
+        }
 
-          if (currentRxPower > highestRxPower)
+      NS_LOG_DEBUG ("Computing rx powers with " << nThreads << " threads");
+      highestRxPowers = GetHighestRxPowersInParallel (edPositions, gwPositions, loss,
+                                                      txPowerDbm, nThreads);
+    }
+  else
+    {
+      highestRxPowers.reserve (edMobility.size ());
+      for (auto position = edMobility.begin (); position != edMobility.end (); ++position)
+        {
+          // Try computing the distance from each gateway and find the best one
+          double highestRxPower = channel->GetRxPower (txPowerDbm, *position, gwMobility[0]);
+          for (uint32_t gw = 1; gw < gwMobility.size (); gw++)
             {
-              bestGateway = curr;
-              bestGatewayPosition = curr->GetObject<MobilityModel> ();
-              highestRxPower = currentRxPower;
+              // Compute the power received from the current gateway
+              double currentRxPower = channel->GetRxPower (txPowerDbm, *position,
+                                                           gwMobility[gw]); // dBm
+              if (currentRxPower > highestRxPower)
+                {
+                  highestRxPower = currentRxPower;
+                }
             }
+          highestRxPowers.push_back (highestRxPower);
         }
+    }
+
+  std::vector<int> sfQuantity (7, 0);
+  uint32_t device = 0;
+  for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j, ++device)
+    {
+      Ptr<Node> object = *j;
+      Ptr<NetDevice> netDevice = object->GetDevice (0);
+      Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice> ();
+      NS_ASSERT (loraNetDevice != 0);
+      Ptr<EndDeviceLorawanMac> mac = loraNetDevice->GetMac ()->GetObject<EndDeviceLorawanMac> ();
+      NS_ASSERT (mac != 0);
 
       // NS_LOG_DEBUG ("Rx Power: " << highestRxPower);
-      double rxPower = highestRxPower;
+      double rxPower = highestRxPowers[device];
 
       // Get the ED sensitivity
       Ptr<EndDeviceLoraPhy> edPhy = loraNetDevice->GetPhy ()->GetObject<EndDeviceLoraPhy> ();
@@ -714,6 +765,117 @@ LorawanMacHelper::SetSpreadingFactorsUp (NodeContainer endDevices, NodeContainer
 
 } //  end function
 
+bool
+LorawanMacHelper::IsLossModelThreadSafe (Ptr<PropagationLossModel> loss)
+{
+  // Models that only compute a function of the distance or of the positions
+  static const char *threadSafeModels[] = {
+    "ns3::LogDistancePropagationLossModel",
+    "ns3::ThreeLogDistancePropagationLossModel",
+    "ns3::FriisPropagationLossModel",
+    "ns3::TwoRayGroundPropagationLossModel",
+    "ns3::FixedRssLossModel",
+    "ns3::RangePropagationLossModel"
+  };
+
+  for (Ptr<PropagationLossModel> model = loss; model != 0; model = model->GetNext ())
+    {
+      std::string name = model->GetInstanceTypeId ().GetName ();
+      bool threadSafe = false;
+      for (uint32_t i = 0; i < sizeof (threadSafeModels) / sizeof (threadSafeModels[0]); i++)
+        {
+          if (name == threadSafeModels[i])
+            {
+              threadSafe = true;
+              break;
+            }
+        }
+      if (!threadSafe)
+        {
+          NS_LOG_DEBUG (name << " may not be thread safe");
+          return false;
+        }
+    }
+  return loss != 0;
+}
+
+std::vector<double>
+LorawanMacHelper::GetHighestRxPowersInParallel (const std::vector<Vector> &edPositions,
+                                                const std::vector<Vector> &gwPositions,
+                                                Ptr<PropagationLossModel> loss,
+                                                double txPowerDbm, uint32_t nThreads)
+{
+  NS_LOG_FUNCTION (edPositions.size () << gwPositions.size () << loss << nThreads);
+
+  std::vector<double> highestRxPowers (edPositions.size ());
+
+  // Loss models take mobility models, so each thread gets its own pair, moved
+  // to the positions of the devices it considers. Objects are created here,
+  // since reference counts are not thread safe, and threads only use the
+  // ones they own.
+  std::vector<Ptr<ConstantPositionMobilityModel> > edMobility;
+  std::vector<Ptr<ConstantPositionMobilityModel> > gwMobility;
+  for (uint32_t t = 0; t < nThreads; t++)
+    {
+      edMobility.push_back (CreateObject<ConstantPositionMobilityModel> ());
+      gwMobility.push_back (CreateObject<ConstantPositionMobilityModel> ());
+    }
+
+  // Each thread gets a contiguous block of devices, and goes through the
+  // gateway positions for each of them
+  std::vector<std::thread> threads;
+  uint32_t blockSize = (edPositions.size () + nThreads - 1) / nThreads;
+  for (uint32_t t = 0; t < nThreads; t++)
+    {
+      uint32_t first = std::min<size_t> (t * blockSize, edPositions.size ());
+      uint32_t last = std::min<size_t> (first + blockSize, edPositions.size ());
+      threads.push_back (std::thread (&LorawanMacHelper::ComputeHighestRxPowers,
+                                      &edPositions, &gwPositions, PeekPointer (loss),
+                                      PeekPointer (edMobility[t]), PeekPointer (gwMobility[t]),
+                                      txPowerDbm, first, last, &highestRxPowers));
+    }
+  for (auto it = threads.begin (); it != threads.end (); ++it)
+    {
+      it->join ();
+    }
+
+  return highestRxPowers;
+}
+
+void
+LorawanMacHelper::ComputeHighestRxPowers (const std::vector<Vector> *edPositions,
+                                          const std::vector<Vector> *gwPositions,
+                                          PropagationLossModel *loss,
+                                          ConstantPositionMobilityModel *edMobility,
+                                          ConstantPositionMobilityModel *gwMobility,
+                                          double txPowerDbm, uint32_t first, uint32_t last,
+                                          std::vector<double> *highestRxPowers)
+{
+  // These only reference objects owned by this thread
+  Ptr<MobilityModel> ed = edMobility;
+  Ptr<MobilityModel> gw = gwMobility;
+
+  for (uint32_t device = first; device < last; device++)
+    {
+      ed->SetPosition ((*edPositions)[device]);
+
+      // Gateways are considered in the same order as the sequential path, so
+      // that ties are broken in the same way
+      gw->SetPosition ((*gwPositions)[0]);
+      double highestRxPower = loss->CalcRxPower (txPowerDbm, ed, gw);
+      for (uint32_t j = 1; j < gwPositions->size (); j++)
+        {
+          gw->SetPosition ((*gwPositions)[j]);
+          double currentRxPower = loss->CalcRxPower (txPowerDbm, ed, gw);
+          if (currentRxPower > highestRxPower)
+            {
+              highestRxPower = currentRxPower;
+            }
+        }
+      (*highestRxPowers)[device] = highestRxPower;
+    }
+}
+
 std::vector<int>
 LorawanMacHelper::SetSpreadingFactorsGivenDistribution (NodeContainer endDevices,
                                                         NodeContainer gateways,
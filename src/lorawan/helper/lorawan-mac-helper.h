@@ -33,6 +33,11 @@
 #include "ns3/gateway-lorawan-mac.h"
 #include "ns3/node-container.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/vector.h"
+
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -118,6 +123,14 @@ public:
    * SF10 -> DR2
    * SF11 -> DR1
    * SF12 -> DR0
+   *
+   * The power each gateway receives from each device is computed on all the
+   * cores of the machine when the channel's loss model is known to only
+   * depend on the positions of the devices (see IsLossModelThreadSafe), and
+   * sequentially otherwise. The result is the same in both cases.
+   *
+   * \return The number of devices that were given each SF, from SF7 to SF12,
+   * followed by the number of devices that are out of range of all gateways.
    */
   static std::vector<int> SetSpreadingFactorsUp (NodeContainer endDevices, NodeContainer gateways,
                                                  Ptr<LoraChannel> channel);
@@ -128,7 +141,37 @@ public:
                                                                 NodeContainer gateways,
                                                                 std::vector<double> distribution);
 
+  /**
+   * Whether a loss model, and all the ones chained to it, compute the loss
+   * only from the positions of the two devices, without changing their state
+   * or using random variables, so that they can be used by several threads
+   * at the same time.
+   */
+  static bool IsLossModelThreadSafe (Ptr<PropagationLossModel> loss);
+
 private:
+  /**
+   * Compute, for each device, the highest power received by a gateway, using
+   * several threads. Devices are assumed to transmit at txPowerDbm.
+   */
+  static std::vector<double> GetHighestRxPowersInParallel (const std::vector<Vector> &edPositions,
+                                                           const std::vector<Vector> &gwPositions,
+                                                           Ptr<PropagationLossModel> loss,
+                                                           double txPowerDbm, uint32_t nThreads);
+
+  /**
+   * Compute the highest received power of the devices from first to last,
+   * excluded. This runs in its own thread, and only uses the mobility models
+   * it is given.
+   */
+  static void ComputeHighestRxPowers (const std::vector<Vector> *edPositions,
+                                      const std::vector<Vector> *gwPositions,
+                                      PropagationLossModel *loss,
+                                      ConstantPositionMobilityModel *edMobility,
+                                      ConstantPositionMobilityModel *gwMobility,
+                                      double txPowerDbm, uint32_t first, uint32_t last,
+                                      std::vector<double> *highestRxPowers);
+
   /**
    * Perform region-specific configurations for the 868 MHz EU band.
    */
@@ -48,6 +48,7 @@ PeriodicSenderHelper::PeriodicSenderHelper ()
 
   m_pktSize = 10;
   m_pktSizeRV = 0;
+  m_calendar = 0;
 }
 
 PeriodicSenderHelper::~PeriodicSenderHelper ()
@@ -124,6 +125,10 @@ PeriodicSenderHelper::InstallPriv (Ptr<Node> node) const
     {
       app->SetPacketSizeRandomVariable (m_pktSizeRV);
     }
+  if (m_calendar)
+    {
+      app->SetCalendar (m_calendar);
+    }
 
   app->SetNode (node);
   node->AddApplication (app);
@@ -149,5 +154,20 @@ PeriodicSenderHelper::SetPacketSize (uint8_t size)
   m_pktSize = size;
 }
 
+void
+PeriodicSenderHelper::EnableCalendar (void)
+{
+  if (!m_calendar)
+    {
+      m_calendar = CreateObject<PeriodicSenderCalendar> ();
+    }
+}
+
+Ptr<PeriodicSenderCalendar>
+PeriodicSenderHelper::GetCalendar (void) const
+{
+  return m_calendar;
+}
+
 }
 } // namespace ns3
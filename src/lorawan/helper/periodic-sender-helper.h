@@ -65,6 +65,23 @@ public:
 
   void SetPacketSize (uint8_t size);
 
+  /**
+   * Drive all the applications created by this helper from now on with a
+   * single PeriodicSenderCalendar, instead of letting each application
+   * schedule its own events.
+   *
+   * This keeps the simulator's event queue small in networks with many
+   * devices, while each application sends its packets at the same times.
+   */
+  void EnableCalendar (void);
+
+  /**
+   * Get the calendar driving the applications created by this helper.
+   *
+   * \return The calendar, or 0 if it was not enabled.
+   */
+  Ptr<PeriodicSenderCalendar> GetCalendar (void) const;
+
 
 private:
   Ptr<Application> InstallPriv (Ptr<Node> node) const;
@@ -82,6 +99,8 @@ private:
 
   uint8_t m_pktSize; // the packet size.
 
+  Ptr<PeriodicSenderCalendar> m_calendar; //!< The calendar of the applications, if any
+
 };
 
 } // namespace ns3
@@ -20,6 +20,8 @@
 
 #include "ns3/adr-component.h"
 
+#include <algorithm>
+
 namespace ns3 {
 namespace lorawan {
 
@@ -79,11 +81,14 @@ AdrComponent::~AdrComponent ()
 {
 }
 
-void AdrComponent::OnReceivedPacket (Ptr<const Packet> packet,
+void AdrComponent::OnReceivedPacket (const UplinkContext &uplink,
                                      Ptr<EndDeviceStatus> status,
                                      Ptr<NetworkStatus> networkStatus)
 {
-  NS_LOG_FUNCTION (this->GetTypeId () << packet << networkStatus);
+  NS_LOG_FUNCTION (this->GetTypeId () << uplink.packet << networkStatus);
+
+  // Make sure the device's history is long enough for the algorithm
+  status->ReserveReceivedPacketHistory (historyRange);
 
   // We will only act just before reply, when all Gateways will have received
   // the packet, since we need their respective received power.
@@ -95,19 +100,15 @@ AdrComponent::BeforeSendingReply (Ptr<EndDeviceStatus> status,
 {
   NS_LOG_FUNCTION (this << status << networkStatus);
 
-  Ptr<Packet> myPacket = status->GetLastPacketReceivedFromDevice ()->Copy ();
-  LorawanMacHeader mHdr;
-  LoraFrameHeader fHdr;
-  fHdr.SetAsUplink ();
-  myPacket->RemoveHeader (mHdr);
-  myPacket->RemoveHeader (fHdr);
+  // Use the frame header that was parsed when the packet was received
+  const EndDeviceStatus::ReceivedPacketList &packetList = status->GetReceivedPacketList ();
 
   //Execute the ADR algotithm only if the request bit is set
-  if (fHdr.GetAdr ())
+  if (packetList.GetSize () > 0 && packetList.Back ().second.frameHeader.GetAdr ())
     {
-      if (int(status->GetReceivedPacketList ().size ()) < historyRange)
+      if (int(status->GetReceivedPacketList ().GetSize ()) < historyRange)
         {
-          NS_LOG_ERROR ("Not enough packets received by this device (" << status->GetReceivedPacketList ().size () << ") for the algorithm to work (need " << historyRange << ")");
+          NS_LOG_ERROR ("Not enough packets received by this device (" << status->GetReceivedPacketList ().GetSize () << ") for the algorithm to work (need " << historyRange << ")");
         }
       else
         {
@@ -287,145 +288,84 @@ double AdrComponent::RxPowerToSNR (double transmissionPower)
   return transmissionPower + 174 - 10 * log10 (B) - NF;
 }
 
-//Get the maximum received power (it considers the values in dB!)
-double AdrComponent::GetMinTxFromGateways (EndDeviceStatus::GatewayList gwList)
-{
-  EndDeviceStatus::GatewayList::iterator it = gwList.begin ();
-  double min = it->second.rxPower;
-
-  for (; it != gwList.end (); it++)
-    {
-      if (it->second.rxPower < min)
-        {
-          min = it->second.rxPower;
-        }
-    }
-
-  return min;
-}
-
-//Get the maximum received power (it considers the values in dB!)
-double AdrComponent::GetMaxTxFromGateways (EndDeviceStatus::GatewayList gwList)
-{
-  EndDeviceStatus::GatewayList::iterator it = gwList.begin ();
-  double max = it->second.rxPower;
-
-  for (; it != gwList.end (); it++)
-    {
-      if (it->second.rxPower > max)
-        {
-          max = it->second.rxPower;
-        }
-    }
-
-  return max;
-}
-
-//Get the maximum received power
-double AdrComponent::GetAverageTxFromGateways (EndDeviceStatus::GatewayList gwList)
-{
-  double sum = 0;
-
-  for (EndDeviceStatus::GatewayList::iterator it = gwList.begin (); it != gwList.end (); it++)
-    {
-      NS_LOG_DEBUG ("Gateway at " << it->first << " has TP " << it->second.rxPower);
-      sum += it->second.rxPower;
-    }
-
-  double average = sum / gwList.size ();
-
-  NS_LOG_DEBUG ("TP (average) = " << average);
-
-  return average;
-}
-
-double
-AdrComponent::GetReceivedPower (EndDeviceStatus::GatewayList gwList)
+enum EndDeviceStatus::ReceivedPacketList::RxPowerStatistic
+AdrComponent::GetRxPowerStatistic (void)
 {
   switch (tpAveraging)
     {
-    case AdrComponent::AVERAGE:
-      return GetAverageTxFromGateways (gwList);
     case AdrComponent::MAXIMUM:
-      return GetMaxTxFromGateways (gwList);
+      return EndDeviceStatus::ReceivedPacketList::MAX_RX_POWER;
     case AdrComponent::MINIMUM:
-      return GetMinTxFromGateways (gwList);
+      return EndDeviceStatus::ReceivedPacketList::MIN_RX_POWER;
     default:
-      return -1;
+      return EndDeviceStatus::ReceivedPacketList::AVERAGE_RX_POWER;
     }
 }
 
-// TODO Make this more elegant
-double AdrComponent::GetMinSNR (EndDeviceStatus::ReceivedPacketList packetList,
+// The received power of each packet, combined over the gateways that
+// received it, is kept by the packet list in a contiguous array, so the
+// following functions are single passes over plain doubles. Since
+// RxPowerToSNR is monotonic, the minimum (maximum) SNR is the SNR of the
+// minimum (maximum) power. The average, instead, converts each value and sums
+// from the most recent packet backwards, like it was always done, so that
+// rounding and thus ADR decisions stay the same.
+double AdrComponent::GetMinSNR (const EndDeviceStatus::ReceivedPacketList &packetList,
                                 int historyRange)
 {
-  double m_SNR;
-
-  //Take elements from the list starting at the end
-  auto it = packetList.rbegin ();
-  double min = RxPowerToSNR (GetReceivedPower (it->second.gwList));
+  // The most recent packet is always considered
+  int n = std::max (historyRange, 1);
+  const double *rxPower = packetList.GetRxPowerHistory (GetRxPowerStatistic (), n);
 
-  for (int i = 0; i < historyRange; i++, it++)
+  double min = rxPower[n - 1];
+  for (int i = n - 2; i >= 0; i--)
     {
-      m_SNR = RxPowerToSNR (GetReceivedPower (it->second.gwList));
-
-      NS_LOG_DEBUG ("Received power: " << GetReceivedPower (it->second.gwList));
-      NS_LOG_DEBUG ("m_SNR = " << m_SNR);
-
-      if (m_SNR < min)
+      if (rxPower[i] < min)
         {
-          min = m_SNR;
+          min = rxPower[i];
         }
     }
 
-  NS_LOG_DEBUG ("SNR (min) = " << min);
+  NS_LOG_DEBUG ("SNR (min) = " << RxPowerToSNR (min));
 
-  return min;
+  return RxPowerToSNR (min);
 }
 
-double AdrComponent::GetMaxSNR (EndDeviceStatus::ReceivedPacketList packetList,
+double AdrComponent::GetMaxSNR (const EndDeviceStatus::ReceivedPacketList &packetList,
                                 int historyRange)
 {
-  double m_SNR;
-
-  //Take elements from the list starting at the end
-  auto it = packetList.rbegin ();
-  double max = RxPowerToSNR (GetReceivedPower (it->second.gwList));
+  // The most recent packet is always considered
+  int n = std::max (historyRange, 1);
+  const double *rxPower = packetList.GetRxPowerHistory (GetRxPowerStatistic (), n);
 
-  for (int i = 0; i < historyRange; i++, it++)
+  double max = rxPower[n - 1];
+  for (int i = n - 2; i >= 0; i--)
     {
-      m_SNR = RxPowerToSNR (GetReceivedPower (it->second.gwList));
-
-      NS_LOG_DEBUG ("Received power: " << GetReceivedPower (it->second.gwList));
-      NS_LOG_DEBUG ("m_SNR = " << m_SNR);
-
-      if (m_SNR > max)
+      if (rxPower[i] > max)
         {
-          max = m_SNR;
+          max = rxPower[i];
         }
     }
 
-  NS_LOG_DEBUG ("SNR (max) = " << max);
+  NS_LOG_DEBUG ("SNR (max) = " << RxPowerToSNR (max));
 
-  return max;
+  return RxPowerToSNR (max);
 }
 
-double AdrComponent::GetAverageSNR (EndDeviceStatus::ReceivedPacketList packetList,
+double AdrComponent::GetAverageSNR (const EndDeviceStatus::ReceivedPacketList &packetList,
                                     int historyRange)
 {
   double sum = 0;
-  double m_SNR;
 
-  //Take elements from the list starting at the end
-  auto it = packetList.rbegin ();
-  for (int i = 0; i < historyRange; i++, it++)
+  if (historyRange > 0)
     {
-      m_SNR = RxPowerToSNR (GetReceivedPower (it->second.gwList));
-
-      NS_LOG_DEBUG ("Received power: " << GetReceivedPower (it->second.gwList));
-      NS_LOG_DEBUG ("m_SNR = " << m_SNR);
+      const double *rxPower = packetList.GetRxPowerHistory (GetRxPowerStatistic (),
+                                                            historyRange);
 
-      sum += m_SNR;
+      //Take elements starting from the most recent one
+      for (int i = historyRange - 1; i >= 0; i--)
+        {
+          sum += RxPowerToSNR (rxPower[i]);
+        }
     }
 
   double average = sum / historyRange;
@@ -51,7 +51,7 @@ public:
   //Destructor
   virtual ~AdrComponent ();
 
-  void OnReceivedPacket (Ptr<const Packet> packet,
+  void OnReceivedPacket (const UplinkContext &uplink,
                          Ptr<EndDeviceStatus> status,
                          Ptr<NetworkStatus> networkStatus);
 
@@ -69,21 +69,19 @@ private:
 
   double RxPowerToSNR (double transmissionPower);
 
-  double GetMinTxFromGateways (EndDeviceStatus::GatewayList gwList);
+  /**
+   * Get how the received power of a packet at different gateways is
+   * combined, according to the MultipleGwCombiningMethod attribute.
+   */
+  enum EndDeviceStatus::ReceivedPacketList::RxPowerStatistic GetRxPowerStatistic (void);
 
-  double GetMaxTxFromGateways (EndDeviceStatus::GatewayList gwList);
-
-  double GetAverageTxFromGateways (EndDeviceStatus::GatewayList gwList);
-
-  double GetReceivedPower (EndDeviceStatus::GatewayList gwList);
-
-  double GetMinSNR (EndDeviceStatus::ReceivedPacketList packetList,
+  double GetMinSNR (const EndDeviceStatus::ReceivedPacketList &packetList,
                     int historyRange);
 
-  double GetMaxSNR (EndDeviceStatus::ReceivedPacketList packetList,
+  double GetMaxSNR (const EndDeviceStatus::ReceivedPacketList &packetList,
                     int historyRange);
 
-  double GetAverageSNR (EndDeviceStatus::ReceivedPacketList packetList,
+  double GetAverageSNR (const EndDeviceStatus::ReceivedPacketList &packetList,
                         int historyRange);
 
   int GetTxPowerIndex (int txPower);
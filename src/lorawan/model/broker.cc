@@ -10,7 +10,11 @@
 #include "ns3/node-container.h"
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/mac-command.h"
+#include "ns3/uplink-context.h"
 #include "ns3/mqtt-tag.h"
+#include "ns3/enum.h"
+
+#include <set>
 
 namespace ns3 {
 namespace lorawan {
@@ -30,8 +34,16 @@ BrokerServer::GetTypeId (void)
                            "Trace source that is fired when a packet arrives at the Broker Server",
                            MakeTraceSourceAccessor (&BrokerServer::m_receivedPacket),
                            "ns3::Packet::TracedCallback")
-          .AddAttribute ("pubDelay", "Delay between publish", DoubleValue (0.0),
+          .AddAttribute ("pubDelay",
+                         "Delay between publishes sent through the same gateway (s)",
+                         DoubleValue (0.0),
                          MakeDoubleAccessor (&BrokerServer::m_delay), MakeDoubleChecker<double> ())
+          .AddAttribute ("DownlinkMode",
+                         "How publishes are delivered to subscribers",
+                         EnumValue (BrokerServer::UNICAST),
+                         MakeEnumAccessor (&BrokerServer::m_downlinkMode),
+                         MakeEnumChecker (BrokerServer::UNICAST, "Unicast",
+                                          BrokerServer::MULTICAST, "Multicast"))
           .SetGroupName ("lorawan");
   return tid;
 }
@@ -138,60 +150,51 @@ BrokerServer::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t
 {
   NS_LOG_FUNCTION (this << packet << protocol << address);
 
-  // Create a copy of the packet
-  Ptr<Packet> myPacket = packet->Copy ();
-  Ptr<Packet> npacket = packet->Copy ();
-
   // Fire the trace source
   m_receivedPacket (packet);
 
+  // Parse the packet once, and share the result with the other components
+  UplinkContext uplink (packet);
+
   // Inform the scheduler of the newly arrived packet
-  m_scheduler->OnReceivedPacket (packet);
+  m_scheduler->OnReceivedPacket (uplink);
 
   // Inform the status of the newly arrived packet
-  m_status->OnReceivedPacket (packet, address);
+  m_status->OnReceivedPacket (uplink, address);
 
   // Inform the controller of the newly arrived packet
-  m_controller->OnNewPacket (packet);
+  m_controller->OnNewPacket (uplink);
 
-  // Here remove MQTT TAG and inspect Type of message
+  // Here inspect the MQTT TAG to find the Type of message
   mqttTag mqtt;
-  myPacket->RemovePacketTag (mqtt);
+  packet->PeekPacketTag (mqtt);
   double messageType;
   messageType = mqtt.GetType ();
 
-  //Remove Frame Header to find ED address
-  LorawanMacHeader macHdr;
-  myPacket->RemoveHeader (macHdr);
-  LoraFrameHeader frameHdr;
-  frameHdr.SetAsUplink ();
-  myPacket->RemoveHeader (frameHdr);
-  LoraDeviceAddress edAddr = frameHdr.GetAddress ();
+  // Use the Frame Header to find ED address
+  LoraDeviceAddress edAddr = uplink.frameHeader.GetAddress ();
 
   std::string topic;
   std::string MSG;
 
-  uint8_t *buffer = new uint8_t[packet->GetSize ()];
-  packet->CopyData (buffer, packet->GetSize ());
-  std::string data = std::string (buffer, buffer + packet->GetSize ());
-  data.erase (0, 9);
-  std::string w = "";
-  for (auto x : data)
+  // The payload is in the form "topic,message": the message is what follows
+  // the last comma, and the topic is the field before it
+  uint32_t size = uplink.payload->GetSize ();
+  std::vector<uint8_t> buffer (size);
+  uplink.payload->CopyData (buffer.data (), size);
+  std::string data = std::string (buffer.begin (), buffer.end ());
+  size_t separator = data.rfind (',');
+  if (separator != std::string::npos)
     {
-      if (x == ',')
-        {
-          topic = w;
-          w = "";
-        }
-      else
-        {
-          w = w + x;
-        }
+      size_t previous = separator > 0 ? data.rfind (',', separator - 1) : std::string::npos;
+      size_t start = previous == std::string::npos ? 0 : previous + 1;
+      topic = data.substr (start, separator - start);
+      MSG = data.substr (separator + 1);
+    }
+  else
+    {
+      MSG = data;
     }
-  MSG = w;
-    // NS_LOG_UNCOND ("TOPIC: " << topic);
-    // NS_LOG_UNCOND ("MSG: " << MSG);
-  //   NS_LOG_UNCOND ("TYPE: " << messageType);
 
   switch (int (messageType))
     {
@@ -199,7 +202,10 @@ BrokerServer::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t
       SubscribeToTopic (topic, edAddr);
       break;
     case 1: // Publish
-      SendToSubscribers (topic, MSG, npacket);
+      SendToSubscribers (topic, MSG, uplink.payload->Copy ());
+      break;
+    case 2: // Unsubscribe
+      UnsubscribeFromTopic (topic, edAddr);
       break;
     }
 
@@ -223,65 +229,186 @@ BrokerServer::GetNetworkStatus (void)
 void
 BrokerServer::SubscribeToTopic (std::string topic, LoraDeviceAddress address)
 {
+  NS_LOG_FUNCTION (this << topic << address);
 
-  std::vector<LoraDeviceAddress> add;
-  add.push_back (address);
-  std::map<std::string, std::vector<LoraDeviceAddress>>::iterator it = m_addresses.find (topic);
-  std::vector<LoraDeviceAddress> &addvec = it->second;
-  // Check if Topic exists; If so add address to list
-  if (m_addresses.find (topic) != m_addresses.end ())
+  if (!m_subscriptions.Subscribe (topic, address))
     {
-      addvec.push_back (address);
+      NS_LOG_DEBUG ("Device " << address << " is already subscribed to \"" << topic << "\"");
     }
-  else
+
+  // Class C devices subscribing to a multicast topic join its group
+  auto group = m_multicastGroups.find (topic);
+  Ptr<ClassCEndDeviceLorawanMac> mac = GetClassCMac (address);
+  if (group != m_multicastGroups.end () && mac != 0)
+    {
+      mac->AddMulticastGroup (group->second);
+    }
+}
+
+void
+BrokerServer::UnsubscribeFromTopic (std::string topic, LoraDeviceAddress address)
+{
+  NS_LOG_FUNCTION (this << topic << address);
+
+  if (!m_subscriptions.Unsubscribe (topic, address))
     {
-      // Create new topic and List of Addresses associated
-      m_addresses.insert ({topic, add});
+      NS_LOG_DEBUG ("Device " << address << " was not subscribed to \"" << topic << "\"");
     }
-  //   NS_LOG_UNCOND ("Topic: \"" << topic << "\" List of adresses: ");
-  //   for (size_t i = 0; i < addvec.size (); i++)
-  //     {
-  //       NS_LOG_UNCOND (addvec[i]);
-  //     }
-  //   NS_LOG_UNCOND ("\n");
+
+  auto group = m_multicastGroups.find (topic);
+  Ptr<ClassCEndDeviceLorawanMac> mac = GetClassCMac (address);
+  if (group != m_multicastGroups.end () && mac != 0)
+    {
+      mac->RemoveMulticastGroup (group->second);
+    }
+}
+
+void
+BrokerServer::SetMulticastGroup (std::string topic, LoraDeviceAddress groupAddress)
+{
+  NS_LOG_FUNCTION (this << topic << groupAddress);
+
+  m_multicastGroups[topic] = groupAddress;
 }
 
 void
 BrokerServer::SendToSubscribers (std::string topic, std::string MSG, Ptr<Packet> data)
 {
-  //Check if topic exists, if not error
-  if (m_addresses.find (topic) == m_addresses.end ())
+  // Find the devices whose subscriptions match the topic
+  std::vector<LoraDeviceAddress> addresses;
+  m_subscriptions.Match (topic, addresses);
+
+  //Check if topic has subscribers, if not error
+  if (addresses.empty ())
     {
       NS_LOG_UNCOND (
           "You tried to Publish to a topic but it doesn't exist.");
-    }else{
-  std::map<std::string, std::vector<LoraDeviceAddress>>::iterator it = m_addresses.find (topic);
-  std::vector<LoraDeviceAddress> &addresses = it->second;
+      return;
+    }
+
   std::string Msg;
   Msg.append (topic);
   Msg.append (",");
   Msg.append (MSG);
-  for (size_t i = 0; i < addresses.size (); i++)
+
+  // Create the packet only once: the downlinks will share its buffer
+  Ptr<Packet> packet = Create<Packet> ((uint8_t *) Msg.data (), Msg.length ());
+
+  // Members of the topic's multicast group only need one downlink for each
+  // gateway serving them
+  auto multicastGroup = m_multicastGroups.find (topic);
+  bool useMulticast = (m_downlinkMode == MULTICAST && multicastGroup != m_multicastGroups.end ());
+  std::set<Address> multicastGateways;
+
+  // Without a delay, the other subscribers are served at once, in the order
+  // they subscribed. With a delay, they are batched by the gateway that is
+  // going to serve them, so that the delay spaces the downlinks of each
+  // gateway, and the batches are kept in the order of their first
+  // subscriber.
+  std::vector<std::shared_ptr<std::vector<Downlink> > > batches;
+  std::map<Address, uint32_t> batchIndexes;
+  for (auto it = addresses.begin (); it != addresses.end (); ++it)
     {
-      //  if (address = Lora)
-      // {
-      // Create new packet to send with MSG inside
-
-      uint8_t *buffer = (uint8_t *) &Msg[0];
-      uint32_t size = Msg.length ();
-      Ptr<Packet> packet =
-          Create<Packet> (buffer, size); //reinterpret_cast<const uint8_t *> (MSG), MSG.length ()
-      // Send through Lora
-      //data->RemoveAllPacketTags();
-      Simulator::Schedule (Seconds ((i * m_delay)), &BrokerServer::SendLora, this, packet,
-                           addresses[i]);
-      // }
-      // else if (address = CSMA)
-      // {
-      //     // Send through CSMA
-      //     Simulator::Schedule(Seconds(0), &BrokerServer::SendCSMA, this, packetCopy, LoraDeviceAddress(addresses[i]));
-      // }
-    }}
+      Address gwAddress = GetPreferredGateway (*it);
+      Ptr<ClassCEndDeviceLorawanMac> mac = GetClassCMac (*it);
+      if (useMulticast && !(gwAddress == Address ()) && mac != 0
+          && mac->IsMulticastGroupMember (multicastGroup->second))
+        {
+          multicastGateways.insert (gwAddress);
+          continue;
+        }
+
+      uint32_t index = 0;
+      if (m_delay != 0)
+        {
+          index = batchIndexes.insert (std::make_pair (gwAddress, batches.size ())).first->second;
+        }
+      if (index == batches.size ())
+        {
+          batches.push_back (std::make_shared<std::vector<Downlink> > ());
+        }
+      batches[index]->push_back (Downlink (*it, gwAddress));
+    }
+
+  if (!multicastGateways.empty ())
+    {
+      NS_LOG_DEBUG ("Sending to multicast group " << multicastGroup->second << " through "
+                                                  << multicastGateways.size () << " gateways");
+      Simulator::Schedule (Seconds (0), &BrokerServer::SendLoraMulticast, this, packet,
+                           multicastGroup->second,
+                           std::vector<Address> (multicastGateways.begin (),
+                                                 multicastGateways.end ()));
+    }
+
+  // Send through Lora, with one event for each batch
+  for (auto it = batches.begin (); it != batches.end (); ++it)
+    {
+      NS_LOG_DEBUG ("Sending to a batch of " << (*it)->size () << " subscribers");
+      Simulator::Schedule (Seconds (0), &BrokerServer::SendLoraBatch, this, packet,
+                           std::shared_ptr<const std::vector<Downlink> > (*it), 0);
+    }
+}
+
+Ptr<ClassCEndDeviceLorawanMac>
+BrokerServer::GetClassCMac (LoraDeviceAddress address)
+{
+  Ptr<EndDeviceStatus> status = m_status->GetEndDeviceStatus (address);
+  if (status == 0)
+    {
+      return 0;
+    }
+  return status->GetMac ()->GetObject<ClassCEndDeviceLorawanMac> ();
+}
+
+void
+BrokerServer::SendLoraMulticast (Ptr<Packet> data, LoraDeviceAddress groupAddress,
+                                 std::vector<Address> gwAddresses)
+{
+  NS_LOG_FUNCTION (this << data << groupAddress << gwAddresses.size ());
+  m_scheduler->DoSendMulticast (data, groupAddress, gwAddresses);
+}
+
+Address
+BrokerServer::GetPreferredGateway (LoraDeviceAddress address)
+{
+  Ptr<EndDeviceStatus> status = m_status->GetEndDeviceStatus (address);
+  if (status == 0 || status->GetReceivedPacketList ().GetSize () == 0)
+    {
+      return Address ();
+    }
+
+  // The gateways are sorted by received power, best first
+  const std::vector<EndDeviceStatus::RankedGateway> &gateways = status->GetRankedGateways ();
+  if (gateways.empty ())
+    {
+      return Address ();
+    }
+  return gateways.front ().gwAddress;
+}
+
+void
+BrokerServer::SendLoraBatch (Ptr<Packet> data,
+                             std::shared_ptr<const std::vector<Downlink> > downlinks,
+                             uint32_t next)
+{
+  NS_LOG_FUNCTION (this << data << downlinks->size () << next);
+
+  if (m_delay == 0)
+    {
+      for (uint32_t i = next; i < downlinks->size (); i++)
+        {
+          m_scheduler->DoSend (data, (*downlinks)[i].first, 2, (*downlinks)[i].second);
+        }
+      return;
+    }
+
+  // Space the downlinks going through the same gateway
+  m_scheduler->DoSend (data, (*downlinks)[next].first, 2, (*downlinks)[next].second);
+  if (next + 1 < downlinks->size ())
+    {
+      Simulator::Schedule (Seconds (m_delay), &BrokerServer::SendLoraBatch, this, data,
+                           downlinks, next + 1);
+    }
 }
 
 void
@@ -14,6 +14,11 @@
 #include "ns3/node-container.h"
 #include "ns3/log.h"
 #include "ns3/class-a-end-device-lorawan-mac.h"
+#include "ns3/class-c-end-device-lorawan-mac.h"
+#include "ns3/mqtt-topic-trie.h"
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace ns3
 {
@@ -26,10 +31,35 @@ namespace ns3
          *
          * This version of the BrokerServer attempts to closely mimic an actual
          * Network Server, by providing as much functionality as possible.
+         *
+         * Multicast group membership is a simulation-only shortcut: when a
+         * Class C client subscribes to a topic mapped to a multicast group,
+         * the broker adds the group to the client's MAC directly, and removes
+         * it when the client unsubscribes. Real devices get their multicast
+         * sessions provisioned on the device side (e.g., through remote
+         * multicast setup messages), which is not modeled here, so the
+         * membership changes instantly and without any over-the-air exchange.
          */
         class BrokerServer : public Application
         {
         public:
+            /**
+             * How publishes are delivered to the subscribers of a topic.
+             */
+            enum DownlinkMode
+            {
+                UNICAST,  //!< One downlink for each subscriber
+                MULTICAST //!< One downlink for each gateway, for the Class C
+                          //!< subscribers of topics mapped to a multicast group
+            };
+
+            /**
+             * A subscriber to send a publish to, and the gateway that is
+             * going to serve it, or an empty Address to let the scheduler
+             * choose one.
+             */
+            typedef std::pair<LoraDeviceAddress, Address> Downlink;
+
             static TypeId GetTypeId(void);
 
             BrokerServer();
@@ -84,18 +114,73 @@ namespace ns3
 
             /**
              * Subscribe a client to a topic.
-             * \param packet the received packet
+             * \param topic the topic filter, which can contain the '+' and
+             * '#' wildcards
+             * \param address the address of the client
+             *
+             * If the topic is mapped to a multicast group and the client is a
+             * Class C device, the group is also added to the client's MAC (see
+             * the class documentation: this is not done over the air).
              */
             void SubscribeToTopic(std::string topic, LoraDeviceAddress address);
 
+            /**
+             * Remove the subscription of a client to a topic.
+             * \param topic the topic filter that was used to subscribe
+             * \param address the address of the client
+             *
+             * If the topic is mapped to a multicast group, the group is also
+             * removed from the client's MAC, if it is a Class C device.
+             */
+            void UnsubscribeFromTopic(std::string topic, LoraDeviceAddress address);
+
             /**
              * Send message to client subcribed to topic.
+             *
+             * The payload is created once and shared by all the downlinks.
+             * Subscribers are served in the order they subscribed. If a
+             * delay between publishes is configured, the downlinks going
+             * through the same gateway are spaced by it: the first downlink
+             * of each gateway is sent right away, in the order of the
+             * gateways' first subscribers, and the others follow in
+             * subscription order.
              * \param packet the received packet
              */
             void SendToSubscribers(std::string topic, std::string MSG, Ptr<Packet> data);
 
             void SendLora(Ptr<Packet> data, LoraDeviceAddress deviceAddress);
 
+            /**
+             * Send the same data to a batch of clients, in order, starting
+             * from the next-th one. If a delay between publishes is
+             * configured, the clients are served one at a time, and the
+             * batch is shared by the events that serve them.
+             * \param data the data to send
+             * \param downlinks the clients of the batch, with their gateway
+             * \param next the index of the first client to serve
+             */
+            void SendLoraBatch(Ptr<Packet> data,
+                               std::shared_ptr<const std::vector<Downlink> > downlinks,
+                               uint32_t next);
+
+            /**
+             * Send data to a multicast group through a set of gateways.
+             */
+            void SendLoraMulticast(Ptr<Packet> data, LoraDeviceAddress groupAddress,
+                                   std::vector<Address> gwAddresses);
+
+            /**
+             * Map a topic to a multicast group.
+             *
+             * Class C clients subscribing to exactly this topic are added to
+             * the group. If the MULTICAST DownlinkMode is used, publishes to
+             * the topic reach them with one downlink per gateway. Clients
+             * that subscribed before the mapping was set are not added.
+             * \param topic the topic
+             * \param groupAddress the address of the multicast group
+             */
+            void SetMulticastGroup(std::string topic, LoraDeviceAddress groupAddress);
+
         protected:
             Ptr<NetworkStatus> m_status;
             Ptr<NetworkController> m_controller;
@@ -103,8 +188,21 @@ namespace ns3
             TracedCallback<Ptr<const Packet>> m_receivedPacket;
 
         private:
-            std::map<std::string, std::vector<LoraDeviceAddress>> m_addresses;
+            /**
+             * Get the gateway that received the last packet of a client with
+             * the highest power, or an empty Address if none is known.
+             */
+            Address GetPreferredGateway(LoraDeviceAddress address);
+
+            /**
+             * Get the MAC of a client, if it is a Class C device.
+             */
+            Ptr<ClassCEndDeviceLorawanMac> GetClassCMac(LoraDeviceAddress address);
+
+            MqttTopicTrie m_subscriptions;
             double m_delay;
+            enum DownlinkMode m_downlinkMode;
+            std::map<std::string, LoraDeviceAddress> m_multicastGroups;
         };
 
     } // namespace lorawan
@@ -297,13 +297,10 @@ ClassAEndDeviceLorawanMac::OpenFirstReceiveWindow (void)
   // Set Phy in Standby mode
   m_phy->GetObject<EndDeviceLoraPhy> ()->SwitchToStandby ();
 
-  //Calculate the duration of a single symbol for the first receive window DR
-  double tSym = pow (2, GetSfFromDataRate (GetFirstReceiveWindowDataRate ())) / GetBandwidthFromDataRate ( GetFirstReceiveWindowDataRate ());
-
   // Schedule return to sleep after "at least the time required by the end
   // device's radio transceiver to effectively detect a downlink preamble"
   // (LoraWAN specification)
-  m_closeFirstWindow = Simulator::Schedule (Seconds (m_receiveWindowDurationInSymbols*tSym),
+  m_closeFirstWindow = Simulator::Schedule (GetReceiveWindowDuration (GetFirstReceiveWindowDataRate ()),
                                             &ClassAEndDeviceLorawanMac::CloseFirstReceiveWindow, this); //m_receiveWindowDuration
 
 }
@@ -365,13 +362,10 @@ ClassAEndDeviceLorawanMac::OpenSecondReceiveWindow (void)
   m_phy->GetObject<EndDeviceLoraPhy> ()->SetSpreadingFactor (GetSfFromDataRate
                                                                (m_secondReceiveWindowDataRate));
 
-  //Calculate the duration of a single symbol for the second receive window DR
-  double tSym = pow (2, GetSfFromDataRate (GetSecondReceiveWindowDataRate ())) / GetBandwidthFromDataRate ( GetSecondReceiveWindowDataRate ());
-
   // Schedule return to sleep after "at least the time required by the end
   // device's radio transceiver to effectively detect a downlink preamble"
   // (LoraWAN specification)
-  m_closeSecondWindow = Simulator::Schedule (Seconds (m_receiveWindowDurationInSymbols*tSym),
+  m_closeSecondWindow = Simulator::Schedule (GetReceiveWindowDuration (GetSecondReceiveWindowDataRate ()),
                                              &ClassAEndDeviceLorawanMac::CloseSecondReceiveWindow, this);
 
 }
@@ -460,10 +454,8 @@ ClassAEndDeviceLorawanMac::GetNextClassTransmissionDelay (Time waitingTime)
         {
           NS_LOG_WARN ("Attempting to send when there are receive windows:" <<
                        " Transmission postponed.");
-          // Compute the duration of a single symbol for the second receive window DR
-          double tSym = pow (2, GetSfFromDataRate (GetSecondReceiveWindowDataRate ())) / GetBandwidthFromDataRate (GetSecondReceiveWindowDataRate ());
           // Compute the closing time of the second receive window
-          Time endSecondRxWindow = Time(m_secondReceiveWindow.GetTs()) + Seconds (m_receiveWindowDurationInSymbols*tSym);
+          Time endSecondRxWindow = Time(m_secondReceiveWindow.GetTs()) + GetReceiveWindowDuration (GetSecondReceiveWindowDataRate ());
 
           NS_LOG_DEBUG("Duration until endSecondRxWindow for new transmission:" << (endSecondRxWindow - Simulator::Now()).GetSeconds());
           waitingTime = std::max (waitingTime, endSecondRxWindow - Simulator::Now());
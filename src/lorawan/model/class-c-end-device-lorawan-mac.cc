@@ -163,7 +163,8 @@ ClassCEndDeviceLorawanMac::Receive (Ptr<Packet const> packet)
       NS_LOG_DEBUG ("Frame Header: " << fHdr);
 
       // Determine whether this packet is for us
-      bool messageForUs = (m_address == fHdr.GetAddress () || fHdr.GetAddress ().IsBroadcast ());
+      bool messageForUs = (m_address == fHdr.GetAddress () || fHdr.GetAddress ().IsBroadcast ()
+                           || IsMulticastGroupMember (fHdr.GetAddress ()));
 
       if (messageForUs)
         {
@@ -197,6 +198,10 @@ ClassCEndDeviceLorawanMac::Receive (Ptr<Packet const> packet)
             {
               NS_LOG_INFO ("This is a broadcast frame!");
             }
+          else if (!(m_address == fHdr.GetAddress ()))
+            {
+              NS_LOG_INFO ("This is a multicast frame for a group we belong to!");
+            }
           else
             {
               NS_LOG_INFO ("This is a unicast frame and the msg is for us!");
@@ -444,14 +449,10 @@ ClassCEndDeviceLorawanMac::OpenFirstReceiveWindow (void)
   m_phy->GetObject<EndDeviceLoraPhy> ()->SetSpreadingFactor (
       GetSfFromDataRate (GetFirstReceiveWindowDataRate ()));
 
-  // Calculate the duration of a single symbol for the first receive window DR
-  double tSym = pow (2, GetSfFromDataRate (GetFirstReceiveWindowDataRate ())) /
-                GetBandwidthFromDataRate (GetFirstReceiveWindowDataRate ());
-
   // Schedule return to sleep after "at least the time required by the end
   // device's radio transceiver to effectively detect a downlink preamble"
   // (LoraWAN specification)
-  m_closeFirstWindow = Simulator::Schedule (Seconds (m_receiveWindowDurationInSymbols * tSym),
+  m_closeFirstWindow = Simulator::Schedule (GetReceiveWindowDuration (GetFirstReceiveWindowDataRate ()),
                                             &ClassCEndDeviceLorawanMac::CloseFirstReceiveWindow,
                                             this); //m_receiveWindowDuration
 }
@@ -623,12 +624,9 @@ ClassCEndDeviceLorawanMac::GetNextClassTransmissionDelay (Time waitingTime)
         {
           NS_LOG_WARN ("Attempting to send when there are receive windows:"
                        << " Transmission postponed.");
-          // Compute the duration of a single symbol for the second receive window DR
-          double tSym = pow (2, GetSfFromDataRate (GetSecondReceiveWindowDataRate ())) /
-                        GetBandwidthFromDataRate (GetSecondReceiveWindowDataRate ());
           // Compute the closing time of the second receive window
           Time endSecondRxWindow = Time (m_secondReceiveWindow.GetTs ()) +
-                                   Seconds (m_receiveWindowDurationInSymbols * tSym);
+                                   GetReceiveWindowDuration (GetSecondReceiveWindowDataRate ());
 
           // fixme: when RX2 receive window(m_RX2BeforeRx1=false) is open, how to get waitingTime?
           // Actually, we just return waitTime since m_secondReceiveWindow = -inf now.
@@ -685,6 +683,28 @@ ClassCEndDeviceLorawanMac::GetSecondReceiveWindowFrequency (void)
   return m_secondReceiveWindowFrequency;
 }
 
+void
+ClassCEndDeviceLorawanMac::AddMulticastGroup (LoraDeviceAddress groupAddress)
+{
+  NS_LOG_FUNCTION (this << groupAddress);
+
+  m_multicastGroups.insert (groupAddress);
+}
+
+void
+ClassCEndDeviceLorawanMac::RemoveMulticastGroup (LoraDeviceAddress groupAddress)
+{
+  NS_LOG_FUNCTION (this << groupAddress);
+
+  m_multicastGroups.erase (groupAddress);
+}
+
+bool
+ClassCEndDeviceLorawanMac::IsMulticastGroupMember (LoraDeviceAddress groupAddress) const
+{
+  return m_multicastGroups.find (groupAddress) != m_multicastGroups.end ();
+}
+
 /////////////////////////
 // MAC command methods //
 /////////////////////////
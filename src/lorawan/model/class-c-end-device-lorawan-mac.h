@@ -27,6 +27,7 @@
 // #include "ns3/random-variable-stream.h"
 #include "ns3/lora-device-address.h"
 // #include "ns3/traced-value.h"
+#include <set>
 
 namespace ns3 {
 namespace lorawan {
@@ -150,6 +151,27 @@ public:
    */
   double GetSecondReceiveWindowFrequency (void);
 
+  /**
+   * Make this device accept downlink frames sent to a multicast group.
+   *
+   * \param groupAddress The address of the multicast group.
+   */
+  void AddMulticastGroup (LoraDeviceAddress groupAddress);
+
+  /**
+   * Stop accepting downlink frames sent to a multicast group.
+   *
+   * \param groupAddress The address of the multicast group.
+   */
+  void RemoveMulticastGroup (LoraDeviceAddress groupAddress);
+
+  /**
+   * Check whether this device belongs to a multicast group.
+   *
+   * \param groupAddress The address of the multicast group.
+   */
+  bool IsMulticastGroupMember (LoraDeviceAddress groupAddress) const;
+
   /////////////////////////
   // MAC command methods //
   /////////////////////////
@@ -228,6 +250,11 @@ private:
    */
   bool m_windowRX2BeforeRX1;
 
+  /**
+   * The multicast groups this device listens to.
+   */
+  std::set<LoraDeviceAddress> m_multicastGroups;
+
 }; /* ClassCEndDeviceLorawanMac */
 } /* namespace lorawan */
 } /* namespace ns3 */
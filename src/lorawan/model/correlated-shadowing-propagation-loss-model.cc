@@ -18,8 +18,12 @@
 
 #include "ns3/correlated-shadowing-propagation-loss-model.h"
 #include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
 #include "ns3/log.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 namespace ns3 {
 namespace lorawan {
@@ -41,11 +45,30 @@ CorrelatedShadowingPropagationLossModel::GetTypeId (void)
                    DoubleValue (110.0),
                    MakeDoubleAccessor
                      (&CorrelatedShadowingPropagationLossModel::m_correlationDistance),
-                   MakeDoubleChecker<double> ());
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("Storage",
+                   "How shadowing values are stored",
+                   EnumValue (CorrelatedShadowingPropagationLossModel::MAP_STORAGE),
+                   MakeEnumAccessor (&CorrelatedShadowingPropagationLossModel::m_storage),
+                   MakeEnumChecker (CorrelatedShadowingPropagationLossModel::MAP_STORAGE,
+                                    "map",
+                                    CorrelatedShadowingPropagationLossModel::FLAT_STORAGE,
+                                    "flat"))
+    .AddAttribute ("MaxPositionsPerSquare",
+                   "The number of positions a square of the grid remembers "
+                   "before forgetting all of them (flat storage only, 0 means "
+                   "no limit). Shadowing at forgotten positions is generated "
+                   "anew, and will not be correlated in time with the old value.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor
+                     (&CorrelatedShadowingPropagationLossModel::m_maxPositionsPerTile),
+                   MakeUintegerChecker<uint32_t> ());
   return tid;
 }
 
-CorrelatedShadowingPropagationLossModel::CorrelatedShadowingPropagationLossModel ()
+CorrelatedShadowingPropagationLossModel::CorrelatedShadowingPropagationLossModel () :
+  m_storage (MAP_STORAGE),
+  m_maxPositionsPerTile (0)
 {
 }
 
@@ -78,6 +101,16 @@ CorrelatedShadowingPropagationLossModel::DoCalcRxPower (double txPowerDbm,
   NS_LOG_DEBUG ("x " << x << ", y " << y);
   NS_LOG_DEBUG ("xcoord " << xcoord << ", ycoord " << ycoord);
 
+  if (m_storage == FLAT_STORAGE)
+    {
+      double loss = GetFlatLoss (xcoord, ycoord,
+                                 Position (b->GetPosition ().x, b->GetPosition ().y));
+
+      NS_LOG_INFO ("Shadowing loss: " << loss);
+
+      return txPowerDbm - loss;
+    }
+
   // Look for the computed coordinates in the shadowingGrid
   std::map<std::pair<int,int>, Ptr<ShadowingMap> >::const_iterator it;
 
@@ -91,6 +124,10 @@ CorrelatedShadowingPropagationLossModel::DoCalcRxPower (double txPowerDbm,
 
       Ptr<ShadowingMap> shadowingMap =
         Create<CorrelatedShadowingPropagationLossModel::ShadowingMap> ();
+      if (m_assignedShadowingValue)
+        {
+          shadowingMap->m_shadowingValue = m_assignedShadowingValue;
+        }
 
       m_shadowingGrid[coordinates] = shadowingMap;
     }
@@ -118,7 +155,206 @@ CorrelatedShadowingPropagationLossModel::DoCalcRxPower (double txPowerDbm,
 int64_t
 CorrelatedShadowingPropagationLossModel::DoAssignStreams (int64_t stream)
 {
-  return 0;
+  NS_LOG_FUNCTION (this << stream);
+
+  m_assignedShadowingValue = ShadowingMap::CreateShadowingValue ();
+  m_assignedShadowingValue->SetStream (stream);
+
+  // Squares that already exist switch to the assigned variable too
+  for (auto &square : m_shadowingGrid)
+    {
+      square.second->m_shadowingValue = m_assignedShadowingValue;
+    }
+  for (auto &tile : m_tiles)
+    {
+      tile.shadowingValue = m_assignedShadowingValue;
+    }
+
+  return 1;
+}
+
+std::size_t
+CorrelatedShadowingPropagationLossModel::GetNStoredPositions (void) const
+{
+  std::size_t positions = 0;
+
+  for (auto const &square : m_shadowingGrid)
+    {
+      positions += square.second->GetSize ();
+    }
+
+  for (auto const &tile : m_tiles)
+    {
+      positions += tile.positions.GetSize ();
+    }
+
+  return positions;
+}
+
+double
+CorrelatedShadowingPropagationLossModel::GetFlatLoss (int xcoord, int ycoord,
+                                                      Position position) const
+{
+  NS_LOG_FUNCTION (this << xcoord << ycoord << position.x << position.y);
+
+  ShadowingTile &tile = m_tiles[GetTile (xcoord, ycoord)];
+
+  const double *value = tile.positions.Find (position.x, position.y);
+  if (value != 0)
+    {
+      NS_LOG_DEBUG ("Shadowing value for this location already exists");
+      return *value;
+    }
+
+  if (m_maxPositionsPerTile > 0 && tile.positions.GetSize () >= m_maxPositionsPerTile)
+    {
+      NS_LOG_DEBUG ("Forgetting the " << tile.positions.GetSize () <<
+                    " positions of square " << xcoord << " " << ycoord);
+      tile.positions.Clear ();
+    }
+
+  // Generate the value like a ShadowingMap would, storing the vertices too so
+  // that lookups at their exact position give the same result
+  ShadowingSample sample = GenerateSample (position, ShadowingMap::gridSpacing,
+                                           tile.shadowingValue);
+  for (int j = 0; j < 4; j++)
+    {
+      tile.positions.Insert (sample.corners[j].x, sample.corners[j].y,
+                             sample.cornerValues[j]);
+    }
+  tile.positions.Insert (position.x, position.y, sample.shadowing);
+
+  return sample.shadowing;
+}
+
+std::size_t
+CorrelatedShadowingPropagationLossModel::GetTile (int xcoord, int ycoord) const
+{
+  // Keep the index at most half full
+  if (2 * (m_tiles.size () + 1) > m_tileIndex.size ())
+    {
+      std::vector<int32_t> index (std::max<std::size_t> (64, 2 * m_tileIndex.size ()), -1);
+      std::size_t mask = index.size () - 1;
+      for (std::size_t i = 0; i < m_tiles.size (); i++)
+        {
+          uint32_t hash = uint32_t (m_tiles[i].xcoord) * 73856093u ^
+            uint32_t (m_tiles[i].ycoord) * 19349663u;
+          std::size_t slot = hash & mask;
+          while (index[slot] != -1)
+            {
+              slot = (slot + 1) & mask;
+            }
+          index[slot] = int32_t (i);
+        }
+      m_tileIndex.swap (index);
+    }
+
+  std::size_t mask = m_tileIndex.size () - 1;
+  uint32_t hash = uint32_t (xcoord) * 73856093u ^ uint32_t (ycoord) * 19349663u;
+  std::size_t slot = hash & mask;
+  while (m_tileIndex[slot] != -1)
+    {
+      const ShadowingTile &tile = m_tiles[m_tileIndex[slot]];
+      if (tile.xcoord == xcoord && tile.ycoord == ycoord)
+        {
+          return m_tileIndex[slot];
+        }
+      slot = (slot + 1) & mask;
+    }
+
+  // Create the square, drawing its random variable at the same point a
+  // ShadowingMap would be created
+  NS_LOG_DEBUG ("Creating a new shadowing square at coordinates " <<
+                xcoord << " " << ycoord);
+
+  ShadowingTile tile;
+  tile.xcoord = xcoord;
+  tile.ycoord = ycoord;
+  tile.shadowingValue = m_assignedShadowingValue ? m_assignedShadowingValue :
+    ShadowingMap::CreateShadowingValue ();
+  m_tiles.push_back (tile);
+  m_tileIndex[slot] = int32_t (m_tiles.size () - 1);
+
+  return m_tiles.size () - 1;
+}
+
+CorrelatedShadowingPropagationLossModel::ShadowingSample
+CorrelatedShadowingPropagationLossModel::GenerateSample (Position position,
+                                                         double correlationDistance,
+                                                         Ptr<NormalRandomVariable> shadowingValue)
+{
+  // Get the coordinates of the position
+  double x = position.x;
+  double y = position.y;
+  int xcoord =
+    ((x > 0) - (x < 0)) * ((std::fabs (x) + correlationDistance / 2) / correlationDistance);
+  int ycoord =
+    ((y > 0) - (y < 0)) * ((std::fabs (y) + correlationDistance / 2) / correlationDistance);
+
+  double xmin = xcoord * correlationDistance - correlationDistance / 2;
+  double xmax = xcoord * correlationDistance + correlationDistance / 2;
+  double ymin = ycoord * correlationDistance - correlationDistance / 2;
+  double ymax = ycoord * correlationDistance + correlationDistance / 2;
+
+  NS_LOG_DEBUG ("Generating a new shadowing value in the following quadrant:");
+  NS_LOG_DEBUG ("xmin " << xmin << ", xmax " << xmax <<
+                ", ymin " << ymin << ", ymax " << ymax);
+
+  ShadowingSample sample;
+  sample.corners[0] = Position (xmin, ymin);
+  sample.corners[1] = Position (xmin, ymax);
+  sample.corners[2] = Position (xmax, ymin);
+  sample.corners[3] = Position (xmax, ymax);
+
+  double q11 = shadowingValue->GetValue ();
+  NS_LOG_DEBUG ("Lower left corner: " << q11);
+  double q12 = shadowingValue->GetValue ();
+  NS_LOG_DEBUG ("Upper left corner: " << q12);
+  double q21 = shadowingValue->GetValue ();
+  NS_LOG_DEBUG ("Lower right corner: " << q21);
+  double q22 = shadowingValue->GetValue ();
+  NS_LOG_DEBUG ("Upper right corner: " << q22);
+
+  sample.cornerValues[0] = q11;
+  sample.cornerValues[1] = q12;
+  sample.cornerValues[2] = q21;
+  sample.cornerValues[3] = q22;
+
+  NS_LOG_DEBUG (q11 << " " << q12 << " " << q21 << " " << q22 << " ");
+
+  // The c matrix contains the positions of the 4 vertices
+  double c[2][4] = {{xmin, xmax, xmax, xmin}, {ymin, ymin, ymax, ymax}};
+
+  // For the following procedure, reference:
+  // S. Schlegel et al., "On the Interpolation of Data with Normally
+  // Distributed Uncertainty for Visualization", IEEE Transactions on
+  // Visualization and Computer Graphics, vol. 18, no. 12, Dec. 2012.
+
+  // Compute the phi coefficients
+  double phi1 = 0;
+  double phi2 = 0;
+  double phi3 = 0;
+  double phi4 = 0;
+
+  for (int j = 0; j < 4; j++)
+    {
+      double distance = sqrt ((c[0][j] - x) * (c[0][j] - x) + (c[1][j] - y) * (c[1][j] - y));
+
+      NS_LOG_DEBUG ("Distance: " << distance);
+
+      double k = std::exp (-distance / correlationDistance);
+      phi1 = phi1 + ShadowingMap::m_kInv[0][j] * k;
+      phi2 = phi2 + ShadowingMap::m_kInv[1][j] * k;
+      phi3 = phi3 + ShadowingMap::m_kInv[2][j] * k;
+      phi4 = phi4 + ShadowingMap::m_kInv[3][j] * k;
+    }
+
+  NS_LOG_DEBUG ("Phi: " << phi1 << " " << phi2 << " " << phi3 << " " <<
+                phi4 << " ");
+
+  sample.shadowing = q11 * phi1 + q21 * phi2 + q22 * phi3 + q12 * phi4;
+
+  return sample;
 }
 
 /*********************************
@@ -134,16 +370,31 @@ const double CorrelatedShadowingPropagationLossModel::ShadowingMap::m_kInv[4][4]
   {-0.366414485833771, -0.0415206295795327, -0.366414485833771, 1.27968707244633}
 };
 
+const double CorrelatedShadowingPropagationLossModel::ShadowingMap::gridSpacing = 110;
+
 CorrelatedShadowingPropagationLossModel::ShadowingMap::ShadowingMap () :
-  m_correlationDistance (110)
+  m_correlationDistance (gridSpacing)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
   // The generation of new variables and positions along the grid is handled
   // by the GetLoss function. Here, we only create the normal random variable.
-  m_shadowingValue = CreateObject<NormalRandomVariable> ();
-  m_shadowingValue->SetAttribute ("Mean", DoubleValue (0.0));
-  m_shadowingValue->SetAttribute ("Variance", DoubleValue (16.0));
+  m_shadowingValue = CreateShadowingValue ();
+}
+
+Ptr<NormalRandomVariable>
+CorrelatedShadowingPropagationLossModel::ShadowingMap::CreateShadowingValue (void)
+{
+  Ptr<NormalRandomVariable> shadowingValue = CreateObject<NormalRandomVariable> ();
+  shadowingValue->SetAttribute ("Mean", DoubleValue (0.0));
+  shadowingValue->SetAttribute ("Variance", DoubleValue (16.0));
+  return shadowingValue;
+}
+
+std::size_t
+CorrelatedShadowingPropagationLossModel::ShadowingMap::GetSize (void) const
+{
+  return m_shadowingMap.size ();
 }
 
 CorrelatedShadowingPropagationLossModel::ShadowingMap::~ShadowingMap ()
@@ -168,82 +419,20 @@ CorrelatedShadowingPropagationLossModel::ShadowingMap::GetLoss
   // generate the value at the specified position.
   if (it == m_shadowingMap.end ())
     {
-      // Get the coordinates of the position
-      double x = position.x;
-      double y = position.y;
-      int xcoord =
-        ((x > 0) - (x < 0)) * ((std::fabs (x) + m_correlationDistance / 2) / m_correlationDistance);
-      int ycoord =
-        ((y > 0) - (y < 0)) * ((std::fabs (y) + m_correlationDistance / 2) / m_correlationDistance);
-
-      // Verify whether there already are the 4 surrounding positions in the
-      // map
-      double xmin = xcoord * m_correlationDistance - m_correlationDistance / 2;
-      double xmax = xcoord * m_correlationDistance + m_correlationDistance / 2;
-      double ymin = ycoord * m_correlationDistance - m_correlationDistance / 2;
-      double ymax = ycoord * m_correlationDistance + m_correlationDistance / 2;
-
-      CorrelatedShadowingPropagationLossModel::Position lowerLeft (xmin, ymin);
-      CorrelatedShadowingPropagationLossModel::Position upperLeft (xmin, ymax);
-      CorrelatedShadowingPropagationLossModel::Position lowerRight (xmax, ymin);
-      CorrelatedShadowingPropagationLossModel::Position upperRight (xmax, ymax);
-
-      NS_LOG_DEBUG ("Generating a new shadowing value in the following quadrant:");
-      NS_LOG_DEBUG ("xmin " << xmin << ", xmax " << xmax <<
-                    ", ymin " << ymin << ", ymax " << ymax);
-
       // Use the map's insert method to insert the coordinates of the 4
       // surrounding positions (if they are already there, they won't be
       // substituted thanks to the map's implementation).
       // TODO: Avoid useless generation of ShadowingMap values. This can be
       // done by performing some checks (and not leveraging the map
       // implementation)
-      double q11 = m_shadowingValue->GetValue ();
-      NS_LOG_DEBUG ("Lower left corner: " << q11);
-      m_shadowingMap[lowerLeft] = q11;
-      double q12 = m_shadowingValue->GetValue ();
-      NS_LOG_DEBUG ("Upper left corner: " << q12);
-      m_shadowingMap[upperLeft] = q12;
-      double q21 = m_shadowingValue->GetValue ();
-      NS_LOG_DEBUG ("Lower right corner: " << q21);
-      m_shadowingMap[lowerRight] = q21;
-      double q22 = m_shadowingValue->GetValue ();
-      NS_LOG_DEBUG ("Upper right corner: " << q22);
-      m_shadowingMap[upperRight] = q22;
-
-      NS_LOG_DEBUG (q11 << " " << q12 << " " << q21 << " " << q22 << " ");
-
-      // The c matrix contains the positions of the 4 vertices
-      double c[2][4] = {{xmin, xmax, xmax, xmin}, {ymin, ymin, ymax, ymax}};
-
-      // For the following procedure, reference:
-      // S. Schlegel et al., "On the Interpolation of Data with Normally
-      // Distributed Uncertainty for Visualization", IEEE Transactions on
-      // Visualization and Computer Graphics, vol. 18, no. 12, Dec. 2012.
-
-      // Compute the phi coefficients
-      double phi1 = 0;
-      double phi2 = 0;
-      double phi3 = 0;
-      double phi4 = 0;
-
+      ShadowingSample sample = GenerateSample (position, m_correlationDistance,
+                                               m_shadowingValue);
       for (int j = 0; j < 4; j++)
         {
-          double distance = sqrt ((c[0][j] - x) * (c[0][j] - x) + (c[1][j] - y) * (c[1][j] - y));
-
-          NS_LOG_DEBUG ("Distance: " << distance);
-
-          double k = std::exp (-distance / m_correlationDistance);
-          phi1 = phi1 + m_kInv[0][j] * k;
-          phi2 = phi2 + m_kInv[1][j] * k;
-          phi3 = phi3 + m_kInv[2][j] * k;
-          phi4 = phi4 + m_kInv[3][j] * k;
+          m_shadowingMap[sample.corners[j]] = sample.cornerValues[j];
         }
 
-      NS_LOG_DEBUG ("Phi: " << phi1 << " " << phi2 << " " << phi3 << " " <<
-                    phi4 << " ");
-
-      double shadowing = q11 * phi1 + q21 * phi2 + q22 * phi3 + q12 * phi4;
+      double shadowing = sample.shadowing;
 
       // Add the newly computed shadowing value to the shadowing map
       m_shadowingMap[position] = shadowing;
@@ -257,6 +446,98 @@ CorrelatedShadowingPropagationLossModel::ShadowingMap::GetLoss
   return m_shadowingMap[position];
 }
 
+/**********************************
+ *  PositionTable implementation  *
+ **********************************/
+
+CorrelatedShadowingPropagationLossModel::PositionTable::PositionTable () :
+  m_size (0)
+{
+}
+
+const double *
+CorrelatedShadowingPropagationLossModel::PositionTable::Find (double x, double y) const
+{
+  if (m_slots.empty ())
+    {
+      return 0;
+    }
+
+  const Slot &slot = m_slots[Probe (x, y)];
+  return slot.used ? &slot.value : 0;
+}
+
+void
+CorrelatedShadowingPropagationLossModel::PositionTable::Insert (double x, double y,
+                                                               double value)
+{
+  // Keep the table at most half full
+  if (2 * (m_size + 1) > m_slots.size ())
+    {
+      Grow ();
+    }
+
+  Slot &slot = m_slots[Probe (x, y)];
+  if (!slot.used)
+    {
+      slot.x = x;
+      slot.y = y;
+      slot.used = true;
+      m_size++;
+    }
+  slot.value = value;
+}
+
+void
+CorrelatedShadowingPropagationLossModel::PositionTable::Clear (void)
+{
+  m_slots.clear ();
+  m_size = 0;
+}
+
+std::size_t
+CorrelatedShadowingPropagationLossModel::PositionTable::GetSize (void) const
+{
+  return m_size;
+}
+
+std::size_t
+CorrelatedShadowingPropagationLossModel::PositionTable::Probe (double x, double y) const
+{
+  // Adding 0.0 turns -0.0 into 0.0, so that positions that compare equal
+  // also have the same hash
+  double key[2] = {x + 0.0, y + 0.0};
+  uint64_t bits[2];
+  std::memcpy (bits, key, sizeof (bits));
+  uint64_t hash = (bits[0] ^ (bits[1] * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+
+  std::size_t mask = m_slots.size () - 1;
+  std::size_t index = (hash >> 32) & mask;
+  while (m_slots[index].used && !(m_slots[index].x == x && m_slots[index].y == y))
+    {
+      index = (index + 1) & mask;
+    }
+  return index;
+}
+
+void
+CorrelatedShadowingPropagationLossModel::PositionTable::Grow (void)
+{
+  std::vector<Slot> oldSlots;
+  oldSlots.swap (m_slots);
+
+  Slot empty = {0, 0, 0, false};
+  m_slots.assign (std::max<std::size_t> (16, 2 * oldSlots.size ()), empty);
+
+  for (auto const &slot : oldSlots)
+    {
+      if (slot.used)
+        {
+          m_slots[Probe (slot.x, slot.y)] = slot;
+        }
+    }
+}
+
 /*****************************
  *  Position Implementation  *
  *****************************/
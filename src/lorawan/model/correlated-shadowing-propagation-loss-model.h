@@ -23,6 +23,8 @@
 #include "ns3/mobility-model.h"
 #include "ns3/vector.h"
 #include "ns3/random-variable-stream.h"
+#include <map>
+#include <vector>
 
 namespace ns3 {
 class MobilityModel;
@@ -44,6 +46,38 @@ public:
     bool operator< (const Position &other) const;
   };
 
+  /**
+   * The storage used to keep track of shadowing values.
+   */
+  enum Storage
+  {
+    MAP_STORAGE,     //!< A map of ShadowingMap instances
+    FLAT_STORAGE,     //!< Open-addressing hash tables of tiles and positions
+  };
+
+  /**
+   * A shadowing value that was generated for a position, together with the
+   * values of the grid vertices it was interpolated from.
+   */
+  struct ShadowingSample
+  {
+    Position corners[4];     //!< Lower left, upper left, lower right, upper right
+    double cornerValues[4];     //!< The values at the corners
+    double shadowing;     //!< The interpolated value
+  };
+
+  /**
+   * Generate the shadowing value at a position, by drawing the values of the
+   * surrounding grid vertices and interpolating them.
+   *
+   * \param position The position to generate the value for.
+   * \param correlationDistance The spacing of the grid vertices.
+   * \param shadowingValue The random variable to draw vertex values from.
+   * \return The generated sample.
+   */
+  static ShadowingSample GenerateSample (Position position, double correlationDistance,
+                                         Ptr<NormalRandomVariable> shadowingValue);
+
   class ShadowingMap : public
                        SimpleRefCount<CorrelatedShadowingPropagationLossModel::ShadowingMap>
   {
@@ -72,6 +106,17 @@ public:
 
     ~ShadowingMap ();
 
+    /**
+     * The spacing between the vertices of the grid.
+     */
+    static const double gridSpacing;
+
+    /**
+     * Create the random variable that ShadowingMap instances use to generate
+     * vertex values.
+     */
+    static Ptr<NormalRandomVariable> CreateShadowingValue (void);
+
     /**
      * Get the loss for a certain position.
      * If this position is not already in the map, add it by computing the
@@ -79,6 +124,11 @@ public:
      */
     double GetLoss (CorrelatedShadowingPropagationLossModel::Position position);
 
+    /**
+     * Get the number of positions stored in this map.
+     */
+    std::size_t GetSize (void) const;
+
 private:
     /**
      * For each Position, this map gives a corresponding loss.
@@ -105,6 +155,8 @@ private:
      * interpolating the vertices of a grid square.
      */
     static const double m_kInv[4][4];
+
+    friend class CorrelatedShadowingPropagationLossModel;
   };
 
   static TypeId GetTypeId (void);
@@ -124,11 +176,104 @@ private:
    */
   double GetCorrelationDistance (void);
 
+  /**
+   * Get the number of positions for which a shadowing value is currently
+   * stored, over all squares of the grid.
+   */
+  std::size_t GetNStoredPositions (void) const;
+
+private:
+  /**
+   * An open-addressing hash table that maps positions to shadowing values.
+   *
+   * Positions are compared exactly, like std::map does with Position keys.
+   */
+  class PositionTable
+  {
+public:
+    PositionTable ();
+
+    /**
+     * Look for the value stored at a position.
+     *
+     * \return A pointer to the value, or 0 if the position is not stored.
+     */
+    const double *Find (double x, double y) const;
+
+    /**
+     * Store a value at a position, replacing any previous value.
+     */
+    void Insert (double x, double y, double value);
+
+    /**
+     * Remove all stored values.
+     */
+    void Clear (void);
+
+    /**
+     * Get the number of stored values.
+     */
+    std::size_t GetSize (void) const;
+
 private:
+    struct Slot
+    {
+      double x;
+      double y;
+      double value;
+      bool used;
+    };
+
+    /**
+     * Get the index of the slot where a position is stored, or of the free
+     * slot where it should be inserted.
+     */
+    std::size_t Probe (double x, double y) const;
+
+    /**
+     * Double the number of slots, re-inserting stored values.
+     */
+    void Grow (void);
+
+    std::vector<Slot> m_slots;     //!< The slots, a power of two in number
+    std::size_t m_size;     //!< The number of used slots
+  };
+
+  /**
+   * A square of the grid in the flat storage, playing the role of a
+   * ShadowingMap.
+   */
+  struct ShadowingTile
+  {
+    int xcoord;     //!< The x coordinate of the square
+    int ycoord;     //!< The y coordinate of the square
+    Ptr<NormalRandomVariable> shadowingValue;     //!< The vertex values generator
+    PositionTable positions;     //!< The values generated so far
+  };
+
+  /**
+   * Get the loss at a position, as seen from a square, using the flat storage.
+   */
+  double GetFlatLoss (int xcoord, int ycoord, Position position) const;
+
+  /**
+   * Get the index in m_tiles of a square, creating it if needed.
+   */
+  std::size_t GetTile (int xcoord, int ycoord) const;
+
   virtual double DoCalcRxPower (double txPowerDbm,
                                 Ptr<MobilityModel> a,
                                 Ptr<MobilityModel> b) const;
 
+  /**
+   * Make all squares, including the ones that will be created later, draw
+   * their vertex values from a single random variable using the given
+   * stream. The values are still independent, but the ones that are
+   * generated depend on the order in which positions are first queried.
+   *
+   * \param stream The stream to use.
+   * \return The number of streams used, 1.
+   */
   virtual int64_t DoAssignStreams (int64_t stream);
 
   double m_correlationDistance;     //!< The correlation distance for the ShadowingMap
@@ -171,6 +316,34 @@ private:
    *  if they are close (ideally, within a correlation distance).
    */
   mutable std::map<std::pair<int, int>, Ptr<ShadowingMap> > m_shadowingGrid;
+
+  /**
+   * Which storage is used for shadowing values.
+   */
+  enum Storage m_storage;
+
+  /**
+   * The maximum number of positions a square keeps in the flat storage
+   * before forgetting all of them, or 0 for no limit.
+   */
+  uint32_t m_maxPositionsPerTile;
+
+  /**
+   * The squares of the grid, when using the flat storage.
+   */
+  mutable std::vector<ShadowingTile> m_tiles;
+
+  /**
+   * Open-addressing index of m_tiles, keyed by square coordinates. Empty
+   * slots contain -1.
+   */
+  mutable std::vector<int32_t> m_tileIndex;
+
+  /**
+   * The random variable all squares draw their vertex values from once
+   * streams were assigned, or 0 if each square uses its own.
+   */
+  Ptr<NormalRandomVariable> m_assignedShadowingValue;
 };
 
 }
@@ -27,6 +27,7 @@
 #include "ns3/simulator.h"
 #include "ns3/log.h"
 #include <algorithm>
+#include <cmath>
 
 namespace ns3 {
 namespace lorawan {
@@ -522,6 +523,34 @@ EndDeviceLorawanMac::GetNextClassTransmissionDelay (Time waitingTime)
   return waitingTime;
 }
 
+Time
+EndDeviceLorawanMac::GetReceiveWindowDuration (uint8_t dataRate)
+{
+  NS_LOG_FUNCTION (this << unsigned (dataRate));
+
+  uint8_t sf = GetSfFromDataRate (dataRate);
+  double bandwidth = GetBandwidthFromDataRate (dataRate);
+
+  if (m_receiveWindowDurations.size () <= dataRate)
+    {
+      ReceiveWindowDuration unknown = {0, -1, Seconds (0)};
+      m_receiveWindowDurations.resize (dataRate + 1, unknown);
+    }
+
+  ReceiveWindowDuration &entry = m_receiveWindowDurations[dataRate];
+  if (entry.sf != sf || entry.bandwidth != bandwidth)
+    {
+      // Calculate the duration of a single symbol for this DR
+      double tSym = pow (2, sf) / bandwidth;
+
+      entry.sf = sf;
+      entry.bandwidth = bandwidth;
+      entry.duration = Seconds (m_receiveWindowDurationInSymbols * tSym);
+    }
+
+  return entry.duration;
+}
+
 Time
 EndDeviceLorawanMac::GetNextTransmissionDelay (void)
 {
@@ -404,6 +404,14 @@ protected:
    */
   uint8_t m_receiveWindowDurationInSymbols;
 
+  /**
+   * Get the duration of a receive window using a certain data rate, that is,
+   * the time it takes to send m_receiveWindowDurationInSymbols symbols at that
+   * data rate. Durations are computed once per data rate, and recomputed only
+   * if the data rate's spreading factor or bandwidth change.
+   */
+  Time GetReceiveWindowDuration (uint8_t dataRate);
+
   /**
    * List of the MAC commands that need to be applied to the next UL packet.
    */
@@ -492,6 +500,21 @@ protected:
   LorawanMacHeader::MType m_mType;
 
   uint16_t m_currentFCnt;
+
+  /**
+   * A receive window duration, with the parameters it was computed for.
+   */
+  struct ReceiveWindowDuration
+  {
+    uint8_t sf;
+    double bandwidth;
+    Time duration;
+  };
+
+  /**
+   * Receive window durations, indexed by data rate.
+   */
+  std::vector<ReceiveWindowDuration> m_receiveWindowDurations;
 };
 
 
@@ -29,6 +29,7 @@
 #include "ns3/simulator.h"
 #include "ns3/packet.h"
 #include "ns3/lora-tag.h"
+#include "ns3/uinteger.h"
 
 #include <algorithm>
 
@@ -43,6 +44,14 @@ EndDeviceStatus::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::EndDeviceStatus")
                           .SetParent<Object> ()
                           .AddConstructor<EndDeviceStatus> ()
+                          .AddAttribute ("ReceivedPacketHistorySize",
+                                         "The number of received packets that "
+                                         "are remembered for this device",
+                                         UintegerValue (20),
+                                         MakeUintegerAccessor
+                                           (&EndDeviceStatus::SetReceivedPacketHistorySize,
+                                           &EndDeviceStatus::GetReceivedPacketHistorySize),
+                                         MakeUintegerChecker<uint32_t> (1))
                           .SetGroupName ("lorawan");
   return tid;
 }
@@ -51,7 +60,7 @@ EndDeviceStatus::EndDeviceStatus (LoraDeviceAddress endDeviceAddress,
                                   Ptr<EndDeviceLorawanMac> endDeviceMac)
     : m_reply (EndDeviceStatus::Reply ()),
       m_endDeviceAddress (endDeviceAddress),
-      m_receivedPacketList (ReceivedPacketList ()),
+      m_receivedPacketList (ReceivedPacketList (20)),
       m_mac (endDeviceMac)
 {
   NS_LOG_FUNCTION (endDeviceAddress);
@@ -63,7 +72,7 @@ EndDeviceStatus::EndDeviceStatus ()
 
   // Initialize data structure
   m_reply = EndDeviceStatus::Reply ();
-  m_receivedPacketList = ReceivedPacketList ();
+  m_receivedPacketList = ReceivedPacketList (20);
 }
 
 EndDeviceStatus::~EndDeviceStatus ()
@@ -126,13 +135,7 @@ EndDeviceStatus::GetCompleteReplyPacket (void)
 
   // Add headers
   m_reply.frameHeader.SetAddress (m_endDeviceAddress);
-  Ptr<Packet> lastPacket = GetLastPacketReceivedFromDevice ()->Copy ();
-  LorawanMacHeader mHdr;
-  LoraFrameHeader fHdr;
-  fHdr.SetAsUplink ();
-  lastPacket->RemoveHeader (mHdr);
-  lastPacket->RemoveHeader (fHdr);
-  m_reply.frameHeader.SetFCnt (fHdr.GetFCnt ());
+  m_reply.frameHeader.SetFCnt (m_receivedPacketList.Back ().second.frameHeader.GetFCnt ());
   m_reply.macHeader.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
   replyPacket->AddHeader (m_reply.frameHeader);
   replyPacket->AddHeader (m_reply.macHeader);
@@ -178,13 +181,37 @@ EndDeviceStatus::GetMac (void)
   return m_mac;
 }
 
-EndDeviceStatus::ReceivedPacketList
-EndDeviceStatus::GetReceivedPacketList ()
+const EndDeviceStatus::ReceivedPacketList &
+EndDeviceStatus::GetReceivedPacketList () const
 {
   NS_LOG_FUNCTION_NOARGS ();
   return m_receivedPacketList;
 }
 
+uint32_t
+EndDeviceStatus::GetReceivedPacketHistorySize (void) const
+{
+  return m_receivedPacketList.GetCapacity ();
+}
+
+void
+EndDeviceStatus::SetReceivedPacketHistorySize (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  m_receivedPacketList.SetCapacity (size);
+}
+
+void
+EndDeviceStatus::ReserveReceivedPacketHistory (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+
+  if (size > m_receivedPacketList.GetCapacity ())
+    {
+      m_receivedPacketList.SetCapacity (size);
+    }
+}
+
 void
 EndDeviceStatus::SetFirstReceiveWindowSpreadingFactor (uint8_t sf)
 {
@@ -243,20 +270,20 @@ EndDeviceStatus::InsertReceivedPacket (Ptr<Packet const> receivedPacket, const A
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  // Create a copy of the packet
-  Ptr<Packet> myPacket = receivedPacket->Copy ();
+  InsertReceivedPacket (UplinkContext (receivedPacket), gwAddress);
+}
 
-  // Extract the headers
-  LorawanMacHeader macHdr;
-  myPacket->RemoveHeader (macHdr);
+void
+EndDeviceStatus::InsertReceivedPacket (const UplinkContext &uplink, const Address &gwAddress)
+{
+  NS_LOG_FUNCTION_NOARGS ();
 
-  LoraFrameHeader frameHdr;
-  frameHdr.SetAsUplink ();
-  myPacket->RemoveHeader (frameHdr);
+  Ptr<Packet const> receivedPacket = uplink.packet;
+  const LorawanMacHeader &macHdr = uplink.macHeader;
+  const LoraFrameHeader &frameHdr = uplink.frameHeader;
 
   // Update current parameters
-  LoraTag tag;
-  myPacket->RemovePacketTag (tag);
+  LoraTag tag = uplink.tag;
   SetFirstReceiveWindowSpreadingFactor (tag.GetSpreadingFactor ());
   SetFirstReceiveWindowFrequency (tag.GetFrequency ());
 
@@ -268,67 +295,85 @@ EndDeviceStatus::InsertReceivedPacket (Ptr<Packet const> receivedPacket, const A
 
   double rcvPower = tag.GetReceivePower ();
 
-  // Perform insertion in list, also checking that the packet isn't already in
-  // the list (it could have been received by another GW already)
-
-  // Start searching from the end
-  auto it = m_receivedPacketList.rbegin ();
-  for (; it != m_receivedPacketList.rend (); it++)
-    {
-      // Get the frame counter of the current packet to compare it with the
-      // newly received one
-      Ptr<Packet> packetCopy = ((*it).first)->Copy ();
-      LorawanMacHeader currentMacHdr;
-      packetCopy->RemoveHeader (currentMacHdr);
-      LoraFrameHeader currentFrameHdr;
-      frameHdr.SetAsUplink ();
-      packetCopy->RemoveHeader (currentFrameHdr);
-
-      NS_LOG_DEBUG ("Received packet's frame counter: " << unsigned(frameHdr.GetFCnt ())
-                                                        << "\nCurrent packet's frame counter: "
-                                                        << unsigned(currentFrameHdr.GetFCnt ()));
-
-      if (frameHdr.GetFCnt () == currentFrameHdr.GetFCnt ())
-        {
-          NS_LOG_INFO ("Packet was already received by another gateway");
-
-          // This packet had already been received from another gateway:
-          // add this gateway's reception information.
-          GatewayList &gwList = it->second.gwList;
+  PacketInfoPerGw gwInfo;
+  gwInfo.receivedTime = Simulator::Now ();
+  gwInfo.rxPower = rcvPower;
+  gwInfo.gwAddress = gwAddress;
 
-          PacketInfoPerGw gwInfo;
-          gwInfo.receivedTime = Simulator::Now ();
-          gwInfo.rxPower = rcvPower;
-          gwInfo.gwAddress = gwAddress;
-          gwList.insert (std::pair<Address, PacketInfoPerGw> (gwAddress, gwInfo));
+  // Look for the frame counter among the packets that are still in the
+  // history (the packet could have been received by another GW already)
+  NS_LOG_DEBUG ("Received packet's frame counter: " << unsigned(frameHdr.GetFCnt ()));
 
-          NS_LOG_DEBUG ("Size of gateway list: " << gwList.size ());
+  // Only the gateways of the last packet are ranked
+  bool isLastPacket = m_receivedPacketList.GetSize () > 0
+    && m_receivedPacketList.Find (frameHdr.GetFCnt ()) == &m_receivedPacketList.Back ();
 
-          break; // Exit from the cycle
+  if (m_receivedPacketList.AddGatewayReception (frameHdr.GetFCnt (), gwInfo))
+    {
+      // This packet had already been received from another gateway: this
+      // gateway's reception information was added to it.
+      NS_LOG_INFO ("Packet was already received by another gateway");
+      if (isLastPacket)
+        {
+          AddRankedGateway (gwInfo);
         }
+      NS_LOG_DEBUG ("Size of gateway list: " <<
+                    m_receivedPacketList.Find (frameHdr.GetFCnt ())->second.gwList.size ());
     }
-  if (it == m_receivedPacketList.rend ())
+  else
     {
       NS_LOG_INFO ("Packet was received for the first time");
-      PacketInfoPerGw gwInfo;
-      gwInfo.receivedTime = Simulator::Now ();
-      gwInfo.rxPower = rcvPower;
-      gwInfo.gwAddress = gwAddress;
+      info.macHeader = macHdr;
+      info.frameHeader = frameHdr;
       info.gwList.insert (std::pair<Address, PacketInfoPerGw> (gwAddress, gwInfo));
-      m_receivedPacketList.push_back (
-          std::pair<Ptr<Packet const>, ReceivedPacketInfo> (receivedPacket, info));
+      m_receivedPacketList.PushBack (ReceivedPacketList::Entry (receivedPacket, info));
+
+      m_rankedGateways.clear ();
+      AddRankedGateway (gwInfo);
     }
   NS_LOG_DEBUG (*this);
 }
 
+void
+EndDeviceStatus::AddRankedGateway (const PacketInfoPerGw &gwInfo)
+{
+  // Like the gateway list, keep the first reception from each gateway
+  for (auto it = m_rankedGateways.begin (); it != m_rankedGateways.end (); ++it)
+    {
+      if (it->gwAddress == gwInfo.gwAddress)
+        {
+          return;
+        }
+    }
+
+  // Find the first gateway that ranks lower than this one
+  auto it = m_rankedGateways.begin ();
+  while (it != m_rankedGateways.end ()
+         && (it->rxPower > gwInfo.rxPower
+             || (it->rxPower == gwInfo.rxPower && it->gwAddress < gwInfo.gwAddress)))
+    {
+      ++it;
+    }
+
+  RankedGateway ranked;
+  ranked.rxPower = gwInfo.rxPower;
+  ranked.gwAddress = gwInfo.gwAddress;
+  m_rankedGateways.insert (it, ranked);
+}
+
+const std::vector<EndDeviceStatus::RankedGateway> &
+EndDeviceStatus::GetRankedGateways (void) const
+{
+  return m_rankedGateways;
+}
+
 EndDeviceStatus::ReceivedPacketInfo
 EndDeviceStatus::GetLastReceivedPacketInfo (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  auto it = m_receivedPacketList.rbegin ();
-  if (it != m_receivedPacketList.rend ())
+  if (m_receivedPacketList.GetSize () > 0)
     {
-      return it->second;
+      return m_receivedPacketList.Back ().second;
     }
   else
     {
@@ -340,10 +385,9 @@ Ptr<Packet const>
 EndDeviceStatus::GetLastPacketReceivedFromDevice (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  auto it = m_receivedPacketList.rbegin ();
-  if (it != m_receivedPacketList.rend ())
+  if (m_receivedPacketList.GetSize () > 0)
     {
-      return it->first;
+      return m_receivedPacketList.Back ().first;
     }
   else
     {
@@ -389,8 +433,7 @@ EndDeviceStatus::GetPowerGatewayMap (void)
   // Create a map of the gateways
   // Key: received power
   // Value: address of the corresponding gateway
-  ReceivedPacketInfo info = m_receivedPacketList.back ().second;
-  GatewayList gwList = info.gwList;
+  const GatewayList &gwList = m_receivedPacketList.Back ().second.gwList;
 
   std::map<double, Address> gatewayPowers;
   for (auto it = gwList.begin (); it != gwList.end (); it++)
@@ -403,16 +446,202 @@ EndDeviceStatus::GetPowerGatewayMap (void)
   return gatewayPowers;
 }
 
+/////////////////////////////
+//   ReceivedPacketList    //
+/////////////////////////////
+
+EndDeviceStatus::ReceivedPacketList::ReceivedPacketList (uint32_t capacity)
+    : m_oldest (0),
+      m_capacity (capacity),
+      m_nInserted (0)
+{
+  NS_ASSERT (capacity > 0);
+  m_entries.reserve (capacity);
+  for (uint32_t s = 0; s < N_RX_POWER_STATISTICS; s++)
+    {
+      m_rxPower[s].resize (2 * capacity, 0);
+    }
+}
+
+void
+EndDeviceStatus::ReceivedPacketList::PushBack (const Entry &entry)
+{
+  uint32_t slot = m_oldest;
+  if (m_entries.size () < m_capacity)
+    {
+      slot = m_entries.size ();
+      m_entries.push_back (entry);
+    }
+  else
+    {
+      // Forget the oldest packet, unless a more recent one with the same frame
+      // counter is in the history
+      uint64_t oldestNumber = m_nInserted - m_entries.size ();
+      auto it = m_fCntIndex.find (m_entries[m_oldest].second.frameHeader.GetFCnt ());
+      if (it != m_fCntIndex.end () && it->second == oldestNumber)
+        {
+          m_fCntIndex.erase (it);
+        }
+
+      // Overwrite the oldest packet
+      m_entries[m_oldest] = entry;
+      m_oldest = (m_oldest + 1) % m_capacity;
+    }
+  m_fCntIndex[entry.second.frameHeader.GetFCnt ()] = m_nInserted;
+  m_nInserted++;
+  UpdateRxPower (slot);
+}
+
+const EndDeviceStatus::ReceivedPacketList::Entry *
+EndDeviceStatus::ReceivedPacketList::Find (uint16_t fCnt) const
+{
+  auto it = m_fCntIndex.find (fCnt);
+  if (it == m_fCntIndex.end ())
+    {
+      return 0;
+    }
+  return &Back (m_nInserted - 1 - it->second);
+}
+
+bool
+EndDeviceStatus::ReceivedPacketList::AddGatewayReception (uint16_t fCnt,
+                                                          const PacketInfoPerGw &gwInfo)
+{
+  auto it = m_fCntIndex.find (fCnt);
+  if (it == m_fCntIndex.end ())
+    {
+      return false;
+    }
+
+  uint32_t slot = GetSlot (m_nInserted - 1 - it->second);
+  m_entries[slot].second.gwList.insert (std::pair<Address, PacketInfoPerGw>
+                                          (gwInfo.gwAddress, gwInfo));
+  UpdateRxPower (slot);
+  return true;
+}
+
+const double *
+EndDeviceStatus::ReceivedPacketList::GetRxPowerHistory (enum RxPowerStatistic statistic,
+                                                        uint32_t n) const
+{
+  NS_ASSERT (n > 0 && n <= m_entries.size ());
+
+  // The most recent packet is at GetSlot (0) + m_capacity, and the ones
+  // before it precede it in the array
+  return &m_rxPower[statistic][GetSlot (0) + m_capacity + 1 - n];
+}
+
+const EndDeviceStatus::ReceivedPacketList::Entry &
+EndDeviceStatus::ReceivedPacketList::Back (uint32_t i) const
+{
+  return m_entries[GetSlot (i)];
+}
+
+uint32_t
+EndDeviceStatus::ReceivedPacketList::GetSlot (uint32_t i) const
+{
+  NS_ASSERT (i < m_entries.size ());
+  return (m_oldest + m_entries.size () - 1 - i) % m_entries.size ();
+}
+
+void
+EndDeviceStatus::ReceivedPacketList::UpdateRxPower (uint32_t slot)
+{
+  const GatewayList &gwList = m_entries[slot].second.gwList;
+
+  double min = 0;
+  double max = 0;
+  double average = 0;
+  if (!gwList.empty ())
+    {
+      // Go through the gateways in the same order as ADR always did, so that
+      // the average is the same to the last bit
+      min = gwList.begin ()->second.rxPower;
+      max = min;
+      double sum = 0;
+      for (auto it = gwList.begin (); it != gwList.end (); it++)
+        {
+          min = std::min (min, it->second.rxPower);
+          max = std::max (max, it->second.rxPower);
+          sum += it->second.rxPower;
+        }
+      average = sum / gwList.size ();
+    }
+
+  m_rxPower[MIN_RX_POWER][slot] = m_rxPower[MIN_RX_POWER][slot + m_capacity] = min;
+  m_rxPower[MAX_RX_POWER][slot] = m_rxPower[MAX_RX_POWER][slot + m_capacity] = max;
+  m_rxPower[AVERAGE_RX_POWER][slot] = m_rxPower[AVERAGE_RX_POWER][slot + m_capacity] = average;
+}
+
+uint32_t
+EndDeviceStatus::ReceivedPacketList::GetSize (void) const
+{
+  return m_entries.size ();
+}
+
+uint32_t
+EndDeviceStatus::ReceivedPacketList::GetCapacity (void) const
+{
+  return m_capacity;
+}
+
+void
+EndDeviceStatus::ReceivedPacketList::SetCapacity (uint32_t capacity)
+{
+  NS_ASSERT (capacity > 0);
+
+  Linearize ();
+  if (m_entries.size () > capacity)
+    {
+      // Forget the oldest packets
+      m_entries.erase (m_entries.begin (), m_entries.end () - capacity);
+    }
+  m_capacity = capacity;
+  m_entries.reserve (capacity);
+  RebuildIndex ();
+
+  for (uint32_t s = 0; s < N_RX_POWER_STATISTICS; s++)
+    {
+      m_rxPower[s].assign (2 * capacity, 0);
+    }
+  for (uint32_t slot = 0; slot < m_entries.size (); slot++)
+    {
+      UpdateRxPower (slot);
+    }
+}
+
+void
+EndDeviceStatus::ReceivedPacketList::Linearize (void)
+{
+  std::rotate (m_entries.begin (), m_entries.begin () + m_oldest, m_entries.end ());
+  m_oldest = 0;
+}
+
+void
+EndDeviceStatus::ReceivedPacketList::RebuildIndex (void)
+{
+  m_fCntIndex.clear ();
+
+  // Go from the oldest to the most recent packet, so that the most recent one
+  // wins if a frame counter appears more than once
+  for (uint32_t i = GetSize (); i > 0; i--)
+    {
+      m_fCntIndex[Back (i - 1).second.frameHeader.GetFCnt ()] = m_nInserted - i;
+    }
+}
+
 std::ostream &
 operator<< (std::ostream &os, const EndDeviceStatus &status)
 {
-  os << "Total packets received: " << status.m_receivedPacketList.size () << std::endl;
+  const EndDeviceStatus::ReceivedPacketList &list = status.m_receivedPacketList;
+  os << "Total packets received: " << list.GetSize () << std::endl;
 
-  for (auto j = status.m_receivedPacketList.begin (); j != status.m_receivedPacketList.end (); j++)
+  // Print from the oldest to the most recent packet
+  for (uint32_t j = list.GetSize (); j > 0; j--)
     {
-      EndDeviceStatus::ReceivedPacketInfo info = (*j).second;
+      EndDeviceStatus::ReceivedPacketInfo info = list.Back (j - 1).second;
       EndDeviceStatus::GatewayList gatewayList = info.gwList;
-      Ptr<Packet const> pkt = (*j).first;
+      Ptr<Packet const> pkt = list.Back (j - 1).first;
       os << pkt << " " << gatewayList.size () << std::endl;
       for (EndDeviceStatus::GatewayList::iterator k = gatewayList.begin (); k != gatewayList.end ();
            k++)
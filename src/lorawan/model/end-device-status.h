@@ -28,8 +28,10 @@
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/lora-frame-header.h"
 #include "ns3/pointer.h"
-#include "ns3/lora-frame-header.h"
+#include "ns3/uplink-context.h"
 #include <iostream>
+#include <vector>
+#include <unordered_map>
 
 namespace ns3 {
 namespace lorawan {
@@ -161,6 +163,16 @@ public:
   // List of gateways, with relative information
   typedef std::map<Address, PacketInfoPerGw> GatewayList;
 
+  /**
+   * A gateway that received the last packet of the device, and the power at
+   * which it was received.
+   */
+  struct RankedGateway
+  {
+    double rxPower;        //!< Reception power of the packet at this gateway.
+    Address gwAddress;     //!< Address of the gateway.
+  };
+
   /**
    * Structure saving information regarding all packet receptions.
    */
@@ -171,10 +183,150 @@ public:
     GatewayList gwList;      //!< List of gateways that received this packet.
     uint8_t sf;
     double frequency;
+    LorawanMacHeader macHeader;   //!< The packet's parsed MAC header
+    LoraFrameHeader frameHeader;   //!< The packet's parsed frame header
   };
 
-  typedef std::list<std::pair<Ptr<Packet const>, ReceivedPacketInfo> >
-    ReceivedPacketList;
+  /**
+   * A fixed-capacity history of the packets received from a device.
+   *
+   * Packets are stored in a ring buffer: once the history is full, inserting
+   * a new packet overwrites the oldest one, so that the memory used by each
+   * device stays constant throughout the simulation. Stored packets are also
+   * indexed by their frame counter, so that copies of the same packet coming
+   * from different gateways can be matched without parsing stored packets.
+   *
+   * For each packet, the reception power is also combined over the gateways
+   * that received it when a reception is added, and kept in contiguous
+   * arrays, so that algorithms looking at the recent history (e.g., ADR) can
+   * go through plain arrays of doubles instead of the gateway lists.
+   */
+  class ReceivedPacketList
+  {
+public:
+    typedef std::pair<Ptr<Packet const>, ReceivedPacketInfo> Entry;
+
+    /**
+     * The ways in which the reception power of a packet at different gateways
+     * is combined.
+     */
+    enum RxPowerStatistic
+    {
+      MIN_RX_POWER,
+      MAX_RX_POWER,
+      AVERAGE_RX_POWER,
+      N_RX_POWER_STATISTICS
+    };
+
+    /**
+     * Create an empty history.
+     *
+     * \param capacity The maximum number of packets to remember.
+     */
+    ReceivedPacketList (uint32_t capacity = 1);
+
+    /**
+     * Insert a packet in the history, forgetting the oldest one if the
+     * history is full.
+     *
+     * The entry's frameHeader field is used to index the packet.
+     */
+    void PushBack (const Entry &entry);
+
+    /**
+     * Find the most recent packet with a certain frame counter.
+     *
+     * \param fCnt The frame counter to look for.
+     * \return A pointer to the entry, or 0 if no packet in the history has
+     * this frame counter.
+     */
+    const Entry *Find (uint16_t fCnt) const;
+
+    /**
+     * Add a gateway's reception to the most recent packet with a certain
+     * frame counter.
+     *
+     * \param fCnt The frame counter of the packet.
+     * \param gwInfo Information on the reception at the gateway.
+     * \return False if no packet in the history has this frame counter.
+     */
+    bool AddGatewayReception (uint16_t fCnt, const PacketInfoPerGw &gwInfo);
+
+    /**
+     * Get the combined reception power of the most recent packets.
+     *
+     * \param statistic How to combine the power at different gateways.
+     * \param n The number of packets, at most GetSize ().
+     * \return An array of n values, going from the oldest to the most recent
+     * of the n packets.
+     */
+    const double *GetRxPowerHistory (enum RxPowerStatistic statistic,
+                                     uint32_t n) const;
+
+    /**
+     * Get one of the most recent packets.
+     *
+     * \param i How many packets back to go: 0 is the most recently inserted
+     * packet, GetSize () - 1 is the oldest one.
+     */
+    const Entry &Back (uint32_t i = 0) const;
+
+    /**
+     * Get the number of packets in the history.
+     */
+    uint32_t GetSize (void) const;
+
+    /**
+     * Get the maximum number of packets the history can hold.
+     */
+    uint32_t GetCapacity (void) const;
+
+    /**
+     * Change the maximum number of packets the history can hold. If the
+     * history is shrunk, the most recent packets are kept.
+     */
+    void SetCapacity (uint32_t capacity);
+
+private:
+    /**
+     * Move entries so that the oldest one is at the beginning of m_entries.
+     */
+    void Linearize (void);
+
+    /**
+     * Rebuild the frame counter index from the stored packets.
+     */
+    void RebuildIndex (void);
+
+    /**
+     * Get the position in m_entries of one of the most recent packets.
+     */
+    uint32_t GetSlot (uint32_t i) const;
+
+    /**
+     * Combine the reception power of the packet stored at a position.
+     */
+    void UpdateRxPower (uint32_t slot);
+
+    std::vector<Entry> m_entries;     //!< The stored packets
+    uint32_t m_oldest;     //!< The index of the oldest packet, if full
+    uint32_t m_capacity;     //!< The maximum number of packets
+    uint64_t m_nInserted;     //!< Total number of packets ever inserted
+
+    /**
+     * Map from a frame counter to the insertion number of the most recent
+     * packet with that frame counter.
+     */
+    std::unordered_map<uint16_t, uint64_t> m_fCntIndex;
+
+    /**
+     * Combined reception power of the stored packets, one array per
+     * statistic. The value of the packet at position i of m_entries is
+     * stored both at i and at i + m_capacity, so that the most recent
+     * packets always occupy a contiguous range.
+     */
+    std::vector<double> m_rxPower[N_RX_POWER_STATISTICS];
+  };
 
 
   /*******************************************/
@@ -217,9 +369,32 @@ public:
   /**
    * Get the received packet list.
    *
-   * \return The received packet list.
+   * \return A reference to the received packet list.
+   */
+  const ReceivedPacketList &GetReceivedPacketList (void) const;
+
+  /**
+   * Set how many received packets are remembered for this device.
+   *
+   * \param size The number of packets to remember.
    */
-  ReceivedPacketList GetReceivedPacketList (void);
+  void SetReceivedPacketHistorySize (uint32_t size);
+
+  /**
+   * Get how many received packets are remembered for this device.
+   */
+  uint32_t GetReceivedPacketHistorySize (void) const;
+
+  /**
+   * Make sure that at least a certain number of received packets are
+   * remembered for this device.
+   *
+   * This method is meant to be used by NetworkControllerComponent objects
+   * which need a certain history to operate.
+   *
+   * \param size The minimum number of packets to remember.
+   */
+  void ReserveReceivedPacketHistory (uint32_t size);
 
   /**
    * Set the spreading factor this device is using in the first receive window.
@@ -268,6 +443,13 @@ public:
   void InsertReceivedPacket (Ptr<Packet const> receivedPacket,
                              const Address& gwAddress);
 
+  /**
+   * Insert a received packet in the packet list, using the headers that were
+   * already parsed by the network server.
+   */
+  void InsertReceivedPacket (const UplinkContext &uplink,
+                             const Address &gwAddress);
+
   /**
    * Return the last packet that was received from this device.
    */
@@ -308,6 +490,16 @@ public:
    */
   std::map<double, Address> GetPowerGatewayMap (void);
 
+  /**
+   * Get the gateways that received the last packet from this device, from the
+   * one that received it with the highest power to the one with the lowest.
+   * Gateways that received it with the same power are sorted by address.
+   *
+   * Unlike GetPowerGatewayMap, this doesn't build a new container: the
+   * ranking is kept up to date as packets are received.
+   */
+  const std::vector<RankedGateway> &GetRankedGateways (void) const;
+
   struct Reply m_reply; //<! Next reply intended for this device
 
   LoraDeviceAddress m_endDeviceAddress;   //<! The address of this device
@@ -324,6 +516,14 @@ private:
 
   ReceivedPacketList m_receivedPacketList;   //<! List of received packets
 
+  /**
+   * Insert a gateway in the ranking of the last packet, if it's not there
+   * already.
+   */
+  void AddRankedGateway (const PacketInfoPerGw &gwInfo);
+
+  std::vector<RankedGateway> m_rankedGateways;   //<! Gateways that received the last packet, best first
+
   // NOTE Using this attribute is 'cheating', since we are assuming perfect
   // synchronization between the info at the device and at the network server
   Ptr<EndDeviceLorawanMac> m_mac;   //!< Pointer to the MAC layer of this device
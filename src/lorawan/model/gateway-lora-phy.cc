@@ -31,6 +31,30 @@ NS_LOG_COMPONENT_DEFINE ("GatewayLoraPhy");
 
 NS_OBJECT_ENSURE_REGISTERED (GatewayLoraPhy);
 
+namespace {
+
+// The number of reception paths in a word of the availability bitmap
+const uint32_t pathsPerWord = 64;
+
+// Get the index of the lowest set bit of a nonzero word
+uint32_t
+LowestSetBit (uint64_t word)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll (word);
+#else
+  uint32_t bit = 0;
+  while (!(word & 1))
+    {
+      word >>= 1;
+      bit++;
+    }
+  return bit;
+#endif
+}
+
+} // namespace
+
 /**************************************
  *    ReceptionPath implementation    *
  **************************************/
@@ -46,7 +70,7 @@ GatewayLoraPhy::ReceptionPath::~ReceptionPath (void)
 }
 
 bool
-GatewayLoraPhy::ReceptionPath::IsAvailable (void)
+GatewayLoraPhy::ReceptionPath::IsAvailable (void) const
 {
   return m_available;
 }
@@ -73,7 +97,7 @@ GatewayLoraPhy::ReceptionPath::SetEvent (Ptr<LoraInterferenceHelper::Event> even
 }
 
 Ptr<LoraInterferenceHelper::Event>
-GatewayLoraPhy::ReceptionPath::GetEvent (void)
+GatewayLoraPhy::ReceptionPath::GetEvent (void) const
 {
   return m_event;
 }
@@ -139,7 +163,15 @@ GatewayLoraPhy::AddReceptionPath ()
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  m_receptionPaths.push_back (Create<GatewayLoraPhy::ReceptionPath> ());
+  uint32_t index = m_receptionPaths.size ();
+  m_receptionPaths.push_back (GatewayLoraPhy::ReceptionPath ());
+
+  // The new path is available
+  if (index % pathsPerWord == 0)
+    {
+      m_availableReceptionPaths.push_back (0);
+    }
+  m_availableReceptionPaths[index / pathsPerWord] |= uint64_t (1) << (index % pathsPerWord);
 }
 
 void
@@ -148,6 +180,82 @@ GatewayLoraPhy::ResetReceptionPaths (void)
   NS_LOG_FUNCTION (this);
 
   m_receptionPaths.clear ();
+  m_availableReceptionPaths.clear ();
+}
+
+uint32_t
+GatewayLoraPhy::FindAvailableReceptionPath (void) const
+{
+  for (uint32_t word = 0; word < m_availableReceptionPaths.size (); word++)
+    {
+      if (m_availableReceptionPaths[word] != 0)
+        {
+          return word * pathsPerWord + LowestSetBit (m_availableReceptionPaths[word]);
+        }
+    }
+  return m_receptionPaths.size ();
+}
+
+uint32_t
+GatewayLoraPhy::FindBusyReceptionPath (uint32_t first) const
+{
+  uint32_t nPaths = m_receptionPaths.size ();
+  for (uint32_t word = first / pathsPerWord; word < m_availableReceptionPaths.size (); word++)
+    {
+      uint64_t busy = ~m_availableReceptionPaths[word];
+
+      // Skip the paths before the first one
+      if (word == first / pathsPerWord)
+        {
+          busy &= ~uint64_t (0) << (first % pathsPerWord);
+        }
+
+      if (busy != 0)
+        {
+          // The bits past the last path are never set as available, so they
+          // look busy: don't return them
+          uint32_t index = word * pathsPerWord + LowestSetBit (busy);
+          return index < nPaths ? index : nPaths;
+        }
+    }
+  return nPaths;
+}
+
+uint32_t
+GatewayLoraPhy::GetReceptionPathIndex (Ptr<const LoraInterferenceHelper::Event> event) const
+{
+  // The event remembers the path that was locked on it, which may have been
+  // freed and locked on another event since
+  uint32_t index = event->GetReceptionPath ();
+  if (index >= m_receptionPaths.size () || m_receptionPaths[index].IsAvailable ()
+      || m_receptionPaths[index].GetEvent () != event)
+    {
+      return m_receptionPaths.size ();
+    }
+  return index;
+}
+
+void
+GatewayLoraPhy::LockReceptionPath (uint32_t index, Ptr<LoraInterferenceHelper::Event> event)
+{
+  NS_LOG_FUNCTION (this << index);
+  NS_ASSERT (index < m_receptionPaths.size () && m_receptionPaths[index].IsAvailable ());
+
+  m_receptionPaths[index].LockOnEvent (event);
+  event->SetReceptionPath (index);
+  m_availableReceptionPaths[index / pathsPerWord] &= ~(uint64_t (1) << (index % pathsPerWord));
+  m_occupiedReceptionPaths++;
+}
+
+void
+GatewayLoraPhy::FreeReceptionPath (uint32_t index)
+{
+  NS_LOG_FUNCTION (this << index);
+  NS_ASSERT (index < m_receptionPaths.size () && !m_receptionPaths[index].IsAvailable ());
+
+  m_receptionPaths[index].Free ();
+  m_availableReceptionPaths[index / pathsPerWord] |= uint64_t (1) << (index % pathsPerWord);
+  m_occupiedReceptionPaths--;
 }
 
 void
@@ -29,6 +29,7 @@
 #include "ns3/lora-phy.h"
 #include "ns3/traced-value.h"
 #include <list>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -44,6 +45,12 @@ class LoraChannel;
  * simultaneously. This characteristic of the chip is modeled using the
  * ReceivePath class, which describes a single parallel receiver. GatewayLoraPhy
  * essentially holds and manages a collection of these objects.
+ *
+ * The reception paths are stored contiguously, along with a bitmap of the
+ * available ones and an index of the paths by the event they are locked on,
+ * so that locking a path on a signal and releasing it take constant time
+ * whatever the number of paths, and interrupting the receptions only visits
+ * the busy paths.
  */
 class GatewayLoraPhy : public LoraPhy
 {
@@ -98,7 +105,7 @@ protected:
    * listen for a certain SF. ReceptionPaths be either locked on an event or
    * free.
    */
-  class ReceptionPath : public SimpleRefCount<GatewayLoraPhy::ReceptionPath>
+  class ReceptionPath
   {
 
   public:
@@ -114,7 +121,7 @@ protected:
      *
      * \return True if its current state is free, false if it's currently locked.
      */
-    bool IsAvailable (void);
+    bool IsAvailable (void) const;
 
     /**
      * Set this reception path as available.
@@ -145,7 +152,7 @@ protected:
      * \returns 0 if no event is currently being received, a pointer to
      * the event otherwise.
      */
-    Ptr<LoraInterferenceHelper::Event> GetEvent (void);
+    Ptr<LoraInterferenceHelper::Event> GetEvent (void) const;
 
     /**
      * Get the EventId of the EndReceive call associated to this ReceptionPath's
@@ -178,10 +185,57 @@ protected:
   };
 
   /**
-   * A list containing the various parallel receivers that are managed by this
-   * Gateway.
+   * Get the index of an available reception path.
+   *
+   * \return The index of the available path with the lowest index, or the
+   * number of paths if all of them are busy.
+   */
+  uint32_t FindAvailableReceptionPath (void) const;
+
+  /**
+   * Get the index of the next busy reception path.
+   *
+   * \param first The index of the first path to consider.
+   * \return The index of the first busy path whose index is at least first,
+   * or the number of paths if there is none.
+   */
+  uint32_t FindBusyReceptionPath (uint32_t first) const;
+
+  /**
+   * Get the index of the reception path that is locked on an event.
+   *
+   * \param event The event to look for.
+   * \return The index of the path locked on the event, or the number of paths
+   * if no path is locked on it.
+   */
+  uint32_t GetReceptionPathIndex (Ptr<const LoraInterferenceHelper::Event> event) const;
+
+  /**
+   * Lock an available reception path on an event, and mark it as occupied.
+   *
+   * \param index The index of the path, which must be available.
+   * \param event The event to lock the path on.
+   */
+  void LockReceptionPath (uint32_t index, Ptr<LoraInterferenceHelper::Event> event);
+
+  /**
+   * Free a busy reception path, and mark it as available.
+   *
+   * \param index The index of the path, which must be busy.
+   */
+  void FreeReceptionPath (uint32_t index);
+
+  /**
+   * A vector containing the various parallel receivers that are managed by
+   * this Gateway.
+   */
+  std::vector<ReceptionPath> m_receptionPaths;
+
+  /**
+   * A bitmap of the available reception paths: bit i % 64 of word i / 64 is
+   * set if the i-th path is available.
    */
-  std::list<Ptr<ReceptionPath>> m_receptionPaths;
+  std::vector<uint64_t> m_availableReceptionPaths;
 
   /**
    * The number of occupied reception paths.
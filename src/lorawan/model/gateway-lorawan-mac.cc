@@ -22,7 +22,9 @@
 #include "ns3/lorawan-mac-header.h"
 #include "ns3/lora-net-device.h"
 #include "ns3/lora-frame-header.h"
+#include "ns3/simulator.h"
 #include "ns3/log.h"
+#include <algorithm>
 
 namespace ns3 {
 namespace lorawan {
@@ -41,7 +43,8 @@ GatewayLorawanMac::GetTypeId (void)
   return tid;
 }
 
-GatewayLorawanMac::GatewayLorawanMac ()
+GatewayLorawanMac::GatewayLorawanMac () :
+  m_txEndTime (Seconds (0))
 {
   NS_LOG_FUNCTION (this);
 }
@@ -68,7 +71,7 @@ GatewayLorawanMac::Send (Ptr<Packet> packet)
   packet->AddPacketTag (tag);
 
   // Make sure we can transmit this packet
-if (m_channelHelper.GetWaitingTime(CreateObject<LogicalLoraChannel> (frequency)) > Time(0))
+  if (m_channelHelper.GetWaitingTime (frequency) > Time (0))
     {
       // We cannot send now!
       NS_LOG_WARN ("Trying to send a packet but Duty Cycle won't allow it. Aborting.");
@@ -90,12 +93,11 @@ if (m_channelHelper.GetWaitingTime(CreateObject<LogicalLoraChannel> (frequency))
   NS_LOG_DEBUG ("Duration: " << duration.GetSeconds ());
 
   // Find the channel with the desired frequency
-  double sendingPower = m_channelHelper.GetTxPowerForChannel
-      (CreateObject<LogicalLoraChannel> (frequency));
+  double sendingPower = m_channelHelper.GetTxPowerForFrequency (frequency);
 
   // Add the event to the channelHelper to keep track of duty cycle
-  m_channelHelper.AddEvent (duration, CreateObject<LogicalLoraChannel>
-                              (frequency));
+  m_channelHelper.AddEvent (duration, frequency);
+  m_txEndTime = Simulator::Now () + duration;
 
   // Send the packet to the PHY layer to send it on the channel
   m_phy->Send (packet, params, frequency, sendingPower);
@@ -152,8 +154,20 @@ GatewayLorawanMac::GetWaitingTime (double frequency)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  return m_channelHelper.GetWaitingTime (CreateObject<LogicalLoraChannel>
-                                           (frequency));
+  return m_channelHelper.GetWaitingTime (frequency);
+}
+
+Time
+GatewayLorawanMac::GetNextTransmissionTime (double frequency)
+{
+  NS_LOG_FUNCTION (this << frequency);
+
+  Time nextTime = m_channelHelper.GetNextTransmissionTime (frequency);
+  if (IsTransmitting ())
+    {
+      nextTime = std::max (nextTime, m_txEndTime);
+    }
+  return nextTime;
 }
 }
 }
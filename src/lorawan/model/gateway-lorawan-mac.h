@@ -56,8 +56,20 @@ public:
    * \return The next transmission time.
    */
   Time GetWaitingTime (double frequency);
+
+  /**
+   * Return the first time at which this gateway will be able to transmit on a
+   * frequency, taking into account both the duty cycle and the transmission
+   * that may currently be ongoing.
+   *
+   * \param frequency The frequency to check, in MHz.
+   * \return The absolute time from which transmission is possible, which may
+   * be in the past.
+   */
+  Time GetNextTransmissionTime (double frequency);
 private:
 protected:
+  Time m_txEndTime;   //!< The time at which the last transmission ends
 };
 
 } /* namespace ns3 */
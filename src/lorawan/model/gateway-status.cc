@@ -20,6 +20,7 @@
 
 #include "ns3/gateway-status.h"
 #include "ns3/log.h"
+#include <algorithm>
 
 namespace ns3 {
 namespace lorawan {
@@ -123,6 +124,18 @@ GatewayStatus::IsAvailableForTransmission (double frequency)
   return true;
 }
 
+Time
+GatewayStatus::GetNextAvailableTime (double frequency)
+{
+  NS_LOG_FUNCTION (this << frequency);
+
+  // Booking, ongoing transmission and duty cycle, as in
+  // IsAvailableForTransmission
+  Time availableTime = std::max (Simulator::Now (),
+                                 m_nextTransmissionTime + MilliSeconds (1));
+  return std::max (availableTime, m_gatewayMac->GetNextTransmissionTime (frequency));
+}
+
 void
 GatewayStatus::SetNextTransmissionTime (Time nextTransmissionTime)
 {
@@ -78,6 +78,18 @@ public:
    */
   bool IsAvailableForTransmission (double frequency);
 
+  /**
+   * Get the first time at which this gateway will be available for
+   * transmission on this frequency, according to the same criteria used by
+   * IsAvailableForTransmission.
+   *
+   * \param frequency The frequency at which the gateway's availability should
+   * be queried.
+   * \return The first time the gateway is available, which is the current
+   * time if it's available now.
+   */
+  Time GetNextAvailableTime (double frequency);
+
   void SetNextTransmissionTime (Time nextTransmissionTime);
   // Time GetNextTransmissionTime (void);
 
@@ -99,20 +99,38 @@ LogicalLoraChannelHelper::GetSubBandFromChannel (Ptr<LogicalLoraChannel>
 Ptr<SubBand>
 LogicalLoraChannelHelper::GetSubBandFromFrequency (double frequency)
 {
+  return m_subBandList[GetSubBandIndex (frequency)];
+}
+
+uint8_t
+LogicalLoraChannelHelper::GetSubBandIndex (double frequency)
+{
+  // Check whether we already know this frequency
+  for (auto it = m_frequencySubBands.begin (); it != m_frequencySubBands.end (); ++it)
+    {
+      if (it->frequency == frequency)
+        {
+          return it->subBand;
+        }
+    }
+
   // Get the SubBand this frequency belongs to
-  std::list< Ptr< SubBand > >::iterator it;
-  for (it = m_subBandList.begin (); it != m_subBandList.end (); it++)
+  for (uint8_t i = 0; i < m_subBandList.size (); i++)
     {
-      if ((*it)->BelongsToSubBand (frequency))
+      if (m_subBandList[i]->BelongsToSubBand (frequency))
         {
-          return *it;
+          FrequencySubBand entry;
+          entry.frequency = frequency;
+          entry.subBand = i;
+          m_frequencySubBands.push_back (entry);
+          return i;
         }
     }
 
   NS_LOG_ERROR ("Requested frequency: " << frequency);
   NS_ABORT_MSG ("Warning: frequency is outside any known SubBand.");
 
-  return 0;     // If no SubBand is found, return 0
+  return 0;
 }
 
 void
@@ -159,7 +177,7 @@ LogicalLoraChannelHelper::AddSubBand (double firstFrequency,
   Ptr<SubBand> subBand = Create<SubBand> (firstFrequency, lastFrequency,
                                           dutyCycle, maxTxPowerDbm);
 
-  m_subBandList.push_back (subBand);
+  AddSubBand (subBand);
 }
 
 void
@@ -168,6 +186,10 @@ LogicalLoraChannelHelper::AddSubBand (Ptr<SubBand> subBand)
   NS_LOG_FUNCTION (this << subBand);
 
   m_subBandList.push_back (subBand);
+
+  // Frequencies are assigned to the first SubBand they belong to, which the
+  // new one could be if SubBands overlap
+  m_frequencySubBands.clear ();
 }
 
 void
@@ -206,10 +228,16 @@ LogicalLoraChannelHelper::GetWaitingTime (Ptr<LogicalLoraChannel> channel)
 {
   NS_LOG_FUNCTION (this << channel);
 
+  return GetWaitingTime (channel->GetFrequency ());
+}
+
+Time
+LogicalLoraChannelHelper::GetWaitingTime (double frequency)
+{
+  NS_LOG_FUNCTION (this << frequency);
+
   // SubBand waiting time
-  Time subBandWaitingTime = GetSubBandFromChannel (channel)->
-    GetNextTransmissionTime () -
-    Simulator::Now ();
+  Time subBandWaitingTime = GetNextTransmissionTime (frequency) - Simulator::Now ();
 
   // Handle case in which waiting time is negative
   subBandWaitingTime = Seconds (std::max (subBandWaitingTime.GetSeconds (),
@@ -220,13 +248,27 @@ LogicalLoraChannelHelper::GetWaitingTime (Ptr<LogicalLoraChannel> channel)
   return subBandWaitingTime;
 }
 
+Time
+LogicalLoraChannelHelper::GetNextTransmissionTime (double frequency)
+{
+  return m_subBandList[GetSubBandIndex (frequency)]->GetNextTransmissionTime ();
+}
+
 void
 LogicalLoraChannelHelper::AddEvent (Time duration,
                                     Ptr<LogicalLoraChannel> channel)
 {
   NS_LOG_FUNCTION (this << duration << channel);
 
-  Ptr<SubBand> subBand = GetSubBandFromChannel (channel);
+  AddEvent (duration, channel->GetFrequency ());
+}
+
+void
+LogicalLoraChannelHelper::AddEvent (Time duration, double frequency)
+{
+  NS_LOG_FUNCTION (this << duration << frequency);
+
+  Ptr<SubBand> subBand = m_subBandList[GetSubBandIndex (frequency)];
 
   double dutyCycle = subBand->GetDutyCycle ();
   double timeOnAir = duration.GetSeconds ();
@@ -243,7 +285,7 @@ LogicalLoraChannelHelper::AddEvent (Time duration,
   NS_LOG_DEBUG ("m_aggregatedDutyCycle: " << m_aggregatedDutyCycle << "  dutyCycle: " << dutyCycle);
   NS_LOG_DEBUG ("Current time: " << Simulator::Now ().GetSeconds ());
   NS_LOG_DEBUG ("Next transmission on this sub-band(lowest frequency:" << subBand->GetFirstFrequency() << " MHz" << 
-                "  logic channel's frequency:" << channel->GetFrequency() << " Mhz) allowed at time: " <<
+                "  logic channel's frequency:" << frequency << " Mhz) allowed at time: " <<
                 (subBand->GetNextTransmissionTime ()).GetSeconds ());
   NS_LOG_DEBUG ("Next aggregated transmission allowed at time " <<
                 m_nextAggregatedTransmissionTime.GetSeconds ());
@@ -255,19 +297,16 @@ LogicalLoraChannelHelper::GetTxPowerForChannel (Ptr<LogicalLoraChannel>
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  // Get the maxTxPowerDbm from the SubBand this channel is in
-  std::list< Ptr< SubBand > >::iterator it;
-  for (it = m_subBandList.begin (); it != m_subBandList.end (); it++)
-    {
-      // Check whether this channel is in this SubBand
-      if ((*it)->BelongsToSubBand (logicalChannel->GetFrequency ()))
-        {
-          return (*it)->GetMaxTxPowerDbm ();
-        }
-    }
-  NS_ABORT_MSG ("Logical channel doesn't belong to a known SubBand");
+  return GetTxPowerForFrequency (logicalChannel->GetFrequency ());
+}
 
-  return 0;
+double
+LogicalLoraChannelHelper::GetTxPowerForFrequency (double frequency)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  // Get the maxTxPowerDbm from the SubBand this frequency is in
+  return m_subBandList[GetSubBandIndex (frequency)]->GetMaxTxPowerDbm ();
 }
 
 void
@@ -72,6 +72,31 @@ public:
    */
   Time GetWaitingTime (Ptr<LogicalLoraChannel> channel);
 
+  /**
+   * Get the time it is necessary to wait for before transmitting on a given
+   * frequency.
+   *
+   * This is equivalent to GetWaitingTime (Ptr<LogicalLoraChannel>), but
+   * doesn't need a LogicalLoraChannel object to be created.
+   *
+   * \param frequency The frequency we want to know the waiting time for, in
+   * MHz.
+   * \return The waiting time before transmission is allowed on the frequency.
+   */
+  Time GetWaitingTime (double frequency);
+
+  /**
+   * Get the first time at which transmission on a frequency will be allowed
+   * by the duty cycle of its SubBand.
+   *
+   * \remark This function does not take into account aggregate waiting time.
+   *
+   * \param frequency The frequency to check, in MHz.
+   * \return The absolute time from which transmission is allowed, which may
+   * be in the past.
+   */
+  Time GetNextTransmissionTime (double frequency);
+
   /**
    * Register the transmission of a packet.
    *
@@ -80,6 +105,14 @@ public:
    */
   void AddEvent (Time duration, Ptr<LogicalLoraChannel> channel);
 
+  /**
+   * Register the transmission of a packet.
+   *
+   * \param duration The duration of the transmission event.
+   * \param frequency The frequency the transmission was made on, in MHz.
+   */
+  void AddEvent (Time duration, double frequency);
+
   /**
    * Get the list of LogicalLoraChannels currently registered on this helper.
    *
@@ -152,6 +185,15 @@ public:
    */
   double GetTxPowerForChannel (Ptr<LogicalLoraChannel> logicalChannel);
 
+  /**
+   * Returns the maximum transmission power [dBm] that is allowed on a
+   * frequency.
+   *
+   * \param frequency The frequency to check, in MHz.
+   * \return The power in dBm.
+   */
+  double GetTxPowerForFrequency (double frequency);
+
   /**
    * Get the SubBand a channel belongs to.
    *
@@ -168,6 +210,18 @@ public:
    */
   Ptr<SubBand> GetSubBandFromFrequency (double frequency);
 
+  /**
+   * Get the index of the SubBand a frequency belongs to, in the order in
+   * which SubBands were added to this helper.
+   *
+   * The SubBand of each frequency is only searched the first time the
+   * frequency is seen, and remembered afterwards.
+   *
+   * \param frequency The frequency we want to check.
+   * \return The index of the SubBand the frequency belongs to.
+   */
+  uint8_t GetSubBandIndex (double frequency);
+
   /**
    * Disable the channel at a specified index.
    *
@@ -177,9 +231,25 @@ public:
 
 private:
   /**
-   * A list of the SubBands that are currently registered within this helper.
+   * Associates a frequency with the index of its SubBand.
+   */
+  struct FrequencySubBand
+  {
+    double frequency;
+    uint8_t subBand;
+  };
+
+  /**
+   * The SubBands that are currently registered within this helper, indexed
+   * by the order in which they were added.
+   */
+  std::vector<Ptr <SubBand> > m_subBandList;
+
+  /**
+   * The SubBand of the frequencies that were used so far. There are only a
+   * handful of these, so they are searched linearly.
    */
-  std::list<Ptr <SubBand> > m_subBandList;
+  std::vector<FrequencySubBand> m_frequencySubBands;
 
   /**
    * A vector of the LogicalLoraChannels that are currently registered within
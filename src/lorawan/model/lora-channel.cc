@@ -26,7 +26,19 @@
 #include "ns3/simulator.h"
 #include "ns3/end-device-lora-phy.h"
 #include "ns3/gateway-lora-phy.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/abort.h"
+#include "ns3/header.h"
+#include "ns3/node.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/mpi-receiver.h"
+#include "ns3/channel-list.h"
+#include "ns3/point-to-point-remote-channel.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace ns3 {
 namespace lorawan {
@@ -35,6 +47,101 @@ NS_LOG_COMPONENT_DEFINE ("LoraChannel");
 
 NS_OBJECT_ENSURE_REGISTERED (LoraChannel);
 
+/**
+ * The parameters of a transmission that is sent to another partition of a
+ * distributed simulation, prepended to the transmitted packet.
+ */
+class LoraRemoteTransmissionHeader : public Header
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  uint32_t senderIndex;   //!< Index of the sending PHY in the channel
+  double txPowerDbm;      //!< Transmission power
+  uint8_t sf;             //!< Spreading factor
+  Time duration;          //!< On-air duration of the packet
+  double frequencyMHz;    //!< Frequency of the transmission
+
+private:
+  static uint64_t ToBits (double value);
+  static double FromBits (uint64_t bits);
+};
+
+NS_OBJECT_ENSURE_REGISTERED (LoraRemoteTransmissionHeader);
+
+TypeId
+LoraRemoteTransmissionHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LoraRemoteTransmissionHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("lorawan")
+    .AddConstructor<LoraRemoteTransmissionHeader> ();
+  return tid;
+}
+
+TypeId
+LoraRemoteTransmissionHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+LoraRemoteTransmissionHeader::GetSerializedSize (void) const
+{
+  return 4 + 8 + 1 + 8 + 8;
+}
+
+void
+LoraRemoteTransmissionHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteHtonU32 (senderIndex);
+  start.WriteHtonU64 (ToBits (txPowerDbm));
+  start.WriteU8 (sf);
+  start.WriteHtonU64 (duration.GetTimeStep ());
+  start.WriteHtonU64 (ToBits (frequencyMHz));
+}
+
+uint32_t
+LoraRemoteTransmissionHeader::Deserialize (Buffer::Iterator start)
+{
+  senderIndex = start.ReadNtohU32 ();
+  txPowerDbm = FromBits (start.ReadNtohU64 ());
+  sf = start.ReadU8 ();
+  duration = TimeStep (start.ReadNtohU64 ());
+  frequencyMHz = FromBits (start.ReadNtohU64 ());
+  return GetSerializedSize ();
+}
+
+void
+LoraRemoteTransmissionHeader::Print (std::ostream &os) const
+{
+  os << "senderIndex=" << senderIndex << " txPowerDbm=" << txPowerDbm
+     << " sf=" << unsigned (sf) << " duration=" << duration
+     << " frequencyMHz=" << frequencyMHz;
+}
+
+uint64_t
+LoraRemoteTransmissionHeader::ToBits (double value)
+{
+  uint64_t bits;
+  std::memcpy (&bits, &value, sizeof (bits));
+  return bits;
+}
+
+double
+LoraRemoteTransmissionHeader::FromBits (uint64_t bits)
+{
+  double value;
+  std::memcpy (&value, &bits, sizeof (value));
+  return value;
+}
+
 TypeId
 LoraChannel::GetTypeId (void)
 {
@@ -52,6 +159,31 @@ LoraChannel::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&LoraChannel::m_delay),
                    MakePointerChecker<PropagationDelayModel> ())
+    .AddAttribute ("CacheLoss",
+                   "Whether to compute the loss between each pair of devices "
+                   "only once, until one of them moves.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LoraChannel::SetLossCaching,
+                                        &LoraChannel::GetLossCaching),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CullingDistance",
+                   "The distance in meters beyond which receivers are not "
+                   "notified of a transmission. 0 disables culling.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&LoraChannel::SetCullingDistance,
+                                       &LoraChannel::GetCullingDistance),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("RemoteDelay",
+                   "The minimum delay of receptions at PHYs that belong to "
+                   "other partitions of a distributed simulation. It must not "
+                   "be shorter than the delay of the point-to-point remote "
+                   "channels between partitions, and it shifts the interference "
+                   "of remote receptions, so it should be a few microseconds. "
+                   "0 disables partitioning.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&LoraChannel::SetRemoteDelay,
+                                     &LoraChannel::GetRemoteDelay),
+                   MakeTimeChecker ())
     .AddTraceSource ("PacketSent",
                      "Trace source fired whenever a packet goes out on the channel",
                      MakeTraceSourceAccessor (&LoraChannel::m_packetSent),
@@ -59,7 +191,13 @@ LoraChannel::GetTypeId (void)
   return tid;
 }
 
-LoraChannel::LoraChannel ()
+LoraChannel::LoraChannel () :
+  m_cullingDistance (0),
+  m_receiverGridValid (false),
+  m_cacheLoss (false),
+  m_remoteDelay (Seconds (0)),
+  m_partitionsValid (false),
+  m_nLoggedTransmissions (0)
 {
 }
 
@@ -68,10 +206,51 @@ LoraChannel::~LoraChannel ()
   m_phyList.clear ();
 }
 
+void
+LoraChannel::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Mobility models may outlive the channel
+  for (auto &mobility : m_trackedMobilities)
+    {
+      mobility->TraceDisconnectWithoutContext
+        ("CourseChange", MakeCallback (&LoraChannel::OnCourseChange, this));
+    }
+  m_trackedMobilities.clear ();
+  m_mobilityIds.clear ();
+  m_mobilityVersions.clear ();
+  m_mobilityPhys.clear ();
+  m_lossCache.clear ();
+
+  m_receiverGrid.clear ();
+  m_receiverCells.clear ();
+  m_receiverMoving.clear ();
+  m_movingReceivers.clear ();
+  m_receiverGridValid = false;
+
+  Simulator::Cancel (m_buildPartitionsEvent);
+  m_phySystemIds.clear ();
+  m_remoteReceivers.clear ();
+  m_partitionsValid = false;
+
+  m_transmissionLog.clear ();
+  m_phyIndexes.clear ();
+  m_phyList.clear ();
+
+  Channel::DoDispose ();
+}
+
 LoraChannel::LoraChannel (Ptr<PropagationLossModel> loss,
                           Ptr<PropagationDelayModel> delay) :
   m_loss (loss),
-  m_delay (delay)
+  m_delay (delay),
+  m_cullingDistance (0),
+  m_receiverGridValid (false),
+  m_cacheLoss (false),
+  m_remoteDelay (Seconds (0)),
+  m_partitionsValid (false),
+  m_nLoggedTransmissions (0)
 {
 }
 
@@ -82,6 +261,12 @@ LoraChannel::Add (Ptr<LoraPhy> phy)
 
   // Add the new phy to the vector
   m_phyList.push_back (phy);
+  m_phyIndexes[PeekPointer (phy)] = m_phyList.size () - 1;
+
+  // The PHY's mobility may not be available yet: place it in the grid at the
+  // next transmission
+  m_receiverGridValid = false;
+  m_partitionsValid = false;
 }
 
 void
@@ -90,7 +275,50 @@ LoraChannel::Remove (Ptr<LoraPhy> phy)
   NS_LOG_FUNCTION (this << phy);
 
   // Remove the phy from the vector
-  m_phyList.erase (find (m_phyList.begin (), m_phyList.end (), phy));
+  auto indexIt = m_phyIndexes.find (PeekPointer (phy));
+  NS_ASSERT (indexIt != m_phyIndexes.end ());
+  uint32_t index = indexIt->second;
+  m_phyList.erase (m_phyList.begin () + index);
+  m_phyIndexes.erase (indexIt);
+  for (uint32_t j = index; j < m_phyList.size (); j++)
+    {
+      m_phyIndexes[PeekPointer (m_phyList[j])] = j;
+    }
+
+  // Receptions in the log refer to PHYs by index too
+  for (auto &frequencyLog : m_transmissionLog)
+    {
+      for (auto &startAndTransmission : frequencyLog.second.transmissions)
+        {
+          std::vector<LoggedReception> &receptions = startAndTransmission.second.receptions;
+          auto it = receptions.begin ();
+          while (it != receptions.end ())
+            {
+              if (it->receiver == index)
+                {
+                  it = receptions.erase (it);
+                  continue;
+                }
+              if (it->receiver > index)
+                {
+                  it->receiver--;
+                }
+              it++;
+            }
+        }
+    }
+
+  // Indexes in the grid are not valid anymore
+  m_receiverGridValid = false;
+  m_partitionsValid = false;
+}
+
+void
+LoraChannel::Reserve (std::size_t nPhys)
+{
+  NS_LOG_FUNCTION (this << nPhys);
+
+  m_phyList.reserve (nPhys);
 }
 
 std::size_t
@@ -118,66 +346,153 @@ LoraChannel::Send (Ptr< LoraPhy > sender, Ptr< Packet > packet,
 
   NS_ASSERT (senderMobility != 0);     // Make sure it's available
 
-  NS_LOG_INFO ("Starting cycle over all " << m_phyList.size () << " PHYs");
+  std::vector<uint32_t> receivers;
+  if (m_cullingDistance > 0)
+    {
+      // Only consider the PHYs that are close enough to hear the sender
+      receivers = GetReceiversInRange (senderMobility);
+
+      NS_LOG_INFO ("Starting cycle over " << receivers.size () << " of " <<
+                   m_phyList.size () << " PHYs");
+    }
+  else
+    {
+      NS_LOG_INFO ("Starting cycle over all " << m_phyList.size () << " PHYs");
+    }
   NS_LOG_INFO ("Sender mobility: " << senderMobility->GetPosition ());
 
-  // Cycle over all registered PHYs
-  uint32_t j = 0;
-  std::vector<Ptr<LoraPhy> >::const_iterator i;
-  for (i = m_phyList.begin (); i != m_phyList.end (); i++, j++)
+  uint32_t nReceivers = m_cullingDistance > 0 ? receivers.size () : m_phyList.size ();
+
+  LoggedTransmission *logEntry = LogTransmission (packet, txParams.sf, duration,
+                                                  frequencyMHz, Simulator::Now ());
+
+  if (!IsPartitioned ())
+    {
+      // Store the receptions of this transmission in a single allocation
+      logEntry->receptions.reserve (nReceivers);
+      for (uint32_t k = 0; k < nReceivers; k++)
+        {
+          uint32_t j = m_cullingDistance > 0 ? receivers[k] : k;
+          ScheduleReception (j, sender, senderMobility, packet, txPowerDbm,
+                             txParams, duration, frequencyMHz, logEntry);
+        }
+      return;
+    }
+
+  if (!m_partitionsValid)
     {
-      // Do not deliver to the sender (*i is the current PHY)
-      if (sender != (*i))
+      BuildPartitions ();
+    }
+
+  // Only schedule receptions at the PHYs of this partition, and remember
+  // which other partitions have receivers
+  uint32_t localSystemId = MpiInterface::GetSystemId ();
+  std::vector<bool> hasReceivers (m_remoteReceivers.size (), false);
+  for (uint32_t k = 0; k < nReceivers; k++)
+    {
+      uint32_t j = m_cullingDistance > 0 ? receivers[k] : k;
+      if (m_phySystemIds[j] == localSystemId)
         {
-          // Get the receiver's mobility model
-          Ptr<MobilityModel> receiverMobility = (*i)->GetMobility ()->
-            GetObject<MobilityModel> ();
+          ScheduleReception (j, sender, senderMobility, packet, txPowerDbm,
+                             txParams, duration, frequencyMHz, logEntry);
+        }
+      else if (m_phyList[j] != sender)
+        {
+          hasReceivers[m_phySystemIds[j]] = true;
+        }
+    }
+
+  uint32_t senderIndex = m_phyIndexes.at (PeekPointer (sender));
+  for (uint32_t systemId = 0; systemId < hasReceivers.size (); systemId++)
+    {
+      if (hasReceivers[systemId])
+        {
+          SendRemote (systemId, senderIndex, packet, txPowerDbm, txParams,
+                      duration, frequencyMHz);
+        }
+    }
+}
 
-          NS_LOG_INFO ("Receiver mobility: " <<
-                       receiverMobility->GetPosition ());
+void
+LoraChannel::ScheduleReception (uint32_t j, Ptr<LoraPhy> sender,
+                                Ptr<MobilityModel> senderMobility,
+                                Ptr<Packet> packet, double txPowerDbm,
+                                LoraTxParameters txParams, Time duration,
+                                double frequencyMHz, LoggedTransmission *logEntry,
+                                Time elapsed) const
+{
+  Ptr<LoraPhy> receiver = m_phyList[j];
 
-          // Compute delay using the delay model
-          Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
+  // Do not deliver to the sender
+  if (sender == receiver)
+    {
+      return;
+    }
 
-          // Compute received power using the loss model
-          double rxPowerDbm = GetRxPower (txPowerDbm, senderMobility,
-                                          receiverMobility);
+  // Get the receiver's mobility model
+  Ptr<MobilityModel> receiverMobility = receiver->GetMobility ()->
+    GetObject<MobilityModel> ();
 
-          NS_LOG_DEBUG ("Propagation: txPower=" << txPowerDbm <<
-                        "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
-                        "distance=" << senderMobility->GetDistanceFrom (receiverMobility) <<
-                        "m, delay=" << delay);
+  NS_LOG_INFO ("Receiver mobility: " <<
+               receiverMobility->GetPosition ());
 
-          // Get the id of the destination PHY to correctly format the context
-          Ptr<NetDevice> dstNetDevice = m_phyList[j]->GetDevice ();
-          uint32_t dstNode = 0;
-          if (dstNetDevice != 0)
-            {
-              NS_LOG_INFO ("Getting node index from NetDevice, since it exists");
-              dstNode = dstNetDevice->GetNode ()->GetId ();
-              NS_LOG_DEBUG ("dstNode = " << dstNode);
-            }
-          else
-            {
-              NS_LOG_INFO ("No net device connected to the PHY, using context 0");
-            }
+  // Compute delay using the delay model
+  Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
 
-          // Create the parameters object based on the calculations above
-          LoraChannelParameters parameters;
-          parameters.rxPowerDbm = rxPowerDbm;
-          parameters.sf = txParams.sf;
-          parameters.duration = duration;
-          parameters.frequencyMHz = frequencyMHz;
+  // Transmissions coming from another partition took at least the remote
+  // delay, which already elapsed
+  if (elapsed.IsStrictlyPositive ())
+    {
+      delay = std::max (delay, elapsed) - elapsed;
+    }
 
-          // Schedule the receive event
-          NS_LOG_INFO ("Scheduling reception of the packet");
-          Simulator::ScheduleWithContext (dstNode, delay, &LoraChannel::Receive,
-                                          this, j, packet, parameters);
+  // Compute received power using the loss model
+  double rxPowerDbm = GetRxPower (txPowerDbm, senderMobility,
+                                  receiverMobility);
 
-          // Fire the trace source for sent packet
-          m_packetSent (packet);
-        }
+  NS_LOG_DEBUG ("Propagation: txPower=" << txPowerDbm <<
+                "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
+                "distance=" << senderMobility->GetDistanceFrom (receiverMobility) <<
+                "m, delay=" << delay);
+
+  // Remember what the receiver sees of this transmission, so that it can be
+  // accounted for as interference
+  LoggedReception reception;
+  reception.receiver = j;
+  reception.rxPowerDbm = rxPowerDbm;
+  reception.delay = elapsed + delay;
+  reception.ignored = false;
+  logEntry->receptions.push_back (reception);
+  m_maxLoggedDelay = std::max (m_maxLoggedDelay, reception.delay);
+
+  // Get the id of the destination PHY to correctly format the context
+  Ptr<NetDevice> dstNetDevice = receiver->GetDevice ();
+  uint32_t dstNode = 0;
+  if (dstNetDevice != 0)
+    {
+      NS_LOG_INFO ("Getting node index from NetDevice, since it exists");
+      dstNode = dstNetDevice->GetNode ()->GetId ();
+      NS_LOG_DEBUG ("dstNode = " << dstNode);
+    }
+  else
+    {
+      NS_LOG_INFO ("No net device connected to the PHY, using context 0");
     }
+
+  // Create the parameters object based on the calculations above
+  LoraChannelParameters parameters;
+  parameters.rxPowerDbm = rxPowerDbm;
+  parameters.sf = txParams.sf;
+  parameters.duration = duration;
+  parameters.frequencyMHz = frequencyMHz;
+
+  // Schedule the receive event
+  NS_LOG_INFO ("Scheduling reception of the packet");
+  Simulator::ScheduleWithContext (dstNode, delay, &LoraChannel::Receive,
+                                  this, j, packet, parameters);
+
+  // Fire the trace source for sent packet
+  m_packetSent (packet);
 }
 
 void
@@ -191,11 +506,644 @@ LoraChannel::Receive (uint32_t i, Ptr<Packet> packet,
                               parameters.duration, parameters.frequencyMHz);
 }
 
+/**
+ * An interferer, with the sequence number of its transmission in the log.
+ */
+struct SequencedInterferer
+{
+  LoraInterferenceHelper::Interferer interferer;
+  uint64_t sequence;
+};
+
+/**
+ * Order interferers the way the simulator delivers them to the receiver: by
+ * their start time at the receiver and, at the same time, in the order their
+ * receptions were scheduled, which is the order they were logged in.
+ */
+static bool
+ArrivesBefore (const SequencedInterferer &a, const SequencedInterferer &b)
+{
+  if (a.interferer.startTime != b.interferer.startTime)
+    {
+      return a.interferer.startTime < b.interferer.startTime;
+    }
+  return a.sequence < b.sequence;
+}
+
+LoraChannel::LoggedTransmission *
+LoraChannel::LogTransmission (Ptr<Packet> packet, uint8_t sf, Time duration,
+                              double frequencyMHz, Time startTime) const
+{
+  NS_LOG_FUNCTION (this << packet << unsigned (sf) << duration << frequencyMHz
+                        << startTime);
+
+  FrequencyLog &frequencyLog = m_transmissionLog[frequencyMHz];
+  frequencyLog.maxDuration = std::max (frequencyLog.maxDuration, duration);
+
+  // A reception that is still in progress started at most maxDuration ago,
+  // and a transmission ends at its receivers at most maxDuration plus the
+  // longest delay after it started: older transmissions can't overlap with
+  // any reception that still needs to be evaluated. Prune every frequency,
+  // so that the log of a frequency that is no longer used doesn't keep the
+  // receptions of its last transmissions until the end of the simulation.
+  for (auto logIt = m_transmissionLog.begin (); logIt != m_transmissionLog.end (); logIt++)
+    {
+      FrequencyLog &log = logIt->second;
+      Time oldest = Simulator::Now () - log.maxDuration - log.maxDuration - m_maxLoggedDelay;
+      auto it = log.transmissions.begin ();
+      while (it != log.transmissions.end () && it->first < oldest)
+        {
+          it = log.transmissions.erase (it);
+        }
+    }
+
+  LoggedTransmission transmission;
+  transmission.packet = packet;
+  transmission.sf = sf;
+  transmission.duration = duration;
+  transmission.sequence = m_nLoggedTransmissions++;
+  auto position = frequencyLog.transmissions.insert (std::make_pair (startTime,
+                                                                     transmission));
+  return &position->second;
+}
+
+bool
+LoraChannel::IsConnected (Ptr<const LoraPhy> phy) const
+{
+  return m_phyIndexes.find (PeekPointer (phy)) != m_phyIndexes.end ();
+}
+
+std::vector<LoraInterferenceHelper::Interferer>
+LoraChannel::GetInterferers (Ptr<const LoraPhy> receiver,
+                             Ptr<LoraInterferenceHelper::Event> event) const
+{
+  NS_LOG_FUNCTION (this << receiver << event);
+
+  std::vector<LoraInterferenceHelper::Interferer> interferers;
+
+  auto indexIt = m_phyIndexes.find (PeekPointer (receiver));
+  auto frequencyIt = m_transmissionLog.find (event->GetFrequency ());
+  if (indexIt == m_phyIndexes.end () || frequencyIt == m_transmissionLog.end ())
+    {
+      return interferers;
+    }
+  std::vector<SequencedInterferer> sequenced;
+  uint32_t j = indexIt->second;
+  const FrequencyLog &frequencyLog = frequencyIt->second;
+
+  // Transmissions that started at the sender after the end of the event
+  // can't overlap with it, and neither can the ones that ended at every
+  // receiver before its start
+  auto first = frequencyLog.transmissions.lower_bound (event->GetStartTime () -
+                                                       frequencyLog.maxDuration -
+                                                       m_maxLoggedDelay);
+  auto last = frequencyLog.transmissions.lower_bound (event->GetEndTime ());
+
+  for (auto it = first; it != last; it++)
+    {
+      const LoggedTransmission &transmission = it->second;
+
+      // Only consider transmissions the receiver was notified of
+      LoggedReception key = {j, 0, Seconds (0), false};
+      auto reception = std::lower_bound (transmission.receptions.begin (),
+                                         transmission.receptions.end (), key);
+      if (reception == transmission.receptions.end () || reception->receiver != j ||
+          reception->ignored)
+        {
+          continue;
+        }
+
+      LoraInterferenceHelper::Interferer interferer;
+      interferer.startTime = it->first + reception->delay;
+      interferer.endTime = interferer.startTime + transmission.duration;
+      interferer.rxPowerDbm = reception->rxPowerDbm;
+      interferer.sf = transmission.sf;
+
+      // Skip the event we are evaluating, and signals that don't overlap
+      // with it
+      if (transmission.packet == event->GetPacket () &&
+          interferer.startTime == event->GetStartTime ())
+        {
+          continue;
+        }
+      if (interferer.endTime <= event->GetStartTime () ||
+          interferer.startTime >= event->GetEndTime ())
+        {
+          continue;
+        }
+
+      SequencedInterferer entry;
+      entry.interferer = interferer;
+      entry.sequence = transmission.sequence;
+      sequenced.push_back (entry);
+    }
+
+  // Signals are logged by their start time at the sender, but they are
+  // evaluated in the order they arrived, like the PHYs' own interference
+  // helpers do
+  std::sort (sequenced.begin (), sequenced.end (), ArrivesBefore);
+  interferers.reserve (sequenced.size ());
+  for (auto it = sequenced.begin (); it != sequenced.end (); it++)
+    {
+      interferers.push_back (it->interferer);
+    }
+
+  NS_LOG_DEBUG ("Found " << interferers.size () << " interferers");
+
+  return interferers;
+}
+
+void
+LoraChannel::IgnoreSignal (Ptr<const LoraPhy> receiver, Ptr<Packet> packet,
+                           double frequencyMHz)
+{
+  NS_LOG_FUNCTION (this << receiver << packet << frequencyMHz);
+
+  auto indexIt = m_phyIndexes.find (PeekPointer (receiver));
+  auto frequencyIt = m_transmissionLog.find (frequencyMHz);
+  if (indexIt == m_phyIndexes.end () || frequencyIt == m_transmissionLog.end ())
+    {
+      return;
+    }
+  uint32_t j = indexIt->second;
+  FrequencyLog &frequencyLog = frequencyIt->second;
+
+  // The signal is arriving now, so it was sent at most the longest delay ago
+  auto first = frequencyLog.transmissions.lower_bound (Simulator::Now () - m_maxLoggedDelay);
+  auto last = frequencyLog.transmissions.upper_bound (Simulator::Now ());
+  for (auto it = first; it != last; it++)
+    {
+      LoggedTransmission &transmission = it->second;
+      if (transmission.packet != packet)
+        {
+          continue;
+        }
+
+      LoggedReception key = {j, 0, Seconds (0), false};
+      auto reception = std::lower_bound (transmission.receptions.begin (),
+                                         transmission.receptions.end (), key);
+      if (reception != transmission.receptions.end () && reception->receiver == j &&
+          it->first + reception->delay == Simulator::Now ())
+        {
+          reception->ignored = true;
+          return;
+        }
+    }
+}
+
 double
 LoraChannel::GetRxPower (double txPowerDbm, Ptr<MobilityModel> senderMobility,
                          Ptr<MobilityModel> receiverMobility) const
 {
-  return m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+  if (!m_cacheLoss)
+    {
+      return m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+    }
+
+  uint32_t senderId = TrackMobility (senderMobility);
+  uint32_t receiverId = TrackMobility (receiverMobility);
+  uint64_t key = (uint64_t (senderId) << 32) | receiverId;
+
+  // Use the cached value, unless one of the two devices moved since it was
+  // computed
+  auto it = m_lossCache.find (key);
+  if (it != m_lossCache.end () &&
+      it->second.senderVersion == m_mobilityVersions[senderId] &&
+      it->second.receiverVersion == m_mobilityVersions[receiverId])
+    {
+      return txPowerDbm - it->second.lossDb;
+    }
+
+  double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+
+  CachedLoss &entry = m_lossCache[key];
+  entry.lossDb = txPowerDbm - rxPowerDbm;
+  entry.senderVersion = m_mobilityVersions[senderId];
+  entry.receiverVersion = m_mobilityVersions[receiverId];
+
+  return rxPowerDbm;
+}
+
+void
+LoraChannel::SetLossCaching (bool cacheLoss)
+{
+  NS_LOG_FUNCTION (this << cacheLoss);
+
+  m_cacheLoss = cacheLoss;
+  m_lossCache.clear ();
+}
+
+bool
+LoraChannel::GetLossCaching (void) const
+{
+  return m_cacheLoss;
+}
+
+void
+LoraChannel::SetCullingDistance (double cullingDistance)
+{
+  NS_LOG_FUNCTION (this << cullingDistance);
+
+  m_cullingDistance = cullingDistance;
+
+  // The grid's cell size depends on the culling distance
+  m_receiverGridValid = false;
+}
+
+double
+LoraChannel::GetCullingDistance (void) const
+{
+  return m_cullingDistance;
+}
+
+double
+LoraChannel::ComputeCullingDistance (Ptr<PropagationLossModel> loss,
+                                     double txPowerDbm, double marginDb)
+{
+  NS_LOG_FUNCTION (loss << txPowerDbm << marginDb);
+
+  // Find the lowest sensitivity among all receivers
+  double minSensitivity = std::min (*std::min_element (GatewayLoraPhy::sensitivity,
+                                                       GatewayLoraPhy::sensitivity + 6),
+                                    *std::min_element (EndDeviceLoraPhy::sensitivity,
+                                                       EndDeviceLoraPhy::sensitivity + 6));
+
+  Ptr<ConstantPositionMobilityModel> tx = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<ConstantPositionMobilityModel> rx = CreateObject<ConstantPositionMobilityModel> ();
+  tx->SetPosition (Vector (0, 0, 0));
+
+  // Find a distance at which the signal cannot be received anymore, doubling
+  // it at each step
+  double inRange = 0;
+  double outOfRange = 1;
+  rx->SetPosition (Vector (outOfRange, 0, 0));
+  while (loss->CalcRxPower (txPowerDbm, tx, rx) + marginDb >= minSensitivity)
+    {
+      inRange = outOfRange;
+      outOfRange *= 2;
+      rx->SetPosition (Vector (outOfRange, 0, 0));
+
+      NS_ABORT_MSG_IF (outOfRange > 1e9, "The loss model never brings the "
+                       "received power below sensitivity");
+    }
+
+  // Bisect to find the limit with meter accuracy
+  while (outOfRange - inRange > 1)
+    {
+      double distance = (inRange + outOfRange) / 2;
+      rx->SetPosition (Vector (distance, 0, 0));
+      if (loss->CalcRxPower (txPowerDbm, tx, rx) + marginDb >= minSensitivity)
+        {
+          inRange = distance;
+        }
+      else
+        {
+          outOfRange = distance;
+        }
+    }
+
+  NS_LOG_DEBUG ("Culling distance for " << txPowerDbm << " dBm and a " <<
+                marginDb << " dB margin: " << outOfRange << " m");
+
+  return outOfRange;
+}
+
+std::vector<uint32_t>
+LoraChannel::GetReceiversInRange (Ptr<MobilityModel> senderMobility) const
+{
+  NS_LOG_FUNCTION (this << senderMobility);
+
+  if (!m_receiverGridValid)
+    {
+      BuildReceiverGrid ();
+    }
+
+  // Since cells are as large as the culling distance, all receivers in range
+  // are in the sender's cell or in the ones surrounding it
+  std::pair<int, int> senderCell = GetCell (senderMobility->GetPosition ());
+
+  std::vector<uint32_t> candidates;
+  for (int dx = -1; dx <= 1; dx++)
+    {
+      for (int dy = -1; dy <= 1; dy++)
+        {
+          auto cellIt = m_receiverGrid.find (std::make_pair (senderCell.first + dx,
+                                                             senderCell.second + dy));
+          if (cellIt != m_receiverGrid.end ())
+            {
+              candidates.insert (candidates.end (), cellIt->second.begin (),
+                                 cellIt->second.end ());
+            }
+        }
+    }
+
+  // Moving PHYs may be anywhere by now
+  candidates.insert (candidates.end (), m_movingReceivers.begin (),
+                     m_movingReceivers.end ());
+
+  // Getting a position may fire CourseChange, which moves PHYs in the grid:
+  // only check the distances once all candidates are known
+  std::vector<uint32_t> receivers;
+  for (auto j : candidates)
+    {
+      if (m_phyList[j]->GetMobility ()->GetDistanceFrom (senderMobility) <=
+          m_cullingDistance)
+        {
+          receivers.push_back (j);
+        }
+    }
+
+  // Deliver packets in the same order we would use without culling
+  std::sort (receivers.begin (), receivers.end ());
+
+  return receivers;
+}
+
+void
+LoraChannel::BuildReceiverGrid (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  m_receiverGrid.clear ();
+  m_receiverCells.assign (m_phyList.size (), std::make_pair (0, 0));
+  m_receiverMoving.assign (m_phyList.size (), false);
+  m_movingReceivers.clear ();
+  for (auto &phys : m_mobilityPhys)
+    {
+      phys.clear ();
+    }
+
+  for (uint32_t j = 0; j < m_phyList.size (); j++)
+    {
+      // Make sure we are notified when this PHY moves
+      uint32_t id = TrackMobility (m_phyList[j]->GetMobility ());
+      if (id >= m_mobilityPhys.size ())
+        {
+          m_mobilityPhys.resize (id + 1);
+        }
+      m_mobilityPhys[id].push_back (j);
+
+      PlaceReceiver (j);
+    }
+
+  m_receiverGridValid = true;
+}
+
+void
+LoraChannel::PlaceReceiver (uint32_t j) const
+{
+  Ptr<MobilityModel> mobility = m_phyList[j]->GetMobility ();
+
+  // A PHY that moves at constant velocity doesn't fire CourseChange, so it
+  // can't be kept in a cell
+  Vector velocity = mobility->GetVelocity ();
+  if (velocity.x != 0 || velocity.y != 0)
+    {
+      m_receiverMoving[j] = true;
+      m_movingReceivers.push_back (j);
+      return;
+    }
+
+  std::pair<int, int> cell = GetCell (mobility->GetPosition ());
+  m_receiverMoving[j] = false;
+  m_receiverGrid[cell].push_back (j);
+  m_receiverCells[j] = cell;
+}
+
+void
+LoraChannel::UnplaceReceiver (uint32_t j) const
+{
+  std::vector<uint32_t> &list = m_receiverMoving[j] ? m_movingReceivers :
+    m_receiverGrid[m_receiverCells[j]];
+  list.erase (std::find (list.begin (), list.end (), j));
+}
+
+std::pair<int, int>
+LoraChannel::GetCell (Vector position) const
+{
+  return std::make_pair (int (std::floor (position.x / m_cullingDistance)),
+                         int (std::floor (position.y / m_cullingDistance)));
+}
+
+uint32_t
+LoraChannel::TrackMobility (Ptr<MobilityModel> mobility) const
+{
+  auto it = m_mobilityIds.find (PeekPointer (mobility));
+  if (it != m_mobilityIds.end ())
+    {
+      return it->second;
+    }
+
+  NS_LOG_DEBUG ("Tracking a new mobility model: " << mobility);
+
+  // Keep a reference to the model, so that its address can't be reused
+  uint32_t id = m_trackedMobilities.size ();
+  m_trackedMobilities.push_back (mobility);
+  m_mobilityVersions.push_back (0);
+  m_mobilityIds[PeekPointer (mobility)] = id;
+
+  mobility->TraceConnectWithoutContext
+    ("CourseChange", MakeCallback (&LoraChannel::OnCourseChange, this));
+
+  return id;
+}
+
+void
+LoraChannel::OnCourseChange (Ptr<const MobilityModel> mobility) const
+{
+  NS_LOG_FUNCTION (this << mobility);
+
+  // Losses computed for this mobility model are now stale
+  auto idIt = m_mobilityIds.find (PeekPointer (mobility));
+  if (idIt == m_mobilityIds.end ())
+    {
+      return;
+    }
+  uint32_t id = idIt->second;
+  m_mobilityVersions[id]++;
+
+  // The grid will be rebuilt from scratch anyway
+  if (!m_receiverGridValid || m_cullingDistance <= 0 || id >= m_mobilityPhys.size ())
+    {
+      return;
+    }
+
+  // Move the PHYs using this mobility model to their new cell, or to the
+  // moving PHYs if they started moving
+  for (auto j : m_mobilityPhys[id])
+    {
+      UnplaceReceiver (j);
+      PlaceReceiver (j);
+    }
+}
+
+void
+LoraChannel::SetRemoteDelay (Time remoteDelay)
+{
+  NS_LOG_FUNCTION (this << remoteDelay);
+
+  m_remoteDelay = remoteDelay;
+  m_partitionsValid = false;
+
+  // Other partitions may send us transmissions before we send any, so make
+  // sure we can receive them from the start of the simulation
+  if (m_remoteDelay.IsStrictlyPositive ())
+    {
+      Simulator::Cancel (m_buildPartitionsEvent);
+      m_buildPartitionsEvent = Simulator::ScheduleNow (&LoraChannel::BuildPartitions, this);
+    }
+}
+
+Time
+LoraChannel::GetRemoteDelay (void) const
+{
+  return m_remoteDelay;
+}
+
+bool
+LoraChannel::IsPartitioned (void) const
+{
+  return m_remoteDelay.IsStrictlyPositive () && MpiInterface::IsEnabled ()
+         && MpiInterface::GetSize () > 1;
+}
+
+void
+LoraChannel::BuildPartitions (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  if (!IsPartitioned ())
+    {
+      return;
+    }
+
+  // Remote events are sent with the remote delay, so it must not be shorter
+  // than the lookahead the distributed simulator derived from the
+  // point-to-point remote channels
+  Time lookahead;
+  bool foundRemoteChannel = false;
+  for (ChannelList::Iterator it = ChannelList::Begin (); it != ChannelList::End (); ++it)
+    {
+      if (DynamicCast<PointToPointRemoteChannel> (*it) == 0)
+        {
+          continue;
+        }
+      TimeValue delay;
+      (*it)->GetAttribute ("Delay", delay);
+      if (!foundRemoteChannel || delay.Get () < lookahead)
+        {
+          lookahead = delay.Get ();
+          foundRemoteChannel = true;
+        }
+    }
+  NS_ABORT_MSG_UNLESS (foundRemoteChannel,
+                       "A partitioned channel needs point-to-point remote channels "
+                       "between partitions to set the lookahead");
+  NS_ABORT_MSG_IF (m_remoteDelay < lookahead,
+                   "The remote delay " << m_remoteDelay << " is shorter than the lookahead "
+                                       << lookahead);
+
+  m_phySystemIds.clear ();
+  m_remoteReceivers.assign (MpiInterface::GetSize (),
+                            std::make_pair (uint32_t (-1), uint32_t (0)));
+
+  for (uint32_t j = 0; j < m_phyList.size (); j++)
+    {
+      Ptr<NetDevice> device = m_phyList[j]->GetDevice ();
+      NS_ABORT_MSG_IF (device == 0 || device->GetNode () == 0,
+                       "PHYs of a partitioned channel must be installed on a node");
+      uint32_t systemId = device->GetNode ()->GetSystemId ();
+      NS_ABORT_MSG_IF (systemId >= m_remoteReceivers.size (),
+                       "Node " << device->GetNode ()->GetId () << " belongs to partition "
+                               << systemId << ", but there are only "
+                               << m_remoteReceivers.size ());
+      m_phySystemIds.push_back (systemId);
+
+      // The first device of each partition receives the transmissions sent
+      // to the partition
+      if (m_remoteReceivers[systemId].first == uint32_t (-1))
+        {
+          m_remoteReceivers[systemId] = std::make_pair (device->GetNode ()->GetId (),
+                                                        device->GetIfIndex ());
+          if (device->GetObject<MpiReceiver> () == 0)
+            {
+              Ptr<MpiReceiver> mpiReceiver = CreateObject<MpiReceiver> ();
+              mpiReceiver->SetReceiveCallback (MakeCallback (&LoraChannel::ReceiveRemote,
+                                                             this));
+              device->AggregateObject (mpiReceiver);
+            }
+        }
+    }
+
+  m_partitionsValid = true;
+}
+
+void
+LoraChannel::SendRemote (uint32_t systemId, uint32_t senderIndex, Ptr<Packet> packet,
+                         double txPowerDbm, LoraTxParameters txParams, Time duration,
+                         double frequencyMHz) const
+{
+  NS_LOG_FUNCTION (this << systemId << senderIndex << packet);
+
+  LoraRemoteTransmissionHeader header;
+  header.senderIndex = senderIndex;
+  header.txPowerDbm = txPowerDbm;
+  header.sf = txParams.sf;
+  header.duration = duration;
+  header.frequencyMHz = frequencyMHz;
+
+  Ptr<Packet> remotePacket = packet->Copy ();
+  remotePacket->AddHeader (header);
+
+  MpiInterface::SendPacket (remotePacket, Simulator::Now () + m_remoteDelay,
+                            m_remoteReceivers[systemId].first,
+                            m_remoteReceivers[systemId].second);
+}
+
+void
+LoraChannel::ReceiveRemote (Ptr<Packet> packet) const
+{
+  NS_LOG_FUNCTION (this << packet);
+
+  if (!m_partitionsValid)
+    {
+      BuildPartitions ();
+    }
+
+  LoraRemoteTransmissionHeader header;
+  packet->RemoveHeader (header);
+
+  NS_ASSERT (header.senderIndex < m_phyList.size ());
+  Ptr<LoraPhy> sender = m_phyList[header.senderIndex];
+  Ptr<MobilityModel> senderMobility = sender->GetMobility ();
+
+  LoraTxParameters txParams;
+  txParams.sf = header.sf;
+
+  // Schedule the receptions at the PHYs of this partition that can hear the
+  // sender, as if the transmission started remote delay ago
+  std::vector<uint32_t> receivers;
+  if (m_cullingDistance > 0)
+    {
+      receivers = GetReceiversInRange (senderMobility);
+    }
+  uint32_t nReceivers = m_cullingDistance > 0 ? receivers.size () : m_phyList.size ();
+
+  LoggedTransmission *logEntry = LogTransmission (packet, header.sf, header.duration,
+                                                  header.frequencyMHz,
+                                                  Simulator::Now () - m_remoteDelay);
+
+  uint32_t localSystemId = MpiInterface::GetSystemId ();
+  for (uint32_t k = 0; k < nReceivers; k++)
+    {
+      uint32_t j = m_cullingDistance > 0 ? receivers[k] : k;
+      if (m_phySystemIds[j] == localSystemId)
+        {
+          ScheduleReception (j, sender, senderMobility, packet, header.txPowerDbm,
+                             txParams, header.duration, header.frequencyMHz,
+                             logEntry, m_remoteDelay);
+        }
+    }
 }
 
 std::ostream &operator << (std::ostream &os, const LoraChannelParameters &params)
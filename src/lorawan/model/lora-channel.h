@@ -25,7 +25,10 @@
 #define LORA_CHANNEL_H
 
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include "ns3/lora-phy.h"
+#include "ns3/lora-interference-helper.h"
 #include "ns3/mobility-model.h"
 #include "ns3/channel.h"
 #include "ns3/net-device.h"
@@ -34,6 +37,7 @@
 #include "ns3/logical-lora-channel.h"
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
+#include "ns3/event-id.h"
 
 namespace ns3 {
 class NetDevice;
@@ -114,6 +118,14 @@ public:
     */
   void Remove (Ptr<LoraPhy> phy);
 
+  /**
+    * Make room for a number of PHYs, to avoid growing the list of PHYs many
+    * times when connecting a large number of them.
+    *
+    * \param nPhys The total number of PHYs that will be connected.
+    */
+  void Reserve (std::size_t nPhys);
+
   /**
     * Send a packet in the channel.
     *
@@ -132,7 +144,9 @@ public:
     * \internal
     *
     * When this method is called, the channel schedules an internal Receive call
-    * that performs the actual call to the PHY's StartReceive function.
+    * that performs the actual call to the PHY's StartReceive function. The
+    * transmission is also added to the log of its frequency, together with the
+    * power and delay computed for each receiver, for use by GetInterferers.
     */
   void Send (Ptr<LoraPhy> sender, Ptr<Packet> packet, double txPowerDbm,
              LoraTxParameters txParams, Time duration, double frequencyMHz)
@@ -153,7 +167,342 @@ public:
   double GetRxPower (double txPowerDbm, Ptr<MobilityModel> senderMobility,
                      Ptr<MobilityModel> receiverMobility) const;
 
+  /**
+    * Set whether the loss between each pair of mobility models should be
+    * computed once and then reused.
+    *
+    * The cached loss of a pair is invalidated whenever one of the two mobility
+    * models fires its CourseChange trace source. Caching assumes that the
+    * loss model only depends on the position of the two devices: loss models
+    * that draw a new random value at each call (like the internal wall
+    * component of BuildingPenetrationLoss) will only draw it once per pair.
+    *
+    * \param cacheLoss Whether to cache the loss.
+    */
+  void SetLossCaching (bool cacheLoss);
+
+  /**
+    * Get whether the loss between each pair of mobility models is cached.
+    *
+    * \return Whether the loss is cached.
+    */
+  bool GetLossCaching (void) const;
+
+  /**
+    * Set the distance beyond which receivers are not notified of a
+    * transmission.
+    *
+    * When this distance is positive, the channel keeps the connected PHYs in a
+    * uniform grid of cells as large as the culling distance, and Send only
+    * considers PHYs in the cells that surround the sender. The grid is kept up
+    * to date through the CourseChange trace source of the PHYs' mobility
+    * models: PHYs that are moving when their course changes are kept out of
+    * the grid, and are checked at each transmission, since their position
+    * changes without notification. PHYs can share a mobility model.
+    *
+    * Culled receivers are not notified of the transmission at all, so they
+    * will also not account for it as interference. A value of 0 disables
+    * culling.
+    *
+    * \param cullingDistance The culling distance, in meters.
+    */
+  void SetCullingDistance (double cullingDistance);
+
+  /**
+    * Get the distance beyond which receivers are not notified of a
+    * transmission.
+    *
+    * \return The culling distance, in meters, or 0 if culling is disabled.
+    */
+  double GetCullingDistance (void) const;
+
+  /**
+    * Compute the distance at which a transmission is received below the
+    * sensitivity of every LoRa receiver, for a given loss model.
+    *
+    * The returned distance is the one at which the power received through
+    * the loss model, increased by a margin, falls below the lowest of the
+    * GatewayLoraPhy and EndDeviceLoraPhy sensitivities. The loss model is
+    * assumed to be monotonically increasing with distance: it should typically
+    * be the deterministic part of the channel's loss model, while the margin
+    * can be used to account for shadowing.
+    *
+    * \param loss The loss model to use to compute the best-case received power.
+    * \param txPowerDbm The highest transmission power in the network, in dBm.
+    * \param marginDb A margin added to the received power, in dB.
+    * \return The distance, in meters, that can be used as culling distance.
+    */
+  static double ComputeCullingDistance (Ptr<PropagationLossModel> loss,
+                                        double txPowerDbm, double marginDb);
+
+  /**
+    * Set the minimum delay of receptions at PHYs that belong to other
+    * partitions of a distributed simulation.
+    *
+    * When this delay is positive and the simulation is distributed with MPI,
+    * Send only schedules receptions at the PHYs whose node belongs to the
+    * local partition (i.e., whose system id is the MPI rank of this process).
+    * Other partitions that have receivers of the transmission are sent a
+    * single remote event each, at the time of the transmission plus this
+    * delay, and schedule the receptions at their own PHYs. Receptions at
+    * PHYs of other partitions are delayed by at least this amount.
+    *
+    * The remote delay must not be shorter than the lookahead of the
+    * distributed simulator, which is the minimum delay of the point-to-point
+    * remote channels between partitions: it can be set to that delay. The
+    * simulation aborts when partitions are built if there is no such channel,
+    * or if the remote delay is shorter. All partitions must build the same
+    * channel, with the same PHYs in the same order, and the position of the
+    * PHYs and the loss model must be the same in every partition. A value of
+    * 0, the default, disables partitioning.
+    *
+    * Receptions at PHYs of other partitions start after the longest of the
+    * propagation delay and the remote delay, so their interference with
+    * local signals is shifted by up to the remote delay minus the
+    * propagation delay. Keep the remote delay small (a few microseconds)
+    * compared to the symbol time of LoRa, which is at least about 1 ms at
+    * SF7 and 125 kHz, so that this shift does not change the outcome of
+    * receptions.
+    *
+    * \param remoteDelay The minimum delay of remote receptions.
+    */
+  void SetRemoteDelay (Time remoteDelay);
+
+  /**
+    * Get the minimum delay of receptions at PHYs that belong to other
+    * partitions of a distributed simulation.
+    *
+    * \return The remote delay, or 0 if partitioning is disabled.
+    */
+  Time GetRemoteDelay (void) const;
+
+  /**
+    * Get whether a PHY is connected to this channel.
+    *
+    * PHYs that are connected to the channel can compute the interference
+    * affecting their receptions with GetInterferers, and don't need to keep
+    * track of all incoming signals themselves.
+    *
+    * \param phy The PHY to look for.
+    * \return Whether the PHY was added to this channel.
+    */
+  bool IsConnected (Ptr<const LoraPhy> phy) const;
+
+  /**
+    * Get the signals that overlap with a reception at a PHY.
+    *
+    * The channel keeps a single log of the transmissions on each frequency,
+    * with the power and the delay that were computed for each of their
+    * receivers when the transmission was sent. This method looks up the
+    * transmissions that the PHY was notified of, and that overlap with the
+    * event at the PHY. The event itself is not part of the returned signals.
+    *
+    * \param receiver The PHY that is receiving the event.
+    * \param event The event the PHY is receiving, created at the time the
+    * channel notified the PHY.
+    * \return The signals on the frequency of the event that overlap with it,
+    * in the order they arrived at the receiver.
+    */
+  std::vector<LoraInterferenceHelper::Interferer>
+  GetInterferers (Ptr<const LoraPhy> receiver,
+                  Ptr<LoraInterferenceHelper::Event> event) const;
+
+  /**
+    * Stop accounting for a signal that is arriving at a PHY as interference
+    * for its receptions.
+    *
+    * PHYs that drop signals without keeping track of them, like gateways
+    * that are transmitting, call this so that the signal is also left out of
+    * the interferers returned by GetInterferers.
+    *
+    * \param receiver The PHY the signal is arriving at.
+    * \param packet The packet carried by the signal.
+    * \param frequencyMHz The frequency of the signal.
+    */
+  void IgnoreSignal (Ptr<const LoraPhy> receiver, Ptr<Packet> packet,
+                     double frequencyMHz);
+
+protected:
+  virtual void DoDispose (void);
+
 private:
+  /**
+    * The reception of a logged transmission at one of the PHYs it was
+    * delivered to.
+    */
+  struct LoggedReception
+  {
+    uint32_t receiver;   //!< The index of the receiving PHY in m_phyList.
+    double rxPowerDbm;   //!< The power of the signal at the receiver.
+    Time delay;          //!< The delay of the start of the signal at the receiver.
+    bool ignored;        //!< Whether the receiver dropped the signal, see IgnoreSignal.
+
+    /**
+      * Order receptions by receiver, to look them up with a binary search.
+      */
+    bool operator< (const LoggedReception &other) const
+    {
+      return receiver < other.receiver;
+    }
+  };
+
+  /**
+    * A transmission in the log of its frequency.
+    */
+  struct LoggedTransmission
+  {
+    Ptr<Packet> packet;   //!< The packet that was sent.
+    uint8_t sf;           //!< The spreading factor of the transmission.
+    Time duration;        //!< The on-air duration of the transmission.
+    uint64_t sequence;    //!< The number of transmissions logged before this one.
+
+    /**
+      * The PHYs the transmission was delivered to, sorted by index.
+      */
+    std::vector<LoggedReception> receptions;
+  };
+
+  /**
+    * The transmissions on a single frequency, indexed by the time they
+    * started at the sender, together with the longest duration that was seen
+    * on the frequency.
+    */
+  struct FrequencyLog
+  {
+    std::multimap<Time, LoggedTransmission> transmissions;
+    Time maxDuration;
+  };
+
+  /**
+    * Add a transmission to the log of its frequency, removing the
+    * transmissions that can't overlap with any reception anymore from the
+    * logs of all frequencies.
+    *
+    * The log thus only holds the transmissions of the last two longest
+    * airtimes plus the longest propagation delay, each with one entry for
+    * every PHY it was delivered to.
+    *
+    * \param packet The packet that is being sent over the channel.
+    * \param sf The spreading factor of the transmission.
+    * \param duration The on-air duration of this packet.
+    * \param frequencyMHz The frequency this transmission will happen at.
+    * \param startTime The time the transmission started at the sender.
+    * \return The entry of the log, to which receptions can be added.
+    */
+  LoggedTransmission *LogTransmission (Ptr<Packet> packet, uint8_t sf,
+                                       Time duration, double frequencyMHz,
+                                       Time startTime) const;
+
+  /**
+    * Compute the received power at a PHY and schedule the corresponding
+    * Receive call.
+    *
+    * \param j The index of the receiving phy.
+    * \param sender The phy that is sending the packet.
+    * \param senderMobility The mobility model of the sender.
+    * \param packet The packet that is being sent over the channel.
+    * \param txPowerDbm The power of the transmission.
+    * \param txParams The set of parameters that are used by the transmitter.
+    * \param duration The on-air duration of this packet.
+    * \param frequencyMHz The frequency this transmission will happen at.
+    * \param logEntry The entry of the transmission log to record the
+    * reception in.
+    * \param elapsed The time that elapsed since the start of the
+    * transmission at the sender.
+    */
+  void ScheduleReception (uint32_t j, Ptr<LoraPhy> sender,
+                          Ptr<MobilityModel> senderMobility,
+                          Ptr<Packet> packet, double txPowerDbm,
+                          LoraTxParameters txParams, Time duration,
+                          double frequencyMHz, LoggedTransmission *logEntry,
+                          Time elapsed = Seconds (0)) const;
+
+  /**
+    * Whether transmissions are split among the partitions of a distributed
+    * simulation.
+    */
+  bool IsPartitioned (void) const;
+
+  /**
+    * Find the partition of each connected PHY, and the device through which
+    * each partition receives remote transmissions.
+    */
+  void BuildPartitions (void) const;
+
+  /**
+    * Send a transmission to another partition, which will schedule the
+    * receptions at its PHYs.
+    *
+    * \param systemId The partition to send the transmission to.
+    * \param senderIndex The index of the sending PHY in m_phyList.
+    * \param packet The packet that is being sent over the channel.
+    * \param txPowerDbm The power of the transmission.
+    * \param txParams The set of parameters that are used by the transmitter.
+    * \param duration The on-air duration of this packet.
+    * \param frequencyMHz The frequency this transmission will happen at.
+    */
+  void SendRemote (uint32_t systemId, uint32_t senderIndex, Ptr<Packet> packet,
+                   double txPowerDbm, LoraTxParameters txParams, Time duration,
+                   double frequencyMHz) const;
+
+  /**
+    * Receive a transmission sent by another partition, and schedule the
+    * receptions at the PHYs of this partition.
+    *
+    * \param packet The packet, with a LoraRemoteTransmissionHeader.
+    */
+  void ReceiveRemote (Ptr<Packet> packet) const;
+
+  /**
+    * Get the indexes of the PHYs that are within the culling distance of a
+    * sender, in increasing order.
+    *
+    * \param senderMobility The mobility model of the sender.
+    * \return The indexes of the PHYs in m_phyList that can hear the sender.
+    */
+  std::vector<uint32_t> GetReceiversInRange (Ptr<MobilityModel> senderMobility) const;
+
+  /**
+    * Place all connected PHYs in the grid, based on their current position.
+    */
+  void BuildReceiverGrid (void) const;
+
+  /**
+    * Get the grid cell a position belongs to.
+    */
+  std::pair<int, int> GetCell (Vector position) const;
+
+  /**
+    * Put a PHY in the cell of its current position or, if it is moving, in
+    * the list of moving PHYs.
+    *
+    * \param j The index of the PHY in m_phyList.
+    */
+  void PlaceReceiver (uint32_t j) const;
+
+  /**
+    * Remove a PHY from its grid cell or from the list of moving PHYs.
+    *
+    * \param j The index of the PHY in m_phyList.
+    */
+  void UnplaceReceiver (uint32_t j) const;
+
+  /**
+    * Get a compact identifier for a mobility model, connecting to its
+    * CourseChange trace source the first time it is seen.
+    *
+    * \param mobility The mobility model to identify.
+    * \return The identifier of the mobility model.
+    */
+  uint32_t TrackMobility (Ptr<MobilityModel> mobility) const;
+
+  /**
+    * Callback for the CourseChange trace source of the PHYs' mobility models.
+    *
+    * \param mobility The mobility model whose position changed.
+    */
+  void OnCourseChange (Ptr<const MobilityModel> mobility) const;
+
   /**
     * Private method that is scheduled by LoraChannel's Send method to happen
     * after the channel delay, for each of the connected PHY layers.
@@ -192,6 +541,133 @@ private:
    */
   TracedCallback<Ptr<const Packet> > m_packetSent;
 
+  /**
+   * The distance beyond which receivers are culled, or 0 if culling is
+   * disabled.
+   */
+  double m_cullingDistance;
+
+  /**
+   * Whether m_receiverGrid reflects the current set of PHYs.
+   */
+  mutable bool m_receiverGridValid;
+
+  /**
+   * The indexes of the PHYs in m_phyList, grouped by the grid cell they are
+   * currently in.
+   */
+  mutable std::map<std::pair<int, int>, std::vector<uint32_t> > m_receiverGrid;
+
+  /**
+   * The grid cell each PHY in m_phyList is currently in, if it is not
+   * moving.
+   */
+  mutable std::vector<std::pair<int, int> > m_receiverCells;
+
+  /**
+   * Whether each PHY in m_phyList is in m_movingReceivers instead of a cell.
+   */
+  mutable std::vector<bool> m_receiverMoving;
+
+  /**
+   * The indexes of the PHYs that were moving when they were last placed,
+   * which are not kept in the grid.
+   */
+  mutable std::vector<uint32_t> m_movingReceivers;
+
+  /**
+   * The indexes in m_phyList of the PHYs using each tracked mobility model,
+   * indexed by the identifier of the mobility model.
+   */
+  mutable std::vector<std::vector<uint32_t> > m_mobilityPhys;
+
+  /**
+   * The mobility models whose CourseChange trace source is connected to this
+   * channel, indexed by their identifier.
+   */
+  mutable std::vector<Ptr<MobilityModel> > m_trackedMobilities;
+
+  /**
+   * The identifier of each mobility model in m_trackedMobilities.
+   */
+  mutable std::unordered_map<const MobilityModel *, uint32_t> m_mobilityIds;
+
+  /**
+   * The number of times each tracked mobility model changed its course.
+   */
+  mutable std::vector<uint32_t> m_mobilityVersions;
+
+  /**
+   * A loss value computed for a pair of mobility models.
+   */
+  struct CachedLoss
+  {
+    double lossDb;     //!< The loss between sender and receiver
+    uint32_t senderVersion;     //!< The version of the sender's position
+    uint32_t receiverVersion;     //!< The version of the receiver's position
+  };
+
+  /**
+   * Whether the loss between pairs of mobility models is cached.
+   */
+  bool m_cacheLoss;
+
+  /**
+   * The cached losses, indexed by the identifiers of sender (in the 32 most
+   * significant bits) and receiver.
+   */
+  mutable std::unordered_map<uint64_t, CachedLoss> m_lossCache;
+
+  /**
+   * The minimum delay of receptions at PHYs of other partitions, or 0 if
+   * partitioning is disabled.
+   */
+  Time m_remoteDelay;
+
+  /**
+   * Whether m_phySystemIds and m_remoteReceivers reflect the current set of
+   * PHYs.
+   */
+  mutable bool m_partitionsValid;
+
+  /**
+   * The partition of the node of each PHY in m_phyList.
+   */
+  mutable std::vector<uint32_t> m_phySystemIds;
+
+  /**
+   * The index in m_phyList of each PHY.
+   */
+  std::unordered_map<const LoraPhy *, uint32_t> m_phyIndexes;
+
+  /**
+   * The log of recent transmissions, for each frequency.
+   */
+  mutable std::map<double, FrequencyLog> m_transmissionLog;
+
+  /**
+   * The longest delay between the start of a transmission at the sender and
+   * at one of its receivers.
+   */
+  mutable Time m_maxLoggedDelay;
+
+  /**
+   * The number of transmissions logged so far.
+   */
+  mutable uint64_t m_nLoggedTransmissions;
+
+  /**
+   * The node and interface index of the device that receives remote
+   * transmissions in each partition, or a node id of -1 if the partition has
+   * no PHYs.
+   */
+  mutable std::vector<std::pair<uint32_t, uint32_t> > m_remoteReceivers;
+
+  /**
+   * The event that builds the partitions at the start of the simulation.
+   */
+  EventId m_buildPartitionsEvent;
+
 };
 
 } /* namespace ns3 */
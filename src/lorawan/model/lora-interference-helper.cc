@@ -21,6 +21,7 @@
 #include "ns3/lora-interference-helper.h"
 #include "ns3/log.h"
 #include "ns3/enum.h"
+#include <algorithm>
 #include <limits>
 
 namespace ns3 {
@@ -32,6 +33,97 @@ NS_LOG_COMPONENT_DEFINE ("LoraInterferenceHelper");
  *    LoraInterferenceHelper::Event    *
  ***************************************/
 
+namespace {
+
+/**
+ * A pool of memory blocks for LoraInterferenceHelper events.
+ *
+ * Blocks are carved from slabs of EVENTS_PER_SLAB events, and freed blocks
+ * are kept in a free list to serve the next allocations. Slabs are never
+ * returned to the system, so that events that are destroyed late (e.g., by
+ * static objects) can still give their block back. Simulations run on a
+ * single thread, so the pool is not synchronized.
+ */
+class EventPool
+{
+public:
+  EventPool () : m_freeList (0)
+  {
+  }
+
+  void *
+  Allocate (void)
+  {
+    if (m_freeList == 0)
+      {
+        Block *slab = new Block[EVENTS_PER_SLAB];
+        for (uint32_t i = 0; i < EVENTS_PER_SLAB; i++)
+          {
+            slab[i].next = m_freeList;
+            m_freeList = &slab[i];
+          }
+      }
+
+    Block *block = m_freeList;
+    m_freeList = block->next;
+    return block;
+  }
+
+  void
+  Deallocate (void *pointer)
+  {
+    Block *block = static_cast<Block *> (pointer);
+    block->next = m_freeList;
+    m_freeList = block;
+  }
+
+private:
+  static const uint32_t EVENTS_PER_SLAB = 1024;
+
+  /**
+   * The memory of an event, or a link in the free list while it's unused.
+   */
+  union Block
+  {
+    Block *next;
+    std::max_align_t alignment;
+    char storage[sizeof (LoraInterferenceHelper::Event)];
+  };
+
+  Block *m_freeList;
+};
+
+EventPool &
+GetEventPool (void)
+{
+  static EventPool *pool = new EventPool ();
+  return *pool;
+}
+
+} // namespace
+
+void *
+LoraInterferenceHelper::Event::operator new (std::size_t size)
+{
+  // Classes deriving from Event may be larger
+  if (size != sizeof (Event))
+    {
+      return ::operator new (size);
+    }
+  return GetEventPool ().Allocate ();
+}
+
+void
+LoraInterferenceHelper::Event::operator delete (void *block, std::size_t size)
+{
+  if (size != sizeof (Event))
+    {
+      ::operator delete (block);
+      return;
+    }
+  GetEventPool ().Deallocate (block);
+}
+
 // Event Constructor
 LoraInterferenceHelper::Event::Event (Time duration, double rxPowerdBm, uint8_t spreadingFactor,
                                       Ptr<Packet> packet, double frequencyMHz)
@@ -40,7 +132,10 @@ LoraInterferenceHelper::Event::Event (Time duration, double rxPowerdBm, uint8_t
       m_sf (spreadingFactor),
       m_rxPowerdBm (rxPowerdBm),
       m_packet (packet),
-      m_frequencyMHz (frequencyMHz)
+      m_frequencyMHz (frequencyMHz),
+      m_receptionPath (uint32_t (-1)),
+      m_previous (0),
+      m_next (0)
 {
   // NS_LOG_FUNCTION_NOARGS ();
 }
@@ -94,6 +189,18 @@ LoraInterferenceHelper::Event::GetFrequency (void) const
   return m_frequencyMHz;
 }
 
+void
+LoraInterferenceHelper::Event::SetReceptionPath (uint32_t index)
+{
+  m_receptionPath = index;
+}
+
+uint32_t
+LoraInterferenceHelper::Event::GetReceptionPath (void) const
+{
+  return m_receptionPath;
+}
+
 void
 LoraInterferenceHelper::Event::Print (std::ostream &stream) const
 {
@@ -170,7 +277,8 @@ LoraInterferenceHelper::GetTypeId (void)
   return tid;
 }
 
-  LoraInterferenceHelper::LoraInterferenceHelper () : m_collisionSnir(LoraInterferenceHelper::collisionSnirGoursaud)
+  LoraInterferenceHelper::LoraInterferenceHelper () : m_collisionSnir(LoraInterferenceHelper::collisionSnirGoursaud),
+                                                       m_nEvents (0)
 {
   NS_LOG_FUNCTION (this);
 
@@ -180,6 +288,8 @@ LoraInterferenceHelper::GetTypeId (void)
 LoraInterferenceHelper::~LoraInterferenceHelper ()
 {
   NS_LOG_FUNCTION (this);
+
+  ClearAllEvents ();
 }
 
 Time LoraInterferenceHelper::oldEventThreshold = Seconds (2);
@@ -196,11 +306,28 @@ LoraInterferenceHelper::Add (Time duration, double rxPower, uint8_t spreadingFac
   Ptr<LoraInterferenceHelper::Event> event = Create<LoraInterferenceHelper::Event> (
       duration, rxPower, spreadingFactor, packet, frequencyMHz);
 
-  // Add the event to the list
-  m_events.push_back (event);
+  // Append the event to the list of its frequency, which keeps a reference
+  FrequencyEvents &frequencyEvents = m_eventsPerFrequency[frequencyMHz];
+  event->m_previous = frequencyEvents.last;
+  if (frequencyEvents.last != 0)
+    {
+      frequencyEvents.last->m_next = PeekPointer (event);
+    }
+  else
+    {
+      frequencyEvents.first = PeekPointer (event);
+    }
+  frequencyEvents.last = PeekPointer (event);
+  event->Ref ();
+  m_nEvents++;
+
+  if (duration > frequencyEvents.maxDuration)
+    {
+      frequencyEvents.maxDuration = duration;
+    }
 
   // Clean the event list
-  if (m_events.size () > 100)
+  if (m_nEvents > 100)
     {
       CleanOldEvents ();
     }
@@ -213,24 +340,84 @@ LoraInterferenceHelper::CleanOldEvents (void)
 {
   NS_LOG_FUNCTION (this);
 
-  // Cycle the events, and clean up if an event is old.
-  for (auto it = m_events.begin (); it != m_events.end ();)
+  // Events are sorted by start time, but a long event may end after the
+  // shorter ones that follow it: remove every expired event, and stop at
+  // the first one that started too recently to have expired.
+  auto frequencyIt = m_eventsPerFrequency.begin ();
+  while (frequencyIt != m_eventsPerFrequency.end ())
     {
-      if ((*it)->GetEndTime () + oldEventThreshold < Simulator::Now ())
+      FrequencyEvents &frequencyEvents = frequencyIt->second;
+      Event *event = frequencyEvents.first;
+      while (event != 0 && event->GetStartTime () + oldEventThreshold < Simulator::Now ())
+        {
+          Event *next = event->m_next;
+          if (event->GetEndTime () + oldEventThreshold < Simulator::Now ())
+            {
+              Remove (frequencyEvents, event);
+              m_nEvents--;
+            }
+          event = next;
+        }
+
+      if (frequencyEvents.first == 0)
         {
-          it = m_events.erase (it);
+          frequencyIt = m_eventsPerFrequency.erase (frequencyIt);
         }
       else
         {
-          it++;
+          frequencyIt++;
         }
     }
 }
 
+uint32_t
+LoraInterferenceHelper::GetNEvents (void) const
+{
+  return m_nEvents;
+}
+
+void
+LoraInterferenceHelper::Remove (FrequencyEvents &frequencyEvents, Event *event)
+{
+  if (event->m_previous != 0)
+    {
+      event->m_previous->m_next = event->m_next;
+    }
+  else
+    {
+      frequencyEvents.first = event->m_next;
+    }
+  if (event->m_next != 0)
+    {
+      event->m_next->m_previous = event->m_previous;
+    }
+  else
+    {
+      frequencyEvents.last = event->m_previous;
+    }
+  event->m_previous = 0;
+  event->m_next = 0;
+  event->Unref ();
+}
+
 std::list<Ptr<LoraInterferenceHelper::Event>>
 LoraInterferenceHelper::GetInterferers ()
 {
-  return m_events;
+  std::multimap<Time, Ptr<LoraInterferenceHelper::Event>> sorted;
+  for (auto const &frequencyEvents : m_eventsPerFrequency)
+    {
+      for (Event *event = frequencyEvents.second.first; event != 0; event = event->m_next)
+        {
+          sorted.insert (std::make_pair (event->GetStartTime (), Ptr<Event> (event)));
+        }
+    }
+
+  std::list<Ptr<LoraInterferenceHelper::Event>> interferers;
+  for (auto const &startAndEvent : sorted)
+    {
+      interferers.push_back (startAndEvent.second);
+    }
+  return interferers;
 }
 
 void
@@ -240,7 +427,8 @@ LoraInterferenceHelper::PrintEvents (std::ostream &stream)
 
   stream << "Currently registered events:" << std::endl;
 
-  for (auto it = m_events.begin (); it != m_events.end (); it++)
+  std::list<Ptr<LoraInterferenceHelper::Event>> events = GetInterferers ();
+  for (auto it = events.begin (); it != events.end (); it++)
     {
       (*it)->Print (stream);
       stream << std::endl;
@@ -252,73 +440,94 @@ LoraInterferenceHelper::IsDestroyedByInterference (Ptr<LoraInterferenceHelper::E
 {
   NS_LOG_FUNCTION (this << event);
 
-  NS_LOG_INFO ("Current number of events in LoraInterferenceHelper: " << m_events.size ());
+  NS_LOG_INFO ("Current number of events in LoraInterferenceHelper: " << m_nEvents);
 
   // We want to see the interference affecting this event: cycle through events
   // that overlap with this one and see whether it survives the interference or
   // not.
 
+  // We assume there's no interchannel interference, so only events on the
+  // same frequency are considered. Among those, only the ones that started
+  // after the beginning of this event minus the longest duration seen on this
+  // channel, and before its end, can overlap with it. Events outside of this
+  // window would contribute zero energy.
+  std::vector<Interferer> interferers;
+  auto frequencyIt = m_eventsPerFrequency.find (event->GetFrequency ());
+  if (frequencyIt != m_eventsPerFrequency.end ())
+    {
+      const FrequencyEvents &frequencyEvents = frequencyIt->second;
+      Time windowStart = event->GetStartTime () - frequencyEvents.maxDuration;
+
+      // Cycle over the candidate events, from the newest one
+      for (Event *interferer = frequencyEvents.last;
+           interferer != 0 && interferer->GetStartTime () >= windowStart;
+           interferer = interferer->m_previous)
+        {
+          // Skip the current event if it's the same that we want to analyze,
+          // and events that started after its end.
+          if (interferer == PeekPointer (event))
+            {
+              NS_LOG_DEBUG ("Same event");
+              continue; // Continues from the first line inside the for cycle
+            }
+          if (interferer->GetStartTime () >= event->GetEndTime ())
+            {
+              continue;
+            }
+
+          Interferer signal;
+          signal.startTime = interferer->GetStartTime ();
+          signal.endTime = interferer->GetEndTime ();
+          signal.rxPowerDbm = interferer->GetRxPowerdBm ();
+          signal.sf = interferer->GetSpreadingFactor ();
+          interferers.push_back (signal);
+        }
+
+      // Interferers are expected in order of start time
+      std::reverse (interferers.begin (), interferers.end ());
+    }
+
+  return IsDestroyedByInterference (event, interferers);
+}
+
+uint8_t
+LoraInterferenceHelper::IsDestroyedByInterference (Ptr<LoraInterferenceHelper::Event> event,
+                                                   const std::vector<Interferer> &interferers)
+{
+  NS_LOG_FUNCTION (this << event << interferers.size ());
+
   // Gather information about the event
   double rxPowerDbm = event->GetRxPowerdBm ();
   uint8_t sf = event->GetSpreadingFactor ();
-  double frequency = event->GetFrequency ();
-
-  // Handy information about the time frame when the packet was received
-  Time now = Simulator::Now ();
   Time duration = event->GetDuration ();
-  Time packetStartTime = now - duration;
-  Time packetEndTime = now;
-
-  // Get the list of interfering events
-  std::list<Ptr<LoraInterferenceHelper::Event>>::iterator it;
 
   // Energy for interferers of various SFs
   std::vector<double> cumulativeInterferenceEnergy (6, 0);
 
-  // Cycle over the events
-  for (it = m_events.begin (); it != m_events.end ();)
+  for (auto it = interferers.begin (); it != interferers.end (); it++)
     {
-      // Pointer to the current interferer
-      Ptr<LoraInterferenceHelper::Event> interferer = *it;
-
-      // Only consider the current event if the channel is the same: we
-      // assume there's no interchannel interference. Also skip the current
-      // event if it's the same that we want to analyze.
-      if (!(interferer->GetFrequency () == frequency) || interferer == event)
-        {
-          NS_LOG_DEBUG ("Different channel or same event");
-          it++;
-          continue; // Continues from the first line inside the for cycle
-        }
-
       NS_LOG_DEBUG ("Interferer on same channel");
 
-      // Gather information about this interferer
-      uint8_t interfererSf = interferer->GetSpreadingFactor ();
-      double interfererPower = interferer->GetRxPowerdBm ();
-      Time interfererStartTime = interferer->GetStartTime ();
-      Time interfererEndTime = interferer->GetEndTime ();
-
-      NS_LOG_INFO ("Found an interferer: sf = " << unsigned(interfererSf)
-                                                << ", power = " << interfererPower
-                                                << ", start time = " << interfererStartTime
-                                                << ", end time = " << interfererEndTime);
+      NS_LOG_INFO ("Found an interferer: sf = " << unsigned(it->sf)
+                                                << ", power = " << it->rxPowerDbm
+                                                << ", start time = " << it->startTime
+                                                << ", end time = " << it->endTime);
 
       // Compute the fraction of time the two events are overlapping
-      Time overlap = GetOverlapTime (event, interferer);
+      Time overlap = GetOverlapTime (event->GetStartTime (), event->GetEndTime (),
+                                     it->startTime, it->endTime);
 
       NS_LOG_DEBUG ("The two events overlap for " << overlap.GetSeconds () << " s.");
 
       // Compute the equivalent energy of the interference
       // Power [mW] = 10^(Power[dBm]/10)
       // Power [W] = Power [mW] / 1000
-      double interfererPowerW = pow (10, interfererPower / 10) / 1000;
+      double interfererPowerW = pow (10, it->rxPowerDbm / 10) / 1000;
       // Energy [J] = Time [s] * Power [W]
       double interferenceEnergy = overlap.GetSeconds () * interfererPowerW;
-      cumulativeInterferenceEnergy.at (unsigned(interfererSf) - 7) += interferenceEnergy;
+      cumulativeInterferenceEnergy.at (unsigned(it->sf) - 7) += interferenceEnergy;
       NS_LOG_DEBUG ("Interferer power in W: " << interfererPowerW);
       NS_LOG_DEBUG ("Interference energy: " << interferenceEnergy);
-      it++;
     }
 
   // For each SF, check if there was destructive interference
@@ -365,7 +574,15 @@ LoraInterferenceHelper::ClearAllEvents (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  m_events.clear ();
+  for (auto &frequencyEvents : m_eventsPerFrequency)
+    {
+      while (frequencyEvents.second.first != 0)
+        {
+          Remove (frequencyEvents.second, frequencyEvents.second.first);
+        }
+    }
+  m_eventsPerFrequency.clear ();
+  m_nEvents = 0;
 }
 
 Time
@@ -374,15 +591,16 @@ LoraInterferenceHelper::GetOverlapTime (Ptr<LoraInterferenceHelper::Event> event
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  return GetOverlapTime (event1->GetStartTime (), event1->GetEndTime (),
+                         event2->GetStartTime (), event2->GetEndTime ());
+}
+
+Time
+LoraInterferenceHelper::GetOverlapTime (Time s1, Time e1, Time s2, Time e2)
+{
   // Create the value we will return later
   Time overlap;
 
-  // Get handy values
-  Time s1 = event1->GetStartTime (); // Start times
-  Time s2 = event2->GetStartTime ();
-  Time e1 = event1->GetEndTime (); // End times
-  Time e2 = event2->GetEndTime ();
-
   // Non-overlapping events
   if (e1 <= s2 || e2 <= s1)
     {
@@ -29,6 +29,9 @@
 #include "ns3/packet.h"
 #include "ns3/logical-lora-channel.h"
 #include <list>
+#include <cstddef>
+#include <map>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -48,6 +51,10 @@ public:
    *
    * Used in LoraInterferenceHelper to keep track of which signals overlap and
    * cause destructive interference.
+   *
+   * Since an event is created for each signal reaching each device, events
+   * are allocated from a pool of fixed-size blocks, which are reused once the
+   * events are destroyed instead of being returned to the system.
    */
   class Event : public SimpleRefCount<LoraInterferenceHelper::Event>
   {
@@ -57,6 +64,16 @@ public:
            double frequencyMHz);
     ~Event ();
 
+    /**
+     * Allocate the memory of an event from the pool.
+     */
+    static void *operator new (std::size_t size);
+
+    /**
+     * Give the memory of an event back to the pool.
+     */
+    static void operator delete (void *block, std::size_t size);
+
     /**
      * Get the duration of the event.
      */
@@ -92,6 +109,19 @@ public:
      */
     double GetFrequency (void) const;
 
+    /**
+     * Set the index of the gateway reception path that is locked on this
+     * event, so that the path can be found without a lookup when the
+     * reception ends.
+     */
+    void SetReceptionPath (uint32_t index);
+
+    /**
+     * Get the index of the gateway reception path that was locked on this
+     * event, or uint32_t (-1) if no path was.
+     */
+    uint32_t GetReceptionPath (void) const;
+
     /**
      * Print the current event in a human readable form.
      */
@@ -127,6 +157,37 @@ public:
      * The frequency this event was on.
      */
     double m_frequencyMHz;
+
+    /**
+     * The index of the gateway reception path locked on this event.
+     */
+    uint32_t m_receptionPath;
+
+    /**
+     * The previous event on the same frequency in the LoraInterferenceHelper
+     * this event was added to.
+     */
+    Event *m_previous;
+
+    /**
+     * The next event on the same frequency in the LoraInterferenceHelper this
+     * event was added to.
+     */
+    Event *m_next;
+
+    friend class LoraInterferenceHelper;
+  };
+
+  /**
+   * A signal overlapping with an event, as seen by the device that is
+   * receiving the event.
+   */
+  struct Interferer
+  {
+    Time startTime;     //!< The time the signal begins at the device.
+    Time endTime;       //!< The time the signal ends at the device.
+    double rxPowerDbm;  //!< The power of the signal at the device.
+    uint8_t sf;         //!< The spreading factor of the signal.
   };
 
   enum CollisionMatrix {
@@ -155,7 +216,7 @@ public:
 
   /**
    * Get a list of the interferers currently registered at this
-   * InterferenceHelper.
+   * InterferenceHelper, ordered by start time.
    */
   std::list<Ptr<LoraInterferenceHelper::Event>> GetInterferers ();
 
@@ -175,6 +236,20 @@ public:
    */
   uint8_t IsDestroyedByInterference (Ptr<LoraInterferenceHelper::Event> event);
 
+  /**
+   * Determine whether the event was destroyed by interference or not, given
+   * the signals overlapping with it, instead of the events registered in this
+   * LoraInterferenceHelper.
+   *
+   * \param event The event for which to check the outcome.
+   * \param interferers The signals on the same frequency that overlap with the
+   * event, excluding the event itself, ordered by start time.
+   * \return The sf of the packets that caused the loss, or 0 if there was no
+   * loss.
+   */
+  uint8_t IsDestroyedByInterference (Ptr<LoraInterferenceHelper::Event> event,
+                                     const std::vector<Interferer> &interferers);
+
   /**
    * Compute the time duration in which two given events are overlapping.
    *
@@ -196,6 +271,11 @@ public:
    */
   void CleanOldEvents (void);
 
+  /**
+   * Get the number of events this LoraInterferenceHelper is keeping track of.
+   */
+  uint32_t GetNEvents (void) const;
+
   static CollisionMatrix collisionMatrix;
 
   static std::vector<std::vector<double>> collisionSnirAloha;
@@ -204,12 +284,58 @@ public:
 private:
   void SetCollisionMatrix (enum CollisionMatrix collisionMatrix);
 
+  /**
+   * Compute the time duration in which two time intervals are overlapping.
+   */
+  static Time GetOverlapTime (Time s1, Time e1, Time s2, Time e2);
+
   std::vector<std::vector<double>> m_collisionSnir;
 
   /**
-   * A list of the events this LoraInterferenceHelper is keeping track of.
+   * The events that were registered on a single frequency, linked through
+   * their m_previous and m_next pointers, from the oldest to the newest.
+   *
+   * Since events are added at the current simulation time, the list is
+   * sorted by start time. Together with the longest duration that was seen
+   * on this frequency, this allows to only visit the events that can overlap
+   * with a given time interval, walking back from the newest one, and to
+   * stop looking for old events at the first one that started recently.
+   * Each event in the list holds a reference, released when it's removed.
+   */
+  struct FrequencyEvents
+  {
+    FrequencyEvents () : first (0), last (0)
+    {
+    }
+
+    Event *first;
+    Event *last;
+    Time maxDuration;
+  };
+
+  /**
+   * Unlink an event from the list of its frequency, and release its
+   * reference.
+   */
+  static void Remove (FrequencyEvents &frequencyEvents, Event *event);
+
+  /**
+   * Copying is not supported, since an event can only be in the lists of one
+   * LoraInterferenceHelper.
+   */
+  LoraInterferenceHelper (const LoraInterferenceHelper &);
+  LoraInterferenceHelper &operator= (const LoraInterferenceHelper &);
+
+  /**
+   * The events this LoraInterferenceHelper is keeping track of, grouped by
+   * frequency.
+   */
+  std::map<double, FrequencyEvents> m_eventsPerFrequency;
+
+  /**
+   * The number of events this LoraInterferenceHelper is keeping track of.
    */
-  std::list<Ptr<LoraInterferenceHelper::Event>> m_events;
+  uint32_t m_nEvents;
 
   /**
    * The matrix containing information about how packets survive interference.
@@ -22,6 +22,7 @@
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 #include <algorithm>
+#include <cmath>
 
 namespace ns3 {
 namespace lorawan {
@@ -136,6 +137,66 @@ LoraPhy::SetChannel (Ptr<LoraChannel> channel)
   m_channel = channel;
 }
 
+bool
+LoraPhy::IsLoggedByChannel (void) const
+{
+  return m_channel != 0 && m_channel->IsConnected (this);
+}
+
+Ptr<LoraInterferenceHelper::Event>
+LoraPhy::TrackSignal (Time duration, double rxPowerDbm, uint8_t sf,
+                      Ptr<Packet> packet, double frequencyMHz)
+{
+  NS_LOG_FUNCTION (this << duration << rxPowerDbm << unsigned (sf) << packet <<
+                   frequencyMHz);
+
+  if (IsLoggedByChannel ())
+    {
+      return 0;
+    }
+
+  return m_interference.Add (duration, rxPowerDbm, sf, packet, frequencyMHz);
+}
+
+void
+LoraPhy::IgnoreSignal (Ptr<Packet> packet, double frequencyMHz)
+{
+  NS_LOG_FUNCTION (this << packet << frequencyMHz);
+
+  if (IsLoggedByChannel ())
+    {
+      m_channel->IgnoreSignal (this, packet, frequencyMHz);
+    }
+}
+
+Ptr<LoraInterferenceHelper::Event>
+LoraPhy::CreateReceptionEvent (Ptr<LoraInterferenceHelper::Event> event,
+                               Time duration, double rxPowerDbm, uint8_t sf,
+                               Ptr<Packet> packet, double frequencyMHz) const
+{
+  if (event != 0)
+    {
+      return event;
+    }
+
+  return Create<LoraInterferenceHelper::Event> (duration, rxPowerDbm, sf, packet,
+                                                frequencyMHz);
+}
+
+uint8_t
+LoraPhy::IsDestroyedByInterference (Ptr<LoraInterferenceHelper::Event> event)
+{
+  NS_LOG_FUNCTION (this << event);
+
+  if (IsLoggedByChannel ())
+    {
+      return m_interference.IsDestroyedByInterference
+               (event, m_channel->GetInterferers (this, event));
+    }
+
+  return m_interference.IsDestroyedByInterference (event);
+}
+
 void
 LoraPhy::SetReceiveOkCallback (RxOkCallback callback)
 {
@@ -154,30 +215,155 @@ LoraPhy::SetTxFinishedCallback (TxFinishedCallback callback)
   m_txFinishedCallback = callback;
 }
 
+namespace {
+
+/**
+ * Symbol times of the bandwidths and spreading factors used by LoRaWAN.
+ */
+class SymbolTimeTable
+{
+public:
+  static const int N_BANDWIDTHS = 3;
+  static const int MIN_SF = 6;
+  static const int MAX_SF = 12;
+
+  SymbolTimeTable ()
+  {
+    const double bandwidths[N_BANDWIDTHS] = {125000, 250000, 500000};
+    for (int bw = 0; bw < N_BANDWIDTHS; bw++)
+      {
+        for (int sf = MIN_SF; sf <= MAX_SF; sf++)
+          {
+            m_tSym[bw][sf - MIN_SF] = Seconds (pow (2, sf) / bandwidths[bw]);
+            m_tSymSeconds[bw][sf - MIN_SF] = m_tSym[bw][sf - MIN_SF].GetSeconds ();
+          }
+      }
+  }
+
+  /**
+   * Get the index of a configuration in the table, or -1 if it's not there.
+   */
+  static int
+  GetIndex (const LoraTxParameters &txParams)
+  {
+    if (txParams.sf < MIN_SF || txParams.sf > MAX_SF)
+      {
+        return -1;
+      }
+
+    int bw;
+    if (txParams.bandwidthHz == 125000)
+      {
+        bw = 0;
+      }
+    else if (txParams.bandwidthHz == 250000)
+      {
+        bw = 1;
+      }
+    else if (txParams.bandwidthHz == 500000)
+      {
+        bw = 2;
+      }
+    else
+      {
+        return -1;
+      }
+    return bw * (MAX_SF - MIN_SF + 1) + txParams.sf - MIN_SF;
+  }
+
+  const Time &
+  GetTSym (int index) const
+  {
+    return m_tSym[index / (MAX_SF - MIN_SF + 1)][index % (MAX_SF - MIN_SF + 1)];
+  }
+
+  double
+  GetTSymSeconds (int index) const
+  {
+    return m_tSymSeconds[index / (MAX_SF - MIN_SF + 1)][index % (MAX_SF - MIN_SF + 1)];
+  }
+
+private:
+  Time m_tSym[N_BANDWIDTHS][MAX_SF - MIN_SF + 1];
+  double m_tSymSeconds[N_BANDWIDTHS][MAX_SF - MIN_SF + 1];
+};
+
+const SymbolTimeTable &
+GetSymbolTimeTable (void)
+{
+  // Built at the first use, when the time resolution is already set
+  static const SymbolTimeTable table;
+  return table;
+}
+
+}
+
 Time
 LoraPhy::GetTSym (LoraTxParameters txParams)
 {
+  int index = SymbolTimeTable::GetIndex (txParams);
+  if (index >= 0)
+    {
+      return GetSymbolTimeTable ().GetTSym (index);
+    }
   return Seconds (pow (2, int (txParams.sf)) / (txParams.bandwidthHz));
 }
 
+double
+LoraPhy::GetTSymSeconds (LoraTxParameters txParams)
+{
+  int index = SymbolTimeTable::GetIndex (txParams);
+  if (index >= 0)
+    {
+      return GetSymbolTimeTable ().GetTSymSeconds (index);
+    }
+  return GetTSym (txParams).GetSeconds ();
+}
+
 Time
 LoraPhy::GetOnAirTime (Ptr<Packet> packet, LoraTxParameters txParams)
 {
-
   NS_LOG_FUNCTION (packet << txParams);
 
+  return GetOnAirTime (packet->GetSize (), txParams);
+}
+
+Time
+LoraPhy::GetOnAirTime (uint32_t size, LoraTxParameters txParams)
+{
+  NS_LOG_FUNCTION (size << txParams);
+
+  // This is the same computation as GetOnAirTimeAnalytic, with the symbol
+  // time looked up and the number of payload symbols computed with integers.
+  // The floating point operations that are left are the same, so the result
+  // is too.
+  double tSym = GetTSymSeconds (txParams);
+  double tPreamble = (double(txParams.nPreamble) + 4.25) * tSym;
+  double tPayload = GetNPayloadSymbols (size, txParams.sf, txParams.codingRate,
+                                        txParams.crcEnabled,
+                                        txParams.headerDisabled,
+                                        txParams.lowDataRateOptimizationEnabled) * tSym;
+
+  return Seconds (tPreamble + tPayload);
+}
+
+Time
+LoraPhy::GetOnAirTimeAnalytic (uint32_t size, LoraTxParameters txParams)
+{
+  NS_LOG_FUNCTION (size << txParams);
+
   // The contents of this function are based on [1].
   // [1] SX1272 LoRa modem designer's guide.
 
   // Compute the symbol duration
   // Bandwidth is in Hz
-  double tSym = GetTSym(txParams).GetSeconds();
+  double tSym = Seconds (pow (2, int (txParams.sf)) / (txParams.bandwidthHz)).GetSeconds ();
 
   // Compute the preamble duration
   double tPreamble = (double(txParams.nPreamble) + 4.25) * tSym;
 
   // Payload size
-  uint32_t pl = packet->GetSize ();      // Size in bytes
+  double pl = size;      // Size in bytes
   NS_LOG_DEBUG ("Packet of size " << pl << " bytes");
 
   // This step is needed since the formula deals with double values.
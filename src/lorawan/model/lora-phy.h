@@ -235,11 +235,41 @@ public:
   /**
    * Compute the symbol time from SF and BW.
    *
+   * Symbol times for the 125, 250 and 500 kHz bandwidths are looked up in a
+   * table that is built once.
+   *
    * \param txParams The parameters for transmission
    * \return TSym, the time required to send a LoRa modulation symbol.
    */
   static Time GetTSym (LoraTxParameters txParams);
 
+  /**
+   * Compute the number of symbols needed to send the part of a packet that
+   * follows the preamble, as in the SX1272 LoRa modem designer's guide.
+   *
+   * This only uses integer arithmetic, and can be evaluated at compile time.
+   *
+   * \param size The size of the packet, in bytes.
+   * \param sf The spreading factor.
+   * \param codingRate The code rate (obtained as 4/(codingRate+4)).
+   * \param crcEnabled Whether Cyclic Redundancy Check is enabled.
+   * \param headerDisabled Whether to use implicit header mode.
+   * \param lowDataRateOptimizationEnabled Whether Low Data Rate Optimization
+   * is enabled.
+   * \return The number of payload symbols.
+   */
+  static constexpr uint32_t
+  GetNPayloadSymbols (uint32_t size, uint8_t sf, uint8_t codingRate,
+                      bool crcEnabled, bool headerDisabled,
+                      bool lowDataRateOptimizationEnabled)
+  {
+    return 8 + PositivePart (CeilDiv (8 * int32_t (size) - 4 * int32_t (sf) + 28
+                                      + 16 * crcEnabled - 20 * headerDisabled,
+                                      4 * (int32_t (sf)
+                                           - 2 * lowDataRateOptimizationEnabled))
+                             * (codingRate + 4));
+  }
+
   /**
    * Compute the time that a packet with certain characteristics will take to be
    * transmitted.
@@ -254,10 +284,110 @@ public:
    */
   static Time GetOnAirTime (Ptr<Packet> packet, LoraTxParameters txParams);
 
+  /**
+   * Compute the time that a packet of a certain size will take to be
+   * transmitted.
+   *
+   * \param size The size of the packet, in bytes.
+   * \param txParams The set of parameters that will be used for transmission.
+   * \return The time necessary to transmit the packet.
+   */
+  static Time GetOnAirTime (uint32_t size, LoraTxParameters txParams);
+
+  /**
+   * Compute the time on air directly with the floating point formula of the
+   * SX1272 LoRa modem designer's guide, without using any precomputed value.
+   *
+   * GetOnAirTime returns the same values, and should be preferred. This is
+   * kept as a reference, to validate and benchmark it.
+   *
+   * \param size The size of the packet, in bytes.
+   * \param txParams The set of parameters that will be used for transmission.
+   * \return The time necessary to transmit the packet.
+   */
+  static Time GetOnAirTimeAnalytic (uint32_t size, LoraTxParameters txParams);
+
 private:
+  /**
+   * Division of integers, rounding up. The denominator must be positive.
+   */
+  static constexpr int32_t
+  CeilDiv (int32_t num, int32_t den)
+  {
+    // Integer division truncates towards zero, which rounds negative
+    // quotients up already
+    return num >= 0 ? (num + den - 1) / den : num / den;
+  }
+
+  /**
+   * Get a value if positive, 0 otherwise.
+   */
+  static constexpr uint32_t
+  PositivePart (int32_t value)
+  {
+    return value > 0 ? value : 0;
+  }
+
+  /**
+   * Get the symbol time in seconds, as a double, like GetTSym (txParams).GetSeconds ()
+   * would return it.
+   */
+  static double GetTSymSeconds (LoraTxParameters txParams);
+
   Ptr<MobilityModel> m_mobility;   //!< The mobility model associated to this PHY.
 
 protected:
+  /**
+   * Whether the signals arriving at this PHY are logged by its channel, which
+   * can then provide the interference affecting a reception when it ends.
+   */
+  bool IsLoggedByChannel (void) const;
+
+  /**
+   * Keep track of a signal arriving at this PHY, so that it can be accounted
+   * for as interference.
+   *
+   * If the signal is logged by the channel, nothing needs to be done and no
+   * event is created: the PHY should create one with CreateReceptionEvent if
+   * it locks on the signal. Otherwise, the signal is added to m_interference.
+   *
+   * \return The event created in m_interference, or 0.
+   */
+  Ptr<LoraInterferenceHelper::Event> TrackSignal (Time duration, double rxPowerDbm,
+                                                  uint8_t sf, Ptr<Packet> packet,
+                                                  double frequencyMHz);
+
+  /**
+   * Stop keeping track of a signal arriving at this PHY, because the PHY is
+   * dropping it without accounting for it as interference.
+   *
+   * This is only needed for signals logged by the channel, which are
+   * otherwise returned as interferers of the PHY's receptions.
+   */
+  void IgnoreSignal (Ptr<Packet> packet, double frequencyMHz);
+
+  /**
+   * Get the event of a reception this PHY is locking on.
+   *
+   * \param event The event returned by TrackSignal for the signal.
+   * \return The same event, or a new one if the signal is logged by the
+   * channel.
+   */
+  Ptr<LoraInterferenceHelper::Event> CreateReceptionEvent (Ptr<LoraInterferenceHelper::Event> event,
+                                                           Time duration, double rxPowerDbm,
+                                                           uint8_t sf, Ptr<Packet> packet,
+                                                           double frequencyMHz) const;
+
+  /**
+   * Determine whether a reception that just ended was destroyed by the
+   * signals that overlapped with it.
+   *
+   * \param event The event of the reception.
+   * \return The sf of the packets that caused the loss, or 0 if there was no
+   * loss.
+   */
+  uint8_t IsDestroyedByInterference (Ptr<LoraInterferenceHelper::Event> event);
+
   // Member objects
 
   Ptr<NetDevice> m_device; //!< The net device this PHY is attached to.
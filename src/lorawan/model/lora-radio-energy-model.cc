@@ -15,10 +15,16 @@
  */
 
 #include "ns3/log.h"
+#include "ns3/abort.h"
 #include "ns3/simulator.h"
 #include "ns3/pointer.h"
 #include "ns3/energy-source.h"
+#include "ns3/basic-energy-source.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
 #include "lora-radio-energy-model.h"
+#include <algorithm>
+#include <limits>
 
 
 namespace ns3 {
@@ -63,6 +69,16 @@ LoraRadioEnergyModel::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&LoraRadioEnergyModel::m_txCurrentModel),
                    MakePointerChecker<LoraTxCurrentModel> ())
+    .AddAttribute ("LazyEnergyUpdates",
+                   "Whether to only account for the charge drawn in each state "
+                   "at transactions, and update the energy source when it "
+                   "is updated or when the low battery threshold might be "
+                   "crossed. Only BasicEnergySource supports it: the "
+                   "simulation aborts if the energy source is of another "
+                   "type.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LoraRadioEnergyModel::m_lazyUpdates),
+                   MakeBooleanChecker ())
     .AddTraceSource ("TotalEnergyConsumption",
                      "Total energy consumption of the radio device.",
                      MakeTraceSourceAccessor (&LoraRadioEnergyModel::m_totalEnergyConsumption),
@@ -85,6 +101,14 @@ LoraRadioEnergyModel::LoraRadioEnergyModel ()
   m_listener->SetChangeStateCallback (MakeCallback (&DeviceEnergyModel::ChangeState, this));
   // set callback for updating the tx current
   m_listener->SetUpdateTxCurrentCallback (MakeCallback (&LoraRadioEnergyModel::SetTxCurrentFromModel, this));
+  m_lazyUpdates = false;
+  m_windowStart = Seconds (0.0);
+  m_accountedTime = Seconds (0.0);
+  m_windowChargeC = 0.0;
+  m_budgetChargeC = 0.0;
+  m_budgetJ = 0.0;
+  m_budgetValid = false;
+  m_refreshingBudget = false;
 }
 
 LoraRadioEnergyModel::~LoraRadioEnergyModel ()
@@ -98,6 +122,8 @@ LoraRadioEnergyModel::SetEnergySource (Ptr<EnergySource> source)
 {
   NS_LOG_FUNCTION (this << source);
   NS_ASSERT (source != NULL);
+  NS_ABORT_MSG_UNLESS (!m_lazyUpdates || DynamicCast<BasicEnergySource> (source) != 0,
+                       "LazyEnergyUpdates requires a BasicEnergySource");
   m_source = source;
 }
 
@@ -105,6 +131,13 @@ double
 LoraRadioEnergyModel::GetTotalEnergyConsumption (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_lazyUpdates && m_source)
+    {
+      // Add the charge that was drawn since the last query of the source
+      double chargeC = m_windowChargeC + GetStateCurrentA (m_currentState) *
+        (Simulator::Now () - m_accountedTime).GetSeconds ();
+      return m_totalEnergyConsumption.Get () + chargeC * m_source->GetSupplyVoltage ();
+    }
   return m_totalEnergyConsumption;
 }
 
@@ -215,6 +248,22 @@ LoraRadioEnergyModel::ChangeState (int newState)
 {
   NS_LOG_FUNCTION (this << newState);
 
+  if (m_lazyUpdates)
+    {
+      // Only account for the charge drawn in the previous state: the source
+      // gets the average current when it queries it
+      AccountCharge ();
+      SetLoraRadioState ((EndDeviceLoraPhy::State) newState);
+
+      // A depletion callback changing the state while the source is being
+      // updated doesn't need to check the budget again
+      if (!m_refreshingBudget)
+        {
+          CheckEnergyBudget ();
+        }
+      return;
+    }
+
   Time duration = Simulator::Now () - m_lastUpdateTime;
   NS_ASSERT (duration.GetNanoSeconds () >= 0);     // check if duration is valid
 
@@ -277,6 +326,11 @@ LoraRadioEnergyModel::HandleEnergyDepletion (void)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("LoraRadioEnergyModel:Energy is depleted!");
+  // the source just updated its remaining energy
+  if (m_lazyUpdates)
+    {
+      CloseWindow ();
+    }
   // invoke energy depletion callback, if set.
   if (!m_energyDepletionCallback.IsNull ())
     {
@@ -289,6 +343,11 @@ LoraRadioEnergyModel::HandleEnergyChanged (void)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("LoraRadioEnergyModel:Energy changed!");
+  // the source just updated its remaining energy
+  if (m_lazyUpdates)
+    {
+      CloseWindow ();
+    }
 }
 
 void
@@ -296,6 +355,13 @@ LoraRadioEnergyModel::HandleEnergyRecharged (void)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("LoraRadioEnergyModel:Energy is recharged!");
+  // the source just updated its remaining energy
+  if (m_lazyUpdates)
+    {
+      CloseWindow ();
+    }
+  // the energy that can be drawn before the next depletion is unknown
+  m_budgetValid = false;
   // invoke energy recharged callback, if set.
   if (!m_energyRechargedCallback.IsNull ())
     {
@@ -318,6 +384,7 @@ void
 LoraRadioEnergyModel::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_budgetCheckEvent);
   m_source = NULL;
   m_energyDepletionCallback.Nullify ();
 }
@@ -326,7 +393,34 @@ double
 LoraRadioEnergyModel::DoGetCurrentA (void) const
 {
   NS_LOG_FUNCTION (this);
-  switch (m_currentState)
+
+  if (!m_lazyUpdates)
+    {
+      return GetStateCurrentA (m_currentState);
+    }
+
+  // The source multiplies the current by the time since its previous update,
+  // which is when the window started: return the average current since
+  // then. The window is only closed once the source is updated, so that
+  // other callers don't change the energy it computes.
+  double chargeC = m_windowChargeC + GetStateCurrentA (m_currentState) *
+    (Simulator::Now () - m_accountedTime).GetSeconds ();
+  Time window = Simulator::Now () - m_windowStart;
+  double currentA = GetStateCurrentA (m_currentState);
+  if (window.IsStrictlyPositive ())
+    {
+      currentA = chargeC / window.GetSeconds ();
+    }
+
+  NS_LOG_DEBUG ("LoraRadioEnergyModel:Average current " << currentA << "A over " <<
+                window.GetSeconds () << " s");
+  return currentA;
+}
+
+double
+LoraRadioEnergyModel::GetStateCurrentA (EndDeviceLoraPhy::State state) const
+{
+  switch (state)
     {
     case EndDeviceLoraPhy::STANDBY:
       return m_idleCurrentA;
@@ -337,8 +431,106 @@ LoraRadioEnergyModel::DoGetCurrentA (void) const
     case EndDeviceLoraPhy::SLEEP:
       return m_sleepCurrentA;
     default:
-      NS_FATAL_ERROR ("LoraRadioEnergyModel:Undefined radio state:" << m_currentState);
+      NS_FATAL_ERROR ("LoraRadioEnergyModel:Undefined radio state:" << state);
+    }
+}
+
+void
+LoraRadioEnergyModel::AccountCharge (void)
+{
+  double chargeC = GetStateCurrentA (m_currentState) *
+    (Simulator::Now () - m_accountedTime).GetSeconds ();
+  m_windowChargeC += chargeC;
+  m_budgetChargeC += chargeC;
+  m_accountedTime = Simulator::Now ();
+}
+
+void
+LoraRadioEnergyModel::CloseWindow (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  AccountCharge ();
+  m_totalEnergyConsumption += m_windowChargeC * m_source->GetSupplyVoltage ();
+  m_windowChargeC = 0.0;
+  m_windowStart = Simulator::Now ();
+}
+
+void
+LoraRadioEnergyModel::CheckEnergyBudget (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (!m_budgetValid)
+    {
+      RefreshEnergyBudget ();
+    }
+
+  // The budget may have been used since the last transaction
+  AccountCharge ();
+  double supplyVoltage = m_source->GetSupplyVoltage ();
+  if (m_budgetChargeC * supplyVoltage >= m_budgetJ)
+    {
+      RefreshEnergyBudget ();
+    }
+
+  // Make sure the budget is checked again when the current state could use
+  // it up. A check that is already scheduled earlier is kept, since the
+  // budget is checked again when it expires.
+  double powerW = GetStateCurrentA (m_currentState) * supplyVoltage;
+  double leftJ = m_budgetJ - m_budgetChargeC * supplyVoltage;
+  if (powerW <= 0 || leftJ == std::numeric_limits<double>::infinity ())
+    {
+      return;
     }
+  // Round up, so that the budget is used up when the check expires
+  Time delay = Seconds (std::min (leftJ / powerW, 1e9)) + NanoSeconds (1);
+  if (m_budgetCheckEvent.IsExpired () || delay < Simulator::GetDelayLeft (m_budgetCheckEvent))
+    {
+      Simulator::Cancel (m_budgetCheckEvent);
+      m_budgetCheckEvent = Simulator::Schedule (delay, &LoraRadioEnergyModel::CheckEnergyBudget,
+                                                this);
+    }
+}
+
+void
+LoraRadioEnergyModel::RefreshEnergyBudget (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<BasicEnergySource> source = DynamicCast<BasicEnergySource> (m_source);
+  NS_ABORT_MSG_UNLESS (source != 0, "LazyEnergyUpdates requires a BasicEnergySource");
+
+  // Updating the source queries the average current, and calls the depletion
+  // callback if the threshold was crossed
+  m_refreshingBudget = true;
+  source->UpdateEnergySource ();
+  double remainingJ = source->GetRemainingEnergy ();
+  m_refreshingBudget = false;
+
+  // The source accounted for the current window, even if its remaining
+  // energy didn't change and it didn't notify us
+  CloseWindow ();
+
+  // The threshold is a fraction of the initial energy
+  DoubleValue lowThreshold;
+  source->GetAttribute ("BasicEnergyLowBatteryThreshold", lowThreshold);
+  double lowThresholdJ = lowThreshold.Get () * source->GetInitialEnergy ();
+
+  // If the source is depleted, nothing needs to be checked until it's
+  // recharged
+  if (remainingJ > lowThresholdJ)
+    {
+      m_budgetJ = remainingJ - lowThresholdJ;
+    }
+  else
+    {
+      m_budgetJ = std::numeric_limits<double>::infinity ();
+    }
+  m_budgetChargeC = 0.0;
+  m_budgetValid = true;
+
+  NS_LOG_DEBUG ("LoraRadioEnergyModel:Energy budget is " << m_budgetJ << "J");
 }
 
 void
@@ -19,6 +19,7 @@
 
 #include "ns3/device-energy-model.h"
 #include "ns3/traced-value.h"
+#include "ns3/event-id.h"
 #include "end-device-lora-phy.h"
 #include "lora-tx-current-model.h"
 
@@ -123,6 +124,22 @@ private:
  * object. The EnergySource object will query this model for the total current.
  * Then the EnergySource object uses the total current to calculate energy.
  *
+ * If the LazyEnergyUpdates attribute is set, transactions don't notify the
+ * EnergySource. The model only accumulates the charge drawn in each state, and
+ * reports the average current since the previous update of the EnergySource
+ * when it queries it, so that the energy the source computes at its periodic
+ * updates is the same. Querying the current doesn't change the model: the
+ * window is closed when the source notifies the model of an update, which
+ * BasicEnergySource does after every update that changes its remaining
+ * energy, or after the model itself updates the source. Lazy updates only
+ * support BasicEnergySource, and abort with other sources, such as
+ * LiIonEnergySource, whose energy doesn't scale with the average current.
+ * To keep depletion callbacks correct, the model notifies the EnergySource
+ * when the energy it drew since it last checked the remaining energy might
+ * have reached the low battery threshold, either at a transaction or, during
+ * a long transaction, with a scheduled check. Other
+ * devices drawing from the same source are only accounted for at the updates
+ * of the source.
  */
 class LoraRadioEnergyModel : public DeviceEnergyModel
 {
@@ -299,6 +316,38 @@ private:
    */
   void SetLoraRadioState (const EndDeviceLoraPhy::State state);
 
+  /**
+   * \param state A radio state.
+   * \return The current drawn in the state.
+   */
+  double GetStateCurrentA (EndDeviceLoraPhy::State state) const;
+
+  /**
+   * Add the charge drawn since the last accounting to the charge of the
+   * current window and to the charge counted against the energy budget.
+   */
+  void AccountCharge (void);
+
+  /**
+   * Add the charge of the current window, which the energy source just
+   * accounted for in an update, to the total energy consumption, and start a
+   * new window.
+   */
+  void CloseWindow (void);
+
+  /**
+   * Notify the EnergySource if the energy drawn since the last budget refresh
+   * might have crossed the low battery threshold, and schedule a check for
+   * when it might be crossed in the current state.
+   */
+  void CheckEnergyBudget (void);
+
+  /**
+   * Update the EnergySource, and compute the energy that can be drawn before
+   * the low battery threshold might be crossed.
+   */
+  void RefreshEnergyBudget (void);
+
   Ptr<EnergySource> m_source; ///< energy source
 
   // Member variables for current draw in different radio modes.
@@ -327,6 +376,17 @@ private:
 
   /// EndDeviceLoraPhy listener
   LoraRadioEnergyModelPhyListener *m_listener;
+
+  // State variables of lazy energy updates.
+  bool m_lazyUpdates; ///< whether transactions don't update the energy source
+  Time m_windowStart; ///< time of the previous update of the energy source
+  Time m_accountedTime; ///< time up to which the drawn charge was accounted
+  double m_windowChargeC; ///< charge drawn since m_windowStart, in coulomb
+  double m_budgetChargeC; ///< charge drawn since the budget refresh, in coulomb
+  double m_budgetJ; ///< energy that can be drawn before the low battery threshold
+  bool m_budgetValid; ///< whether m_budgetJ is up to date
+  bool m_refreshingBudget; ///< whether the energy source is being updated
+  EventId m_budgetCheckEvent; ///< check of the energy budget during a state
 };
 
 } // namespace ns3
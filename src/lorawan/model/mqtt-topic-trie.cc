@@ -0,0 +1,298 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/mqtt-topic-trie.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <set>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("MqttTopicTrie");
+
+MqttTopicTrie::MqttTopicTrie () : m_nSubscriptions (0), m_nextSequence (0)
+{
+}
+
+MqttTopicTrie::~MqttTopicTrie ()
+{
+}
+
+void
+MqttTopicTrie::SplitLevels (const std::string &topic,
+                            std::vector<std::pair<size_t, size_t> > &levels)
+{
+  levels.clear ();
+
+  size_t start = 0;
+  while (true)
+    {
+      size_t end = topic.find ('/', start);
+      if (end == std::string::npos)
+        {
+          levels.push_back (std::make_pair (start, topic.size () - start));
+          return;
+        }
+      levels.push_back (std::make_pair (start, end - start));
+      start = end + 1;
+    }
+}
+
+std::size_t
+MqttTopicTrie::LowerBound (const Node *node, const std::string &topic, size_t start,
+                           size_t length)
+{
+  std::size_t first = 0;
+  std::size_t count = node->children.size ();
+  while (count > 0)
+    {
+      std::size_t step = count / 2;
+      if (node->children[first + step].first.compare (0, std::string::npos, topic, start,
+                                                      length) < 0)
+        {
+          first += step + 1;
+          count -= step + 1;
+        }
+      else
+        {
+          count = step;
+        }
+    }
+  return first;
+}
+
+MqttTopicTrie::Node *
+MqttTopicTrie::FindChild (const Node *node, const std::string &topic, size_t start,
+                          size_t length)
+{
+  std::size_t i = LowerBound (node, topic, start, length);
+  if (i < node->children.size () &&
+      node->children[i].first.compare (0, std::string::npos, topic, start, length) == 0)
+    {
+      return node->children[i].second.get ();
+    }
+  return 0;
+}
+
+bool
+MqttTopicTrie::IsValidFilter (const std::string &filter)
+{
+  std::vector<std::pair<size_t, size_t> > levels;
+  SplitLevels (filter, levels);
+
+  for (uint32_t i = 0; i < levels.size (); i++)
+    {
+      std::string level = filter.substr (levels[i].first, levels[i].second);
+      bool isWildcard = (level == "+" || level == "#");
+      if (!isWildcard && level.find_first_of ("+#") != std::string::npos)
+        {
+          return false;
+        }
+      if (level == "#" && i != levels.size () - 1)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+bool
+MqttTopicTrie::Subscribe (const std::string &filter, LoraDeviceAddress address)
+{
+  NS_LOG_FUNCTION (this << filter << address);
+
+  if (!IsValidFilter (filter))
+    {
+      NS_LOG_ERROR ("Invalid topic filter: " << filter);
+      return false;
+    }
+
+  std::vector<std::pair<size_t, size_t> > levels;
+  SplitLevels (filter, levels);
+
+  // Walk down the trie, creating the missing levels
+  Node *node = &m_root;
+  for (auto it = levels.begin (); it != levels.end (); ++it)
+    {
+      std::size_t i = LowerBound (node, filter, it->first, it->second);
+      if (i == node->children.size () ||
+          node->children[i].first.compare (0, std::string::npos, filter, it->first,
+                                           it->second) != 0)
+        {
+          node->children.insert (node->children.begin () + i,
+                                 std::make_pair (filter.substr (it->first, it->second),
+                                                 std::unique_ptr<Node> (new Node ())));
+        }
+      node = node->children[i].second.get ();
+    }
+
+  // Subscribers are delivered in the order they subscribed
+  bool added = node->subscribers.insert (std::make_pair (address, m_nextSequence)).second;
+  if (added)
+    {
+      m_nextSequence++;
+      m_nSubscriptions++;
+    }
+  return added;
+}
+
+bool
+MqttTopicTrie::Unsubscribe (const std::string &filter, LoraDeviceAddress address)
+{
+  NS_LOG_FUNCTION (this << filter << address);
+
+  std::vector<std::pair<size_t, size_t> > levels;
+  SplitLevels (filter, levels);
+
+  // Walk down the trie, remembering the path to prune it afterwards
+  std::vector<std::pair<Node *, std::size_t> > path;
+  Node *node = &m_root;
+  for (auto it = levels.begin (); it != levels.end (); ++it)
+    {
+      std::size_t i = LowerBound (node, filter, it->first, it->second);
+      if (i == node->children.size () ||
+          node->children[i].first.compare (0, std::string::npos, filter, it->first,
+                                           it->second) != 0)
+        {
+          return false;
+        }
+      path.push_back (std::make_pair (node, i));
+      node = node->children[i].second.get ();
+    }
+
+  if (node->subscribers.erase (address) == 0)
+    {
+      return false;
+    }
+  m_nSubscriptions--;
+
+  // Remove the levels that are left without subscribers and children
+  for (auto it = path.rbegin (); it != path.rend (); ++it)
+    {
+      Node *child = it->first->children[it->second].second.get ();
+      if (!child->subscribers.empty () || !child->children.empty ())
+        {
+          break;
+        }
+      it->first->children.erase (it->first->children.begin () + it->second);
+    }
+  return true;
+}
+
+uint32_t
+MqttTopicTrie::Collect (const Node *node, const std::string &topic,
+                        const std::vector<std::pair<size_t, size_t> > &levels, uint32_t level,
+                        std::vector<Match_t> &matches) const
+{
+  static const std::string wildcards = "#+";
+  uint32_t nodes = 0;
+
+  // Topics starting with '$' are not matched by wildcards in the first level
+  bool matchWildcards = !(level == 0 && levels[0].second > 0 && topic[levels[0].first] == '$');
+
+  if (matchWildcards)
+    {
+      // '#' matches this level and all the following ones
+      const Node *multi = FindChild (node, wildcards, 0, 1);
+      if (multi != 0 && !multi->subscribers.empty ())
+        {
+          for (auto it = multi->subscribers.begin (); it != multi->subscribers.end (); ++it)
+            {
+              matches.push_back (std::make_pair (it->second, it->first));
+            }
+          nodes++;
+        }
+    }
+
+  if (level == levels.size ())
+    {
+      if (!node->subscribers.empty ())
+        {
+          for (auto it = node->subscribers.begin (); it != node->subscribers.end (); ++it)
+            {
+              matches.push_back (std::make_pair (it->second, it->first));
+            }
+          nodes++;
+        }
+      return nodes;
+    }
+
+  const Node *exact = FindChild (node, topic, levels[level].first, levels[level].second);
+  if (exact != 0)
+    {
+      nodes += Collect (exact, topic, levels, level + 1, matches);
+    }
+
+  if (matchWildcards)
+    {
+      const Node *single = FindChild (node, wildcards, 1, 1);
+      if (single != 0)
+        {
+          nodes += Collect (single, topic, levels, level + 1, matches);
+        }
+    }
+  return nodes;
+}
+
+void
+MqttTopicTrie::Match (const std::string &topic, std::vector<LoraDeviceAddress> &subscribers) const
+{
+  NS_LOG_FUNCTION (this << topic);
+
+  subscribers.clear ();
+
+  std::vector<std::pair<size_t, size_t> > levels;
+  SplitLevels (topic, levels);
+  std::vector<Match_t> matches;
+  uint32_t nodes = Collect (&m_root, topic, levels, 0, matches);
+
+  // Deliver in subscription order
+  std::sort (matches.begin (), matches.end ());
+  subscribers.reserve (matches.size ());
+  if (nodes <= 1)
+    {
+      for (auto it = matches.begin (); it != matches.end (); ++it)
+        {
+          subscribers.push_back (it->second);
+        }
+    }
+  else
+    {
+      // A device can be subscribed through more than one matching filter:
+      // keep its earliest subscription
+      std::set<LoraDeviceAddress> seen;
+      for (auto it = matches.begin (); it != matches.end (); ++it)
+        {
+          if (seen.insert (it->second).second)
+            {
+              subscribers.push_back (it->second);
+            }
+        }
+    }
+
+  NS_LOG_DEBUG ("Topic " << topic << " has " << subscribers.size () << " subscribers");
+}
+
+uint32_t
+MqttTopicTrie::GetNSubscriptions (void) const
+{
+  return m_nSubscriptions;
+}
+
+} // namespace lorawan
+} // namespace ns3
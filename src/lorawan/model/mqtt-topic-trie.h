@@ -0,0 +1,162 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MQTT_TOPIC_TRIE_H
+#define MQTT_TOPIC_TRIE_H
+
+#include "ns3/lora-device-address.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * An index of MQTT subscriptions, organized as a trie of topic levels.
+ *
+ * Topics are split in levels at each '/' character. Topic filters used to
+ * subscribe can contain the MQTT wildcards: '+' matches exactly one level,
+ * while '#' must be the last level of the filter and matches any number of
+ * levels, including the parent level. Matching a topic only visits the trie
+ * nodes on the paths that can match it, so its cost depends on the depth of
+ * the topic and on the number of matching subscribers, and not on the total
+ * number of subscriptions.
+ */
+class MqttTopicTrie
+{
+public:
+  MqttTopicTrie ();
+  ~MqttTopicTrie ();
+
+  /**
+   * Subscribe a device to a topic filter.
+   *
+   * \param filter The topic filter, possibly containing wildcards.
+   * \param address The address of the subscribing device.
+   * \return True if the subscription was added, false if the device was
+   * already subscribed to this filter or the filter is not valid.
+   */
+  bool Subscribe (const std::string &filter, LoraDeviceAddress address);
+
+  /**
+   * Remove the subscription of a device to a topic filter.
+   *
+   * \param filter The topic filter that was used to subscribe.
+   * \param address The address of the device.
+   * \return True if the subscription existed and was removed.
+   */
+  bool Unsubscribe (const std::string &filter, LoraDeviceAddress address);
+
+  /**
+   * Get the devices that are subscribed to a topic.
+   *
+   * Each device appears only once, even if more than one of its filters
+   * matches the topic.
+   *
+   * \param topic The topic a message is published to (no wildcards).
+   * \param subscribers The vector where the subscribers are stored, in the
+   * order of their earliest matching subscription. Its previous content is
+   * discarded.
+   */
+  void Match (const std::string &topic, std::vector<LoraDeviceAddress> &subscribers) const;
+
+  /**
+   * Get the total number of subscriptions.
+   */
+  uint32_t GetNSubscriptions (void) const;
+
+  /**
+   * Check whether a topic filter is well formed, i.e., whether wildcards
+   * take a whole level and '#' only appears as the last level.
+   */
+  static bool IsValidFilter (const std::string &filter);
+
+private:
+  /**
+   * A level of the trie.
+   */
+  struct Node
+  {
+    /**
+     * The next levels, sorted by name.
+     */
+    std::vector<std::pair<std::string, std::unique_ptr<Node> > > children;
+
+    /**
+     * The subscribers whose filter ends here, with the sequence number of
+     * their subscription.
+     */
+    std::map<LoraDeviceAddress, uint64_t> subscribers;
+  };
+
+  /**
+   * A subscriber matching a topic, with the sequence number of the matching
+   * subscription.
+   */
+  typedef std::pair<uint64_t, LoraDeviceAddress> Match_t;
+
+  /**
+   * Get the index of the first child of a node whose name is not lower than
+   * a level of a topic, comparing the level in place.
+   *
+   * \param node The node.
+   * \param topic The topic.
+   * \param start The position of the level in the topic.
+   * \param length The length of the level.
+   * \return The index of the child, or the number of children.
+   */
+  static std::size_t LowerBound (const Node *node, const std::string &topic,
+                                 size_t start, size_t length);
+
+  /**
+   * Get the child of a node whose name is a level of a topic.
+   *
+   * \param node The node.
+   * \param topic The topic.
+   * \param start The position of the level in the topic.
+   * \param length The length of the level.
+   * \return The child, or 0 if there is none.
+   */
+  static Node *FindChild (const Node *node, const std::string &topic, size_t start,
+                          size_t length);
+
+  /**
+   * Add to matches the devices whose filters match the topic levels from
+   * the level-th on, starting from node.
+   *
+   * \return The number of nodes whose subscribers were added.
+   */
+  uint32_t Collect (const Node *node, const std::string &topic,
+                    const std::vector<std::pair<size_t, size_t> > &levels, uint32_t level,
+                    std::vector<Match_t> &matches) const;
+
+  /**
+   * Split a topic in levels, saved as (start, length) pairs.
+   */
+  static void SplitLevels (const std::string &topic,
+                           std::vector<std::pair<size_t, size_t> > &levels);
+
+  Node m_root;     //!< The root of the trie
+  uint32_t m_nSubscriptions;     //!< The total number of subscriptions
+  uint64_t m_nextSequence;     //!< The sequence number of the next subscription
+};
+
+} // namespace lorawan
+
+} // namespace ns3
+#endif /* MQTT_TOPIC_TRIE_H */
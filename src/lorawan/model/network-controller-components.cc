@@ -66,19 +66,15 @@ ConfirmedMessagesComponent::~ConfirmedMessagesComponent ()
 }
 
 void
-ConfirmedMessagesComponent::OnReceivedPacket (Ptr<const Packet> packet,
+ConfirmedMessagesComponent::OnReceivedPacket (const UplinkContext &uplink,
                                               Ptr<EndDeviceStatus> status,
                                               Ptr<NetworkStatus> networkStatus)
 {
-  NS_LOG_FUNCTION (this->GetTypeId () << packet << networkStatus);
+  NS_LOG_FUNCTION (this->GetTypeId () << uplink.packet << networkStatus);
 
   // Check whether the received packet requires an acknowledgment.
-  LorawanMacHeader mHdr;
-  LoraFrameHeader fHdr;
-  fHdr.SetAsUplink ();
-  Ptr<Packet> myPacket = packet->Copy ();
-  myPacket->RemoveHeader (mHdr);
-  myPacket->RemoveHeader (fHdr);
+  const LorawanMacHeader &mHdr = uplink.macHeader;
+  const LoraFrameHeader &fHdr = uplink.frameHeader;
 
   NS_LOG_INFO ("Received packet Mac Header: " << mHdr);
   NS_LOG_INFO ("Received packet Frame Header: " << fHdr);
@@ -143,11 +139,11 @@ LinkCheckComponent::~LinkCheckComponent ()
 }
 
 void
-LinkCheckComponent::OnReceivedPacket (Ptr<const Packet> packet,
+LinkCheckComponent::OnReceivedPacket (const UplinkContext &uplink,
                                       Ptr<EndDeviceStatus> status,
                                       Ptr<NetworkStatus> networkStatus)
 {
-  NS_LOG_FUNCTION (this->GetTypeId () << packet << networkStatus);
+  NS_LOG_FUNCTION (this->GetTypeId () << uplink.packet << networkStatus);
 
   // We will only act just before reply, when all Gateways will have received
   // the packet.
@@ -159,14 +155,9 @@ LinkCheckComponent::BeforeSendingReply (Ptr<EndDeviceStatus> status,
 {
   NS_LOG_FUNCTION (this << status << networkStatus);
 
-  Ptr<Packet> myPacket = status->GetLastPacketReceivedFromDevice ()->Copy ();
-  LorawanMacHeader mHdr;
-  LoraFrameHeader fHdr;
-  fHdr.SetAsUplink ();
-  myPacket->RemoveHeader (mHdr);
-  myPacket->RemoveHeader (fHdr);
-
-  Ptr<LinkCheckReq> command = fHdr.GetMacCommand<LinkCheckReq> ();
+  // Use the headers that were parsed when the packet was received
+  EndDeviceStatus::ReceivedPacketInfo lastInfo = status->GetLastReceivedPacketInfo ();
+  Ptr<LinkCheckReq> command = lastInfo.frameHeader.GetMacCommand<LinkCheckReq> ();
 
   // GetMacCommand returns 0 if no command is found
   if (command)
@@ -175,7 +166,7 @@ LinkCheckComponent::BeforeSendingReply (Ptr<EndDeviceStatus> status,
 
       // Get the number of gateways that received the packet and the best
       // margin
-      uint8_t gwCount = status->GetLastReceivedPacketInfo ().gwList.size ();
+      uint8_t gwCount = lastInfo.gwList.size ();
 
       Ptr<LinkCheckAns> replyCommand = Create<LinkCheckAns> ();
       replyCommand->SetGwCnt (gwCount);
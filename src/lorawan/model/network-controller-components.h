@@ -25,6 +25,7 @@
 #include "ns3/log.h"
 #include "ns3/packet.h"
 #include "ns3/network-status.h"
+#include "ns3/uplink-context.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -55,10 +56,10 @@ public:
   /**
    * Method that is called when a new packet is received by the NetworkServer.
    *
-   * \param packet The newly received packet
+   * \param uplink The newly received packet, already parsed
    * \param networkStatus A pointer to the NetworkStatus object
    */
-  virtual void OnReceivedPacket (Ptr<const Packet> packet,
+  virtual void OnReceivedPacket (const UplinkContext &uplink,
                                  Ptr<EndDeviceStatus> status,
                                  Ptr<NetworkStatus> networkStatus) = 0;
 
@@ -93,10 +94,10 @@ public:
    * This method checks whether the received packet requires an acknowledgment
    * and sets up the appropriate reply in case it does.
    *
-   * \param packet The newly received packet
+   * \param uplink The newly received packet, already parsed
    * \param networkStatus A pointer to the NetworkStatus object
    */
-  void OnReceivedPacket (Ptr<const Packet> packet,
+  void OnReceivedPacket (const UplinkContext &uplink,
                          Ptr<EndDeviceStatus> status,
                          Ptr<NetworkStatus> networkStatus);
 
@@ -124,10 +125,10 @@ public:
    * This method checks whether the received packet requires an acknowledgment
    * and sets up the appropriate reply in case it does.
    *
-   * \param packet The newly received packet
+   * \param uplink The newly received packet, already parsed
    * \param networkStatus A pointer to the NetworkStatus object
    */
-  void OnReceivedPacket (Ptr<const Packet> packet,
+  void OnReceivedPacket (const UplinkContext &uplink,
                          Ptr<EndDeviceStatus> status,
                          Ptr<NetworkStatus> networkStatus);
 
@@ -60,20 +60,21 @@ NetworkController::Install (Ptr<NetworkControllerComponent> component)
 }
 
 void
-NetworkController::OnNewPacket (Ptr<Packet const> packet)
+NetworkController::OnNewPacket (const UplinkContext &uplink)
 {
-  NS_LOG_FUNCTION (this << packet);
+  NS_LOG_FUNCTION (this << uplink.packet);
 
   // NOTE As a future optimization, we can allow components to register their
   // callbacks and only be called in case a certain MAC command is contained.
   // For now, we call all components.
 
+  Ptr<EndDeviceStatus> status =
+    m_status->GetEndDeviceStatus (uplink.frameHeader.GetAddress ());
+
   // Inform each component about the new packet
   for (auto it = m_components.begin (); it != m_components.end (); ++it)
     {
-      (*it)->OnReceivedPacket (packet,
-                               m_status->GetEndDeviceStatus (packet),
-                               m_status);
+      (*it)->OnReceivedPacket (uplink, status, m_status);
     }
 }
 
@@ -1,4 +1,5 @@
 #include "network-scheduler.h"
+#include <algorithm>
 
 namespace ns3 {
 namespace lorawan {
@@ -37,26 +38,19 @@ NetworkScheduler::~NetworkScheduler ()
 }
 
 void
-NetworkScheduler::OnReceivedPacket (Ptr<const Packet> packet)
+NetworkScheduler::OnReceivedPacket (const UplinkContext &uplink)
 {
-  NS_LOG_FUNCTION (packet);
+  NS_LOG_FUNCTION (uplink.packet);
 
-  // Get the current packet's frame counter
-  Ptr<Packet> packetCopy = packet->Copy ();
-  LorawanMacHeader receivedMacHdr;
-  packetCopy->RemoveHeader (receivedMacHdr);
-  LoraFrameHeader receivedFrameHdr;
-  receivedFrameHdr.SetAsUplink ();
-  packetCopy->RemoveHeader (receivedFrameHdr);
+  // Extract the address
+  LoraDeviceAddress deviceAddress = uplink.frameHeader.GetAddress ();
+  Ptr<EndDeviceStatus> edStatus = m_status->GetEndDeviceStatus (deviceAddress);
 
   // Need to decide whether to schedule a receive window
-  if (!m_status->GetEndDeviceStatus (packet)->HasReceiveWindowOpportunityScheduled ())
+  if (!edStatus->HasReceiveWindowOpportunityScheduled ())
   {
-    // Extract the address
-    LoraDeviceAddress deviceAddress = receivedFrameHdr.GetAddress ();
-
     // Schedule OnReceiveWindowOpportunity event
-    m_status->GetEndDeviceStatus (packet)->SetReceiveWindowOpportunity (
+    edStatus->SetReceiveWindowOpportunity (
       Simulator::Schedule (Seconds (1),
                            &NetworkScheduler::OnReceiveWindowOpportunity,
                            this,
@@ -160,22 +154,54 @@ NetworkScheduler::DoSend(Ptr<Packet> data, LoraDeviceAddress deviceAddress, int
   // Unicast frame
   else 
     {
-      // Check whether we can send a reply to the device, again by using
-      // NetworkStatus
-      Address gwAddress = m_status->GetBestGatewayForDevice (deviceAddress, window);
+      DoSend (data, deviceAddress, window, Address ());
+    }
+}
 
-      NS_LOG_DEBUG ("Found available gateway with address: " << gwAddress);
-      if(gwAddress == Address())
-      {
-        NS_LOG_DEBUG ("No suitable gateway found.");
-        return;
-      }
+void
+NetworkScheduler::DoSend (Ptr<Packet> data, LoraDeviceAddress deviceAddress, int window,
+                          const Address &preferredGwAddress)
+{
+  NS_LOG_FUNCTION (this << data << deviceAddress << window << preferredGwAddress);
+
+  // Check whether we can send a reply to the device, again by using
+  // NetworkStatus
+  Address gwAddress = m_status->GetBestGatewayForDevice (deviceAddress, window,
+                                                        preferredGwAddress);
 
-      // Create a frame
-      Ptr<Packet> packet = m_status->GetDataPacketForDevice(data, deviceAddress, window);
-      
-      // Send the reply through that gateway
-      m_status->SendThroughGateway (packet, gwAddress);
+  NS_LOG_DEBUG ("Found available gateway with address: " << gwAddress);
+  if (gwAddress == Address ())
+    {
+      NS_LOG_DEBUG ("No suitable gateway found.");
+      return;
+    }
+
+  // Create a frame
+  Ptr<Packet> packet = m_status->GetDataPacketForDevice (data, deviceAddress, window);
+
+  // Send the reply through that gateway
+  m_status->SendThroughGateway (packet, gwAddress);
+}
+
+void
+NetworkScheduler::DoSendMulticast (Ptr<Packet> data, LoraDeviceAddress groupAddress,
+                                   const std::vector<Address> &gwAddresses)
+{
+  NS_LOG_FUNCTION (this << data << groupAddress << gwAddresses.size ());
+
+  // Multicast frames use the same parameters as broadcast ones
+  std::list<Address> available = m_status->GetAvalibleGatewaysForBroadcast ();
+  Ptr<Packet> packet = m_status->CreateMulticastPacket (data, groupAddress);
+
+  for (auto it = gwAddresses.begin (); it != gwAddresses.end (); ++it)
+    {
+      if (std::find (available.begin (), available.end (), *it) == available.end ())
+        {
+          NS_LOG_INFO ("Gateway " << *it << " is not available for multicast");
+          continue;
+        }
+      NS_LOG_DEBUG ("Send a multicast frame through gateway " << *it << " .");
+      m_status->SendThroughGateway (packet->Copy (), *it);
     }
 }
 }
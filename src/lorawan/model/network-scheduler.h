@@ -29,6 +29,7 @@
 #include "ns3/lora-frame-header.h"
 #include "ns3/network-controller.h"
 #include "ns3/network-status.h"
+#include "ns3/uplink-context.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -50,8 +51,10 @@ public:
    * Method called by NetworkServer to inform the Scheduler of a newly arrived
    * uplink packet. This function schedules the OnReceiveWindowOpportunity
    * events 1 and 2 seconds later.
+   *
+   * \param uplink The parsed uplink packet.
    */
-  void OnReceivedPacket (Ptr<const Packet> packet);
+  void OnReceivedPacket (const UplinkContext &uplink);
 
   /**
    * Method that is scheduled after packet arrivals in order to act on
@@ -64,6 +67,21 @@ public:
    */
   void DoSend(Ptr<Packet> data, LoraDeviceAddress deviceAddress, int window);
 
+  /**
+   * Send data to the end device in the specified receive window, through
+   * the specified gateway if it can reach the device and it's available, or
+   * through the best available gateway otherwise.
+   */
+  void DoSend(Ptr<Packet> data, LoraDeviceAddress deviceAddress, int window,
+              const Address &gwAddress);
+
+  /**
+   * Send data to a multicast group, with one downlink through each of the
+   * specified gateways that is available for transmission.
+   */
+  void DoSendMulticast (Ptr<Packet> data, LoraDeviceAddress groupAddress,
+                        const std::vector<Address> &gwAddresses);
+
 private:
   TracedCallback<Ptr<const Packet> > m_receiveWindowOpened;
   Ptr<NetworkStatus> m_status;
@@ -31,6 +31,7 @@
 #include "ns3/node-container.h"
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/mac-command.h"
+#include "ns3/uplink-context.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -155,20 +156,20 @@ NetworkServer::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet,
 {
   NS_LOG_FUNCTION (this << packet << protocol << address);
 
-  // Create a copy of the packet
-  Ptr<Packet> myPacket = packet->Copy ();
-
   // Fire the trace source
   m_receivedPacket (packet);
 
+  // Parse the packet once, and share the result with the other components
+  UplinkContext uplink (packet);
+
   // Inform the scheduler of the newly arrived packet
-  m_scheduler->OnReceivedPacket (packet);
+  m_scheduler->OnReceivedPacket (uplink);
 
   // Inform the status of the newly arrived packet
-  m_status->OnReceivedPacket (packet, address);
+  m_status->OnReceivedPacket (uplink, address);
 
   // Inform the controller of the newly arrived packet
-  m_controller->OnNewPacket (packet);
+  m_controller->OnNewPacket (uplink);
 
   return true;
 }
@@ -95,25 +95,15 @@ NetworkStatus::AddGateway (Address& address, Ptr<GatewayStatus> gwStatus)
 }
 
 void
-NetworkStatus::OnReceivedPacket (Ptr<const Packet> packet,
+NetworkStatus::OnReceivedPacket (const UplinkContext &uplink,
                                   const Address& gwAddress)
 {
-  NS_LOG_FUNCTION (this << packet << gwAddress);
-
-  // Create a copy of the packet
-  Ptr<Packet> myPacket = packet->Copy ();
-
-  // Extract the headers
-  LorawanMacHeader macHdr;
-  myPacket->RemoveHeader (macHdr);
-  LoraFrameHeader frameHdr;
-  frameHdr.SetAsUplink ();
-  myPacket->RemoveHeader (frameHdr);
+  NS_LOG_FUNCTION (this << uplink.packet << gwAddress);
 
   // Update the correct EndDeviceStatus object
-  LoraDeviceAddress edAddr = frameHdr.GetAddress ();
+  LoraDeviceAddress edAddr = uplink.frameHeader.GetAddress ();
   NS_LOG_DEBUG ("Node address: " << edAddr);
-  m_endDeviceStatuses.at (edAddr)->InsertReceivedPacket (packet, gwAddress);
+  m_endDeviceStatuses.at (edAddr)->InsertReceivedPacket (uplink, gwAddress);
 }
 
 bool
@@ -125,6 +115,13 @@ NetworkStatus::NeedsReply (LoraDeviceAddress deviceAddress)
 
 Address
 NetworkStatus::GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int window)
+{
+  return GetBestGatewayForDevice (deviceAddress, window, Address ());
+}
+
+Address
+NetworkStatus::GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int window,
+                                        const Address &preferredGwAddress)
 {
   // Get the endDeviceStatus we are interested in
   Ptr<EndDeviceStatus> edStatus = m_endDeviceStatuses.at (deviceAddress);
@@ -145,19 +142,33 @@ NetworkStatus::GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int win
   // Get the list of gateways that this device can reach
   // NOTE: At this point, we could also take into account the whole network to
   // identify the best gateway according to various metrics. For now, we just
-  // ask the EndDeviceStatus to pick the best gateway for us via its method.
-  std::map<double, Address> gwAddresses = edStatus->GetPowerGatewayMap ();
+  // go through the gateways that received the device's last packet, from the
+  // one with the highest received power to the one with the lowest.
+  const std::vector<EndDeviceStatus::RankedGateway> &gateways = edStatus->GetRankedGateways ();
+
+  // Use the preferred gateway if it can reach the device
+  if (!(preferredGwAddress == Address ()))
+    {
+      for (auto it = gateways.begin (); it != gateways.end (); ++it)
+        {
+          if (it->gwAddress == preferredGwAddress)
+            {
+              if (IsGatewayAvailable (preferredGwAddress, replyFrequency))
+                {
+                  return preferredGwAddress;
+                }
+              NS_LOG_DEBUG ("Preferred gateway " << preferredGwAddress << " is not available");
+              break;
+            }
+        }
+    }
 
-  // By iterating on the map in reverse, we go from the 'best'
-  // gateway, i.e. the one with the highest received power, to the
-  // worst.
   Address bestGwAddress;
-  for (auto it = gwAddresses.rbegin(); it != gwAddresses.rend(); it++)
+  for (auto it = gateways.begin (); it != gateways.end (); ++it)
     {
-      bool isAvailable = m_gatewayStatuses.find(it->second)->second->IsAvailableForTransmission (replyFrequency);
-      if (isAvailable)
+      if (IsGatewayAvailable (it->gwAddress, replyFrequency))
         {
-          bestGwAddress = it->second;
+          bestGwAddress = it->gwAddress;
           break;
         }
     }
@@ -165,6 +176,32 @@ NetworkStatus::GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int win
   return bestGwAddress;
 }
 
+bool
+NetworkStatus::IsGatewayAvailable (const Address &gwAddress, double frequency)
+{
+  return m_gatewayStatuses.at (gwAddress)->IsAvailableForTransmission (frequency);
+}
+
+Address
+NetworkStatus::GetEarliestAvailableGateway (double frequency, Time &availableTime)
+{
+  NS_LOG_FUNCTION (this << frequency);
+
+  Address earliestGwAddress;
+  availableTime = Time::Max ();
+  for (auto it = m_gatewayStatuses.begin (); it != m_gatewayStatuses.end (); ++it)
+    {
+      Time gwAvailableTime = it->second->GetNextAvailableTime (frequency);
+      if (gwAvailableTime < availableTime)
+        {
+          availableTime = gwAvailableTime;
+          earliestGwAddress = it->first;
+        }
+    }
+
+  return earliestGwAddress;
+}
+
 std::list<Address> 
 NetworkStatus::GetAvalibleGatewaysForBroadcast ()
 {
@@ -176,7 +213,7 @@ NetworkStatus::GetAvalibleGatewaysForBroadcast ()
   for (auto &iter : m_gatewayStatuses)
     {
       // fixme: this frequency should be set according to different regions, not fixed at 869.525 (ED region)
-      if (iter.second->IsAvailableForTransmission (869.525))
+      if (IsGatewayAvailable (iter.first, 869.525))
         {
           gwAddress.push_back (iter.first);
         }
@@ -191,7 +228,15 @@ NetworkStatus::CreateBroadcastPacket (Ptr<Packet> data)
   LoraDeviceAddress address;
   address.SetNwkID (0x7F);
   address.SetNwkAddr (0x1FFFFFF);
-  
+
+  return CreateMulticastPacket (data, address);
+}
+
+Ptr<Packet>
+NetworkStatus::CreateMulticastPacket (Ptr<Packet> data, LoraDeviceAddress address)
+{
+  NS_LOG_FUNCTION (this << data << address);
+
   LorawanMacHeader mHdr;
   mHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
   mHdr.SetMajor (1);
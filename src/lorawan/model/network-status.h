@@ -66,10 +66,10 @@ public:
   /**
    * Update network status on the received packet.
    *
-   * \param packet the received packet.
+   * \param uplink the parsed received packet.
    * \param address the gateway this packet was received from.
    */
-  void OnReceivedPacket (Ptr<const Packet> packet, const Address &gwaddress);
+  void OnReceivedPacket (const UplinkContext &uplink, const Address &gwaddress);
 
   /**
    * Return whether the specified device needs a reply.
@@ -86,6 +86,32 @@ public:
    */
   Address GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int window);
 
+  /**
+   * Return the gateway to use to send a reply to the specified device,
+   * preferring a given gateway.
+   *
+   * \param deviceAddress the address of the device we are interested in.
+   * \param window the receive window of the reply.
+   * \param preferredGwAddress the gateway to use if it received the device's
+   * last packet and it is available, or an empty Address.
+   * \return the preferred gateway, or the best available one if it can't be
+   * used, or an empty Address if no gateway is available.
+   */
+  Address GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int window,
+                                   const Address &preferredGwAddress);
+
+  /**
+   * Find the gateway that will be the first to be available for transmission
+   * on a frequency, among all the gateways of the network.
+   *
+   * \param frequency The frequency of the transmission, in MHz.
+   * \param availableTime Set to the time at which the returned gateway will
+   * be available, which is the current time if it's available now.
+   * \return The address of the gateway, or an invalid Address if the network
+   * has no gateways.
+   */
+  Address GetEarliestAvailableGateway (double frequency, Time &availableTime);
+
   /**
    * Get all addresses of gateway which is available for transmission
    */
@@ -98,6 +124,14 @@ public:
    */
   Ptr<Packet> CreateBroadcastPacket (Ptr<Packet> data);
 
+  /**
+   * Create a packet for the end devices belonging to a multicast group
+   *
+   * \param data payload for multicast frame
+   * \param groupAddress the address of the multicast group
+   */
+  Ptr<Packet> CreateMulticastPacket (Ptr<Packet> data, LoraDeviceAddress groupAddress);
+
   /**
    * Send a packet through a Gateway.
    *
@@ -136,6 +170,16 @@ public:
 public:
   std::map<LoraDeviceAddress, Ptr<EndDeviceStatus>> m_endDeviceStatuses;
   std::map<Address, Ptr<GatewayStatus>> m_gatewayStatuses;
+
+private:
+  /**
+   * Check whether a gateway is available for transmission on a frequency.
+   *
+   * Availability is asked to the GatewayStatus every time, since it can move
+   * earlier as well as later: a booking can be moved, and a sub-band's duty
+   * cycle can be changed.
+   */
+  bool IsGatewayAvailable (const Address &gwAddress, double frequency);
 };
 
 } // namespace lorawan
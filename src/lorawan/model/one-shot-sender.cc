@@ -41,7 +41,7 @@ OneShotSender::GetTypeId (void)
   static TypeId tid =
       TypeId ("ns3::OneShotSender")
           .SetParent<Application> ()
-          .AddAttribute ("Option", "0 -> Subscribe; 1-> Publish", IntegerValue (0),
+          .AddAttribute ("Option", "0 -> Subscribe; 1-> Publish; 2 -> Unsubscribe", IntegerValue (0),
                          MakeIntegerAccessor (&OneShotSender::m_sw), MakeIntegerChecker<int> ())
           .AddAttribute ("Topic", "Topic to subscribe/publish", StringValue (""),
                          MakeStringAccessor (&OneShotSender::m_topic), MakeStringChecker ())
@@ -99,6 +99,15 @@ OneShotSender::SendPacket (void)
       packet->AddPacketTag (mqtt);
       m_mac->Send (packet);
     }
+  else if (m_sw == 2)
+    {
+      //Unsubscribe
+      mqttTag mqtt;
+      mqtt.SetType (2);
+      Ptr<Packet> packet = Create<Packet> (buffer,size);
+      packet->AddPacketTag (mqtt);
+      m_mac->Send (packet);
+    }
   else
     {
       //Publish
@@ -0,0 +1,332 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/periodic-sender-calendar.h"
+#include "ns3/periodic-sender.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("PeriodicSenderCalendar");
+
+NS_OBJECT_ENSURE_REGISTERED (PeriodicSenderCalendar);
+
+TypeId
+PeriodicSenderCalendar::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PeriodicSenderCalendar")
+    .SetParent<Object> ()
+    .SetGroupName ("lorawan")
+    .AddConstructor<PeriodicSenderCalendar> ()
+    .AddAttribute ("SlotWidth",
+                   "The width of the slots of the timing wheel. It can only "
+                   "be changed before the first transmission is scheduled.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&PeriodicSenderCalendar::m_slotWidth),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("Slots",
+                   "The number of slots of the timing wheel. It can only be "
+                   "changed before the first transmission is scheduled.",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&PeriodicSenderCalendar::m_nSlots),
+                   MakeUintegerChecker<uint32_t> (1));
+  return tid;
+}
+
+PeriodicSenderCalendar::PeriodicSenderCalendar ()
+  : m_slotWidth (Seconds (1)),
+    m_nSlots (4096),
+    m_nScheduled (0),
+    m_nEntries (0),
+    m_dueSlot (-1),
+    m_firing (false),
+    m_eventTime (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PeriodicSenderCalendar::~PeriodicSenderCalendar ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+PeriodicSenderCalendar::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Simulator::Cancel (m_event);
+  m_senders.clear ();
+  m_wheel.clear ();
+  m_due.clear ();
+  m_batch.clear ();
+
+  Object::DoDispose ();
+}
+
+uint32_t
+PeriodicSenderCalendar::Add (Ptr<PeriodicSender> sender)
+{
+  NS_LOG_FUNCTION (this << sender);
+
+  m_senders.push_back (sender);
+  m_generations.push_back (0);
+  m_scheduled.push_back (false);
+  return m_senders.size () - 1;
+}
+
+void
+PeriodicSenderCalendar::Schedule (uint32_t id, Time delay)
+{
+  NS_LOG_FUNCTION (this << id << delay);
+  NS_ASSERT (id < m_senders.size ());
+  NS_ASSERT (!delay.IsStrictlyNegative ());
+
+  if (m_wheel.empty ())
+    {
+      m_wheel.resize (m_nSlots);
+    }
+
+  // Invalidate the transmission that was scheduled, if any
+  m_generations[id]++;
+  if (!m_scheduled[id])
+    {
+      m_scheduled[id] = true;
+      m_nScheduled++;
+    }
+
+  Entry entry;
+  entry.time = (Simulator::Now () + delay).GetTimeStep ();
+  entry.id = id;
+  entry.generation = m_generations[id];
+  Insert (entry);
+
+  // While firing, the event is scheduled again once all applications sent
+  // their packet
+  if (!m_firing && (!m_event.IsRunning () || entry.time < m_eventTime))
+    {
+      Simulator::Cancel (m_event);
+      m_eventTime = entry.time;
+      m_event = Simulator::Schedule (delay, &PeriodicSenderCalendar::Fire, this);
+    }
+}
+
+void
+PeriodicSenderCalendar::Cancel (uint32_t id)
+{
+  NS_LOG_FUNCTION (this << id);
+  NS_ASSERT (id < m_senders.size ());
+
+  // The entry is discarded when it is reached
+  m_generations[id]++;
+  if (m_scheduled[id])
+    {
+      m_scheduled[id] = false;
+      m_nScheduled--;
+    }
+}
+
+uint32_t
+PeriodicSenderCalendar::GetNScheduled (void) const
+{
+  return m_nScheduled;
+}
+
+bool
+PeriodicSenderCalendar::IsLater (const Entry &first, const Entry &second)
+{
+  // Applications that are due at the same time fire in the order they were
+  // added
+  if (first.time != second.time)
+    {
+      return first.time > second.time;
+    }
+  return first.id > second.id;
+}
+
+int64_t
+PeriodicSenderCalendar::GetSlot (int64_t time) const
+{
+  return time / m_slotWidth.GetTimeStep ();
+}
+
+void
+PeriodicSenderCalendar::Insert (const Entry &entry)
+{
+  int64_t slot = GetSlot (entry.time);
+
+  if (slot == m_dueSlot)
+    {
+      m_due.insert (std::upper_bound (m_due.begin (), m_due.end (), entry, IsLater), entry);
+    }
+  else
+    {
+      if (m_dueSlot >= 0 && slot < m_dueSlot)
+        {
+          // The slots before the due one were found empty: put the due
+          // entries back in the wheel, so that they are searched again
+          for (std::vector<Entry>::const_iterator it = m_due.begin (); it != m_due.end (); ++it)
+            {
+              m_wheel[GetSlot (it->time) % m_wheel.size ()].push_back (*it);
+            }
+          m_due.clear ();
+          m_dueSlot = -1;
+        }
+      m_wheel[slot % m_wheel.size ()].push_back (entry);
+    }
+  m_nEntries++;
+}
+
+bool
+PeriodicSenderCalendar::IsValid (const Entry &entry) const
+{
+  return m_scheduled[entry.id] && m_generations[entry.id] == entry.generation;
+}
+
+bool
+PeriodicSenderCalendar::FillDueEntries (void)
+{
+  NS_ASSERT (m_due.empty ());
+
+  if (m_nEntries == 0)
+    {
+      return false;
+    }
+
+  // Visit the slots in order, starting from the current one, until one with
+  // entries of this revolution of the wheel is found
+  uint32_t nSlots = m_wheel.size ();
+  int64_t slot = std::max (m_dueSlot + 1, GetSlot (Simulator::Now ().GetTimeStep ()));
+  for (uint32_t i = 0; i <= nSlots; i++, slot++)
+    {
+      if (i == nSlots)
+        {
+          // All entries are more than a revolution away: jump to the
+          // earliest one
+          slot = -1;
+          for (uint32_t j = 0; j < nSlots; j++)
+            {
+              for (std::vector<Entry>::const_iterator it = m_wheel[j].begin ();
+                   it != m_wheel[j].end (); ++it)
+                {
+                  if (slot < 0 || GetSlot (it->time) < slot)
+                    {
+                      slot = GetSlot (it->time);
+                    }
+                }
+            }
+        }
+
+      std::vector<Entry> &bucket = m_wheel[slot % nSlots];
+      for (uint32_t j = 0; j < bucket.size ();)
+        {
+          if (GetSlot (bucket[j].time) == slot)
+            {
+              m_due.push_back (bucket[j]);
+              bucket[j] = bucket.back ();
+              bucket.pop_back ();
+            }
+          else
+            {
+              j++;
+            }
+        }
+
+      if (!m_due.empty ())
+        {
+          std::sort (m_due.begin (), m_due.end (), IsLater);
+          m_dueSlot = slot;
+          return true;
+        }
+    }
+
+  NS_ASSERT_MSG (false, "The earliest entry was not found");
+  return false;
+}
+
+bool
+PeriodicSenderCalendar::PeekNext (Entry &entry)
+{
+  while (true)
+    {
+      if (m_due.empty () && !FillDueEntries ())
+        {
+          return false;
+        }
+
+      if (IsValid (m_due.back ()))
+        {
+          entry = m_due.back ();
+          return true;
+        }
+
+      // Discard the cancelled transmission
+      m_due.pop_back ();
+      m_nEntries--;
+    }
+}
+
+void
+PeriodicSenderCalendar::ScheduleNext (void)
+{
+  Entry entry;
+  if (PeekNext (entry))
+    {
+      Simulator::Cancel (m_event);
+      m_eventTime = entry.time;
+      m_event = Simulator::Schedule (TimeStep (entry.time) - Simulator::Now (),
+                                     &PeriodicSenderCalendar::Fire, this);
+    }
+}
+
+void
+PeriodicSenderCalendar::Fire (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Take all the transmissions that are due now
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  Entry entry;
+  m_batch.clear ();
+  while (PeekNext (entry) && entry.time == now)
+    {
+      m_due.pop_back ();
+      m_nEntries--;
+      m_scheduled[entry.id] = false;
+      m_nScheduled--;
+      m_batch.push_back (entry);
+    }
+
+  NS_LOG_DEBUG (m_batch.size () << " applications send a packet");
+
+  // The applications schedule their next transmission while sending
+  m_firing = true;
+  for (std::vector<Entry>::const_iterator it = m_batch.begin (); it != m_batch.end (); ++it)
+    {
+      m_senders[it->id]->SendPacket ();
+    }
+  m_firing = false;
+
+  ScheduleNext ();
+}
+
+} // namespace lorawan
+} // namespace ns3
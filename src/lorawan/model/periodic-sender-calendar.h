@@ -0,0 +1,166 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PERIODIC_SENDER_CALENDAR_H
+#define PERIODIC_SENDER_CALENDAR_H
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+class PeriodicSender;
+
+/**
+ * A calendar that drives the transmissions of a fleet of PeriodicSender
+ * applications.
+ *
+ * Instead of keeping one event per application in the simulator's queue,
+ * the next transmission of each application is stored in a timing wheel of
+ * fixed width slots, and a single simulator event is scheduled at the time
+ * of the earliest transmission. When it fires, all the applications due at
+ * that time send their packet, and the event is scheduled again at the time
+ * of the next transmission. Applications send their packets at the same
+ * times as if they scheduled themselves.
+ */
+class PeriodicSenderCalendar : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  PeriodicSenderCalendar ();
+  virtual ~PeriodicSenderCalendar ();
+
+  /**
+   * Add an application to the ones driven by this calendar.
+   *
+   * \param sender The application.
+   * \return The identifier of the application in this calendar.
+   */
+  uint32_t Add (Ptr<PeriodicSender> sender);
+
+  /**
+   * Schedule the next transmission of an application, replacing the one that
+   * was scheduled, if any.
+   *
+   * \param id The identifier of the application.
+   * \param delay The delay after which the application sends a packet.
+   */
+  void Schedule (uint32_t id, Time delay);
+
+  /**
+   * Cancel the transmission that was scheduled for an application.
+   *
+   * \param id The identifier of the application.
+   */
+  void Cancel (uint32_t id);
+
+  /**
+   * Get the number of transmissions that are scheduled.
+   */
+  uint32_t GetNScheduled (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * A transmission scheduled in the calendar.
+   */
+  struct Entry
+  {
+    int64_t time; //!< The time of the transmission, in time steps
+    uint32_t id; //!< The identifier of the application
+    uint32_t generation; //!< The generation of the application's schedule
+  };
+
+  /**
+   * Order entries so that the earliest one is at the back of a vector.
+   */
+  static bool IsLater (const Entry &first, const Entry &second);
+
+  /**
+   * Get the slot of the wheel a time belongs to, counting from time 0.
+   */
+  int64_t GetSlot (int64_t time) const;
+
+  /**
+   * Add an entry to the wheel, or to the due entries if it is in their slot.
+   */
+  void Insert (const Entry &entry);
+
+  /**
+   * Check whether an entry is still the scheduled transmission of its
+   * application.
+   */
+  bool IsValid (const Entry &entry) const;
+
+  /**
+   * Move the entries of the earliest slot that has any to the due entries,
+   * sorted by time.
+   *
+   * \return False if there are no entries in the calendar.
+   */
+  bool FillDueEntries (void);
+
+  /**
+   * Get the earliest valid entry, discarding the cancelled ones before it.
+   *
+   * \return False if no transmission is scheduled.
+   */
+  bool PeekNext (Entry &entry);
+
+  /**
+   * Schedule the simulator event at the time of the next transmission.
+   */
+  void ScheduleNext (void);
+
+  /**
+   * Make the applications that are due now send their packets.
+   */
+  void Fire (void);
+
+  Time m_slotWidth; //!< The width of the slots of the wheel
+  uint32_t m_nSlots; //!< The number of slots of the wheel
+
+  std::vector<Ptr<PeriodicSender> > m_senders; //!< The applications, by identifier
+  std::vector<uint32_t> m_generations; //!< The generation of each application's schedule
+  std::vector<bool> m_scheduled; //!< Whether each application has a scheduled transmission
+  uint32_t m_nScheduled; //!< The number of applications with a scheduled transmission
+
+  std::vector<std::vector<Entry> > m_wheel; //!< The entries, by slot modulo m_nSlots
+  uint32_t m_nEntries; //!< The number of entries in the wheel and in m_due
+
+  /**
+   * The entries of slot m_dueSlot, sorted so that the earliest is at the back.
+   */
+  std::vector<Entry> m_due;
+  int64_t m_dueSlot; //!< The slot of the due entries, or -1
+
+  std::vector<Entry> m_batch; //!< The entries that are firing
+  bool m_firing; //!< Whether applications are sending their packets
+
+  EventId m_event; //!< The event of the next transmission
+  int64_t m_eventTime; //!< The time of m_event, in time steps
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* PERIODIC_SENDER_CALENDAR_H */
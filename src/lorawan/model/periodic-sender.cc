@@ -55,7 +55,9 @@ PeriodicSender::PeriodicSender ()
   : m_interval (Seconds (10)),
   m_initialDelay (Seconds (1)),
   m_basePktSize (10),
-  m_pktSizeRV (0)
+  m_pktSizeRV (0),
+  m_calendar (0),
+  m_calendarId (0)
 
 {
   NS_LOG_FUNCTION_NOARGS ();
@@ -101,6 +103,41 @@ PeriodicSender::SetPacketSize (uint8_t size)
   m_basePktSize = size;
 }
 
+void
+PeriodicSender::SetCalendar (Ptr<PeriodicSenderCalendar> calendar)
+{
+  NS_LOG_FUNCTION (this << calendar);
+
+  m_calendar = calendar;
+  if (m_calendar)
+    {
+      m_calendarId = m_calendar->Add (this);
+    }
+}
+
+void
+PeriodicSender::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // The calendar keeps a reference to this application
+  m_calendar = 0;
+  Application::DoDispose ();
+}
+
+void
+PeriodicSender::ScheduleSendPacket (Time delay)
+{
+  if (m_calendar)
+    {
+      m_calendar->Schedule (m_calendarId, delay);
+    }
+  else
+    {
+      m_sendEvent = Simulator::Schedule (delay, &PeriodicSender::SendPacket, this);
+    }
+}
+
 
 void
 PeriodicSender::SendPacket (void)
@@ -121,8 +158,7 @@ PeriodicSender::SendPacket (void)
   m_mac->Send (packet);
 
   // Schedule the next SendPacket event
-  m_sendEvent = Simulator::Schedule (m_interval, &PeriodicSender::SendPacket,
-                                     this);
+  ScheduleSendPacket (m_interval);
 
   NS_LOG_DEBUG ("Sent a packet of size " << packet->GetSize ());
 }
@@ -146,8 +182,7 @@ PeriodicSender::StartApplication (void)
   Simulator::Cancel (m_sendEvent);
   NS_LOG_DEBUG ("Starting up application with a first event with a " <<
                 m_initialDelay.GetSeconds () << " seconds delay");
-  m_sendEvent = Simulator::Schedule (m_initialDelay,
-                                     &PeriodicSender::SendPacket, this);
+  ScheduleSendPacket (m_initialDelay);
   NS_LOG_DEBUG ("Event Id: " << m_sendEvent.GetUid ());
 }
 
@@ -156,6 +191,10 @@ PeriodicSender::StopApplication (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
   Simulator::Cancel (m_sendEvent);
+  if (m_calendar)
+    {
+      m_calendar->Cancel (m_calendarId);
+    }
 }
 
 }
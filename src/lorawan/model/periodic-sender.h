@@ -25,6 +25,7 @@
 #include "ns3/nstime.h"
 #include "ns3/lorawan-mac.h"
 #include "ns3/attribute.h"
+#include "ns3/periodic-sender-calendar.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -64,6 +65,15 @@ public:
    */
   void SetPacketSizeRandomVariable (Ptr <RandomVariableStream> rv);
 
+  /**
+   * Let a calendar schedule the packet sendings of this application, instead
+   * of scheduling them with its own events.
+   *
+   * \param calendar The calendar, which can be shared with other
+   * applications.
+   */
+  void SetCalendar (Ptr<PeriodicSenderCalendar> calendar);
+
   /**
    * Send a packet using the LoraNetDevice's Send method
    */
@@ -79,7 +89,15 @@ public:
    */
   void StopApplication (void);
 
+protected:
+  virtual void DoDispose (void);
+
 private:
+  /**
+   * Schedule the next SendPacket call, with an event or in the calendar
+   */
+  void ScheduleSendPacket (Time delay);
+
   /**
    * The interval between to consecutive send events
    */
@@ -111,6 +129,15 @@ private:
    */
   Ptr<RandomVariableStream> m_pktSizeRV;
 
+  /**
+   * The calendar scheduling the sendings, if any
+   */
+  Ptr<PeriodicSenderCalendar> m_calendar;
+
+  /**
+   * The identifier of this application in the calendar
+   */
+  uint32_t m_calendarId;
 
 };
 
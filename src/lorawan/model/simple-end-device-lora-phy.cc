@@ -118,16 +118,17 @@ SimpleEndDeviceLoraPhy::StartReceive (Ptr<Packet> packet, double rxPowerDbm,
   NS_LOG_FUNCTION (this << packet << rxPowerDbm << unsigned (sf) << duration <<
                    frequencyMHz);
 
-  // Notify the LoraInterferenceHelper of the impinging signal, and remember
-  // the event it creates. This will be used then to correctly handle the end
-  // of reception event.
+  // Keep track of the impinging signal, and remember the event that is
+  // created for it, if any. This will be used then to correctly handle the
+  // end of reception event.
   //
   // We need to do this regardless of our state or frequency, since these could
   // change (and making the interference relevant) while the interference is
-  // still incoming.
+  // still incoming. Signals delivered by our channel are already in its
+  // transmission log, and only need an event if we lock on them.
 
   Ptr<LoraInterferenceHelper::Event> event;
-  event = m_interference.Add (duration, rxPowerDbm, sf, packet, frequencyMHz);
+  event = TrackSignal (duration, rxPowerDbm, sf, packet, frequencyMHz);
 
   // Switch on the current PHY state
   switch (m_state)
@@ -236,6 +237,9 @@ SimpleEndDeviceLoraPhy::StartReceive (Ptr<Packet> packet, double rxPowerDbm,
             // EndReceive will handle the switch back to STANDBY state
             SwitchToRx ();
 
+            event = CreateReceptionEvent (event, duration, rxPowerDbm, sf,
+                                          packet, frequencyMHz);
+
             // Schedule the end of the reception of the packet
             NS_LOG_INFO ("Scheduling reception of a packet. End in " <<
                          duration.GetSeconds () << " seconds");
@@ -264,7 +268,7 @@ SimpleEndDeviceLoraPhy::EndReceive (Ptr<Packet> packet,
 
   // Call the LoraInterferenceHelper to determine whether there was destructive
   // interference on this event.
-  bool packetDestroyed = m_interference.IsDestroyedByInterference (event);
+  bool packetDestroyed = IsDestroyedByInterference (event);
 
   // Fire the trace source if packet was destroyed
   if (packetDestroyed)
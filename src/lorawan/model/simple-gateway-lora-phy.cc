@@ -66,34 +66,30 @@ SimpleGatewayLoraPhy::Send (Ptr<Packet> packet, LoraTxParameters txParams, doubl
 
   NS_LOG_DEBUG ("Duration of packet: " << duration << ", SF" << unsigned (txParams.sf));
 
-  // Interrupt all receive operations
-  std::list<Ptr<SimpleGatewayLoraPhy::ReceptionPath>>::iterator it;
-  for (it = m_receptionPaths.begin (); it != m_receptionPaths.end (); ++it)
+  // Interrupt all receive operations, only visiting the busy reception paths
+  for (uint32_t i = FindBusyReceptionPath (0); i < m_receptionPaths.size ();
+       i = FindBusyReceptionPath (i + 1))
     {
+      ReceptionPath &currentPath = m_receptionPaths[i];
 
-      Ptr<SimpleGatewayLoraPhy::ReceptionPath> currentPath = *it;
-
-      if (!currentPath->IsAvailable ()) // Reception path is occupied
+      // Call the callback for reception interrupted by transmission
+      // Fire the trace source
+      if (m_device)
         {
-          // Call the callback for reception interrupted by transmission
-          // Fire the trace source
-          if (m_device)
-            {
-              m_noReceptionBecauseTransmitting (currentPath->GetEvent ()->GetPacket (),
-                                                m_device->GetNode ()->GetId ());
-            }
-          else
-            {
-              m_noReceptionBecauseTransmitting (currentPath->GetEvent ()->GetPacket (), 0);
-            }
+          m_noReceptionBecauseTransmitting (currentPath.GetEvent ()->GetPacket (),
+                                            m_device->GetNode ()->GetId ());
+        }
+      else
+        {
+          m_noReceptionBecauseTransmitting (currentPath.GetEvent ()->GetPacket (), 0);
+        }
 
-          // Cancel the scheduled EndReceive call
-          Simulator::Cancel (currentPath->GetEndReceive ());
+      // Cancel the scheduled EndReceive call
+      Simulator::Cancel (currentPath.GetEndReceive ());
 
-          // Free it
-          // This also resets all parameters like packet and endReceive call
-          currentPath->Free ();
-        }
+      // Free it
+      // This also resets all parameters like packet and endReceive call
+      FreeReceptionPath (i);
     }
 
   // Send the packet in the channel
@@ -141,65 +137,62 @@ SimpleGatewayLoraPhy::StartReceive (Ptr<Packet> packet, double rxPowerDbm, uint8
           m_noReceptionBecauseTransmitting (packet, 0);
         }
 
+      // The signal is not interference for later receptions either
+      IgnoreSignal (packet, frequencyMHz);
+
       return;
     }
 
-  // Add the event to the LoraInterferenceHelper
+  // Keep track of the signal as interference
   Ptr<LoraInterferenceHelper::Event> event;
-  event = m_interference.Add (duration, rxPowerDbm, sf, packet, frequencyMHz);
+  event = TrackSignal (duration, rxPowerDbm, sf, packet, frequencyMHz);
 
-  // Cycle over the receive paths to check availability to receive the packet
-  std::list<Ptr<SimpleGatewayLoraPhy::ReceptionPath>>::iterator it;
+  // Look for an available receive path
+  uint32_t index = FindAvailableReceptionPath ();
 
-  for (it = m_receptionPaths.begin (); it != m_receptionPaths.end (); ++it)
+  // If a receive path is available, we have a candidate
+  if (index < m_receptionPaths.size ())
     {
-      Ptr<SimpleGatewayLoraPhy::ReceptionPath> currentPath = *it;
+      // See whether the reception power is above or below the sensitivity
+      // for that spreading factor
+      double sensitivity = SimpleGatewayLoraPhy::sensitivity[unsigned (sf) - 7];
 
-      // If the receive path is available and listening on the channel of
-      // interest, we have a candidate
-      if (currentPath->IsAvailable ())
+      if (rxPowerDbm < sensitivity) // Packet arrived below sensitivity
         {
-          // See whether the reception power is above or below the sensitivity
-          // for that spreading factor
-          double sensitivity = SimpleGatewayLoraPhy::sensitivity[unsigned (sf) - 7];
+          NS_LOG_INFO ("Dropping packet reception of packet with sf = "
+                       << unsigned (sf) << " because under the sensitivity of " << sensitivity
+                       << " dBm");
 
-          if (rxPowerDbm < sensitivity) // Packet arrived below sensitivity
+          if (m_device)
             {
-              NS_LOG_INFO ("Dropping packet reception of packet with sf = "
-                           << unsigned (sf) << " because under the sensitivity of " << sensitivity
-                           << " dBm");
-
-              if (m_device)
-                {
-                  m_underSensitivity (packet, m_device->GetNode ()->GetId ());
-                }
-              else
-                {
-                  m_underSensitivity (packet, 0);
-                }
-
-              // Since the packet is below sensitivity, it makes no sense to
-              // search for another ReceivePath
-              return;
+              m_underSensitivity (packet, m_device->GetNode ()->GetId ());
             }
-          else // We have sufficient sensitivity to start receiving
+          else
             {
-              NS_LOG_INFO ("Scheduling reception of a packet, "
-                           << "occupying one demodulator");
+              m_underSensitivity (packet, 0);
+            }
+
+          // Since the packet is below sensitivity, it makes no sense to
+          // search for another ReceivePath
+          return;
+        }
+      else // We have sufficient sensitivity to start receiving
+        {
+          NS_LOG_INFO ("Scheduling reception of a packet, "
+                       << "occupying one demodulator");
 
-              // Block this resource
-              currentPath->LockOnEvent (event);
-              m_occupiedReceptionPaths++;
+          // Block this resource
+          event = CreateReceptionEvent (event, duration, rxPowerDbm, sf,
+                                        packet, frequencyMHz);
+          LockReceptionPath (index, event);
 
-              // Schedule the end of the reception of the packet
-              EventId endReceiveEventId =
-                  Simulator::Schedule (duration, &LoraPhy::EndReceive, this, packet, event);
+          // Schedule the end of the reception of the packet
+          EventId endReceiveEventId =
+              Simulator::Schedule (duration, &LoraPhy::EndReceive, this, packet, event);
 
-              currentPath->SetEndReceive (endReceiveEventId);
+          m_receptionPaths[index].SetEndReceive (endReceiveEventId);
 
-              // Make sure we don't go on searching for other ReceivePaths
-              return;
-            }
+          return;
         }
     }
   // If we get to this point, there are no demodulators we can use
@@ -230,7 +223,7 @@ SimpleGatewayLoraPhy::EndReceive (Ptr<Packet> packet, Ptr<LoraInterferenceHelper
   // destructive interference. If the packet is correctly received, this
   // method returns a 0.
   uint8_t packetDestroyed = 0;
-  packetDestroyed = m_interference.IsDestroyedByInterference (event);
+  packetDestroyed = IsDestroyedByInterference (event);
 
   // Check whether the packet was destroyed
   if (packetDestroyed != uint8_t (0))
@@ -287,20 +280,11 @@ SimpleGatewayLoraPhy::EndReceive (Ptr<Packet> packet, Ptr<LoraInterferenceHelper
         }
     }
 
-  // Search for the demodulator that was locked on this event to free it.
-
-  std::list<Ptr<SimpleGatewayLoraPhy::ReceptionPath>>::iterator it;
-
-  for (it = m_receptionPaths.begin (); it != m_receptionPaths.end (); ++it)
+  // Free the demodulator that was locked on this event
+  uint32_t index = GetReceptionPathIndex (event);
+  if (index < m_receptionPaths.size ())
     {
-      Ptr<SimpleGatewayLoraPhy::ReceptionPath> currentPath = *it;
-
-      if (currentPath->GetEvent () == event)
-        {
-          currentPath->Free ();
-          m_occupiedReceptionPaths--;
-          return;
-        }
+      FreeReceptionPath (index);
     }
 }
 
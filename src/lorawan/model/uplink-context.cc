@@ -0,0 +1,42 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/uplink-context.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("UplinkContext");
+
+UplinkContext::UplinkContext (Ptr<const Packet> receivedPacket)
+  : packet (receivedPacket)
+{
+  NS_LOG_FUNCTION (receivedPacket);
+
+  // This is the only copy of the packet that is made on the uplink path
+  Ptr<Packet> myPacket = receivedPacket->Copy ();
+  myPacket->RemoveHeader (macHeader);
+  frameHeader.SetAsUplink ();
+  myPacket->RemoveHeader (frameHeader);
+  myPacket->PeekPacketTag (tag);
+  payload = myPacket;
+
+  NS_LOG_DEBUG ("Parsed uplink: " << macHeader << " " << frameHeader);
+}
+
+} // namespace lorawan
+} // namespace ns3
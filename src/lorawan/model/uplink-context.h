@@ -0,0 +1,55 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef UPLINK_CONTEXT_H
+#define UPLINK_CONTEXT_H
+
+#include "ns3/packet.h"
+#include "ns3/lorawan-mac-header.h"
+#include "ns3/lora-frame-header.h"
+#include "ns3/lora-tag.h"
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * An uplink packet as seen by the network server, parsed once on arrival.
+ *
+ * The NetworkServer and BrokerServer build one of these objects for each
+ * packet they receive from a gateway, and pass it to the NetworkScheduler,
+ * the NetworkStatus and the NetworkController components, so that these
+ * don't need to copy the packet and deserialize its headers themselves.
+ */
+struct UplinkContext
+{
+  /**
+   * Parse an uplink packet.
+   *
+   * \param packet The packet, as received from the gateway.
+   */
+  UplinkContext (Ptr<const Packet> packet);
+
+  Ptr<const Packet> packet;     //!< The packet, headers included
+  LorawanMacHeader macHeader;     //!< The packet's MAC header
+  LoraFrameHeader frameHeader;     //!< The packet's frame header
+  LoraTag tag;     //!< The LoraTag the gateway attached to the packet
+  Ptr<const Packet> payload;     //!< The packet without headers
+};
+
+} // namespace lorawan
+
+} // namespace ns3
+#endif /* UPLINK_CONTEXT_H */
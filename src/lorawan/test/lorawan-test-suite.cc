@@ -7,11 +7,33 @@
 #include "ns3/simple-gateway-lora-phy.h"
 #include "ns3/mobility-helper.h"
 #include "ns3/one-shot-sender-helper.h"
+#include "ns3/periodic-sender-helper.h"
 #include "ns3/constant-position-mobility-model.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/correlated-shadowing-propagation-loss-model.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/pointer.h"
+#include "ns3/mqtt-topic-trie.h"
+#include "ns3/lora-packet-tracker.h"
+#include "ns3/lora-trace-sink.h"
+#include "ns3/lora-campaign-helper.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/lora-tag.h"
+#include "ns3/lorawan-mac-header.h"
+#include "ns3/lora-radio-energy-model.h"
+#include "ns3/basic-energy-source.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
 using namespace ns3;
 using namespace lorawan;
 
@@ -164,6 +186,107 @@ InterferenceTest::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (interferenceHelper.IsDestroyedByInterference (event), 0,
                          "Packet did not survive interference as expected");
   interferenceHelper.ClearAllEvents ();
+
+  // Events on all frequencies are tracked, and removed when clearing
+  interferenceHelper.Add (Seconds (2), 14, 7, 0, frequency);
+  interferenceHelper.Add (Seconds (2), 14, 7, 0, differentFrequency);
+  interferenceHelper.Add (Seconds (1), 14, 8, 0, frequency);
+  NS_TEST_EXPECT_MSG_EQ (interferenceHelper.GetInterferers ().size (), 3,
+                         "Unexpected number of registered events");
+  interferenceHelper.ClearAllEvents ();
+  NS_TEST_EXPECT_MSG_EQ (interferenceHelper.GetInterferers ().size (), 0,
+                         "Events were not cleared");
+
+  // The memory of a destroyed event is reused by the next one
+  event = interferenceHelper.Add (Seconds (2), 14, 7, 0, frequency);
+  const LoraInterferenceHelper::Event *block = PeekPointer (event);
+  interferenceHelper.ClearAllEvents ();
+  event = 0;
+  event = interferenceHelper.Add (Seconds (2), 14, 8, 0, frequency);
+  NS_TEST_EXPECT_MSG_EQ ((PeekPointer (event) == block), true,
+                         "The memory of a destroyed event was not reused");
+  interferenceHelper.ClearAllEvents ();
+}
+
+/*****************************
+ * InterferenceCleaningTest *
+ *****************************/
+
+class InterferenceCleaningTest : public TestCase
+{
+public:
+  InterferenceCleaningTest ();
+  virtual ~InterferenceCleaningTest ();
+
+private:
+  virtual void DoRun (void);
+
+  void AddEvent (Time duration, uint8_t sf);
+  void CheckEvents (uint32_t expected);
+
+  LoraInterferenceHelper m_interferenceHelper;
+};
+
+// Add some help text to this case to describe what it is intended to test
+InterferenceCleaningTest::InterferenceCleaningTest ()
+    : TestCase ("Verify that LoraInterferenceHelper removes exactly the expired events")
+{
+}
+
+// Reminder that the test case should clean up after itself
+InterferenceCleaningTest::~InterferenceCleaningTest ()
+{
+}
+
+void
+InterferenceCleaningTest::AddEvent (Time duration, uint8_t sf)
+{
+  m_interferenceHelper.Add (duration, 14, sf, 0, 868.1);
+}
+
+void
+InterferenceCleaningTest::CheckEvents (uint32_t expected)
+{
+  m_interferenceHelper.CleanOldEvents ();
+  NS_TEST_EXPECT_MSG_EQ (m_interferenceHelper.GetNEvents (), expected,
+                         "Unexpected number of events after cleaning at " <<
+                         Simulator::Now ().GetSeconds () << " s");
+  NS_TEST_EXPECT_MSG_EQ (m_interferenceHelper.GetInterferers ().size (), expected,
+                         "Unexpected number of listed events after cleaning at " <<
+                         Simulator::Now ().GetSeconds () << " s");
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+InterferenceCleaningTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("InterferenceCleaningTest");
+
+  // A long SF12 event, followed by short SF7 events on the same frequency
+  // that expire before it does
+  Simulator::Schedule (Seconds (0), &InterferenceCleaningTest::AddEvent, this,
+                       Seconds (3), 12);
+  for (int i = 1; i <= 5; i++)
+    {
+      Simulator::Schedule (Seconds (0.1 * i), &InterferenceCleaningTest::AddEvent, this,
+                           Seconds (0.1), 7);
+    }
+  // A short event that is still recent at the first cleaning
+  Simulator::Schedule (Seconds (2), &InterferenceCleaningTest::AddEvent, this,
+                       Seconds (0.1), 7);
+
+  // Events are old 2 s after they end: at 3 s only the first five SF7
+  // events are, even though the SF12 event before them isn't
+  Simulator::Schedule (Seconds (3), &InterferenceCleaningTest::CheckEvents, this, 2);
+  // The last SF7 event expires at 4.1 s, the SF12 one at 5 s
+  Simulator::Schedule (Seconds (4.5), &InterferenceCleaningTest::CheckEvents, this, 1);
+  Simulator::Schedule (Seconds (5.5), &InterferenceCleaningTest::CheckEvents, this, 0);
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  m_interferenceHelper.ClearAllEvents ();
 }
 
 /***************
@@ -734,6 +857,156 @@ ReceivePathTest::DoRun (void)
   // NS_TEST_EXPECT_MSG_EQ (m_maxOccupiedReceptionPaths, 1, "Unexpected value");
 }
 
+/*****************************
+ * GatewayReceptionPathsTest *
+ *****************************/
+
+class GatewayReceptionPathsTest : public TestCase
+{
+public:
+  GatewayReceptionPathsTest ();
+  virtual ~GatewayReceptionPathsTest ();
+
+private:
+  virtual void DoRun (void);
+
+  void StartReceptions (uint32_t nReceptions, Time duration);
+  void CheckOccupiedReceptionPaths (int expected);
+  void OccupiedReceptionPaths (int oldValue, int newValue);
+  void NoMoreDemodulators (Ptr<const Packet> packet, uint32_t node);
+  void NoReceptionBecauseTransmitting (Ptr<const Packet> packet, uint32_t node);
+
+  Ptr<SimpleGatewayLoraPhy> m_gatewayPhy;
+  int m_occupiedReceptionPaths;
+  int m_maxOccupiedReceptionPaths;
+  uint32_t m_noMoreDemodulatorsCalls;
+  uint32_t m_noReceptionBecauseTransmittingCalls;
+};
+
+// Add some help text to this case to describe what it is intended to test
+GatewayReceptionPathsTest::GatewayReceptionPathsTest ()
+    : TestCase ("Verify that a gateway with many reception paths locks and frees them correctly")
+{
+}
+
+// Reminder that the test case should clean up after itself
+GatewayReceptionPathsTest::~GatewayReceptionPathsTest ()
+{
+}
+
+void
+GatewayReceptionPathsTest::StartReceptions (uint32_t nReceptions, Time duration)
+{
+  for (uint32_t i = 0; i < nReceptions; i++)
+    {
+      m_gatewayPhy->StartReceive (Create<Packet> (10), -50, 7 + i % 6, duration, 868.1);
+    }
+}
+
+void
+GatewayReceptionPathsTest::CheckOccupiedReceptionPaths (int expected)
+{
+  NS_TEST_EXPECT_MSG_EQ (m_occupiedReceptionPaths, expected,
+                         "Unexpected number of occupied reception paths at "
+                             << Simulator::Now ().GetSeconds () << " s");
+}
+
+void
+GatewayReceptionPathsTest::OccupiedReceptionPaths (int oldValue, int newValue)
+{
+  m_occupiedReceptionPaths = newValue;
+  if (m_maxOccupiedReceptionPaths < newValue)
+    {
+      m_maxOccupiedReceptionPaths = newValue;
+    }
+}
+
+void
+GatewayReceptionPathsTest::NoMoreDemodulators (Ptr<const Packet> packet, uint32_t node)
+{
+  m_noMoreDemodulatorsCalls++;
+}
+
+void
+GatewayReceptionPathsTest::NoReceptionBecauseTransmitting (Ptr<const Packet> packet,
+                                                           uint32_t node)
+{
+  m_noReceptionBecauseTransmittingCalls++;
+}
+
+void
+GatewayReceptionPathsTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("GatewayReceptionPathsTest");
+
+  m_occupiedReceptionPaths = 0;
+  m_maxOccupiedReceptionPaths = 0;
+  m_noMoreDemodulatorsCalls = 0;
+  m_noReceptionBecauseTransmittingCalls = 0;
+
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<LoraChannel> channel =
+      CreateObject<LoraChannel> (CreateObject<LogDistancePropagationLossModel> (),
+                                 CreateObject<ConstantSpeedPropagationDelayModel> ());
+
+  // More reception paths than fit in a word of the availability bitmap
+  uint32_t nPaths = 70;
+  m_gatewayPhy = CreateObject<SimpleGatewayLoraPhy> ();
+  m_gatewayPhy->SetMobility (mobility);
+  m_gatewayPhy->SetChannel (channel);
+  for (uint32_t i = 0; i < nPaths; i++)
+    {
+      m_gatewayPhy->AddReceptionPath ();
+    }
+
+  m_gatewayPhy->TraceConnectWithoutContext (
+      "OccupiedReceptionPaths",
+      MakeCallback (&GatewayReceptionPathsTest::OccupiedReceptionPaths, this));
+  m_gatewayPhy->TraceConnectWithoutContext (
+      "LostPacketBecauseNoMoreReceivers",
+      MakeCallback (&GatewayReceptionPathsTest::NoMoreDemodulators, this));
+  m_gatewayPhy->TraceConnectWithoutContext (
+      "NoReceptionBecauseTransmitting",
+      MakeCallback (&GatewayReceptionPathsTest::NoReceptionBecauseTransmitting, this));
+
+  // One reception more than the paths: all paths are locked, and the last
+  // reception finds no demodulator
+  Simulator::Schedule (Seconds (1), &GatewayReceptionPathsTest::StartReceptions, this,
+                       nPaths + 1, Seconds (1));
+  Simulator::Schedule (Seconds (1.5), &GatewayReceptionPathsTest::CheckOccupiedReceptionPaths,
+                       this, int (nPaths));
+
+  // All paths are freed when the receptions end
+  Simulator::Schedule (Seconds (2.5), &GatewayReceptionPathsTest::CheckOccupiedReceptionPaths,
+                       this, 0);
+
+  // The freed paths can be locked again, and a transmission interrupts the
+  // receptions going on
+  LoraTxParameters txParams;
+  Simulator::Schedule (Seconds (3), &GatewayReceptionPathsTest::StartReceptions, this, 10,
+                       Seconds (2));
+  Simulator::Schedule (Seconds (3.5), &GatewayReceptionPathsTest::CheckOccupiedReceptionPaths,
+                       this, 10);
+  Simulator::Schedule (Seconds (4), &SimpleGatewayLoraPhy::Send, m_gatewayPhy,
+                       Create<Packet> (10), txParams, 869.525, 14);
+  Simulator::Schedule (Seconds (4.5), &GatewayReceptionPathsTest::CheckOccupiedReceptionPaths,
+                       this, 0);
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_maxOccupiedReceptionPaths, int (nPaths),
+                         "Not all reception paths were occupied");
+  NS_TEST_EXPECT_MSG_EQ (m_noMoreDemodulatorsCalls, 1u,
+                         "Unexpected number of receptions without a demodulator");
+  NS_TEST_EXPECT_MSG_EQ (m_noReceptionBecauseTransmittingCalls, 10u,
+                         "Unexpected number of receptions interrupted by the transmission");
+  NS_TEST_EXPECT_MSG_EQ (m_occupiedReceptionPaths, 0, "Reception paths were not freed");
+
+  m_gatewayPhy = 0;
+}
+
 /**************************
  * LogicalLoraChannelTest *
  **************************/
@@ -847,6 +1120,28 @@ LogicalLoraChannelTest::DoRun (void)
                          "Waiting time affects other subbands");
   NS_TEST_EXPECT_MSG_EQ (channelHelper->GetWaitingTime (channel5), Time (0),
                          "Waiting time affects other subbands");
+
+  // Frequencies map to the SubBands in the order they were added, also when
+  // they don't belong to any channel
+  NS_TEST_EXPECT_MSG_EQ (unsigned (channelHelper->GetSubBandIndex (868.3)), 0,
+                         "Frequency was mapped to the wrong SubBand");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (channelHelper->GetSubBandIndex (869.2)), 1,
+                         "Frequency was mapped to the wrong SubBand");
+  NS_TEST_EXPECT_MSG_EQ (channelHelper->GetTxPowerForFrequency (869.2), 27,
+                         "Wrong maximum transmission power");
+
+  // The frequency based methods see the same SubBand state
+  NS_TEST_EXPECT_MSG_EQ (channelHelper->GetWaitingTime (868.5), expectedTimeOff,
+                         "Waiting time doesn't behave as expected");
+  NS_TEST_EXPECT_MSG_EQ (channelHelper->GetNextTransmissionTime (868.5),
+                         Simulator::Now () + expectedTimeOff,
+                         "Next transmission time doesn't behave as expected");
+
+  channelHelper->AddEvent (Seconds (1), 869.2);
+  NS_TEST_EXPECT_MSG_EQ (channelHelper->GetWaitingTime (channel4), Seconds (1 / 0.1 - 1),
+                         "Waiting time doesn't behave as expected");
+  NS_TEST_EXPECT_MSG_EQ (channelHelper->GetWaitingTime (channel1), expectedTimeOff,
+                         "Waiting time affects other subbands");
 }
 
 /*****************
@@ -957,6 +1252,41 @@ TimeOnAirTest::DoRun (void)
   txParams.codingRate = 1;
   duration = LoraPhy::GetOnAirTime (packet, txParams);
   NS_TEST_EXPECT_MSG_EQ_TOL (duration.GetSeconds (), 2.301952, 0.0001, "Unexpected duration");
+
+  // The number of payload symbols can be computed at compile time
+  static_assert (LoraPhy::GetNPayloadSymbols (10, 7, 1, true, false, false) == 28,
+                 "Unexpected number of payload symbols");
+
+  // The precomputed values must give exactly the same durations as the formula
+  const double bandwidths[] = {125000, 250000, 500000};
+  int mismatches = 0;
+  for (uint8_t sf = 7; sf <= 12; sf++)
+    {
+      for (int bw = 0; bw < 3; bw++)
+        {
+          for (uint8_t cr = 1; cr <= 4; cr++)
+            {
+              for (int flags = 0; flags < 8; flags++)
+                {
+                  txParams.sf = sf;
+                  txParams.bandwidthHz = bandwidths[bw];
+                  txParams.codingRate = cr;
+                  txParams.crcEnabled = flags & 1;
+                  txParams.headerDisabled = flags & 2;
+                  txParams.lowDataRateOptimizationEnabled = flags & 4;
+                  for (uint32_t size = 0; size < 256; size++)
+                    {
+                      if (LoraPhy::GetOnAirTime (size, txParams) !=
+                          LoraPhy::GetOnAirTimeAnalytic (size, txParams))
+                        {
+                          mismatches++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (mismatches, 0, "Precomputed durations differ from the formula");
 }
 
 /**************************
@@ -1225,6 +1555,23 @@ PhyConnectivityTest::DoRun (void)
 
   Reset ();
 
+  // Without a distributed simulation, a remote delay doesn't change delivery
+
+  channel->SetAttribute ("RemoteDelay", TimeValue (MilliSeconds (1)));
+
+  Simulator::Schedule (Seconds (2), &SimpleEndDeviceLoraPhy::Send, edPhy1, packet, txParams, 868.1,
+                       14);
+
+  Simulator::Stop (Hours (2));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (
+      m_receivedPacketCalls, 2,
+      "Remote delay changed delivery without a distributed simulation");
+
+  Reset ();
+
   // Sleeping PHYs do not receive the packet
 
   edPhy2->SwitchToSleep ();
@@ -1360,6 +1707,1640 @@ PhyConnectivityTest::DoRun (void)
                          "State didn't switch to STANDBY as expected");
 }
 
+/*******************
+ * ChannelLossTest *
+ *******************/
+
+class ChannelLossTest : public TestCase
+{
+public:
+  ChannelLossTest ();
+  virtual ~ChannelLossTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+ChannelLossTest::ChannelLossTest ()
+    : TestCase ("Verify that LoraChannel's loss caching works as expected")
+{
+}
+
+// Reminder that the test case should clean up after itself
+ChannelLossTest::~ChannelLossTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+ChannelLossTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("ChannelLossTest");
+
+  // A random loss on top of a deterministic one, so that values that are
+  // computed again can be told apart from cached ones
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+
+  Ptr<UniformRandomVariable> variable = CreateObject<UniformRandomVariable> ();
+  variable->SetAttribute ("Min", DoubleValue (0.0));
+  variable->SetAttribute ("Max", DoubleValue (20.0));
+  Ptr<RandomPropagationLossModel> random = CreateObject<RandomPropagationLossModel> ();
+  random->SetAttribute ("Variable", PointerValue (variable));
+  loss->SetNext (random);
+
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+
+  Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
+
+  Ptr<ConstantPositionMobilityModel> mob1 = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<ConstantPositionMobilityModel> mob2 = CreateObject<ConstantPositionMobilityModel> ();
+  mob1->SetPosition (Vector (0.0, 0.0, 0.0));
+  mob2->SetPosition (Vector (1000.0, 0.0, 0.0));
+
+  // Without caching, each call draws a new value
+  double first = channel->GetRxPower (14, mob1, mob2);
+  NS_TEST_EXPECT_MSG_NE (channel->GetRxPower (14, mob1, mob2), first,
+                         "The loss model is not random");
+
+  // With caching, the value stays the same, and only the transmission power
+  // changes the received power
+  channel->SetLossCaching (true);
+  double cached = channel->GetRxPower (14, mob1, mob2);
+  for (int i = 0; i < 5; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (channel->GetRxPower (14, mob1, mob2), cached,
+                             "The cached value changed");
+    }
+  NS_TEST_EXPECT_MSG_EQ_TOL (channel->GetRxPower (10, mob1, mob2), cached - 4, 1e-9,
+                             "The cached loss depends on the transmission power");
+  Ptr<LogDistancePropagationLossModel> deterministic =
+      CreateObject<LogDistancePropagationLossModel> ();
+  deterministic->SetPathLossExponent (3.76);
+  deterministic->SetReference (1, 7.7);
+  double meanRxPower = deterministic->CalcRxPower (14, mob1, mob2) - 10;
+  NS_TEST_EXPECT_MSG_EQ_TOL (cached, meanRxPower, 10,
+                             "The cached value is not the one of the loss model");
+
+  // A course change of either device invalidates the cached value, even if
+  // the position is the same
+  mob2->SetPosition (Vector (1000.0, 0.0, 0.0));
+  double afterReceiverChange = channel->GetRxPower (14, mob1, mob2);
+  NS_TEST_EXPECT_MSG_NE (afterReceiverChange, cached,
+                         "The cached value was not updated after the receiver moved");
+  NS_TEST_EXPECT_MSG_EQ (channel->GetRxPower (14, mob1, mob2), afterReceiverChange,
+                         "The new value was not cached");
+
+  mob1->SetPosition (Vector (0.0, 0.0, 0.0));
+  double afterSenderChange = channel->GetRxPower (14, mob1, mob2);
+  NS_TEST_EXPECT_MSG_NE (afterSenderChange, afterReceiverChange,
+                         "The cached value was not updated after the sender moved");
+  NS_TEST_EXPECT_MSG_EQ (channel->GetRxPower (14, mob1, mob2), afterSenderChange,
+                         "The new value was not cached");
+
+  // The loss in the other direction is cached separately
+  double reverse = channel->GetRxPower (14, mob2, mob1);
+  NS_TEST_EXPECT_MSG_EQ (channel->GetRxPower (14, mob2, mob1), reverse,
+                         "The reverse value was not cached");
+  NS_TEST_EXPECT_MSG_EQ (channel->GetRxPower (14, mob1, mob2), afterSenderChange,
+                         "The reverse value replaced the direct one");
+
+  // Disabling caching draws new values again
+  channel->SetLossCaching (false);
+  NS_TEST_EXPECT_MSG_NE (channel->GetRxPower (14, mob1, mob2), afterSenderChange,
+                         "The value is still cached");
+}
+
+/**********************
+ * ChannelCullingTest *
+ **********************/
+
+class ChannelCullingTest : public TestCase
+{
+public:
+  ChannelCullingTest ();
+  virtual ~ChannelCullingTest ();
+
+private:
+  virtual void DoRun (void);
+
+  void Notified (std::string context, Ptr<const Packet> packet, uint32_t node);
+  void CheckNotified (std::vector<uint32_t> expected, std::string message);
+
+  std::vector<uint32_t> m_notified;
+};
+
+// Add some help text to this case to describe what it is intended to test
+ChannelCullingTest::ChannelCullingTest ()
+    : TestCase ("Verify that LoraChannel only notifies the receivers within the culling "
+                "distance")
+{
+}
+
+// Reminder that the test case should clean up after itself
+ChannelCullingTest::~ChannelCullingTest ()
+{
+}
+
+void
+ChannelCullingTest::Notified (std::string context, Ptr<const Packet> packet, uint32_t node)
+{
+  m_notified.push_back (std::atoi (context.c_str ()));
+}
+
+void
+ChannelCullingTest::CheckNotified (std::vector<uint32_t> expected, std::string message)
+{
+  std::sort (m_notified.begin (), m_notified.end ());
+  NS_TEST_EXPECT_MSG_EQ ((m_notified == expected), true, message);
+  m_notified.clear ();
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+ChannelCullingTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("ChannelCullingTest");
+
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+
+  // At the culling distance, no device can receive the packet
+  double cullingDistance = LoraChannel::ComputeCullingDistance (loss, 14, 0);
+  Ptr<ConstantPositionMobilityModel> mob1 = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<ConstantPositionMobilityModel> mob2 = CreateObject<ConstantPositionMobilityModel> ();
+  mob1->SetPosition (Vector (0.0, 0.0, 0.0));
+  mob2->SetPosition (Vector (cullingDistance, 0.0, 0.0));
+  NS_TEST_EXPECT_MSG_LT (loss->CalcRxPower (14, mob1, mob2), GatewayLoraPhy::sensitivity[5],
+                         "Device at the culling distance is above sensitivity");
+  mob2->SetPosition (Vector (cullingDistance - 2, 0.0, 0.0));
+  bool inRange = loss->CalcRxPower (14, mob1, mob2) >= GatewayLoraPhy::sensitivity[5];
+  NS_TEST_EXPECT_MSG_EQ (inRange, true, "Culling distance is shorter than the device range");
+
+  Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
+  channel->SetCullingDistance (1000);
+
+  // The receivers listen on another frequency than the one of the
+  // transmissions, so that each notification is traced
+  Ptr<ConstantPositionMobilityModel> shared = CreateObject<ConstantPositionMobilityModel> ();
+  shared->SetPosition (Vector (5000.0, 5000.0, 0.0));
+  Ptr<ConstantVelocityMobilityModel> moving = CreateObject<ConstantVelocityMobilityModel> ();
+  moving->SetPosition (Vector (3000.0, 0.0, 0.0));
+  moving->SetVelocity (Vector (-1000.0, 0.0, 0.0));
+
+  std::vector<Ptr<MobilityModel> > mobilities;
+  mobilities.push_back (mob2);   // In range
+  mobilities.push_back (CreateObject<ConstantPositionMobilityModel> ());   // Neighbor cell
+  mobilities.push_back (CreateObject<ConstantPositionMobilityModel> ());   // Far away
+  mobilities.push_back (shared);   // Two PHYs sharing a mobility model
+  mobilities.push_back (shared);
+  mobilities.push_back (moving);   // Moving towards the sender
+  mob2->SetPosition (Vector (500.0, 0.0, 0.0));
+  mobilities[1]->GetObject<ConstantPositionMobilityModel> ()->SetPosition (Vector (900.0, 900.0,
+                                                                                   0.0));
+  mobilities[2]->GetObject<ConstantPositionMobilityModel> ()->SetPosition (Vector (5000.0, 0.0,
+                                                                                   0.0));
+
+  for (uint32_t i = 0; i < mobilities.size (); i++)
+    {
+      Ptr<SimpleEndDeviceLoraPhy> phy = CreateObject<SimpleEndDeviceLoraPhy> ();
+      phy->SetMobility (mobilities[i]);
+      phy->SetFrequency (868.3);
+      phy->SwitchToStandby ();
+      phy->SetChannel (channel);
+      channel->Add (phy);
+
+      std::ostringstream context;
+      context << i;
+      phy->TraceConnect ("LostPacketBecauseWrongFrequency", context.str (),
+                         MakeCallback (&ChannelCullingTest::Notified, this));
+    }
+
+  Ptr<SimpleEndDeviceLoraPhy> sender = CreateObject<SimpleEndDeviceLoraPhy> ();
+  sender->SetMobility (mob1);
+
+  LoraTxParameters txParams;
+  txParams.sf = 7;
+
+  // Only the first PHY is in range: the one in the neighbor cell is too far,
+  // and the moving one is still 2 km away
+  std::vector<uint32_t> expected;
+  expected.push_back (0);
+  Simulator::Schedule (Seconds (1), &LoraChannel::Send, channel, sender, Create<Packet> (10),
+                       14, txParams, Seconds (0.1), 868.1);
+  Simulator::Schedule (Seconds (1.5), &ChannelCullingTest::CheckNotified, this, expected,
+                       "Unexpected receivers before moving");
+
+  // Both PHYs sharing the mobility model move close to the sender, and the
+  // moving PHY reaches it without changing course
+  Simulator::Schedule (Seconds (2), &ConstantPositionMobilityModel::SetPosition, shared,
+                       Vector (100.0, 100.0, 0.0));
+  expected.push_back (3);
+  expected.push_back (4);
+  expected.push_back (5);
+  Simulator::Schedule (Seconds (3), &LoraChannel::Send, channel, sender, Create<Packet> (10),
+                       14, txParams, Seconds (0.1), 868.1);
+  Simulator::Schedule (Seconds (3.5), &ChannelCullingTest::CheckNotified, this, expected,
+                       "Unexpected receivers after moving");
+
+  // The moving PHY stops 1.5 km past the sender
+  Simulator::Schedule (Seconds (4.5), &ConstantVelocityMobilityModel::SetVelocity, moving,
+                       Vector (0.0, 0.0, 0.0));
+  expected.pop_back ();
+  Simulator::Schedule (Seconds (5), &LoraChannel::Send, channel, sender, Create<Packet> (10),
+                       14, txParams, Seconds (0.1), 868.1);
+  Simulator::Schedule (Seconds (5.5), &ChannelCullingTest::CheckNotified, this, expected,
+                       "Unexpected receivers after stopping");
+
+  Simulator::Stop (Seconds (6));
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+/******************************
+ * ChannelInterferenceLogTest *
+ ******************************/
+
+class ChannelInterferenceLogTest : public TestCase
+{
+public:
+  ChannelInterferenceLogTest ();
+  virtual ~ChannelInterferenceLogTest ();
+
+private:
+  virtual void DoRun (void);
+
+  void StartReception (Ptr<Packet> packet, double rxPowerDbm);
+  void CheckInterferers (void);
+
+  Ptr<LoraChannel> m_channel;
+  Ptr<PropagationDelayModel> m_delay;
+  Ptr<SimpleEndDeviceLoraPhy> m_receiver;
+  Ptr<LoraInterferenceHelper::Event> m_event;
+  Ptr<MobilityModel> m_interfererMobility;
+  Time m_interfererStart;
+  uint32_t m_checks;
+};
+
+// Add some help text to this case to describe what it is intended to test
+ChannelInterferenceLogTest::ChannelInterferenceLogTest ()
+    : TestCase ("Verify that LoraChannel's transmission log provides the interferers of a "
+                "reception")
+{
+}
+
+// Reminder that the test case should clean up after itself
+ChannelInterferenceLogTest::~ChannelInterferenceLogTest ()
+{
+}
+
+void
+ChannelInterferenceLogTest::StartReception (Ptr<Packet> packet, double rxPowerDbm)
+{
+  // The event of the reception, as a PHY locking on it would create it
+  m_event = Create<LoraInterferenceHelper::Event> (Seconds (1), rxPowerDbm, 7, packet, 868.1);
+}
+
+void
+ChannelInterferenceLogTest::CheckInterferers (void)
+{
+  m_checks++;
+
+  // Only the transmission on the same frequency that overlaps with the event
+  // is an interferer, with the power and timing seen by the receiver
+  std::vector<LoraInterferenceHelper::Interferer> interferers =
+      m_channel->GetInterferers (m_receiver, m_event);
+  NS_TEST_ASSERT_MSG_EQ (interferers.size (), 1u, "Unexpected number of interferers");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (interferers[0].sf), 8, "Unexpected interferer SF");
+  NS_TEST_EXPECT_MSG_EQ (interferers[0].startTime,
+                         m_interfererStart + m_delay->GetDelay (m_interfererMobility,
+                                                                m_receiver->GetMobility ()),
+                         "Unexpected interferer start time");
+  NS_TEST_EXPECT_MSG_EQ (interferers[0].endTime, interferers[0].startTime + Seconds (1),
+                         "Unexpected interferer end time");
+  NS_TEST_EXPECT_MSG_EQ_TOL (interferers[0].rxPowerDbm,
+                             m_channel->GetRxPower (14, m_interfererMobility,
+                                                    m_receiver->GetMobility ()),
+                             1e-9, "Unexpected interferer power");
+}
+
+void
+ChannelInterferenceLogTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("ChannelInterferenceLogTest");
+
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+
+  m_delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  m_channel = CreateObject<LoraChannel> (loss, m_delay);
+  m_checks = 0;
+
+  // A receiver, and three senders at different distances from it
+  std::vector<Ptr<SimpleEndDeviceLoraPhy> > phys;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Ptr<ConstantPositionMobilityModel> mobility =
+          CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (1000.0 * i, 0.0, 0.0));
+
+      Ptr<SimpleEndDeviceLoraPhy> phy = CreateObject<SimpleEndDeviceLoraPhy> ();
+      phy->SetMobility (mobility);
+      phy->SetChannel (m_channel);
+      m_channel->Add (phy);
+      phys.push_back (phy);
+    }
+  m_receiver = phys[0];
+  m_interfererMobility = phys[2]->GetMobility ();
+  m_interfererStart = Seconds (1.5);
+
+  LoraTxParameters txParams;
+  Ptr<Packet> packet = Create<Packet> (10);
+
+  // The transmission whose reception is evaluated
+  txParams.sf = 7;
+  Simulator::Schedule (Seconds (1), &LoraChannel::Send, m_channel, phys[1], packet, 14,
+                       txParams, Seconds (1), 868.1);
+
+  // An overlapping transmission on the same frequency
+  txParams.sf = 8;
+  Simulator::Schedule (m_interfererStart, &LoraChannel::Send, m_channel, phys[2],
+                       Create<Packet> (10), 14, txParams, Seconds (1), 868.1);
+
+  // An overlapping transmission on another frequency, and an earlier one on
+  // the same frequency, which are not interferers
+  Simulator::Schedule (Seconds (1.2), &LoraChannel::Send, m_channel, phys[3],
+                       Create<Packet> (10), 14, txParams, Seconds (1), 868.3);
+  Simulator::Schedule (Seconds (0.2), &LoraChannel::Send, m_channel, phys[3],
+                       Create<Packet> (10), 14, txParams, Seconds (0.5), 868.1);
+
+  // Evaluate the reception when it ends, after all transmissions were sent
+  Ptr<MobilityModel> senderMobility = phys[1]->GetMobility ();
+  Time receptionStart = Seconds (1) + m_delay->GetDelay (senderMobility,
+                                                         m_receiver->GetMobility ());
+  Simulator::Schedule (receptionStart, &ChannelInterferenceLogTest::StartReception, this,
+                       packet, m_channel->GetRxPower (14, senderMobility,
+                                                      m_receiver->GetMobility ()));
+  Simulator::Schedule (receptionStart + Seconds (1),
+                       &ChannelInterferenceLogTest::CheckInterferers, this);
+
+  Simulator::Stop (Seconds (5));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_checks, 1u, "Interferers were not checked");
+
+  m_channel = 0;
+  m_delay = 0;
+  m_receiver = 0;
+  m_event = 0;
+  m_interfererMobility = 0;
+}
+
+/*****************************************
+ * GatewayTransmissionInterferenceTest *
+ *****************************************/
+
+class GatewayTransmissionInterferenceTest : public TestCase
+{
+public:
+  GatewayTransmissionInterferenceTest ();
+  virtual ~GatewayTransmissionInterferenceTest ();
+
+private:
+  virtual void DoRun (void);
+
+  static void Count (uint32_t *counter, Ptr<const Packet> packet, uint32_t node);
+};
+
+// Add some help text to this case to describe what it is intended to test
+GatewayTransmissionInterferenceTest::GatewayTransmissionInterferenceTest ()
+    : TestCase ("Verify that signals a gateway drops while transmitting don't interfere with "
+                "its later receptions")
+{
+}
+
+// Reminder that the test case should clean up after itself
+GatewayTransmissionInterferenceTest::~GatewayTransmissionInterferenceTest ()
+{
+}
+
+void
+GatewayTransmissionInterferenceTest::Count (uint32_t *counter, Ptr<const Packet> packet,
+                                            uint32_t node)
+{
+  (*counter)++;
+}
+
+void
+GatewayTransmissionInterferenceTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("GatewayTransmissionInterferenceTest");
+
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  loss->SetPathLossExponent (3.76);
+  loss->SetReference (1, 7.7);
+  Ptr<LoraChannel> channel =
+      CreateObject<LoraChannel> (loss, CreateObject<ConstantSpeedPropagationDelayModel> ());
+
+  // A gateway whose receptions are evaluated with the channel's log
+  Ptr<ConstantPositionMobilityModel> gatewayMobility =
+      CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<SimpleGatewayLoraPhy> gatewayPhy = CreateObject<SimpleGatewayLoraPhy> ();
+  gatewayPhy->SetMobility (gatewayMobility);
+  gatewayPhy->SetChannel (channel);
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      gatewayPhy->AddReceptionPath ();
+    }
+  channel->Add (gatewayPhy);
+
+  // A device close to the gateway, whose signals are much stronger than the
+  // ones of a far away device
+  std::vector<Ptr<SimpleEndDeviceLoraPhy> > phys;
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<ConstantPositionMobilityModel> mobility =
+          CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (i == 0 ? 100.0 : 2000.0, 0.0, 0.0));
+      Ptr<SimpleEndDeviceLoraPhy> phy = CreateObject<SimpleEndDeviceLoraPhy> ();
+      phy->SetMobility (mobility);
+      phy->SetChannel (channel);
+      channel->Add (phy);
+      phys.push_back (phy);
+    }
+  Ptr<SimpleEndDeviceLoraPhy> nearPhy = phys[0];
+  Ptr<SimpleEndDeviceLoraPhy> farPhy = phys[1];
+
+  uint32_t received = 0;
+  uint32_t interfered = 0;
+  uint32_t droppedWhileTransmitting = 0;
+  gatewayPhy->TraceConnectWithoutContext
+    ("ReceivedPacket", MakeBoundCallback (&GatewayTransmissionInterferenceTest::Count,
+                                          &received));
+  gatewayPhy->TraceConnectWithoutContext
+    ("LostPacketBecauseInterference",
+    MakeBoundCallback (&GatewayTransmissionInterferenceTest::Count, &interfered));
+  gatewayPhy->TraceConnectWithoutContext
+    ("NoReceptionBecauseTransmitting",
+    MakeBoundCallback (&GatewayTransmissionInterferenceTest::Count, &droppedWhileTransmitting));
+
+  LoraTxParameters txParams;
+  txParams.sf = 7;
+
+  // The near device starts a long transmission while the gateway is
+  // transmitting, which drops it. As before the channel kept a log of
+  // transmissions, it doesn't destroy the packet the gateway receives next.
+  Simulator::Schedule (Seconds (1), &SimpleGatewayLoraPhy::Send, gatewayPhy,
+                       Create<Packet> (10), txParams, 868.1, 14);
+  Simulator::Schedule (Seconds (1.01), &LoraChannel::Send, channel, nearPhy,
+                       Create<Packet> (10), 14, txParams, Seconds (2), 868.1);
+  Simulator::Schedule (Seconds (1.5), &LoraChannel::Send, channel, farPhy,
+                       Create<Packet> (10), 14, txParams, Seconds (0.2), 868.1);
+
+  // The same transmission does destroy the packet when the gateway hears it
+  Simulator::Schedule (Seconds (5), &LoraChannel::Send, channel, nearPhy,
+                       Create<Packet> (10), 14, txParams, Seconds (2), 868.1);
+  Simulator::Schedule (Seconds (5.5), &LoraChannel::Send, channel, farPhy,
+                       Create<Packet> (10), 14, txParams, Seconds (0.2), 868.1);
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (droppedWhileTransmitting, 1u,
+                         "The signal arriving during the transmission was not dropped");
+  // The near device's second signal is received, and the far one's is
+  // received before and destroyed after
+  NS_TEST_EXPECT_MSG_EQ (received, 2u, "Unexpected number of received packets");
+  NS_TEST_EXPECT_MSG_EQ (interfered, 1u, "Unexpected number of interfered packets");
+}
+
+/************************
+ * ShadowingStorageTest *
+ ************************/
+
+class ShadowingStorageTest : public TestCase
+{
+public:
+  ShadowingStorageTest ();
+  virtual ~ShadowingStorageTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+ShadowingStorageTest::ShadowingStorageTest ()
+    : TestCase ("Verify that the flat storage of CorrelatedShadowingPropagationLossModel works "
+                "as expected, and gives the same values as the map storage")
+{
+}
+
+// Reminder that the test case should clean up after itself
+ShadowingStorageTest::~ShadowingStorageTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+ShadowingStorageTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("ShadowingStorageTest");
+
+  Ptr<CorrelatedShadowingPropagationLossModel> shadowing =
+      CreateObject<CorrelatedShadowingPropagationLossModel> ();
+  shadowing->SetAttribute ("Storage",
+                           EnumValue (CorrelatedShadowingPropagationLossModel::FLAT_STORAGE));
+
+  Ptr<ConstantPositionMobilityModel> tx = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<ConstantPositionMobilityModel> rx = CreateObject<ConstantPositionMobilityModel> ();
+  tx->SetPosition (Vector (0.0, 0.0, 0.0));
+
+  // Values are remembered for each position
+  std::vector<double> values;
+  for (int i = 0; i < 10; i++)
+    {
+      rx->SetPosition (Vector (1000.0 + 7 * i, 20.0, 0.0));
+      values.push_back (shadowing->CalcRxPower (14, tx, rx));
+    }
+  for (int i = 0; i < 10; i++)
+    {
+      rx->SetPosition (Vector (1000.0 + 7 * i, 20.0, 0.0));
+      NS_TEST_EXPECT_MSG_EQ (shadowing->CalcRxPower (14, tx, rx), values[i],
+                             "Shadowing at the same position changed");
+    }
+
+  // Each new position also stores the vertices it was interpolated from, so
+  // with a limit the number of stored positions stays bounded
+  shadowing->SetAttribute ("MaxPositionsPerSquare", UintegerValue (20));
+  for (int i = 0; i < 100; i++)
+    {
+      rx->SetPosition (Vector (2000.0 + 3 * i, 20.0, 0.0));
+      shadowing->CalcRxPower (14, tx, rx);
+    }
+  bool bounded = shadowing->GetNStoredPositions () < 25;
+  NS_TEST_EXPECT_MSG_EQ (bounded, true, "Stored positions were not bounded");
+
+  // With the same run and stream, both storages give the same values over
+  // the same sequence of positions, including the ones seen again and the
+  // ones at grid vertices
+  uint64_t run = RngSeedManager::GetRun ();
+  RngSeedManager::SetRun (7);
+  std::vector<double> storageValues[2];
+  for (int storage = 0; storage < 2; storage++)
+    {
+      Ptr<CorrelatedShadowingPropagationLossModel> model =
+          CreateObject<CorrelatedShadowingPropagationLossModel> ();
+      model->SetAttribute ("Storage",
+                           EnumValue (storage == 0 ?
+                                      CorrelatedShadowingPropagationLossModel::MAP_STORAGE :
+                                      CorrelatedShadowingPropagationLossModel::FLAT_STORAGE));
+      model->AssignStreams (0);
+
+      for (int round = 0; round < 2; round++)
+        {
+          for (int i = 0; i < 3; i++)
+            {
+              tx->SetPosition (Vector (-400.0 * i, 250.0 * i, 0.0));
+              for (int j = 0; j < 20; j++)
+                {
+                  rx->SetPosition (Vector (37.5 * j - 150, 120.0 - 23 * j, 0.0));
+                  storageValues[storage].push_back (model->CalcRxPower (14, tx, rx));
+                }
+              for (int j = 0; j < 3; j++)
+                {
+                  rx->SetPosition (Vector (110.0 * j - 55, 55.0, 0.0));
+                  storageValues[storage].push_back (model->CalcRxPower (14, tx, rx));
+                }
+            }
+        }
+    }
+  RngSeedManager::SetRun (run);
+
+  NS_TEST_ASSERT_MSG_EQ (storageValues[0].size (), storageValues[1].size (),
+                         "Different number of values");
+  for (std::size_t i = 0; i < storageValues[0].size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (storageValues[1][i], storageValues[0][i],
+                             "Flat storage differs from map storage at value " << i);
+    }
+}
+
+/*********************
+ * MqttTopicTrieTest *
+ *********************/
+
+class MqttTopicTrieTest : public TestCase
+{
+public:
+  MqttTopicTrieTest ();
+  virtual ~MqttTopicTrieTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+MqttTopicTrieTest::MqttTopicTrieTest ()
+    : TestCase ("Verify that MqttTopicTrie matches topics and wildcards correctly")
+{
+}
+
+// Reminder that the test case should clean up after itself
+MqttTopicTrieTest::~MqttTopicTrieTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+MqttTopicTrieTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("MqttTopicTrieTest");
+
+  MqttTopicTrie trie;
+  LoraDeviceAddress first (1);
+  LoraDeviceAddress second (2);
+  LoraDeviceAddress third (3);
+
+  NS_TEST_EXPECT_MSG_EQ (trie.Subscribe ("home/kitchen/temp", first), true,
+                         "Subscription was not added");
+  NS_TEST_EXPECT_MSG_EQ (trie.Subscribe ("home/kitchen/temp", first), false,
+                         "Duplicate subscription was added");
+  trie.Subscribe ("home/+/temp", second);
+  trie.Subscribe ("home/#", third);
+  trie.Subscribe ("home/kitchen/#", first);
+  NS_TEST_EXPECT_MSG_EQ (trie.Subscribe ("home/#/temp", first), false,
+                         "Invalid filter was accepted");
+
+  std::vector<LoraDeviceAddress> subscribers;
+  trie.Match ("home/kitchen/temp", subscribers);
+  NS_TEST_EXPECT_MSG_EQ (subscribers.size (), 3, "Wrong number of subscribers");
+
+  trie.Match ("home/garden/temp", subscribers);
+  NS_TEST_EXPECT_MSG_EQ (subscribers.size (), 2, "Wrong number of subscribers");
+
+  // '#' also matches the parent level
+  trie.Match ("home", subscribers);
+  NS_TEST_EXPECT_MSG_EQ (subscribers.size (), 1, "Wrong number of subscribers");
+  trie.Match ("office/kitchen/temp", subscribers);
+  NS_TEST_EXPECT_MSG_EQ (subscribers.size (), 0, "Wrong number of subscribers");
+
+  NS_TEST_EXPECT_MSG_EQ (trie.Unsubscribe ("home/+/temp", second), true,
+                         "Subscription was not removed");
+  NS_TEST_EXPECT_MSG_EQ (trie.Unsubscribe ("home/+/temp", second), false,
+                         "Missing subscription was removed");
+  trie.Match ("home/garden/temp", subscribers);
+  NS_TEST_EXPECT_MSG_EQ (subscribers.size (), 1, "Wrong number of subscribers");
+  NS_TEST_EXPECT_MSG_EQ (subscribers[0], third, "Wrong subscriber");
+  NS_TEST_EXPECT_MSG_EQ (trie.GetNSubscriptions (), 3, "Wrong number of subscriptions");
+
+  // Subscribers are delivered in the order they subscribed, not by address,
+  // and a device matching through several filters keeps its earliest place
+  MqttTopicTrie ordered;
+  ordered.Subscribe ("sensors/light", third);
+  ordered.Subscribe ("sensors/light", first);
+  ordered.Subscribe ("sensors/+", second);
+  ordered.Subscribe ("sensors/#", third);
+  ordered.Match ("sensors/light", subscribers);
+  NS_TEST_ASSERT_MSG_EQ (subscribers.size (), 3, "Wrong number of subscribers");
+  NS_TEST_EXPECT_MSG_EQ (subscribers[0], third, "Wrong subscriber order");
+  NS_TEST_EXPECT_MSG_EQ (subscribers[1], first, "Wrong subscriber order");
+  NS_TEST_EXPECT_MSG_EQ (subscribers[2], second, "Wrong subscriber order");
+
+  ordered.Unsubscribe ("sensors/light", third);
+  ordered.Match ("sensors/light", subscribers);
+  NS_TEST_ASSERT_MSG_EQ (subscribers.size (), 3, "Wrong number of subscribers");
+  NS_TEST_EXPECT_MSG_EQ (subscribers[0], first, "Wrong subscriber order");
+  NS_TEST_EXPECT_MSG_EQ (subscribers[1], second, "Wrong subscriber order");
+  NS_TEST_EXPECT_MSG_EQ (subscribers[2], third, "Wrong subscriber order");
+
+  // Levels are compared whole, not by prefix
+  ordered.Match ("sensors/lights", subscribers);
+  NS_TEST_EXPECT_MSG_EQ (subscribers.size (), 2, "Wrong number of subscribers");
+  ordered.Match ("sensors", subscribers);
+  NS_TEST_EXPECT_MSG_EQ (subscribers.size (), 1, "Wrong number of subscribers");
+}
+
+/*********************
+ * PacketTrackerTest *
+ *********************/
+
+class PacketTrackerTest : public TestCase
+{
+public:
+  PacketTrackerTest ();
+  virtual ~PacketTrackerTest ();
+
+private:
+  void ScheduleTraffic (LoraPacketTracker *tracker);
+  virtual void DoRun (void);
+
+  std::vector<Ptr<Packet> > m_packets;
+};
+
+// Add some help text to this case to describe what it is intended to test
+PacketTrackerTest::PacketTrackerTest ()
+    : TestCase ("Verify that LoraPacketTracker counters and streaming work as expected")
+{
+}
+
+// Reminder that the test case should clean up after itself
+PacketTrackerTest::~PacketTrackerTest ()
+{
+}
+
+void
+PacketTrackerTest::ScheduleTraffic (LoraPacketTracker *tracker)
+{
+  // Uplink packets from device 0, with outcomes at gateways 5 and 6
+  Simulator::Schedule (Seconds (1), &LoraPacketTracker::TransmissionCallback,
+                       tracker, m_packets[0], 0);
+  Simulator::Schedule (Seconds (2), &LoraPacketTracker::PacketReceptionCallback,
+                       tracker, m_packets[0], 5);
+  Simulator::Schedule (Seconds (12), &LoraPacketTracker::TransmissionCallback,
+                       tracker, m_packets[1], 0);
+  Simulator::Schedule (Seconds (13), &LoraPacketTracker::InterferenceCallback,
+                       tracker, m_packets[1], 5);
+  Simulator::Schedule (Seconds (13), &LoraPacketTracker::PacketReceptionCallback,
+                       tracker, m_packets[1], 6);
+  Simulator::Schedule (Seconds (25), &LoraPacketTracker::TransmissionCallback,
+                       tracker, m_packets[2], 0);
+  Simulator::Schedule (Seconds (26), &LoraPacketTracker::UnderSensitivityCallback,
+                       tracker, m_packets[2], 5);
+
+  // A packet sent on the boundary between two counting intervals
+  Simulator::Schedule (Seconds (20), &LoraPacketTracker::TransmissionCallback,
+                       tracker, m_packets[3], 0);
+  Simulator::Schedule (Seconds (21), &LoraPacketTracker::PacketReceptionCallback,
+                       tracker, m_packets[3], 5);
+
+  // MAC packets, of which only the first is received
+  Simulator::ScheduleWithContext (0, Seconds (1),
+                                  &LoraPacketTracker::MacTransmissionCallback,
+                                  tracker, m_packets[0]);
+  Simulator::ScheduleWithContext (5, Seconds (2),
+                                  &LoraPacketTracker::MacGwReceptionCallback,
+                                  tracker, m_packets[0]);
+  Simulator::ScheduleWithContext (0, Seconds (12),
+                                  &LoraPacketTracker::MacTransmissionCallback,
+                                  tracker, m_packets[1]);
+  Simulator::ScheduleWithContext (0, Seconds (20),
+                                  &LoraPacketTracker::MacTransmissionCallback,
+                                  tracker, m_packets[3]);
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+PacketTrackerTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("PacketTrackerTest");
+
+  for (int i = 0; i < 4; i++)
+    {
+      Ptr<Packet> packet = Create<Packet> (10);
+      LorawanMacHeader macHdr;
+      macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+      packet->AddHeader (macHdr);
+      m_packets.push_back (packet);
+    }
+
+  LoraPacketTracker tracker;
+  tracker.SetCountingInterval (Seconds (10));
+  ScheduleTraffic (&tracker);
+
+  LoraPacketTracker streamingTracker;
+  streamingTracker.SetCountingInterval (Seconds (10));
+  streamingTracker.EnableStreaming (CreateTempDirFilename ("tracker.txt"), Seconds (5));
+  ScheduleTraffic (&streamingTracker);
+
+  LoraPacketTracker scanningTracker;
+  ScheduleTraffic (&scanningTracker);
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // Aligned windows are counted from the counters
+  std::vector<int> counts = tracker.CountPhyPacketsPerGw (Seconds (0), Seconds (10), 5);
+  NS_TEST_EXPECT_MSG_EQ (counts.at (0), 1, "Wrong number of sent packets");
+  NS_TEST_EXPECT_MSG_EQ (counts.at (1), 1, "Wrong number of received packets");
+
+  counts = tracker.CountPhyPacketsPerGw (Seconds (0), Seconds (30), 5);
+  NS_TEST_EXPECT_MSG_EQ (counts.at (0), 4, "Wrong number of sent packets");
+  NS_TEST_EXPECT_MSG_EQ (counts.at (1), 2, "Wrong number of received packets");
+  NS_TEST_EXPECT_MSG_EQ (counts.at (2), 1, "Wrong number of interfered packets");
+  NS_TEST_EXPECT_MSG_EQ (counts.at (4), 1, "Wrong number of packets under sensitivity");
+
+  counts = tracker.CountPhyPacketsPerGw (Seconds (10), Seconds (30), 6);
+  NS_TEST_EXPECT_MSG_EQ (counts.at (0), 3, "Wrong number of sent packets");
+  NS_TEST_EXPECT_MSG_EQ (counts.at (1), 1, "Wrong number of received packets");
+
+  // Like a scan, the counters include both bounds of the window, so the
+  // packet sent at 20 s is in both windows that share that bound
+  counts = tracker.CountPhyPacketsPerGw (Seconds (10), Seconds (20), 5);
+  NS_TEST_EXPECT_MSG_EQ (counts.at (0), 2, "Wrong number of sent packets");
+  NS_TEST_EXPECT_MSG_EQ (counts.at (1), 1, "Wrong number of received packets");
+  counts = tracker.CountPhyPacketsPerGw (Seconds (20), Seconds (30), 5);
+  NS_TEST_EXPECT_MSG_EQ (counts.at (0), 2, "Wrong number of sent packets");
+  NS_TEST_EXPECT_MSG_EQ (counts.at (1), 1, "Wrong number of received packets");
+  for (int start = 0; start <= 20; start += 10)
+    {
+      NS_TEST_EXPECT_MSG_EQ (tracker.PrintPhyPacketsPerGw (Seconds (start),
+                                                           Seconds (start + 10), 5),
+                             scanningTracker.PrintPhyPacketsPerGw (Seconds (start),
+                                                                   Seconds (start + 10), 5),
+                             "Counters and scan disagree");
+      NS_TEST_EXPECT_MSG_EQ (tracker.CountMacPacketsGlobally (Seconds (start),
+                                                              Seconds (start + 10)),
+                             scanningTracker.CountMacPacketsGlobally (Seconds (start),
+                                                                      Seconds (start + 10)),
+                             "Counters and scan disagree");
+    }
+
+  // Other windows are counted by scanning the stored packets
+  counts = tracker.CountPhyPacketsPerGw (Seconds (1), Seconds (12), 5);
+  NS_TEST_EXPECT_MSG_EQ (counts.at (0), 2, "Wrong number of sent packets");
+  NS_TEST_EXPECT_MSG_EQ (counts.at (2), 1, "Wrong number of interfered packets");
+
+  NS_TEST_EXPECT_MSG_EQ (tracker.CountMacPacketsGlobally (Seconds (0), Seconds (20)),
+                         tracker.CountMacPacketsGlobally (Seconds (0.5), Seconds (20.5)),
+                         "Counters and scan disagree");
+
+  // The streaming tracker freed the old records, but still counts them
+  bool freed = streamingTracker.GetNStoredRecords () < tracker.GetNStoredRecords ();
+  NS_TEST_EXPECT_MSG_EQ (freed, true, "Old records were not freed");
+  NS_TEST_EXPECT_MSG_EQ (streamingTracker.PrintPhyPacketsPerGw (Seconds (0), Seconds (30), 5),
+                         tracker.PrintPhyPacketsPerGw (Seconds (0), Seconds (30), 5),
+                         "Streaming changed the counts");
+
+  // It also merged the counters of the intervals it freed, and still counts
+  // windows starting at time zero or within the retention exactly
+  bool merged = streamingTracker.GetNStoredCounters () < tracker.GetNStoredCounters ();
+  NS_TEST_EXPECT_MSG_EQ (merged, true, "Old counters were not merged");
+  NS_TEST_EXPECT_MSG_EQ (streamingTracker.PrintPhyPacketsPerGw (Seconds (20), Seconds (30), 5),
+                         tracker.PrintPhyPacketsPerGw (Seconds (20), Seconds (30), 5),
+                         "Streaming changed the counts");
+  NS_TEST_EXPECT_MSG_EQ (streamingTracker.CountMacPacketsGlobally (Seconds (0), Seconds (30)),
+                         tracker.CountMacPacketsGlobally (Seconds (0), Seconds (30)),
+                         "Streaming changed the counts");
+  streamingTracker.FlushRecords ();
+  NS_TEST_EXPECT_MSG_EQ (streamingTracker.GetNStoredRecords (), 0, "Records were not flushed");
+}
+
+/**********************
+ * BinaryTraceTest *
+ **********************/
+
+class BinaryTraceTest : public TestCase
+{
+public:
+  BinaryTraceTest ();
+  virtual ~BinaryTraceTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+BinaryTraceTest::BinaryTraceTest ()
+    : TestCase ("Verify that binary traces can be written and read back")
+{
+}
+
+// Reminder that the test case should clean up after itself
+BinaryTraceTest::~BinaryTraceTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+BinaryTraceTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("BinaryTraceTest");
+
+  std::string filename = CreateTempDirFilename ("trace.bin");
+
+  Ptr<Packet> packet = Create<Packet> (23);
+  LoraTag tag;
+  tag.SetSpreadingFactor (9);
+  tag.SetFrequency (868.1);
+  packet->AddPacketTag (tag);
+
+  {
+    // Buffer fewer records than are written, to also go through a flush
+    LoraTraceSink sink (filename, 2);
+    sink.TransmissionCallback (packet, 3);
+    sink.InterferenceCallback (packet, 7);
+    sink.PacketReceptionCallback (packet, 8);
+    NS_TEST_EXPECT_MSG_EQ (sink.GetNRecords (), 3, "Wrong number of records");
+  }
+
+  LoraTraceReader reader (filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.IsValid (), true, "The trace header is not valid");
+  NS_TEST_EXPECT_MSG_EQ (reader.GetEventNames ().size (),
+                         uint32_t (LoraTraceSink::N_EVENT_TYPES), "Wrong number of events");
+
+  LoraTraceSink::Record record;
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (record), true, "Missing record");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (record.event), LoraTraceSink::PHY_TX, "Wrong event");
+  NS_TEST_EXPECT_MSG_EQ (record.nodeId, 3, "Wrong node");
+  NS_TEST_EXPECT_MSG_EQ (record.packetUid, packet->GetUid (), "Wrong packet");
+  NS_TEST_EXPECT_MSG_EQ (record.size, 23, "Wrong packet size");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (record.sf), 9, "Wrong spreading factor");
+  NS_TEST_EXPECT_MSG_EQ (record.frequencyHz, 868100000, "Wrong frequency");
+
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (record), true, "Missing record");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (record.event), LoraTraceSink::PHY_INTERFERED,
+                         "Wrong event");
+
+  // The rest of the trace is converted to CSV
+  std::ostringstream csv;
+  NS_TEST_EXPECT_MSG_EQ (reader.ConvertToCsv (csv), 1, "Wrong number of converted records");
+  NS_TEST_EXPECT_MSG_EQ (csv.str (),
+                         "timeNs,packetUid,nodeId,frequencyHz,size,event,sf\n"
+                         "0," + std::to_string (packet->GetUid ()) + ",8,868100000,23,PhyRx,9\n",
+                         "Wrong CSV output");
+}
+
+/***********************
+ * TraceDispatcherTest *
+ ***********************/
+
+class TraceDispatcherTest : public TestCase
+{
+public:
+  TraceDispatcherTest ();
+  virtual ~TraceDispatcherTest ();
+
+private:
+  void RunScenario (bool trackingFirst, bool destroyHelper);
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+TraceDispatcherTest::TraceDispatcherTest ()
+    : TestCase ("Verify that the packet tracker and the binary trace get each event once")
+{
+}
+
+// Reminder that the test case should clean up after itself
+TraceDispatcherTest::~TraceDispatcherTest ()
+{
+}
+
+// Enable both the packet tracker and the binary trace, in the given order,
+// and have an end device send a packet to a gateway, optionally destroying
+// the helper before the simulation runs
+void
+TraceDispatcherTest::RunScenario (bool trackingFirst, bool destroyHelper)
+{
+  std::string filename = CreateTempDirFilename ("dispatcher.bin");
+
+  LoraHelper *helper = new LoraHelper ();
+  if (trackingFirst)
+    {
+      helper->EnablePacketTracking ();
+      helper->EnableBinaryTracing (filename);
+    }
+  else
+    {
+      helper->EnableBinaryTracing (filename);
+      helper->EnablePacketTracking ();
+    }
+  // The tracker isn't owned by the helper
+  LoraPacketTracker &tracker = helper->GetPacketTracker ();
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (0, 0, 0));
+  allocator->Add (Vector (100, 0, 0));
+  mobility.SetPositionAllocator (allocator);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  LoraPhyHelper phyHelper;
+  phyHelper.SetChannel (channel);
+  LorawanMacHelper macHelper;
+
+  NodeContainer gateways;
+  gateways.Create (1);
+  mobility.Install (gateways);
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper->Install (phyHelper, macHelper, gateways);
+
+  NodeContainer endDevices;
+  endDevices.Create (1);
+  mobility.Install (endDevices);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_A);
+  helper->Install (phyHelper, macHelper, endDevices);
+
+  OneShotSenderHelper oneShotSenderHelper;
+  oneShotSenderHelper.SetSendTime (Seconds (1));
+  oneShotSenderHelper.Install (endDevices);
+
+  // The connected callbacks must not depend on the helper
+  if (destroyHelper)
+    {
+      delete helper;
+      helper = 0;
+    }
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  delete helper;
+
+  // The tracker ignores repeated events, so check its counts first, and
+  // then look for repeated events in the trace
+  uint32_t gwId = gateways.Get (0)->GetId ();
+  std::vector<int> counts =
+    tracker.CountPhyPacketsPerGw (Seconds (0), Seconds (10), gwId);
+  NS_TEST_EXPECT_MSG_EQ (counts.at (0), 1, "Wrong number of sent packets");
+  NS_TEST_EXPECT_MSG_EQ (counts.at (1), 1, "Wrong number of received packets");
+  NS_TEST_EXPECT_MSG_EQ (tracker.CountMacPacketsGlobally (Seconds (0), Seconds (10)),
+                         std::to_string (1.0) + " " + std::to_string (1.0),
+                         "Wrong number of MAC packets");
+
+  LoraTraceReader reader (filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.IsValid (), true, "The trace header is not valid");
+  std::vector<uint32_t> events (LoraTraceSink::N_EVENT_TYPES, 0);
+  LoraTraceSink::Record record;
+  while (reader.Read (record))
+    {
+      events.at (record.event)++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (events[LoraTraceSink::PHY_TX], 1, "Wrong number of PHY transmissions");
+  NS_TEST_EXPECT_MSG_EQ (events[LoraTraceSink::PHY_RX], 1, "Wrong number of PHY receptions");
+  NS_TEST_EXPECT_MSG_EQ (events[LoraTraceSink::MAC_TX], 1, "Wrong number of MAC transmissions");
+  NS_TEST_EXPECT_MSG_EQ (events[LoraTraceSink::MAC_RX], 1, "Wrong number of MAC receptions");
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+TraceDispatcherTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("TraceDispatcherTest");
+
+  RunScenario (true, false);
+  RunScenario (false, false);
+  RunScenario (true, true);
+}
+
+/*********************
+ * CampaignHelperTest *
+ *********************/
+
+class CampaignHelperTest : public TestCase
+{
+public:
+  CampaignHelperTest ();
+  virtual ~CampaignHelperTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+CampaignHelperTest::CampaignHelperTest ()
+    : TestCase ("Verify that campaign replications get deterministic runs and results")
+{
+}
+
+// Reminder that the test case should clean up after itself
+CampaignHelperTest::~CampaignHelperTest ()
+{
+}
+
+// A scenario that reports its parameters and the run it was given
+std::vector<double>
+CampaignTestScenario (const LoraCampaignHelper::Point &point)
+{
+  std::vector<double> metrics;
+  metrics.push_back (point.nDevices);
+  metrics.push_back (point.brokerDelay);
+  metrics.push_back (RngSeedManager::GetRun ());
+  return metrics;
+}
+
+// A scenario with more metrics than a pipe's buffer can hold
+std::vector<double>
+CampaignLargeTestScenario (const LoraCampaignHelper::Point &point)
+{
+  std::vector<double> metrics (100000);
+  for (uint32_t i = 0; i < metrics.size (); i++)
+    {
+      metrics[i] = i;
+    }
+  return metrics;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+CampaignHelperTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("CampaignHelperTest");
+
+  uint64_t originalRun = RngSeedManager::GetRun ();
+
+  LoraCampaignHelper campaign;
+  std::vector<std::string> names;
+  names.push_back ("nDevices");
+  names.push_back ("brokerDelay");
+  names.push_back ("run");
+  campaign.SetScenario (MakeCallback (&CampaignTestScenario), names);
+  campaign.AddGrid (std::vector<uint32_t> {10, 20}, std::vector<double> {1000},
+                    std::vector<uint32_t> {1}, std::vector<bool> {false},
+                    std::vector<double> {0, 5});
+  campaign.SetReplications (3);
+  campaign.SetFirstRun (100);
+  campaign.SetMaxProcesses (2);
+
+  NS_TEST_ASSERT_MSG_EQ (campaign.GetPoints ().size (), 4u, "Wrong number of points");
+  NS_TEST_EXPECT_MSG_EQ (campaign.GetPoints ()[1].brokerDelay, 5,
+                         "The last parameter should vary fastest");
+
+  NS_TEST_EXPECT_MSG_EQ (campaign.Run (), 0, "Some replications failed");
+
+  const std::vector<LoraCampaignHelper::Result> &results = campaign.GetResults ();
+  NS_TEST_ASSERT_MSG_EQ (results.size (), 12u, "Wrong number of results");
+  for (uint32_t i = 0; i < results.size (); i++)
+    {
+      const LoraCampaignHelper::Point &point = campaign.GetPoints ()[results[i].point];
+      NS_TEST_EXPECT_MSG_EQ (results[i].point, i / 3, "Results are not sorted");
+      NS_TEST_EXPECT_MSG_EQ (results[i].replication, i % 3, "Results are not sorted");
+      NS_TEST_EXPECT_MSG_EQ (results[i].run, 100 + i, "Wrong run");
+      NS_TEST_ASSERT_MSG_EQ (results[i].completed, true, "Replication did not complete");
+      NS_TEST_EXPECT_MSG_EQ (results[i].metrics[0], point.nDevices, "Wrong metric");
+      NS_TEST_EXPECT_MSG_EQ (results[i].metrics[1], point.brokerDelay, "Wrong metric");
+      NS_TEST_EXPECT_MSG_EQ (results[i].metrics[2], 100 + i,
+                             "The scenario did not run with its replication's run");
+    }
+
+  // Replications don't affect the process that runs the campaign
+  NS_TEST_EXPECT_MSG_EQ (RngSeedManager::GetRun (), originalRun, "Run was changed");
+
+  // Metrics are read while the replications write them
+  LoraCampaignHelper largeCampaign;
+  largeCampaign.SetScenario (MakeCallback (&CampaignLargeTestScenario),
+                             std::vector<std::string> (100000, "metric"));
+  largeCampaign.AddGrid (std::vector<uint32_t> {10}, std::vector<double> {1000},
+                         std::vector<uint32_t> {1}, std::vector<bool> {false},
+                         std::vector<double> {0});
+  largeCampaign.SetReplications (3);
+  largeCampaign.SetMaxProcesses (2);
+
+  NS_TEST_EXPECT_MSG_EQ (largeCampaign.Run (), 0, "Some replications failed");
+  const std::vector<LoraCampaignHelper::Result> &largeResults = largeCampaign.GetResults ();
+  NS_TEST_ASSERT_MSG_EQ (largeResults.size (), 3u, "Wrong number of results");
+  for (uint32_t i = 0; i < largeResults.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (largeResults[i].completed, true, "Replication did not complete");
+      NS_TEST_ASSERT_MSG_EQ (largeResults[i].metrics.size (), 100000u, "Wrong number of metrics");
+      NS_TEST_EXPECT_MSG_EQ (largeResults[i].metrics[99999], 99999, "Wrong metric");
+    }
+}
+
+/***********************
+ * PartitionHelperTest *
+ ***********************/
+
+class PartitionHelperTest : public TestCase
+{
+public:
+  PartitionHelperTest ();
+  virtual ~PartitionHelperTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+PartitionHelperTest::PartitionHelperTest ()
+    : TestCase ("Verify that nodes are partitioned by gateway region")
+{
+}
+
+// Reminder that the test case should clean up after itself
+PartitionHelperTest::~PartitionHelperTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+PartitionHelperTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("PartitionHelperTest");
+
+  double radius = 1000;
+  LoraPartitionHelper partitionHelper;
+  partitionHelper.SetCellRadius (radius);
+  partitionHelper.SetNPartitions (2);
+
+  // The central cell and the cells above and below it are in the same
+  // column, and the cells on its sides are in the other partition
+  NS_TEST_EXPECT_MSG_EQ (partitionHelper.GetPartition (Vector (0, 0, 0)), 0,
+                         "Wrong partition of the central cell");
+  NS_TEST_EXPECT_MSG_EQ (partitionHelper.GetPartition (Vector (0, 2 * radius, 0)), 0,
+                         "Wrong partition of the cell above");
+  NS_TEST_EXPECT_MSG_EQ (partitionHelper.GetPartition (Vector (0, -2 * radius, 0)), 0,
+                         "Wrong partition of the cell below");
+  NS_TEST_EXPECT_MSG_EQ (partitionHelper.GetPartition
+                           (Vector (std::sqrt (3.0) * radius, radius, 0)), 1,
+                         "Wrong partition of the cell on the right");
+  NS_TEST_EXPECT_MSG_EQ (partitionHelper.GetPartition
+                           (Vector (-std::sqrt (3.0) * radius, -radius, 0)), 1,
+                         "Wrong partition of the cell on the left");
+
+  // Positions inside a cell are in the partition of its center
+  NS_TEST_EXPECT_MSG_EQ (partitionHelper.GetPartition (Vector (0.8 * radius, 0, 0)), 0,
+                         "Wrong partition close to the border of the central cell");
+  NS_TEST_EXPECT_MSG_EQ (partitionHelper.GetPartition (Vector (0.9 * radius, 0.5 * radius, 0)),
+                         1, "Wrong partition close to the border of the cell on the right");
+
+  // Nodes are created in the partition of the cell they are placed in
+  Ptr<HexGridPositionAllocator> allocator = CreateObject<HexGridPositionAllocator> (radius);
+  NodeContainer nodes = partitionHelper.Create (allocator, 7);
+  NS_TEST_ASSERT_MSG_EQ (nodes.GetN (), 7u, "Wrong number of nodes");
+  uint32_t partitionSizes[2] = {0, 0};
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Vector position = nodes.Get (i)->GetObject<MobilityModel> ()->GetPosition ();
+      NS_TEST_EXPECT_MSG_EQ (nodes.Get (i)->GetSystemId (),
+                             partitionHelper.GetPartition (position),
+                             "Node was created in the wrong partition");
+      partitionSizes[nodes.Get (i)->GetSystemId ()]++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (partitionSizes[0], 3, "Wrong number of nodes in the central column");
+  NS_TEST_EXPECT_MSG_EQ (partitionSizes[1], 4, "Wrong number of nodes in the side columns");
+}
+
+/**********************************
+ * SpreadingFactorAssignmentTest *
+ **********************************/
+
+class SpreadingFactorAssignmentTest : public TestCase
+{
+public:
+  SpreadingFactorAssignmentTest ();
+  virtual ~SpreadingFactorAssignmentTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+SpreadingFactorAssignmentTest::SpreadingFactorAssignmentTest ()
+    : TestCase ("Verify that parallel and sequential SF assignment agree")
+{
+}
+
+// Reminder that the test case should clean up after itself
+SpreadingFactorAssignmentTest::~SpreadingFactorAssignmentTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+SpreadingFactorAssignmentTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("SpreadingFactorAssignmentTest");
+
+  // Enough devices and gateways to use several threads, if there are cores
+  Ptr<LoraChannel> channel = CreateChannel ();
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator",
+                                 "rho", DoubleValue (6000),
+                                 "X", DoubleValue (0.0),
+                                 "Y", DoubleValue (0.0));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  NodeContainer endDevices = CreateEndDevices (1500, mobility, channel);
+  NodeContainer gateways = CreateGateways (6, mobility, channel);
+
+  PointerValue lossValue;
+  channel->GetAttribute ("PropagationLossModel", lossValue);
+  Ptr<PropagationLossModel> loss = lossValue.Get<PropagationLossModel> ();
+  NS_TEST_EXPECT_MSG_EQ (LorawanMacHelper::IsLossModelThreadSafe (loss), true,
+                         "A distance based model should be thread safe");
+
+  std::vector<int> parallel = LorawanMacHelper::SetSpreadingFactorsUp (endDevices, gateways,
+                                                                      channel);
+  std::vector<uint8_t> parallelDataRates;
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      parallelDataRates.push_back
+        (GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (i))->GetDataRate ());
+    }
+
+  // A random model that doesn't change the power forces the sequential path
+  Ptr<RandomPropagationLossModel> random = CreateObject<RandomPropagationLossModel> ();
+  Ptr<ConstantRandomVariable> zero = CreateObject<ConstantRandomVariable> ();
+  zero->SetAttribute ("Constant", DoubleValue (0));
+  random->SetAttribute ("Variable", PointerValue (zero));
+  loss->SetNext (random);
+  NS_TEST_EXPECT_MSG_EQ (LorawanMacHelper::IsLossModelThreadSafe (loss), false,
+                         "A random model should not be thread safe");
+
+  std::vector<int> sequential = LorawanMacHelper::SetSpreadingFactorsUp (endDevices, gateways,
+                                                                        channel);
+
+  NS_TEST_ASSERT_MSG_EQ (parallel.size (), 7u, "Wrong size of the histogram");
+  int total = 0;
+  for (uint32_t sf = 0; sf < parallel.size (); sf++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (parallel[sf], sequential[sf], "Histograms differ");
+      total += parallel[sf];
+    }
+  NS_TEST_EXPECT_MSG_EQ (total, 1500, "Some devices were not counted");
+
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (unsigned (GetMacLayerFromNode<ClassAEndDeviceLorawanMac>
+                                         (endDevices.Get (i))->GetDataRate ()),
+                             unsigned (parallelDataRates[i]), "Data rates differ");
+    }
+
+  Simulator::Destroy ();
+}
+
+/******************************
+ * PeriodicSenderCalendarTest *
+ ******************************/
+
+class PeriodicSenderCalendarTest : public TestCase
+{
+public:
+  PeriodicSenderCalendarTest ();
+  virtual ~PeriodicSenderCalendarTest ();
+
+private:
+  virtual void DoRun (void);
+
+  std::vector<std::pair<Time, uint32_t> > RunScenario (bool calendar);
+  void CheckScheduled (Ptr<PeriodicSenderCalendar> calendar, uint32_t expected);
+  static void RecordSend (std::vector<std::pair<Time, uint32_t> > *sends, uint32_t node,
+                          Ptr<const Packet> packet);
+};
+
+// Add some help text to this case to describe what it is intended to test
+PeriodicSenderCalendarTest::PeriodicSenderCalendarTest ()
+    : TestCase ("Verify that PeriodicSenders driven by a calendar send at the same times")
+{
+}
+
+// Reminder that the test case should clean up after itself
+PeriodicSenderCalendarTest::~PeriodicSenderCalendarTest ()
+{
+}
+
+void
+PeriodicSenderCalendarTest::RecordSend (std::vector<std::pair<Time, uint32_t> > *sends,
+                                        uint32_t node, Ptr<const Packet> packet)
+{
+  sends->push_back (std::make_pair (Simulator::Now (), node));
+}
+
+void
+PeriodicSenderCalendarTest::CheckScheduled (Ptr<PeriodicSenderCalendar> calendar,
+                                            uint32_t expected)
+{
+  NS_TEST_EXPECT_MSG_EQ (calendar->GetNScheduled (), expected,
+                         "Unexpected number of scheduled transmissions at "
+                             << Simulator::Now ().GetSeconds () << " s");
+}
+
+// Run a network of devices with periodic applications, and return the time
+// of each packet sent by their MAC layers
+std::vector<std::pair<Time, uint32_t> >
+PeriodicSenderCalendarTest::RunScenario (bool calendar)
+{
+  Ptr<LoraChannel> channel = CreateChannel ();
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator",
+                                 "rho", DoubleValue (1000),
+                                 "X", DoubleValue (0.0),
+                                 "Y", DoubleValue (0.0));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  NodeContainer endDevices = CreateEndDevices (20, mobility, channel);
+
+  PeriodicSenderHelper appHelper;
+  appHelper.SetPeriod (Seconds (600));
+  if (calendar)
+    {
+      appHelper.EnableCalendar ();
+    }
+  ApplicationContainer apps = appHelper.Install (endDevices);
+
+  // The same initial delays in both runs, some of them in the same slot of
+  // the calendar and some more than a revolution of its wheel away
+  for (uint32_t i = 0; i < apps.GetN (); i++)
+    {
+      Time delay = Seconds (400 * i + 0.3 * (i % 5));
+      apps.Get (i)->GetObject<PeriodicSender> ()->SetInitialDelay (delay);
+    }
+  apps.Start (Seconds (0));
+  apps.Stop (Seconds (3600));
+
+  // Stop one application before its first packet
+  apps.Get (3)->SetStopTime (Seconds (1000));
+
+  std::vector<std::pair<Time, uint32_t> > sends;
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (i))
+          ->TraceConnectWithoutContext ("SentNewPacket",
+                                        MakeBoundCallback (&RecordSend, &sends, i));
+    }
+
+  if (calendar)
+    {
+      Ptr<PeriodicSenderCalendar> wheel = appHelper.GetCalendar ();
+      wheel->SetAttribute ("Slots", UintegerValue (1024));
+      Simulator::Schedule (Seconds (1800), &PeriodicSenderCalendarTest::CheckScheduled, this,
+                           wheel, 19);
+    }
+
+  Simulator::Stop (Seconds (4000));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::sort (sends.begin (), sends.end ());
+  return sends;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+PeriodicSenderCalendarTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("PeriodicSenderCalendarTest");
+
+  std::vector<std::pair<Time, uint32_t> > events = RunScenario (false);
+  std::vector<std::pair<Time, uint32_t> > calendar = RunScenario (true);
+
+  NS_TEST_ASSERT_MSG_EQ (calendar.size (), events.size (), "Different numbers of packets");
+  for (uint32_t i = 0; i < events.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (calendar[i].first, events[i].first, "Different sending times");
+      NS_TEST_EXPECT_MSG_EQ (calendar[i].second, events[i].second, "Different senders");
+    }
+}
+
+/*******************
+ * EnergyModelTest *
+ *******************/
+
+class EnergyModelTest : public TestCase
+{
+public:
+  EnergyModelTest ();
+  virtual ~EnergyModelTest ();
+
+private:
+  virtual void DoRun (void);
+
+  Ptr<LoraRadioEnergyModel> CreateModel (bool lazy, double initialEnergyJ,
+                                         Time updateInterval);
+  void RecordEnergy (void);
+  void QueryCurrent (void);
+  void EnergyDepleted (void);
+
+  Ptr<BasicEnergySource> m_source;
+  Ptr<LoraRadioEnergyModel> m_model;
+  double m_remainingEnergyJ;
+  double m_consumedEnergyJ;
+  Time m_depletionTime;
+};
+
+// Add some help text to this case to describe what it is intended to test
+EnergyModelTest::EnergyModelTest ()
+    : TestCase ("Verify that lazy energy updates consume the same energy and detect depletion")
+{
+}
+
+// Reminder that the test case should clean up after itself
+EnergyModelTest::~EnergyModelTest ()
+{
+}
+
+Ptr<LoraRadioEnergyModel>
+EnergyModelTest::CreateModel (bool lazy, double initialEnergyJ, Time updateInterval)
+{
+  m_source = CreateObject<BasicEnergySource> ();
+  m_source->SetAttribute ("BasicEnergySourceInitialEnergyJ", DoubleValue (initialEnergyJ));
+  m_source->SetAttribute ("BasicEnergySupplyVoltageV", DoubleValue (3.3));
+  m_source->SetAttribute ("PeriodicEnergyUpdateInterval", TimeValue (updateInterval));
+
+  m_model = CreateObject<LoraRadioEnergyModel> ();
+  m_model->SetAttribute ("LazyEnergyUpdates", BooleanValue (lazy));
+  m_model->SetEnergySource (m_source);
+  m_model->SetEnergyDepletionCallback (MakeCallback (&EnergyModelTest::EnergyDepleted, this));
+  m_source->AppendDeviceEnergyModel (m_model);
+
+  m_depletionTime = Seconds (0);
+  return m_model;
+}
+
+void
+EnergyModelTest::RecordEnergy (void)
+{
+  m_remainingEnergyJ = m_source->GetRemainingEnergy ();
+  m_consumedEnergyJ = m_model->GetTotalEnergyConsumption ();
+}
+
+void
+EnergyModelTest::QueryCurrent (void)
+{
+  m_model->GetCurrentA ();
+}
+
+void
+EnergyModelTest::EnergyDepleted (void)
+{
+  m_depletionTime = Simulator::Now ();
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+EnergyModelTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("EnergyModelTest");
+
+  // The states of an uplink with two receive windows, with periodic updates
+  // of the source falling in the middle of states, and queries of the
+  // current by others than the source in between
+  double remainingEnergyJ[2];
+  double consumedEnergyJ[2];
+  for (uint32_t lazy = 0; lazy < 2; lazy++)
+    {
+      Ptr<LoraRadioEnergyModel> model = CreateModel (lazy, 10000, Seconds (0.7));
+      Simulator::Schedule (Seconds (1), &LoraRadioEnergyModel::ChangeState, model,
+                           EndDeviceLoraPhy::STANDBY);
+      Simulator::Schedule (Seconds (2), &LoraRadioEnergyModel::ChangeState, model,
+                           EndDeviceLoraPhy::TX);
+      Simulator::Schedule (Seconds (3.2), &LoraRadioEnergyModel::ChangeState, model,
+                           EndDeviceLoraPhy::STANDBY);
+      Simulator::Schedule (Seconds (4.2), &LoraRadioEnergyModel::ChangeState, model,
+                           EndDeviceLoraPhy::RX);
+      Simulator::Schedule (Seconds (4.5), &LoraRadioEnergyModel::ChangeState, model,
+                           EndDeviceLoraPhy::STANDBY);
+      Simulator::Schedule (Seconds (5.2), &LoraRadioEnergyModel::ChangeState, model,
+                           EndDeviceLoraPhy::RX);
+      Simulator::Schedule (Seconds (5.5), &LoraRadioEnergyModel::ChangeState, model,
+                           EndDeviceLoraPhy::SLEEP);
+      Simulator::Schedule (Seconds (10), &LoraRadioEnergyModel::ChangeState, model,
+                           EndDeviceLoraPhy::SLEEP);
+      Simulator::Schedule (Seconds (2.5), &EnergyModelTest::QueryCurrent, this);
+      Simulator::Schedule (Seconds (4.3), &EnergyModelTest::QueryCurrent, this);
+      Simulator::Schedule (Seconds (4.3), &EnergyModelTest::QueryCurrent, this);
+      Simulator::Schedule (Seconds (10), &EnergyModelTest::RecordEnergy, this);
+      Simulator::Stop (Seconds (11));
+      Simulator::Run ();
+      Simulator::Destroy ();
+
+      remainingEnergyJ[lazy] = m_remainingEnergyJ;
+      consumedEnergyJ[lazy] = m_consumedEnergyJ;
+    }
+  NS_TEST_EXPECT_MSG_EQ_TOL (remainingEnergyJ[1], remainingEnergyJ[0], 1e-9,
+                             "Different remaining energy with lazy updates");
+  NS_TEST_EXPECT_MSG_EQ_TOL (consumedEnergyJ[1], consumedEnergyJ[0], 1e-9,
+                             "Different consumed energy with lazy updates");
+
+  // A long transmission depletes the source between its periodic updates:
+  // the threshold of 10% of the energy is crossed after 0.9 J are consumed
+  Ptr<LoraRadioEnergyModel> model = CreateModel (true, 1, Seconds (1000));
+  Simulator::Schedule (Seconds (1), &LoraRadioEnergyModel::ChangeState, model,
+                       EndDeviceLoraPhy::TX);
+  Simulator::Stop (Seconds (20));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  double expectedS = 1 + 0.9 / (model->GetTxCurrentA () * 3.3);
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_depletionTime.GetSeconds (), expectedS, 1e-3,
+                             "Depletion was not detected when the threshold was crossed");
+
+  m_source = 0;
+  m_model = 0;
+}
+
 /*****************
  * LorawanMacTest *
  *****************/
@@ -1412,12 +3393,28 @@ LorawanTestSuite::LorawanTestSuite () : TestSuite ("lorawan", UNIT)
   LogComponentEnable ("LorawanTestSuite", LOG_LEVEL_DEBUG);
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new InterferenceTest, TestCase::QUICK);
+  AddTestCase (new InterferenceCleaningTest, TestCase::QUICK);
   AddTestCase (new AddressTest, TestCase::QUICK);
   AddTestCase (new HeaderTest, TestCase::QUICK);
   AddTestCase (new ReceivePathTest, TestCase::QUICK);
+  AddTestCase (new GatewayReceptionPathsTest, TestCase::QUICK);
   AddTestCase (new LogicalLoraChannelTest, TestCase::QUICK);
   AddTestCase (new TimeOnAirTest, TestCase::QUICK);
   AddTestCase (new PhyConnectivityTest, TestCase::QUICK);
+  AddTestCase (new ChannelLossTest, TestCase::QUICK);
+  AddTestCase (new ChannelCullingTest, TestCase::QUICK);
+  AddTestCase (new ChannelInterferenceLogTest, TestCase::QUICK);
+  AddTestCase (new GatewayTransmissionInterferenceTest, TestCase::QUICK);
+  AddTestCase (new ShadowingStorageTest, TestCase::QUICK);
+  AddTestCase (new MqttTopicTrieTest, TestCase::QUICK);
+  AddTestCase (new PacketTrackerTest, TestCase::QUICK);
+  AddTestCase (new BinaryTraceTest, TestCase::QUICK);
+  AddTestCase (new TraceDispatcherTest, TestCase::QUICK);
+  AddTestCase (new CampaignHelperTest, TestCase::QUICK);
+  AddTestCase (new PartitionHelperTest, TestCase::QUICK);
+  AddTestCase (new SpreadingFactorAssignmentTest, TestCase::QUICK);
+  AddTestCase (new PeriodicSenderCalendarTest, TestCase::QUICK);
+  AddTestCase (new EnergyModelTest, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
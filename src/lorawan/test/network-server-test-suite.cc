@@ -15,6 +15,11 @@
 #include "ns3/callback.h"
 #include "ns3/network-server.h"
 #include "ns3/network-server-helper.h"
+#include "ns3/uplink-context.h"
+#include "ns3/broker.h"
+#include "ns3/broker-helper.h"
+#include "ns3/one-shot-sender-helper.h"
+#include "ns3/lora-device-address-generator.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -267,6 +272,426 @@ LinkCheckTest::DoRun (void)
   NS_ASSERT (m_receivedPacketAtEd);
 }
 
+///////////////////////
+// UplinkContextTest //
+///////////////////////
+
+class UplinkContextTest : public TestCase
+{
+public:
+  UplinkContextTest ();
+  virtual ~UplinkContextTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+UplinkContextTest::UplinkContextTest ()
+  : TestCase ("Verify that UplinkContext parses the headers and tag of an"
+              " uplink packet without modifying it")
+{
+}
+
+// Reminder that the test case should clean up after itself
+UplinkContextTest::~UplinkContextTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+UplinkContextTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("UplinkContextTest");
+
+  // Build a packet like a gateway forwards it to the network server
+  Ptr<Packet> packet = Create<Packet> (20);
+
+  LoraFrameHeader frameHdr;
+  frameHdr.SetAsUplink ();
+  frameHdr.SetAddress (LoraDeviceAddress (0x01020304));
+  frameHdr.SetFCnt (42);
+  frameHdr.SetAdr (true);
+  packet->AddHeader (frameHdr);
+
+  LorawanMacHeader macHdr;
+  macHdr.SetMType (LorawanMacHeader::CONFIRMED_DATA_UP);
+  packet->AddHeader (macHdr);
+
+  LoraTag tag;
+  tag.SetSpreadingFactor (9);
+  tag.SetReceivePower (-110);
+  packet->AddPacketTag (tag);
+
+  uint32_t size = packet->GetSize ();
+
+  UplinkContext uplink (packet);
+
+  NS_TEST_EXPECT_MSG_EQ (uplink.packet, packet, "The context doesn't refer to the packet");
+  NS_TEST_EXPECT_MSG_EQ (packet->GetSize (), size, "The packet was modified");
+  NS_TEST_EXPECT_MSG_EQ (uplink.payload->GetSize (), 20u, "Unexpected payload size");
+
+  NS_TEST_EXPECT_MSG_EQ (unsigned (uplink.macHeader.GetMType ()),
+                         unsigned (LorawanMacHeader::CONFIRMED_DATA_UP),
+                         "Unexpected message type");
+  NS_TEST_EXPECT_MSG_EQ (uplink.frameHeader.GetAddress (), LoraDeviceAddress (0x01020304),
+                         "Unexpected device address");
+  NS_TEST_EXPECT_MSG_EQ (uplink.frameHeader.GetFCnt (), 42, "Unexpected frame counter");
+  NS_TEST_EXPECT_MSG_EQ (uplink.frameHeader.GetAdr (), true, "Unexpected ADR bit");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (uplink.tag.GetSpreadingFactor ()), 9,
+                         "Unexpected spreading factor");
+  NS_TEST_EXPECT_MSG_EQ_TOL (uplink.tag.GetReceivePower (), -110, 1e-9,
+                             "Unexpected receive power");
+
+  // The packet can still be parsed by components that need the headers
+  LorawanMacHeader peekedMacHdr;
+  packet->PeekHeader (peekedMacHdr);
+  NS_TEST_EXPECT_MSG_EQ (unsigned (peekedMacHdr.GetMType ()),
+                         unsigned (LorawanMacHeader::CONFIRMED_DATA_UP),
+                         "The MAC header was removed from the packet");
+}
+
+/////////////////////////
+// BrokerMulticastTest //
+/////////////////////////
+
+class BrokerMulticastTest : public TestCase
+{
+public:
+  BrokerMulticastTest ();
+  virtual ~BrokerMulticastTest ();
+
+  void GatewaySentPacket (std::string context, Ptr<Packet const> packet);
+  void DeviceReceivedPacket (std::string context, Ptr<Packet const> packet);
+
+private:
+  virtual void DoRun (void);
+  Time m_publishTime;
+  std::map<std::string, int> m_gatewayDownlinks;
+  std::map<std::string, int> m_deviceReceptions;
+};
+
+// Add some help text to this case to describe what it is intended to test
+BrokerMulticastTest::BrokerMulticastTest ()
+  : TestCase ("Verify that in multicast mode a publish reaches every member of"
+              " the topic's group with one downlink for each gateway")
+{
+}
+
+// Reminder that the test case should clean up after itself
+BrokerMulticastTest::~BrokerMulticastTest ()
+{
+}
+
+void
+BrokerMulticastTest::GatewaySentPacket (std::string context, Ptr<Packet const> packet)
+{
+  if (Simulator::Now () >= m_publishTime)
+    {
+      m_gatewayDownlinks[context]++;
+    }
+}
+
+void
+BrokerMulticastTest::DeviceReceivedPacket (std::string context, Ptr<Packet const> packet)
+{
+  m_deviceReceptions[context]++;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+BrokerMulticastTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("BrokerMulticastTest");
+
+  m_publishTime = Seconds (100);
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+  LoraHelper helper = LoraHelper ();
+
+  // Two gateways too far apart to hear each other's devices, each with two
+  // subscribers close to it. The publisher is the first device.
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator> ();
+  positions->Add (Vector (0, 100, 0));
+  positions->Add (Vector (100, 0, 0));
+  positions->Add (Vector (0, -100, 0));
+  positions->Add (Vector (20000, 100, 0));
+  positions->Add (Vector (20000, -100, 0));
+  positions->Add (Vector (0, 0, 15));
+  positions->Add (Vector (20000, 0, 15));
+  mobility.SetPositionAllocator (positions);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  NodeContainer endDevices;
+  endDevices.Create (5);
+  mobility.Install (endDevices);
+
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_C);
+  macHelper.SetAddressGenerator (CreateObject<LoraDeviceAddressGenerator> (54, 1864));
+  macHelper.SetRegion (LorawanMacHelper::EU);
+  helper.Install (phyHelper, macHelper, endDevices);
+
+  NodeContainer gateways;
+  gateways.Create (2);
+  mobility.Install (gateways);
+
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel);
+
+  NodeContainer brokers;
+  brokers.Create (1);
+  BrokerServerHelper brokerHelper;
+  brokerHelper.SetAttribute ("DownlinkMode", EnumValue (BrokerServer::MULTICAST));
+  brokerHelper.SetGateways (gateways);
+  brokerHelper.SetEndDevices (endDevices);
+  Ptr<BrokerServer> broker = DynamicCast<BrokerServer> (brokerHelper.Install (brokers).Get (0));
+  broker->SetMulticastGroup ("alerts", LoraDeviceAddress (0x7E, 1));
+
+  ForwarderHelper forwarderHelper;
+  forwarderHelper.Install (gateways);
+
+  // The subscriptions are spaced so that they don't collide
+  OneShotSenderHelper senderHelper;
+  senderHelper.SetAttribute ("Topic", StringValue ("alerts"));
+  senderHelper.SetAttribute ("Option", IntegerValue (0));
+  for (uint32_t i = 1; i < endDevices.GetN (); i++)
+    {
+      senderHelper.SetSendTime (Seconds (10 * i));
+      senderHelper.Install (endDevices.Get (i));
+    }
+  senderHelper.SetAttribute ("Option", IntegerValue (1));
+  senderHelper.SetAttribute ("Payload", StringValue ("message"));
+  senderHelper.SetSendTime (m_publishTime);
+  senderHelper.Install (endDevices.Get (0));
+
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      std::ostringstream context;
+      context << i;
+      endDevices.Get (i)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac ()->TraceConnect (
+          "ReceivedPacket", context.str (),
+          MakeCallback (&BrokerMulticastTest::DeviceReceivedPacket, this));
+    }
+  for (uint32_t i = 0; i < gateways.GetN (); i++)
+    {
+      std::ostringstream context;
+      context << i;
+      gateways.Get (i)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac ()->TraceConnect (
+          "SentNewPacket", context.str (),
+          MakeCallback (&BrokerMulticastTest::GatewaySentPacket, this));
+    }
+
+  Simulator::Stop (m_publishTime + Seconds (60));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_gatewayDownlinks["0"], 1,
+                         "The first gateway didn't send exactly one downlink");
+  NS_TEST_EXPECT_MSG_EQ (m_gatewayDownlinks["1"], 1,
+                         "The second gateway didn't send exactly one downlink");
+  for (uint32_t i = 1; i < endDevices.GetN (); i++)
+    {
+      std::ostringstream context;
+      context << i;
+      NS_TEST_EXPECT_MSG_EQ (m_deviceReceptions[context.str ()], 1,
+                             "Subscriber " << i << " didn't receive the publish once");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_deviceReceptions["0"], 0, "The publisher received a downlink");
+}
+
+//////////////////////
+// BrokerFanOutTest //
+//////////////////////
+
+class BrokerFanOutTest : public TestCase
+{
+public:
+  BrokerFanOutTest ();
+  virtual ~BrokerFanOutTest ();
+
+  void GatewaySentPacket (std::string context, Ptr<Packet const> packet);
+  void DeviceReceivedPacket (std::string context, Ptr<Packet const> packet);
+
+private:
+  virtual void DoRun (void);
+  Time m_publishTime;
+  std::vector<std::pair<std::string, LoraDeviceAddress> > m_downlinks;
+  std::map<std::string, int> m_deviceReceptions;
+};
+
+// Add some help text to this case to describe what it is intended to test
+BrokerFanOutTest::BrokerFanOutTest ()
+  : TestCase ("Verify that in unicast mode a publish reaches every subscriber"
+              " with one downlink, through its gateway and in subscription order")
+{
+}
+
+// Reminder that the test case should clean up after itself
+BrokerFanOutTest::~BrokerFanOutTest ()
+{
+}
+
+void
+BrokerFanOutTest::GatewaySentPacket (std::string context, Ptr<Packet const> packet)
+{
+  if (Simulator::Now () < m_publishTime)
+    {
+      return;
+    }
+
+  Ptr<Packet> copy = packet->Copy ();
+  LorawanMacHeader mHdr;
+  copy->RemoveHeader (mHdr);
+  LoraFrameHeader fHdr;
+  fHdr.SetAsDownlink ();
+  copy->RemoveHeader (fHdr);
+  m_downlinks.push_back (std::make_pair (context, fHdr.GetAddress ()));
+}
+
+void
+BrokerFanOutTest::DeviceReceivedPacket (std::string context, Ptr<Packet const> packet)
+{
+  m_deviceReceptions[context]++;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+BrokerFanOutTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("BrokerFanOutTest");
+
+  m_publishTime = Seconds (100);
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+  LoraHelper helper = LoraHelper ();
+
+  // Two gateways too far apart to hear each other's devices. The publisher
+  // is the first device, and the others subscribe in order: two close to
+  // the first gateway, then two close to the second one.
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator> ();
+  positions->Add (Vector (0, 100, 0));
+  positions->Add (Vector (100, 0, 0));
+  positions->Add (Vector (0, -100, 0));
+  positions->Add (Vector (20000, 100, 0));
+  positions->Add (Vector (20000, -100, 0));
+  positions->Add (Vector (0, 0, 15));
+  positions->Add (Vector (20000, 0, 15));
+  mobility.SetPositionAllocator (positions);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  NodeContainer endDevices;
+  endDevices.Create (5);
+  mobility.Install (endDevices);
+
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_C);
+  macHelper.SetAddressGenerator (CreateObject<LoraDeviceAddressGenerator> (54, 1864));
+  macHelper.SetRegion (LorawanMacHelper::EU);
+  helper.Install (phyHelper, macHelper, endDevices);
+
+  NodeContainer gateways;
+  gateways.Create (2);
+  mobility.Install (gateways);
+
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel);
+
+  // The delay leaves the gateways enough duty cycle for each downlink
+  NodeContainer brokers;
+  brokers.Create (1);
+  BrokerServerHelper brokerHelper;
+  brokerHelper.SetAttribute ("DownlinkMode", EnumValue (BrokerServer::UNICAST));
+  brokerHelper.SetAttribute ("pubDelay", DoubleValue (20));
+  brokerHelper.SetGateways (gateways);
+  brokerHelper.SetEndDevices (endDevices);
+  brokerHelper.Install (brokers);
+
+  ForwarderHelper forwarderHelper;
+  forwarderHelper.Install (gateways);
+
+  // The subscriptions are spaced so that they don't collide
+  OneShotSenderHelper senderHelper;
+  senderHelper.SetAttribute ("Topic", StringValue ("alerts"));
+  senderHelper.SetAttribute ("Option", IntegerValue (0));
+  for (uint32_t i = 1; i < endDevices.GetN (); i++)
+    {
+      senderHelper.SetSendTime (Seconds (10 * i));
+      senderHelper.Install (endDevices.Get (i));
+    }
+  senderHelper.SetAttribute ("Option", IntegerValue (1));
+  senderHelper.SetAttribute ("Payload", StringValue ("message"));
+  senderHelper.SetSendTime (m_publishTime);
+  senderHelper.Install (endDevices.Get (0));
+
+  std::vector<LoraDeviceAddress> addresses;
+  for (uint32_t i = 0; i < endDevices.GetN (); i++)
+    {
+      std::ostringstream context;
+      context << i;
+      Ptr<LorawanMac> mac = endDevices.Get (i)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac ();
+      mac->TraceConnect ("ReceivedPacket", context.str (),
+                         MakeCallback (&BrokerFanOutTest::DeviceReceivedPacket, this));
+      addresses.push_back (mac->GetObject<EndDeviceLorawanMac> ()->GetDeviceAddress ());
+    }
+  for (uint32_t i = 0; i < gateways.GetN (); i++)
+    {
+      std::ostringstream context;
+      context << i;
+      gateways.Get (i)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac ()->TraceConnect (
+          "SentNewPacket", context.str (),
+          MakeCallback (&BrokerFanOutTest::GatewaySentPacket, this));
+    }
+
+  Simulator::Stop (m_publishTime + Seconds (60));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // The first downlink of each gateway goes right away, in the order of
+  // their first subscribers, and the second one after the delay
+  std::vector<std::pair<std::string, LoraDeviceAddress> > expected;
+  expected.push_back (std::make_pair ("0", addresses[1]));
+  expected.push_back (std::make_pair ("1", addresses[3]));
+  expected.push_back (std::make_pair ("0", addresses[2]));
+  expected.push_back (std::make_pair ("1", addresses[4]));
+  NS_TEST_ASSERT_MSG_EQ (m_downlinks.size (), expected.size (),
+                         "The publish didn't produce one downlink for each subscriber");
+  for (uint32_t i = 0; i < expected.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_downlinks[i].first, expected[i].first,
+                             "Downlink " << i << " went through the wrong gateway");
+      NS_TEST_EXPECT_MSG_EQ ((m_downlinks[i].second == expected[i].second), true,
+                             "Downlink " << i << " went to the wrong subscriber");
+    }
+  for (uint32_t i = 1; i < endDevices.GetN (); i++)
+    {
+      std::ostringstream context;
+      context << i;
+      NS_TEST_EXPECT_MSG_EQ (m_deviceReceptions[context.str ()], 1,
+                             "Subscriber " << i << " didn't receive the publish once");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_deviceReceptions["0"], 0, "The publisher received a downlink");
+}
+
 /**************
  * Test Suite *
  **************/
@@ -305,6 +730,9 @@ NetworkServerTestSuite::NetworkServerTestSuite ()
   AddTestCase (new UplinkPacketTest, TestCase::QUICK);
   AddTestCase (new DownlinkPacketTest, TestCase::QUICK);
   AddTestCase (new LinkCheckTest, TestCase::QUICK);
+  AddTestCase (new UplinkContextTest, TestCase::QUICK);
+  AddTestCase (new BrokerMulticastTest, TestCase::QUICK);
+  AddTestCase (new BrokerFanOutTest, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
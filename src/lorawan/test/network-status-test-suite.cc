@@ -12,6 +12,12 @@
 #include "ns3/log.h"
 #include "ns3/end-device-status.h"
 #include "ns3/network-status.h"
+#include "ns3/lora-tag.h"
+#include "ns3/uinteger.h"
+#include "ns3/mac48-address.h"
+#include "ns3/gateway-status.h"
+#include "ns3/gateway-lorawan-mac.h"
+#include <algorithm>
 #include "utilities.h"
 
 // An essential include is test.h
@@ -26,6 +32,21 @@ NS_LOG_COMPONENT_DEFINE ("NetworkStatusTestSuite");
 // EndDeviceStatus testing //
 /////////////////////////////
 
+// Create an entry of the received packet history, with a packet of the given
+// size and frame counter
+static EndDeviceStatus::ReceivedPacketList::Entry
+CreateHistoryEntry (uint16_t fCnt, uint32_t size)
+{
+  Ptr<Packet> packet = Create<Packet> (size);
+  EndDeviceStatus::ReceivedPacketInfo info;
+  info.packet = packet;
+  info.sf = 7;
+  info.frequency = 868.1;
+  info.frameHeader.SetAsUplink ();
+  info.frameHeader.SetFCnt (fCnt);
+  return EndDeviceStatus::ReceivedPacketList::Entry (packet, info);
+}
+
 class EndDeviceStatusTest : public TestCase
 {
 public:
@@ -56,6 +77,190 @@ EndDeviceStatusTest::DoRun (void)
 
   // Create an EndDeviceStatus object
   EndDeviceStatus eds = EndDeviceStatus ();
+
+  // Check that the history of received packets is bounded
+  Ptr<EndDeviceStatus> status = CreateObject<EndDeviceStatus> ();
+  status->SetAttribute ("ReceivedPacketHistorySize", UintegerValue (3));
+
+  for (uint16_t fCnt = 0; fCnt < 5; fCnt++)
+    {
+      Ptr<Packet> packet = Create<Packet> (10);
+      LoraTag tag;
+      tag.SetSpreadingFactor (7);
+      packet->AddPacketTag (tag);
+      LoraFrameHeader frameHdr;
+      frameHdr.SetAsUplink ();
+      frameHdr.SetFCnt (fCnt);
+      packet->AddHeader (frameHdr);
+      LorawanMacHeader macHdr;
+      macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+      packet->AddHeader (macHdr);
+      status->InsertReceivedPacket (packet, Address ());
+
+      // A second reception of the same packet must not add a new entry
+      status->InsertReceivedPacket (packet, Address ());
+    }
+
+  const EndDeviceStatus::ReceivedPacketList &list = status->GetReceivedPacketList ();
+  NS_TEST_EXPECT_MSG_EQ (list.GetSize (), 3, "History was not bounded");
+
+  // The most recent packet should be the last one that was inserted
+  Ptr<Packet> last = list.Back ().first->Copy ();
+  LorawanMacHeader macHdr;
+  last->RemoveHeader (macHdr);
+  LoraFrameHeader frameHdr;
+  frameHdr.SetAsUplink ();
+  last->RemoveHeader (frameHdr);
+  NS_TEST_EXPECT_MSG_EQ (frameHdr.GetFCnt (), 4, "Wrong most recent packet");
+
+  // Growing the history keeps the stored packets
+  status->ReserveReceivedPacketHistory (10);
+  NS_TEST_EXPECT_MSG_EQ (list.GetSize (), 3, "Packets were lost when growing");
+  NS_TEST_EXPECT_MSG_EQ (status->GetReceivedPacketHistorySize (), 10,
+                         "History was not grown");
+
+  // Check that the reception power is combined over gateways, and that the
+  // most recent values are contiguous even after the history wraps around
+  status = CreateObject<EndDeviceStatus> ();
+  status->SetAttribute ("ReceivedPacketHistorySize", UintegerValue (3));
+  Address firstGw = Mac48Address ("00:00:00:00:00:01");
+  Address secondGw = Mac48Address ("00:00:00:00:00:02");
+
+  for (uint16_t fCnt = 0; fCnt < 5; fCnt++)
+    {
+      Ptr<Packet> packet = Create<Packet> (10);
+      LoraFrameHeader frameHdr;
+      frameHdr.SetAsUplink ();
+      frameHdr.SetFCnt (fCnt);
+      packet->AddHeader (frameHdr);
+      LorawanMacHeader macHdr;
+      macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+      packet->AddHeader (macHdr);
+
+      LoraTag tag;
+      tag.SetSpreadingFactor (7);
+      tag.SetReceivePower (-100.0 - fCnt);
+      Ptr<Packet> firstCopy = packet->Copy ();
+      firstCopy->AddPacketTag (tag);
+      status->InsertReceivedPacket (firstCopy, firstGw);
+
+      tag.SetReceivePower (-90.0 - fCnt);
+      Ptr<Packet> secondCopy = packet->Copy ();
+      secondCopy->AddPacketTag (tag);
+      status->InsertReceivedPacket (secondCopy, secondGw);
+    }
+
+  const EndDeviceStatus::ReceivedPacketList &powerList = status->GetReceivedPacketList ();
+  const double *minPower = powerList.GetRxPowerHistory
+      (EndDeviceStatus::ReceivedPacketList::MIN_RX_POWER, 3);
+  const double *maxPower = powerList.GetRxPowerHistory
+      (EndDeviceStatus::ReceivedPacketList::MAX_RX_POWER, 3);
+  const double *averagePower = powerList.GetRxPowerHistory
+      (EndDeviceStatus::ReceivedPacketList::AVERAGE_RX_POWER, 3);
+  for (uint16_t i = 0; i < 3; i++)
+    {
+      // The oldest remembered packet has frame counter 2
+      NS_TEST_EXPECT_MSG_EQ (minPower[i], -102.0 - i, "Wrong minimum power");
+      NS_TEST_EXPECT_MSG_EQ (maxPower[i], -92.0 - i, "Wrong maximum power");
+      NS_TEST_EXPECT_MSG_EQ (averagePower[i], -97.0 - i, "Wrong average power");
+    }
+
+  // Check that the gateways of the last packet are ranked by power, and that
+  // receptions of older packets don't affect the ranking
+  Address thirdGw = Mac48Address ("00:00:00:00:00:03");
+  for (uint16_t fCnt = 3; fCnt < 5; fCnt++)
+    {
+      Ptr<Packet> packet = Create<Packet> (10);
+      LoraFrameHeader frameHdr;
+      frameHdr.SetAsUplink ();
+      frameHdr.SetFCnt (fCnt);
+      packet->AddHeader (frameHdr);
+      LorawanMacHeader macHdr;
+      macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+      packet->AddHeader (macHdr);
+
+      // Same power as the second gateway for the last packet
+      LoraTag tag;
+      tag.SetSpreadingFactor (7);
+      tag.SetReceivePower (fCnt == 4 ? -94.0 : -50.0);
+      packet->AddPacketTag (tag);
+      status->InsertReceivedPacket (packet, thirdGw);
+    }
+
+  const std::vector<EndDeviceStatus::RankedGateway> &ranking = status->GetRankedGateways ();
+  NS_TEST_ASSERT_MSG_EQ (ranking.size (), 3u, "Wrong number of ranked gateways");
+  NS_TEST_EXPECT_MSG_EQ (ranking[0].gwAddress, secondGw, "Wrong best gateway");
+  NS_TEST_EXPECT_MSG_EQ (ranking[1].gwAddress, thirdGw,
+                         "Gateways with the same power are not sorted by address");
+  NS_TEST_EXPECT_MSG_EQ (ranking[2].gwAddress, firstGw, "Wrong worst gateway");
+  NS_TEST_EXPECT_MSG_EQ (ranking[2].rxPower, -104.0, "Wrong power of ranked gateway");
+
+  // Check that packets are found by frame counter, and that the index
+  // follows the ring as it overwrites and resizes. Each packet has a
+  // different size, to tell apart packets with the same frame counter.
+  EndDeviceStatus::ReceivedPacketList ring (3);
+  ring.PushBack (CreateHistoryEntry (1, 11));
+  ring.PushBack (CreateHistoryEntry (2, 12));
+  ring.PushBack (CreateHistoryEntry (3, 13));
+  NS_TEST_ASSERT_MSG_NE (ring.Find (2), 0, "Stored packet not found");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (2)->first->GetSize (), 12u, "Wrong packet found");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (9), 0, "Packet that was never stored found");
+
+  // The ring overwrites the packet with frame counter 1, and the most recent
+  // packet with frame counter 2 is the new one
+  ring.PushBack (CreateHistoryEntry (2, 14));
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (1), 0, "Overwritten packet found");
+  NS_TEST_ASSERT_MSG_NE (ring.Find (2), 0, "Stored packet not found");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (2)->first->GetSize (), 14u, "Older duplicate found");
+
+  // Overwriting the older packet with frame counter 2 keeps the newer one
+  ring.PushBack (CreateHistoryEntry (5, 15));
+  NS_TEST_ASSERT_MSG_NE (ring.Find (2), 0, "Newer duplicate was forgotten");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (2)->first->GetSize (), 14u, "Wrong packet found");
+  NS_TEST_ASSERT_MSG_NE (ring.Find (3), 0, "Stored packet not found");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (3)->first->GetSize (), 13u, "Wrong packet found");
+
+  ring.PushBack (CreateHistoryEntry (6, 16));
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (3), 0, "Overwritten packet found");
+
+  // Receptions are added to the packet that was found
+  EndDeviceStatus::PacketInfoPerGw gwInfo;
+  gwInfo.gwAddress = firstGw;
+  gwInfo.receivedTime = Seconds (0);
+  gwInfo.rxPower = -100;
+  NS_TEST_EXPECT_MSG_EQ (ring.AddGatewayReception (5, gwInfo), true,
+                         "Reception of a stored packet not added");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (5)->second.gwList.size (), 1u,
+                         "Reception added to the wrong packet");
+  NS_TEST_EXPECT_MSG_EQ (ring.AddGatewayReception (3, gwInfo), false,
+                         "Reception of an overwritten packet added");
+
+  // Shrinking keeps the most recent packets, and only indexes those
+  ring.SetCapacity (2);
+  NS_TEST_EXPECT_MSG_EQ (ring.GetSize (), 2u, "Wrong size after shrinking");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (2), 0, "Forgotten packet found after shrinking");
+  NS_TEST_ASSERT_MSG_NE (ring.Find (5), 0, "Stored packet not found after shrinking");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (5)->first->GetSize (), 15u, "Wrong packet found");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (5)->second.gwList.size (), 1u,
+                         "Reception lost after shrinking");
+  NS_TEST_ASSERT_MSG_NE (ring.Find (6), 0, "Stored packet not found after shrinking");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (6)->first->GetSize (), 16u, "Wrong packet found");
+
+  // Growing keeps the index, which still follows the ring once it's full
+  ring.SetCapacity (4);
+  ring.PushBack (CreateHistoryEntry (7, 17));
+  ring.PushBack (CreateHistoryEntry (8, 18));
+  NS_TEST_EXPECT_MSG_EQ (ring.GetSize (), 4u, "Wrong size after growing");
+  NS_TEST_ASSERT_MSG_NE (ring.Find (5), 0, "Stored packet not found after growing");
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (5)->first->GetSize (), 15u, "Wrong packet found");
+  ring.PushBack (CreateHistoryEntry (9, 19));
+  NS_TEST_EXPECT_MSG_EQ (ring.Find (5), 0, "Overwritten packet found after growing");
+  for (uint16_t fCnt = 6; fCnt <= 9; fCnt++)
+    {
+      NS_TEST_ASSERT_MSG_NE (ring.Find (fCnt), 0, "Stored packet not found after growing");
+      NS_TEST_EXPECT_MSG_EQ (ring.Find (fCnt)->first->GetSize (), 10u + fCnt,
+                             "Wrong packet found after growing");
+    }
 }
 
 /////////////////////////////
@@ -104,6 +309,259 @@ NetworkStatusTest::DoRun (void)
   ns.AddNode (GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (0)));
 }
 
+/////////////////////////////////////
+// Downlink scheduling helpers     //
+/////////////////////////////////////
+
+// Create a gateway with the given duty cycle on all sub-bands, and add it to
+// the NetworkStatus
+static Ptr<GatewayLorawanMac>
+AddGatewayWithDutyCycle (Ptr<NetworkStatus> status, Ptr<LoraChannel> channel,
+                         double dutyCycle, Address &address)
+{
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  macHelper.SetDutyCycle (dutyCycle);
+
+  NodeContainer gateways;
+  gateways.Create (1);
+  mobility.Install (gateways);
+  LoraHelper ().Install (phyHelper, macHelper, gateways);
+
+  Ptr<GatewayLorawanMac> mac = GetMacLayerFromNode<GatewayLorawanMac> (gateways.Get (0));
+  address = Mac48Address::Allocate ();
+  status->AddGateway (address, Create<GatewayStatus> (address, gateways.Get (0)->GetDevice (0),
+                                                      mac));
+  return mac;
+}
+
+// Make a gateway send a downlink
+static void
+SendDownlink (Ptr<GatewayLorawanMac> mac, uint8_t dataRate, double frequency, uint32_t size)
+{
+  Ptr<Packet> packet = Create<Packet> (size);
+  LoraTag tag;
+  tag.SetDataRate (dataRate);
+  tag.SetFrequency (frequency);
+  packet->AddPacketTag (tag);
+  mac->Send (packet);
+}
+
+// Get the duration of a downlink sent by a gateway
+static Time
+GetDownlinkDuration (Ptr<GatewayLorawanMac> mac, uint8_t dataRate, uint32_t size)
+{
+  // Use the same parameters as GatewayLorawanMac::Send
+  LoraTxParameters params;
+  params.sf = mac->GetSfFromDataRate (dataRate);
+  params.headerDisabled = false;
+  params.codingRate = 1;
+  params.bandwidthHz = mac->GetBandwidthFromDataRate (dataRate);
+  params.nPreamble = 8;
+  params.crcEnabled = 1;
+  params.lowDataRateOptimizationEnabled = LoraPhy::GetTSym (params) > MilliSeconds (16);
+  return LoraPhy::GetOnAirTime (size, params);
+}
+
+//////////////////////////////////
+// EarliestAvailableGatewayTest //
+//////////////////////////////////
+
+class EarliestAvailableGatewayTest : public TestCase
+{
+public:
+  EarliestAvailableGatewayTest ();
+  virtual ~EarliestAvailableGatewayTest ();
+
+private:
+  virtual void DoRun (void);
+  void CheckEarliest (double frequency, Address expectedGw, Time expectedTime);
+
+  Ptr<NetworkStatus> m_status;
+};
+
+// Add some help text to this case to describe what it is intended to test
+EarliestAvailableGatewayTest::EarliestAvailableGatewayTest ()
+  : TestCase ("Verify that NetworkStatus finds the gateway that is available"
+              " first, according to transmissions and duty cycle")
+{
+}
+
+// Reminder that the test case should clean up after itself
+EarliestAvailableGatewayTest::~EarliestAvailableGatewayTest ()
+{
+}
+
+void
+EarliestAvailableGatewayTest::CheckEarliest (double frequency, Address expectedGw,
+                                             Time expectedTime)
+{
+  Time availableTime;
+  Address gwAddress = m_status->GetEarliestAvailableGateway (frequency, availableTime);
+  NS_TEST_EXPECT_MSG_EQ ((gwAddress == expectedGw), true,
+                         "Wrong earliest gateway at " << Simulator::Now ().GetSeconds ()
+                                                      << " s on " << frequency << " MHz");
+  NS_TEST_EXPECT_MSG_EQ_TOL (availableTime.GetSeconds (), expectedTime.GetSeconds (), 1e-6,
+                             "Wrong available time at " << Simulator::Now ().GetSeconds ()
+                                                        << " s on " << frequency << " MHz");
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+EarliestAvailableGatewayTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("EarliestAvailableGatewayTest");
+
+  m_status = CreateObject<NetworkStatus> ();
+  Ptr<LoraChannel> channel = CreateChannel ();
+  Address slowAddress;
+  Address fastAddress;
+  Ptr<GatewayLorawanMac> slowMac = AddGatewayWithDutyCycle (m_status, channel, 0.5, slowAddress);
+  Ptr<GatewayLorawanMac> fastMac = AddGatewayWithDutyCycle (m_status, channel, 0.1, fastAddress);
+
+  // The slow gateway sends a long packet with a loose duty cycle, the fast
+  // one a short packet with a tight duty cycle
+  Time slowDuration = GetDownlinkDuration (slowMac, 0, 30);
+  Time fastDuration = GetDownlinkDuration (fastMac, 5, 10);
+  NS_TEST_ASSERT_MSG_LT (9 * fastDuration.GetSeconds () + 0.001, slowDuration.GetSeconds (),
+                         "The fast gateway's duty cycle must end before the slow gateway's");
+  Simulator::Schedule (Seconds (1), &SendDownlink, slowMac, 0, 869.525, 30);
+  Simulator::Schedule (Seconds (1), &SendDownlink, fastMac, 5, 869.525, 10);
+
+  Time fastEnd = Seconds (1) + fastDuration;
+  Time fastDutyCycleEnd = Seconds (1 + 9 * fastDuration.GetSeconds ());
+
+  // On the sub-band they used, the duty cycle of the fast gateway ends
+  // before the slow gateway's transmission and duty cycle
+  Simulator::Schedule (Seconds (1), &EarliestAvailableGatewayTest::CheckEarliest, this,
+                       869.525, fastAddress, fastDutyCycleEnd);
+
+  // On the other sub-bands, only the ongoing transmissions count
+  Simulator::Schedule (Seconds (1), &EarliestAvailableGatewayTest::CheckEarliest, this,
+                       868.1, fastAddress, fastEnd);
+
+  // After its transmission, the fast gateway is available on the other
+  // sub-bands, but still has to wait on the one it used
+  Time afterFastEnd = fastEnd + MilliSeconds (1);
+  Simulator::Schedule (afterFastEnd, &EarliestAvailableGatewayTest::CheckEarliest, this,
+                       868.1, fastAddress, afterFastEnd);
+  Simulator::Schedule (afterFastEnd, &EarliestAvailableGatewayTest::CheckEarliest, this,
+                       869.525, fastAddress, fastDutyCycleEnd);
+
+  // After its duty cycle, it's available on that sub-band too, while the
+  // slow gateway is still transmitting
+  Time afterFastDutyCycle = fastDutyCycleEnd + MilliSeconds (1);
+  Simulator::Schedule (afterFastDutyCycle, &EarliestAvailableGatewayTest::CheckEarliest,
+                       this, 869.525, fastAddress, afterFastDutyCycle);
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+///////////////////////////////
+// GatewayAvailabilityTest   //
+///////////////////////////////
+
+class GatewayAvailabilityTest : public TestCase
+{
+public:
+  GatewayAvailabilityTest ();
+  virtual ~GatewayAvailabilityTest ();
+
+private:
+  virtual void DoRun (void);
+  void CheckAvailable (Address gwAddress, bool expected);
+  static void LiftDutyCycle (Ptr<GatewayLorawanMac> mac, double frequency);
+
+  Ptr<NetworkStatus> m_status;
+};
+
+// Add some help text to this case to describe what it is intended to test
+GatewayAvailabilityTest::GatewayAvailabilityTest ()
+  : TestCase ("Verify that NetworkStatus sees gateways becoming available"
+              " again, also earlier than their duty cycle required")
+{
+}
+
+// Reminder that the test case should clean up after itself
+GatewayAvailabilityTest::~GatewayAvailabilityTest ()
+{
+}
+
+void
+GatewayAvailabilityTest::CheckAvailable (Address gwAddress, bool expected)
+{
+  std::list<Address> available = m_status->GetAvalibleGatewaysForBroadcast ();
+  bool found = std::find (available.begin (), available.end (), gwAddress) != available.end ();
+  NS_TEST_EXPECT_MSG_EQ (found, expected,
+                         "Wrong availability at " << Simulator::Now ().GetSeconds () << " s");
+}
+
+void
+GatewayAvailabilityTest::LiftDutyCycle (Ptr<GatewayLorawanMac> mac, double frequency)
+{
+  // The sub-bands are shared by the copies of the channel helper
+  mac->GetLogicalLoraChannelHelper ().GetSubBandFromFrequency (frequency)->
+    SetNextTransmissionTime (Simulator::Now ());
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+GatewayAvailabilityTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("GatewayAvailabilityTest");
+
+  m_status = CreateObject<NetworkStatus> ();
+  Ptr<LoraChannel> channel = CreateChannel ();
+  Address waitingAddress;
+  Address liftedAddress;
+  Ptr<GatewayLorawanMac> waitingMac = AddGatewayWithDutyCycle (m_status, channel, 0.1,
+                                                               waitingAddress);
+  Ptr<GatewayLorawanMac> liftedMac = AddGatewayWithDutyCycle (m_status, channel, 0.1,
+                                                              liftedAddress);
+
+  // Both gateways send a downlink on the broadcast frequency
+  Time duration = GetDownlinkDuration (waitingMac, 5, 10);
+  Simulator::Schedule (Seconds (1), &SendDownlink, waitingMac, 5, 869.525, 10);
+  Simulator::Schedule (Seconds (1), &SendDownlink, liftedMac, 5, 869.525, 10);
+
+  // They are busy while transmitting, and then because of the duty cycle
+  Time afterEnd = Seconds (1) + duration + MilliSeconds (1);
+  Time afterDutyCycle = Seconds (1 + 9 * duration.GetSeconds ()) + MilliSeconds (1);
+  Simulator::Schedule (Seconds (1), &GatewayAvailabilityTest::CheckAvailable, this,
+                       waitingAddress, false);
+  Simulator::Schedule (Seconds (1), &GatewayAvailabilityTest::CheckAvailable, this,
+                       liftedAddress, false);
+  Simulator::Schedule (afterEnd, &GatewayAvailabilityTest::CheckAvailable, this,
+                       waitingAddress, false);
+  Simulator::Schedule (afterEnd, &GatewayAvailabilityTest::CheckAvailable, this,
+                       liftedAddress, false);
+
+  // Lifting the duty cycle makes a gateway available at once, although it
+  // was found busy until the end of its duty cycle
+  Simulator::Schedule (afterEnd, &GatewayAvailabilityTest::LiftDutyCycle, liftedMac, 869.525);
+  Simulator::Schedule (afterEnd, &GatewayAvailabilityTest::CheckAvailable, this,
+                       liftedAddress, true);
+  Simulator::Schedule (afterEnd, &GatewayAvailabilityTest::CheckAvailable, this,
+                       waitingAddress, false);
+
+  // The other one is available again after its duty cycle
+  Simulator::Schedule (afterDutyCycle, &GatewayAvailabilityTest::CheckAvailable, this,
+                       waitingAddress, true);
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
 /**************
  * Test Suite *
  **************/
@@ -125,6 +583,8 @@ NetworkStatusTestSuite::NetworkStatusTestSuite ()
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new EndDeviceStatusTest, TestCase::QUICK);
   AddTestCase (new NetworkStatusTest, TestCase::QUICK);
+  AddTestCase (new EarliestAvailableGatewayTest, TestCase::QUICK);
+  AddTestCase (new GatewayAvailabilityTest, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite